@@ -0,0 +1,1055 @@
+﻿#pragma once
+#ifndef ARTREE_H
+#define ARTREE_H
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "KeySearch.h"
+#include "NodePool.h"
+
+//编码后的key:不超过InlineSize个字节时保存在对象内部(栈上),更长时才申请堆内存
+//查找、插入和删除每次都要编码key,整数和常见长度的字符串因此不需要任何堆分配
+class ARTKeyBytes
+{
+public:
+	static const size_t InlineSize = 64;
+	ARTKeyBytes() : ptr(buf), len(0), cap(InlineSize) {}
+	~ARTKeyBytes() { if (ptr != buf) { delete[] ptr; } }
+	//防止拷贝构造
+	ARTKeyBytes(const ARTKeyBytes&) = delete;
+	ARTKeyBytes& operator=(const ARTKeyBytes&) = delete;
+
+	size_t size() const { return len; }
+	const unsigned char* data() const { return ptr; }
+	unsigned char* data() { return ptr; }
+	unsigned char operator[](size_t i) const { return ptr[i]; }
+	void clear() { len = 0; }
+	//保证至少能放下n个字节(已有的内容保留)
+	void reserve(size_t n)
+	{
+		if (n <= cap) { return; }
+		unsigned char* bigger = new unsigned char[n];
+		std::memcpy(bigger, ptr, len);
+		if (ptr != buf) { delete[] ptr; }
+		ptr = bigger;
+		cap = n;
+	}
+	void resize(size_t n)
+	{
+		reserve(n);
+		len = n;
+	}
+	void push_back(unsigned char c)
+	{
+		if (len == cap) { reserve(cap * 2); }
+		ptr[len++] = c;
+	}
+private:
+	unsigned char* ptr;				//当前的存储(buf或堆上的数组)
+	size_t len;						//字节数
+	size_t cap;						//容量
+	unsigned char buf[InlineSize];	//内部存储
+};
+
+//ART的键编码:把key转换成字节序和key的顺序一致的字节串,并且任何一个编码都不是另一个编码的前缀
+//整数:转成大端序,有符号数把最高位取反(所有编码等长,自然没有前缀关系)
+//std::string:字节0转义为0x00 0xFF,末尾加上0x00 0x00作为结束符(0x00 0x00比任何后续字节都小,顺序不变)
+//其他key类型可以特化ARTKeyTraits,提供static void Encode(const K& key, ARTKeyBytes& out)
+template<class K, class = void>
+struct ARTKeyTraits;
+
+template<class K>
+struct ARTKeyTraits<K, typename std::enable_if<std::is_integral<K>::value>::type>
+{
+	static void Encode(const K& key, ARTKeyBytes& out)
+	{
+		using U = typename std::make_unsigned<K>::type;
+		U bits = U(key);
+		if (std::is_signed<K>::value) { bits ^= U(U(1) << (sizeof(K) * 8 - 1)); }
+		out.resize(sizeof(K));
+		unsigned char* data = out.data();
+		for (size_t i = 0; i < sizeof(K); i++) { data[i] = (unsigned char)((bits >> (8 * (sizeof(K) - 1 - i))) & 0xFF); }
+	}
+};
+
+template<>
+struct ARTKeyTraits<std::string>
+{
+	static void Encode(const std::string& key, ARTKeyBytes& out)
+	{
+		if (std::memchr(key.data(), 0, key.size()) == nullptr)
+		{
+			//没有字节0(常见情况):整段复制,再加上结束符
+			out.resize(key.size() + 2);
+			std::memcpy(out.data(), key.data(), key.size());
+			out.data()[key.size()] = 0;
+			out.data()[key.size() + 1] = 0;
+			return;
+		}
+		out.clear();
+		out.reserve(key.size() + 2);
+		for (char c : key)
+		{
+			out.push_back((unsigned char)c);
+			if (c == '\0') { out.push_back(0xFF); }
+		}
+		out.push_back(0);
+		out.push_back(0);
+	}
+};
+
+//ART的叶子:保存完整的key和val,用法和RBTNode相同(node->key、node->val)
+//叶子指针的最低位用来区分叶子和内部节点,因此至少按2字节对齐
+template<class K, class V>
+struct alignas(alignof(K) > alignof(V) ? (alignof(K) > 2 ? alignof(K) : 2) : (alignof(V) > 2 ? alignof(V) : 2)) ARTLeaf
+{
+	K key;		//键
+	V val;		//值
+	//key由第一个参数构造,val由剩余参数原地构造(没有剩余参数时值初始化)
+	template<class KArg, class... VArgs>
+	ARTLeaf(KArg&& key, VArgs&&... val) : key(std::forward<KArg>(key)), val(std::forward<VArgs>(val)...) {}
+};
+
+//ART内部节点的公共部分
+//prefix为路径压缩掉的字节:prefixLen为完整的长度,只保存前MaxPrefix个字节(乐观策略)
+//更长的前缀在查找时直接跳过,由叶子中完整的key验证;插入和删除需要完整前缀时从子树中任意一个叶子的key得到
+struct ARTNode
+{
+	static const uint32_t MaxPrefix = 8;
+	uint8_t type;						//Node4/Node16/Node48/Node256
+	uint16_t count;						//子节点数
+	uint32_t prefixLen;					//压缩路径的长度
+	unsigned char prefix[MaxPrefix];	//压缩路径的前MaxPrefix个字节
+};
+
+//最多4个子节点:keys按字节从小到大排列
+struct ARTNode4 : ARTNode
+{
+	unsigned char keys[4];
+	uintptr_t children[4];
+};
+
+//最多16个子节点:keys有序,查找时用SSE2一次比较16个字节
+struct ARTNode16 : ARTNode
+{
+	unsigned char keys[16];
+	uintptr_t children[16];
+};
+
+//最多48个子节点:index[字节]为子节点的下标+1(0表示没有)
+struct ARTNode48 : ARTNode
+{
+	unsigned char index[256];
+	uintptr_t children[48];
+};
+
+//最多256个子节点:直接按字节寻址
+struct ARTNode256 : ARTNode
+{
+	uintptr_t children[256];
+};
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
+//自适应基数树(Adaptive Radix Tree):按key编码后的字节逐层下降,每层一个字节
+//查找的代价只和key的长度有关,和树的大小无关;内部节点按子节点数在4/16/48/256四种大小之间变化,稀疏的层不浪费空间
+//只有一个子节点的路径被压缩进节点的prefix,叶子直接挂在第一个能区分它的位置上(延迟展开)
+//接口和RBT相同(Insert/Delete/Search/GetNode/operator[]/inOrder/range...),GetNode等返回ARTLeaf*
+//key的顺序由ARTKeyTraits的编码决定,整数和std::string的编码顺序和std::less一致;K需要支持==和<
+//Alloc为分配器(默认为NodePool内存池),会被rebind为叶子和各种内部节点的分配器
+template<class K, class V, class Traits = ARTKeyTraits<K>, class Alloc = NodePool<std::pair<const K, V>>>
+class ARTree
+{
+	friend struct TreeTestAccess;
+private:
+	using Leaf = ARTLeaf<K, V>;
+	template<class T>
+	using AllocOf = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+	enum NodeType : uint8_t { Type4 = 1, Type16, Type48, Type256 };
+
+	uintptr_t root;		//根(叶子指针|1、内部节点指针,空树为0)
+	int NodeSize;		//键值数
+	AllocOf<Leaf> leafAlloc;
+	AllocOf<ARTNode4> alloc4;
+	AllocOf<ARTNode16> alloc16;
+	AllocOf<ARTNode48> alloc48;
+	AllocOf<ARTNode256> alloc256;
+
+	//子节点引用的编码
+	static bool IsLeaf(uintptr_t ref) { return (ref & 1) != 0; }
+	static Leaf* LeafOf(uintptr_t ref) { return reinterpret_cast<Leaf*>(ref & ~uintptr_t(1)); }
+	static ARTNode* NodeOf(uintptr_t ref) { return reinterpret_cast<ARTNode*>(ref); }
+	static uintptr_t RefOf(Leaf* leaf) { return reinterpret_cast<uintptr_t>(leaf) | 1; }
+	static uintptr_t RefOf(ARTNode* node) { return reinterpret_cast<uintptr_t>(node); }
+
+	//申请一个值初始化(全部清零)的节点
+	template<class T>
+	static T* NewNode(AllocOf<T>& alloc, uint8_t type);
+	//释放节点
+	template<class T>
+	static void FreeNode(AllocOf<T>& alloc, ARTNode* node);
+	void FreeInner(ARTNode* node);
+	//申请并构造叶子
+	template<class... Args>
+	Leaf* NewLeaf(Args&&... args);
+	void FreeLeaf(Leaf* leaf);
+	//释放以ref为根的子树
+	void FreeTree(uintptr_t ref);
+	//只析构以ref为根的子树中的叶子,不归还内存
+	void DestroyLeaves(uintptr_t ref);
+
+	//node中字节byte对应的子节点引用的位置(没有时返回nullptr)
+	static uintptr_t* FindChild(ARTNode* node, unsigned char byte);
+	//子树中最小、最大的叶子
+	static Leaf* MinLeaf(uintptr_t ref);
+	static Leaf* MaxLeaf(uintptr_t ref);
+	//node的前缀和key[depth...]相同的字节数(需要时用子树中的叶子得到完整前缀)
+	static uint32_t PrefixMatch(ARTNode* node, const ARTKeyBytes& key, size_t depth);
+	//把node复制到更大(或更小)的节点类型时复制头部
+	static void CopyHeader(ARTNode* to, const ARTNode* from);
+	//ref指向的节点已满时换成更大的节点
+	void Grow(uintptr_t& ref);
+	//向ref指向的节点加入子节点(调用者保证有空位)
+	static void AddChild(ARTNode* node, unsigned char byte, uintptr_t child);
+	//从ref指向的节点中删除字节byte对应的子节点,需要时换成更小的节点或者合并到唯一的子节点
+	void RemoveChild(uintptr_t& ref, unsigned char byte);
+
+	//插入的公共入口:key不存在时调用make()得到新叶子(返回key对应的叶子和是否插入成功)
+	template<class Make>
+	std::pair<Leaf*, bool> InsertWith(const K& key, Make make);
+	//插入的递归部分,ref为当前子树在父节点中的位置
+	template<class Make>
+	std::pair<Leaf*, bool> InsertAt(uintptr_t& ref, const K& key, const ARTKeyBytes& bytes, size_t depth, Make& make);
+	//删除的递归部分
+	bool DeleteAt(uintptr_t& ref, const K& key, const ARTKeyBytes& bytes, size_t depth);
+	//中序遍历的递归部分
+	template<class Function>
+	static void InOrderHelp(uintptr_t ref, Function& function);
+	//按字节从小到大对node的每个子节点调用f(byte, ref),f返回false时停止(返回false)
+	template<class F>
+	static bool ForEachChild(ARTNode* node, F&& f);
+	//[lo, hi)范围访问的递归部分,tight表示当前路径和lo的编码相同(子树中可能有<lo的key),返回false表示已经到达hi
+	template<class Visitor>
+	static bool RangeHelp(uintptr_t ref, const K& lo, const ARTKeyBytes& loBytes, size_t depth, bool tight, const K& hi, Visitor& visitor);
+public:
+	//构造函数
+	ARTree() : root(0), NodeSize(0) {}
+	explicit ARTree(const Alloc& allocator)
+		: root(0), NodeSize(0), leafAlloc(allocator), alloc4(allocator), alloc16(allocator), alloc48(allocator), alloc256(allocator) {}
+	//析构函数
+	~ARTree() { Clear(); }
+	//防止拷贝构造
+	ARTree(const ARTree&) = delete;
+	ARTree& operator=(const ARTree&) = delete;
+
+	//插入键值(key已存在时覆盖val)
+	void Insert(const K& key, const V& val) { insert_or_assign(key, val); }
+	//key不存在时才用args原地构造val(key已存在时args不会被移动)
+	template<class... Args>
+	std::pair<Leaf*, bool> try_emplace(const K& key, Args&&... args);
+	//key不存在时插入,存在时把val赋给已有的叶子
+	template<class M>
+	std::pair<Leaf*, bool> insert_or_assign(const K& key, M&& val);
+	//删除key
+	void Delete(const K& key);
+	//判断key是否存在
+	bool Search(const K& key)const { return GetNode(key) != nullptr; }
+	//得到key所在的叶子(不存在时返回nullptr)
+	Leaf* GetNode(const K& key)const;
+	//最小、最大的叶子
+	Leaf* GetMinNode()const { return MinLeaf(root); }
+	Leaf* GetMaxNode()const { return MaxLeaf(root); }
+	//清空(独占内存池时整块释放slab,不需要逐个释放节点)
+	void Clear();
+	//键值数
+	int getNodeSize()const { return NodeSize; }
+	//中序遍历:按key从小到大对每个叶子调用function(ARTLeaf*)
+	template<class Function>
+	void inOrder(Function&& function)const { InOrderHelp(root, function); }
+	//按key从小到大对[lo, hi)中的每个叶子调用visitor(ARTLeaf*),跳过整个小于lo的子树,遇到>=hi的key就停止
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor)const;
+
+	//重载[]操作符(key不存在时插入值初始化的val)
+	V& operator[](const K& key) { return try_emplace(key).first->val; }
+};
+
+namespace ARTDetail
+{
+	//mask中最低的置位的位置(mask不为0)
+	inline unsigned LowestBit(unsigned mask)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return unsigned(__builtin_ctz(mask));
+#else
+		unsigned bit = 0;
+		for (; (mask & 1) == 0; mask >>= 1) { bit++; }
+		return bit;
+#endif
+	}
+}
+
+//申请一个值初始化的节点
+template<class K, class V, class Traits, class Alloc>
+template<class T>
+T* ARTree<K, V, Traits, Alloc>::NewNode(AllocOf<T>& alloc, uint8_t type)
+{
+	T* node = std::allocator_traits<AllocOf<T>>::allocate(alloc, 1);
+	std::allocator_traits<AllocOf<T>>::construct(alloc, node);
+	node->type = type;
+	return node;
+}
+
+//释放节点
+template<class K, class V, class Traits, class Alloc>
+template<class T>
+void ARTree<K, V, Traits, Alloc>::FreeNode(AllocOf<T>& alloc, ARTNode* node)
+{
+	T* typed = static_cast<T*>(node);
+	std::allocator_traits<AllocOf<T>>::destroy(alloc, typed);
+	std::allocator_traits<AllocOf<T>>::deallocate(alloc, typed, 1);
+}
+
+//按类型释放内部节点
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::FreeInner(ARTNode* node)
+{
+	switch (node->type)
+	{
+	case Type4: FreeNode<ARTNode4>(alloc4, node); break;
+	case Type16: FreeNode<ARTNode16>(alloc16, node); break;
+	case Type48: FreeNode<ARTNode48>(alloc48, node); break;
+	default: FreeNode<ARTNode256>(alloc256, node); break;
+	}
+}
+
+//申请并构造叶子
+template<class K, class V, class Traits, class Alloc>
+template<class... Args>
+typename ARTree<K, V, Traits, Alloc>::Leaf* ARTree<K, V, Traits, Alloc>::NewLeaf(Args&&... args)
+{
+	Leaf* leaf = std::allocator_traits<AllocOf<Leaf>>::allocate(leafAlloc, 1);
+	try
+	{
+		std::allocator_traits<AllocOf<Leaf>>::construct(leafAlloc, leaf, std::forward<Args>(args)...);
+	}
+	catch (...)
+	{
+		std::allocator_traits<AllocOf<Leaf>>::deallocate(leafAlloc, leaf, 1);
+		throw;
+	}
+	return leaf;
+}
+
+//析构并释放叶子
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::FreeLeaf(Leaf* leaf)
+{
+	std::allocator_traits<AllocOf<Leaf>>::destroy(leafAlloc, leaf);
+	std::allocator_traits<AllocOf<Leaf>>::deallocate(leafAlloc, leaf, 1);
+}
+
+//释放以ref为根的子树
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::FreeTree(uintptr_t ref)
+{
+	if (ref == 0) { return; }
+	if (IsLeaf(ref))
+	{
+		FreeLeaf(LeafOf(ref));
+		return;
+	}
+	ARTNode* node = NodeOf(ref);
+	ForEachChild(node, [this](unsigned char, uintptr_t child) { FreeTree(child); return true; });
+	FreeInner(node);
+}
+
+//只析构以ref为根的子树中的叶子(内部节点是平凡类型,不需要析构)
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::DestroyLeaves(uintptr_t ref)
+{
+	if (ref == 0) { return; }
+	if (IsLeaf(ref))
+	{
+		std::allocator_traits<AllocOf<Leaf>>::destroy(leafAlloc, LeafOf(ref));
+		return;
+	}
+	ForEachChild(NodeOf(ref), [this](unsigned char, uintptr_t child) { DestroyLeaves(child); return true; });
+}
+
+//清空
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::Clear()
+{
+	if (CanReleaseAll(leafAlloc) && CanReleaseAll(alloc4) && CanReleaseAll(alloc16) && CanReleaseAll(alloc48) && CanReleaseAll(alloc256))
+	{
+		//内存池只属于这棵树:平凡析构的叶子连遍历都不需要,直接整块归还slab
+		if (!std::is_trivially_destructible<Leaf>::value) { DestroyLeaves(root); }
+		ReleaseAll(leafAlloc);
+		ReleaseAll(alloc4);
+		ReleaseAll(alloc16);
+		ReleaseAll(alloc48);
+		ReleaseAll(alloc256);
+	}
+	else
+	{
+		FreeTree(root);
+	}
+	root = 0;
+	NodeSize = 0;
+}
+
+//node中字节byte对应的子节点
+template<class K, class V, class Traits, class Alloc>
+uintptr_t* ARTree<K, V, Traits, Alloc>::FindChild(ARTNode* node, unsigned char byte)
+{
+	switch (node->type)
+	{
+	case Type4:
+	{
+		ARTNode4* n = static_cast<ARTNode4*>(node);
+		for (int i = 0; i < n->count; i++)
+		{
+			if (n->keys[i] == byte) { return &n->children[i]; }
+		}
+		return nullptr;
+	}
+	case Type16:
+	{
+		ARTNode16* n = static_cast<ARTNode16*>(node);
+#ifdef TREE_USE_SIMD
+		//16个字节一次比较,只保留前count位
+		__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(char(byte)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(n->keys)));
+		unsigned mask = unsigned(_mm_movemask_epi8(cmp)) & ((1u << n->count) - 1);
+		return mask != 0 ? &n->children[ARTDetail::LowestBit(mask)] : nullptr;
+#else
+		for (int i = 0; i < n->count; i++)
+		{
+			if (n->keys[i] == byte) { return &n->children[i]; }
+		}
+		return nullptr;
+#endif
+	}
+	case Type48:
+	{
+		ARTNode48* n = static_cast<ARTNode48*>(node);
+		return n->index[byte] != 0 ? &n->children[n->index[byte] - 1] : nullptr;
+	}
+	default:
+	{
+		ARTNode256* n = static_cast<ARTNode256*>(node);
+		return n->children[byte] != 0 ? &n->children[byte] : nullptr;
+	}
+	}
+}
+
+//按字节从小到大对node的每个子节点调用f(byte, ref)
+template<class K, class V, class Traits, class Alloc>
+template<class F>
+bool ARTree<K, V, Traits, Alloc>::ForEachChild(ARTNode* node, F&& f)
+{
+	switch (node->type)
+	{
+	case Type4:
+	{
+		ARTNode4* n = static_cast<ARTNode4*>(node);
+		for (int i = 0; i < n->count; i++)
+		{
+			if (!f(n->keys[i], n->children[i])) { return false; }
+		}
+		return true;
+	}
+	case Type16:
+	{
+		ARTNode16* n = static_cast<ARTNode16*>(node);
+		for (int i = 0; i < n->count; i++)
+		{
+			if (!f(n->keys[i], n->children[i])) { return false; }
+		}
+		return true;
+	}
+	case Type48:
+	{
+		ARTNode48* n = static_cast<ARTNode48*>(node);
+		for (int b = 0; b < 256; b++)
+		{
+			if (n->index[b] != 0 && !f((unsigned char)b, n->children[n->index[b] - 1])) { return false; }
+		}
+		return true;
+	}
+	default:
+	{
+		ARTNode256* n = static_cast<ARTNode256*>(node);
+		for (int b = 0; b < 256; b++)
+		{
+			if (n->children[b] != 0 && !f((unsigned char)b, n->children[b])) { return false; }
+		}
+		return true;
+	}
+	}
+}
+
+//子树中最小的叶子
+template<class K, class V, class Traits, class Alloc>
+typename ARTree<K, V, Traits, Alloc>::Leaf* ARTree<K, V, Traits, Alloc>::MinLeaf(uintptr_t ref)
+{
+	if (ref == 0) { return nullptr; }
+	while (!IsLeaf(ref))
+	{
+		ARTNode* node = NodeOf(ref);
+		switch (node->type)
+		{
+		case Type4: ref = static_cast<ARTNode4*>(node)->children[0]; break;
+		case Type16: ref = static_cast<ARTNode16*>(node)->children[0]; break;
+		case Type48:
+		{
+			ARTNode48* n = static_cast<ARTNode48*>(node);
+			int b = 0;
+			while (n->index[b] == 0) { b++; }
+			ref = n->children[n->index[b] - 1];
+			break;
+		}
+		default:
+		{
+			ARTNode256* n = static_cast<ARTNode256*>(node);
+			int b = 0;
+			while (n->children[b] == 0) { b++; }
+			ref = n->children[b];
+			break;
+		}
+		}
+	}
+	return LeafOf(ref);
+}
+
+//子树中最大的叶子
+template<class K, class V, class Traits, class Alloc>
+typename ARTree<K, V, Traits, Alloc>::Leaf* ARTree<K, V, Traits, Alloc>::MaxLeaf(uintptr_t ref)
+{
+	if (ref == 0) { return nullptr; }
+	while (!IsLeaf(ref))
+	{
+		ARTNode* node = NodeOf(ref);
+		switch (node->type)
+		{
+		case Type4: ref = static_cast<ARTNode4*>(node)->children[node->count - 1]; break;
+		case Type16: ref = static_cast<ARTNode16*>(node)->children[node->count - 1]; break;
+		case Type48:
+		{
+			ARTNode48* n = static_cast<ARTNode48*>(node);
+			int b = 255;
+			while (n->index[b] == 0) { b--; }
+			ref = n->children[n->index[b] - 1];
+			break;
+		}
+		default:
+		{
+			ARTNode256* n = static_cast<ARTNode256*>(node);
+			int b = 255;
+			while (n->children[b] == 0) { b--; }
+			ref = n->children[b];
+			break;
+		}
+		}
+	}
+	return LeafOf(ref);
+}
+
+//node的前缀和key[depth...]相同的字节数
+template<class K, class V, class Traits, class Alloc>
+uint32_t ARTree<K, V, Traits, Alloc>::PrefixMatch(ARTNode* node, const ARTKeyBytes& key, size_t depth)
+{
+	size_t limit = key.size() - depth < node->prefixLen ? key.size() - depth : node->prefixLen;
+	size_t stored = limit < ARTNode::MaxPrefix ? limit : ARTNode::MaxPrefix;
+	size_t i = 0;
+	for (; i < stored; i++)
+	{
+		if (node->prefix[i] != key[depth + i]) { return uint32_t(i); }
+	}
+	if (i < limit)
+	{
+		//没有保存的部分:子树中所有key在这一段都相同,用最小的叶子的key比较
+		ARTKeyBytes full;
+		Traits::Encode(MinLeaf(RefOf(node))->key, full);
+		for (; i < limit; i++)
+		{
+			if (full[depth + i] != key[depth + i]) { return uint32_t(i); }
+		}
+	}
+	return uint32_t(i);
+}
+
+//复制头部
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::CopyHeader(ARTNode* to, const ARTNode* from)
+{
+	to->count = from->count;
+	to->prefixLen = from->prefixLen;
+	std::memcpy(to->prefix, from->prefix, ARTNode::MaxPrefix);
+}
+
+//已满的节点换成更大的节点
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::Grow(uintptr_t& ref)
+{
+	ARTNode* node = NodeOf(ref);
+	switch (node->type)
+	{
+	case Type4:
+	{
+		if (node->count < 4) { return; }
+		ARTNode4* n = static_cast<ARTNode4*>(node);
+		ARTNode16* bigger = NewNode<ARTNode16>(alloc16, Type16);
+		CopyHeader(bigger, n);
+		std::memcpy(bigger->keys, n->keys, 4);
+		std::memcpy(bigger->children, n->children, 4 * sizeof(uintptr_t));
+		ref = RefOf(bigger);
+		FreeNode<ARTNode4>(alloc4, n);
+		return;
+	}
+	case Type16:
+	{
+		if (node->count < 16) { return; }
+		ARTNode16* n = static_cast<ARTNode16*>(node);
+		ARTNode48* bigger = NewNode<ARTNode48>(alloc48, Type48);
+		CopyHeader(bigger, n);
+		for (int i = 0; i < 16; i++)
+		{
+			bigger->index[n->keys[i]] = (unsigned char)(i + 1);
+			bigger->children[i] = n->children[i];
+		}
+		ref = RefOf(bigger);
+		FreeNode<ARTNode16>(alloc16, n);
+		return;
+	}
+	case Type48:
+	{
+		if (node->count < 48) { return; }
+		ARTNode48* n = static_cast<ARTNode48*>(node);
+		ARTNode256* bigger = NewNode<ARTNode256>(alloc256, Type256);
+		CopyHeader(bigger, n);
+		for (int b = 0; b < 256; b++)
+		{
+			if (n->index[b] != 0) { bigger->children[b] = n->children[n->index[b] - 1]; }
+		}
+		ref = RefOf(bigger);
+		FreeNode<ARTNode48>(alloc48, n);
+		return;
+	}
+	default:
+		return;
+	}
+}
+
+//加入子节点
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::AddChild(ARTNode* node, unsigned char byte, uintptr_t child)
+{
+	switch (node->type)
+	{
+	case Type4:
+	case Type16:
+	{
+		//Node4和Node16的布局只有数组长度不同,按字节有序插入
+		unsigned char* keys = node->type == Type4 ? static_cast<ARTNode4*>(node)->keys : static_cast<ARTNode16*>(node)->keys;
+		uintptr_t* children = node->type == Type4 ? static_cast<ARTNode4*>(node)->children : static_cast<ARTNode16*>(node)->children;
+		int pos = 0;
+		while (pos < node->count && keys[pos] < byte) { pos++; }
+		std::memmove(keys + pos + 1, keys + pos, node->count - pos);
+		std::memmove(children + pos + 1, children + pos, (node->count - pos) * sizeof(uintptr_t));
+		keys[pos] = byte;
+		children[pos] = child;
+		break;
+	}
+	case Type48:
+	{
+		ARTNode48* n = static_cast<ARTNode48*>(node);
+		int slot = 0;
+		while (n->children[slot] != 0) { slot++; }
+		n->children[slot] = child;
+		n->index[byte] = (unsigned char)(slot + 1);
+		break;
+	}
+	default:
+		static_cast<ARTNode256*>(node)->children[byte] = child;
+		break;
+	}
+	node->count++;
+}
+
+//删除子节点
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::RemoveChild(uintptr_t& ref, unsigned char byte)
+{
+	ARTNode* node = NodeOf(ref);
+	switch (node->type)
+	{
+	case Type4:
+	case Type16:
+	{
+		unsigned char* keys = node->type == Type4 ? static_cast<ARTNode4*>(node)->keys : static_cast<ARTNode16*>(node)->keys;
+		uintptr_t* children = node->type == Type4 ? static_cast<ARTNode4*>(node)->children : static_cast<ARTNode16*>(node)->children;
+		int pos = 0;
+		while (keys[pos] != byte) { pos++; }
+		std::memmove(keys + pos, keys + pos + 1, node->count - pos - 1);
+		std::memmove(children + pos, children + pos + 1, (node->count - pos - 1) * sizeof(uintptr_t));
+		break;
+	}
+	case Type48:
+	{
+		ARTNode48* n = static_cast<ARTNode48*>(node);
+		n->children[n->index[byte] - 1] = 0;
+		n->index[byte] = 0;
+		break;
+	}
+	default:
+		static_cast<ARTNode256*>(node)->children[byte] = 0;
+		break;
+	}
+	node->count--;
+
+	if (node->type == Type4 && node->count == 1)
+	{
+		//只剩一个子节点:把这个节点的前缀和分支字节接到子节点的前缀前面,节点本身去掉
+		ARTNode4* n = static_cast<ARTNode4*>(node);
+		uintptr_t child = n->children[0];
+		if (!IsLeaf(child))
+		{
+			ARTNode* c = NodeOf(child);
+			unsigned char merged[ARTNode::MaxPrefix];
+			uint32_t len = 0;
+			//保存的前缀总是完整前缀的前MaxPrefix个字节,依次拼接:node的前缀、分支字节、子节点的前缀
+			for (uint32_t i = 0; i < n->prefixLen && len < ARTNode::MaxPrefix; i++) { merged[len++] = n->prefix[i]; }
+			if (len < ARTNode::MaxPrefix) { merged[len++] = n->keys[0]; }
+			for (uint32_t i = 0; i < c->prefixLen && len < ARTNode::MaxPrefix; i++) { merged[len++] = c->prefix[i]; }
+			std::memcpy(c->prefix, merged, len);
+			c->prefixLen += n->prefixLen + 1;
+		}
+		ref = child;
+		FreeNode<ARTNode4>(alloc4, n);
+		return;
+	}
+	//子节点数降到下一种节点能放下时换成更小的节点(留出余量,避免在边界上反复增删时来回转换)
+	//申请失败时保留原来较大的节点,树仍然有效
+	try
+	{
+		if (node->type == Type16 && node->count <= 3)
+		{
+			ARTNode16* n = static_cast<ARTNode16*>(node);
+			ARTNode4* smaller = NewNode<ARTNode4>(alloc4, Type4);
+			CopyHeader(smaller, n);
+			std::memcpy(smaller->keys, n->keys, n->count);
+			std::memcpy(smaller->children, n->children, n->count * sizeof(uintptr_t));
+			ref = RefOf(smaller);
+			FreeNode<ARTNode16>(alloc16, n);
+		}
+		else if (node->type == Type48 && node->count <= 12)
+		{
+			ARTNode48* n = static_cast<ARTNode48*>(node);
+			ARTNode16* smaller = NewNode<ARTNode16>(alloc16, Type16);
+			CopyHeader(smaller, n);
+			int count = 0;
+			for (int b = 0; b < 256; b++)
+			{
+				if (n->index[b] != 0)
+				{
+					smaller->keys[count] = (unsigned char)b;
+					smaller->children[count++] = n->children[n->index[b] - 1];
+				}
+			}
+			ref = RefOf(smaller);
+			FreeNode<ARTNode48>(alloc48, n);
+		}
+		else if (node->type == Type256 && node->count <= 37)
+		{
+			ARTNode256* n = static_cast<ARTNode256*>(node);
+			ARTNode48* smaller = NewNode<ARTNode48>(alloc48, Type48);
+			CopyHeader(smaller, n);
+			int count = 0;
+			for (int b = 0; b < 256; b++)
+			{
+				if (n->children[b] != 0)
+				{
+					smaller->children[count] = n->children[b];
+					smaller->index[b] = (unsigned char)(++count);
+				}
+			}
+			ref = RefOf(smaller);
+			FreeNode<ARTNode256>(alloc256, n);
+		}
+	}
+	catch (...)
+	{
+	}
+}
+
+//插入的公共入口
+template<class K, class V, class Traits, class Alloc>
+template<class Make>
+std::pair<typename ARTree<K, V, Traits, Alloc>::Leaf*, bool> ARTree<K, V, Traits, Alloc>::InsertWith(const K& key, Make make)
+{
+	ARTKeyBytes bytes;
+	Traits::Encode(key, bytes);
+	std::pair<Leaf*, bool> result = InsertAt(root, key, bytes, 0, make);
+	if (result.second) { NodeSize++; }
+	return result;
+}
+
+//插入的递归部分:所有节点都在make()之前申请好,make()抛出异常时树不变
+template<class K, class V, class Traits, class Alloc>
+template<class Make>
+std::pair<typename ARTree<K, V, Traits, Alloc>::Leaf*, bool> ARTree<K, V, Traits, Alloc>::InsertAt(uintptr_t& ref, const K& key, const ARTKeyBytes& bytes, size_t depth, Make& make)
+{
+	if (ref == 0)
+	{
+		Leaf* leaf = make();
+		ref = RefOf(leaf);
+		return std::make_pair(leaf, true);
+	}
+	if (IsLeaf(ref))
+	{
+		Leaf* old = LeafOf(ref);
+		if (old->key == key) { return std::make_pair(old, false); }
+		//延迟展开:两个key从depth开始的公共部分成为新Node4的前缀,在第一个不同的字节处分开
+		ARTKeyBytes oldBytes;
+		Traits::Encode(old->key, oldBytes);
+		size_t i = depth;
+		while (i < bytes.size() && i < oldBytes.size() && bytes[i] == oldBytes[i]) { i++; }
+		ARTNode4* node = NewNode<ARTNode4>(alloc4, Type4);
+		Leaf* leaf;
+		try
+		{
+			leaf = make();
+		}
+		catch (...)
+		{
+			FreeNode<ARTNode4>(alloc4, node);
+			throw;
+		}
+		node->prefixLen = uint32_t(i - depth);
+		std::memcpy(node->prefix, bytes.data() + depth, node->prefixLen < ARTNode::MaxPrefix ? node->prefixLen : ARTNode::MaxPrefix);
+		AddChild(node, (unsigned char)bytes[i], RefOf(leaf));
+		AddChild(node, (unsigned char)oldBytes[i], ref);
+		ref = RefOf(node);
+		return std::make_pair(leaf, true);
+	}
+	ARTNode* node = NodeOf(ref);
+	if (node->prefixLen != 0)
+	{
+		uint32_t match = PrefixMatch(node, bytes, depth);
+		if (match < node->prefixLen)
+		{
+			//前缀在match处分叉:新的Node4保存前match个字节,原节点保留分叉字节之后的部分
+			ARTKeyBytes full;
+			if (node->prefixLen > ARTNode::MaxPrefix) { Traits::Encode(MinLeaf(ref)->key, full); }
+			ARTNode4* parent = NewNode<ARTNode4>(alloc4, Type4);
+			Leaf* leaf;
+			try
+			{
+				leaf = make();
+			}
+			catch (...)
+			{
+				FreeNode<ARTNode4>(alloc4, parent);
+				throw;
+			}
+			parent->prefixLen = match;
+			std::memcpy(parent->prefix, node->prefix, match < ARTNode::MaxPrefix ? match : ARTNode::MaxPrefix);
+			unsigned char branch;
+			uint32_t rest = node->prefixLen - match - 1;
+			uint32_t restStored = rest < ARTNode::MaxPrefix ? rest : ARTNode::MaxPrefix;
+			if (node->prefixLen <= ARTNode::MaxPrefix)
+			{
+				branch = node->prefix[match];
+				std::memmove(node->prefix, node->prefix + match + 1, restStored);
+			}
+			else
+			{
+				branch = (unsigned char)full[depth + match];
+				std::memcpy(node->prefix, full.data() + depth + match + 1, restStored);
+			}
+			node->prefixLen = rest;
+			AddChild(parent, branch, ref);
+			AddChild(parent, (unsigned char)bytes[depth + match], RefOf(leaf));
+			ref = RefOf(parent);
+			return std::make_pair(leaf, true);
+		}
+		depth += node->prefixLen;
+	}
+	uintptr_t* child = FindChild(node, (unsigned char)bytes[depth]);
+	if (child != nullptr) { return InsertAt(*child, key, bytes, depth + 1, make); }
+	//没有这个字节的子节点:先保证有空位,再构造叶子
+	Grow(ref);
+	Leaf* leaf = make();
+	AddChild(NodeOf(ref), (unsigned char)bytes[depth], RefOf(leaf));
+	return std::make_pair(leaf, true);
+}
+
+//key不存在时才用args原地构造val
+template<class K, class V, class Traits, class Alloc>
+template<class... Args>
+std::pair<typename ARTree<K, V, Traits, Alloc>::Leaf*, bool> ARTree<K, V, Traits, Alloc>::try_emplace(const K& key, Args&&... args)
+{
+	return InsertWith(key, [&]() { return NewLeaf(key, std::forward<Args>(args)...); });
+}
+
+//key不存在时插入,存在时把val赋给已有的叶子
+template<class K, class V, class Traits, class Alloc>
+template<class M>
+std::pair<typename ARTree<K, V, Traits, Alloc>::Leaf*, bool> ARTree<K, V, Traits, Alloc>::insert_or_assign(const K& key, M&& val)
+{
+	std::pair<Leaf*, bool> result = InsertWith(key, [&]() { return NewLeaf(key, std::forward<M>(val)); });
+	if (!result.second) { result.first->val = std::forward<M>(val); }
+	return result;
+}
+
+//删除的递归部分
+template<class K, class V, class Traits, class Alloc>
+bool ARTree<K, V, Traits, Alloc>::DeleteAt(uintptr_t& ref, const K& key, const ARTKeyBytes& bytes, size_t depth)
+{
+	ARTNode* node = NodeOf(ref);
+	if (node->prefixLen != 0)
+	{
+		if (PrefixMatch(node, bytes, depth) < node->prefixLen) { return false; }
+		depth += node->prefixLen;
+	}
+	if (depth >= bytes.size()) { return false; }
+	unsigned char byte = (unsigned char)bytes[depth];
+	uintptr_t* child = FindChild(node, byte);
+	if (child == nullptr) { return false; }
+	if (!IsLeaf(*child)) { return DeleteAt(*child, key, bytes, depth + 1); }
+	Leaf* leaf = LeafOf(*child);
+	if (!(leaf->key == key)) { return false; }
+	FreeLeaf(leaf);
+	RemoveChild(ref, byte);
+	return true;
+}
+
+//删除key
+template<class K, class V, class Traits, class Alloc>
+void ARTree<K, V, Traits, Alloc>::Delete(const K& key)
+{
+	if (root == 0) { return; }
+	if (IsLeaf(root))
+	{
+		if (LeafOf(root)->key == key)
+		{
+			FreeLeaf(LeafOf(root));
+			root = 0;
+			NodeSize--;
+		}
+		return;
+	}
+	ARTKeyBytes bytes;
+	Traits::Encode(key, bytes);
+	if (DeleteAt(root, key, bytes, 0)) { NodeSize--; }
+}
+
+//得到key所在的叶子:只比较保存的前缀字节(乐观),最后由叶子中完整的key确认
+template<class K, class V, class Traits, class Alloc>
+typename ARTree<K, V, Traits, Alloc>::Leaf* ARTree<K, V, Traits, Alloc>::GetNode(const K& key)const
+{
+	ARTKeyBytes bytes;
+	Traits::Encode(key, bytes);
+	uintptr_t ref = root;
+	size_t depth = 0;
+	while (ref != 0)
+	{
+		if (IsLeaf(ref))
+		{
+			Leaf* leaf = LeafOf(ref);
+			return leaf->key == key ? leaf : nullptr;
+		}
+		ARTNode* node = NodeOf(ref);
+		if (node->prefixLen != 0)
+		{
+			uint32_t stored = node->prefixLen < ARTNode::MaxPrefix ? node->prefixLen : ARTNode::MaxPrefix;
+			if (depth + stored > bytes.size() || std::memcmp(node->prefix, bytes.data() + depth, stored) != 0) { return nullptr; }
+			depth += node->prefixLen;
+		}
+		if (depth >= bytes.size()) { return nullptr; }
+		uintptr_t* child = FindChild(node, (unsigned char)bytes[depth]);
+		if (child == nullptr) { return nullptr; }
+		ref = *child;
+		depth++;
+	}
+	return nullptr;
+}
+
+//中序遍历的递归部分(递归深度不超过key编码的长度)
+template<class K, class V, class Traits, class Alloc>
+template<class Function>
+void ARTree<K, V, Traits, Alloc>::InOrderHelp(uintptr_t ref, Function& function)
+{
+	if (ref == 0) { return; }
+	if (IsLeaf(ref))
+	{
+		function(LeafOf(ref));
+		return;
+	}
+	ForEachChild(NodeOf(ref), [&function](unsigned char, uintptr_t child) { InOrderHelp(child, function); return true; });
+}
+
+//[lo, hi)范围访问的递归部分
+template<class K, class V, class Traits, class Alloc>
+template<class Visitor>
+bool ARTree<K, V, Traits, Alloc>::RangeHelp(uintptr_t ref, const K& lo, const ARTKeyBytes& loBytes, size_t depth, bool tight, const K& hi, Visitor& visitor)
+{
+	if (IsLeaf(ref))
+	{
+		Leaf* leaf = LeafOf(ref);
+		if (tight && leaf->key < lo) { return true; }
+		if (!(leaf->key < hi)) { return false; }
+		visitor(leaf);
+		return true;
+	}
+	ARTNode* node = NodeOf(ref);
+	if (tight && node->prefixLen != 0)
+	{
+		//和lo的编码比较前缀:前缀更小时整个子树都<lo,更大时整个子树都>lo
+		ARTKeyBytes full;
+		const unsigned char* prefix = node->prefix;
+		if (node->prefixLen > ARTNode::MaxPrefix)
+		{
+			Traits::Encode(MinLeaf(ref)->key, full);
+			prefix = full.data() + depth;
+		}
+		for (uint32_t i = 0; i < node->prefixLen; i++)
+		{
+			if (depth + i >= loBytes.size()) { tight = false; break; }
+			unsigned char b = (unsigned char)loBytes[depth + i];
+			if (prefix[i] < b) { return true; }
+			if (prefix[i] > b) { tight = false; break; }
+		}
+	}
+	depth += node->prefixLen;
+	return ForEachChild(node, [&](unsigned char byte, uintptr_t child)
+	{
+		bool childTight = false;
+		if (tight && depth < loBytes.size())
+		{
+			unsigned char b = (unsigned char)loBytes[depth];
+			if (byte < b) { return true; }
+			childTight = byte == b;
+		}
+		return RangeHelp(child, lo, loBytes, depth + 1, childTight, hi, visitor);
+	});
+}
+
+//按key从小到大访问[lo, hi)中的叶子
+template<class K, class V, class Traits, class Alloc>
+template<class Visitor>
+void ARTree<K, V, Traits, Alloc>::range(const K& lo, const K& hi, Visitor&& visitor)const
+{
+	if (root == 0 || !(lo < hi)) { return; }
+	ARTKeyBytes loBytes;
+	Traits::Encode(lo, loBytes);
+	RangeHelp(root, lo, loBytes, 0, true, hi, visitor);
+}
+
+#endif // !ARTREE_H
@@ -1,170 +1,495 @@
 ﻿#pragma once
 #ifndef AVLTREE_H
 #define AVLTREE_H
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Augment.h"
+#include "BulkBuild.h"
+#include "FrozenTree.h"
+#include "KeyCompare.h"
+#include "NodePool.h"
+#include "TaskPool.h"
 using std::max;
 using std::swap;
 
+//统计节点写入(setLeft/setRight/setBalance)和旋转次数的钩子,默认什么也不做
+//基准程序可以在包含本文件之前定义AVL_COUNT(counter)(见bench/avl_rotations_writes.cpp)
+#ifndef AVL_COUNT
+#define AVL_COUNT(counter)
+#endif
+
 //AVL树的节点
-template<class K, class V>
-struct AVLNode
-{
-	K key;					//键
-	V val;					//值
-	int height;				//AVL树使用
-	AVLNode<K, V>* left;
-	AVLNode<K, V>* right;
+//平衡因子(右子树高度-左子树高度,只可能为-1,0,1)压缩在左子节点指针的最低两位中
+//(节点至少按4字节对齐,指针的最低两位一定为0),因此节点只比键值多出两个指针
+//Augment为附加信息策略(见Augment.h),默认的NoAugment是空基类,不占空间
+template<class K, class V, class Augment = NoAugment>
+struct AVLNode : AugmentSlot<Augment>
+{
+	K key;						//键
+	V val;						//值
+	uintptr_t leftBalance;		//左子节点指针|(平衡因子+1)
+	AVLNode<K, V, Augment>* rightNode;	//右子节点
 	AVLNode() = default;
-	AVLNode(K key, V val) : key(key), val(val), height(0), left(nullptr), right(nullptr) {}
+	//key由第一个参数构造,val由剩余参数原地构造(没有剩余参数时值初始化)
+	template<class KArg, class... VArgs>
+	AVLNode(KArg&& key, VArgs&&... val)
+		: key(std::forward<KArg>(key)), val(std::forward<VArgs>(val)...), leftBalance(1), rightNode(nullptr) {}
+
+	//左子节点
+	AVLNode<K, V, Augment>* left() const { return reinterpret_cast<AVLNode<K, V, Augment>*>(leftBalance & ~uintptr_t(3)); }
+	//右子节点
+	AVLNode<K, V, Augment>* right() const { return rightNode; }
+	//平衡因子
+	int balance() const { return int(leftBalance & 3) - 1; }
+	//设置左子节点(保留平衡因子)
+	void setLeft(AVLNode<K, V, Augment>* node) { AVL_COUNT(writes); leftBalance = reinterpret_cast<uintptr_t>(node) | (leftBalance & 3); }
+	//设置右子节点
+	void setRight(AVLNode<K, V, Augment>* node) { AVL_COUNT(writes); rightNode = node; }
+	//设置平衡因子(保留左子节点)
+	void setBalance(int balance) { AVL_COUNT(writes); leftBalance = (leftBalance & ~uintptr_t(3)) | uintptr_t(balance + 1); }
 };
 
+//节点大小检查:平衡因子不额外占用空间,节点只比键值多出两个指针
+static_assert(alignof(AVLNode<char, char>) >= 4, "AVLNode: balance bits need 4-byte alignment");
+static_assert(sizeof(AVLNode<int, int>) == 2 * sizeof(int) + 2 * sizeof(void*), "AVLNode<int, int>: key + val + 2 links");
+static_assert(sizeof(AVLNode<long long, long long>) == 2 * sizeof(long long) + 2 * sizeof(void*), "AVLNode<long long, long long>: key + val + 2 links");
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
 //AVL树,AVL树是带平衡条件的BST
 //AVL树是每个节点的左子树和右子树的高度最多差1的二叉查找树
-template<class K, class V>
+//Compare为键的比较器(默认为std::less<K>),带is_transparent的比较器(如std::less<>)支持异构查找
+//Alloc为节点分配器(默认为NodePool内存池),会被rebind为AVLNode<K, V, Augment>的分配器
+//Augment为节点聚合值策略(默认为NoAugment,见Augment.h),由旋转和插入/删除自动维护,支持reduce(lo, hi)
+//为OrderStatistic时聚合值为子树大小,额外支持rank/select/count
+template<class K, class V, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, V>>, class Augment = NoAugment>
 class AVL
 {
+	friend struct TreeTestAccess;
 private:
-	AVLNode<K, V>* root;	//树的根节点
+	using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<AVLNode<K, V, Augment>>;
+	using NodeTraits = std::allocator_traits<NodeAlloc>;
+	AVLNode<K, V, Augment>* root;	//树的根节点
 	int NodeSize;			//树节点总数
-	//得到某一节点的高度
-	int GetNodeHeight(AVLNode<K, V>* node)const;
-	//将树清空
-	void ClearTree(AVLNode<K, V>* node);
+	NodeAlloc alloc;		//节点分配器
+	Compare comp;			//键的比较器
+	//从分配器中申请并构造一个节点
+	template<class... Args>
+	AVLNode<K, V, Augment>* CreateNode(Args&&... args);
+	//析构节点并归还给分配器
+	void DestroyNode(AVLNode<K, V, Augment>* node);
+	//将树清空(逐个释放节点)
+	void ClearTree(AVLNode<K, V, Augment>* node);
+	//只析构以node为根的所有节点,不归还内存(内存随后由分配器整体释放)
+	void DestroyTree(AVLNode<K, V, Augment>* node);
 
 	//前序遍历的辅助函数(AVLNode* 可更改node的值)
-	void preOrderHelp(AVLNode<K, V>* node, void(*function)(AVLNode<K, V>* node));
+	template<class Function>
+	void preOrderHelp(AVLNode<K, V, Augment>* node, Function& function);
 	//中序遍历的辅助函数(AVLNode* 可更改node的值)
-	void inOrderHelp(AVLNode<K, V>* node, void(*function)(AVLNode<K, V>* node));
+	template<class Function>
+	void inOrderHelp(AVLNode<K, V, Augment>* node, Function& function);
 	//后序遍历的辅助函数(AVLNode* 可更改node的值)
-	void backOrderHelp(AVLNode<K, V>* node, void(*function)(AVLNode<K, V>* node));
+	template<class Function>
+	void backOrderHelp(AVLNode<K, V, Augment>* node, Function& function);
 
 	//返回AVL中最小值的节点
-	AVLNode<K, V>* FindMinNode(AVLNode<K, V>* node)const;
+	AVLNode<K, V, Augment>* FindMinNode(AVLNode<K, V, Augment>* node)const;
 	//返回AVL中最大值的节点
-	AVLNode<K, V>* FindMaxNode(AVLNode<K, V>* node)const;
+	AVLNode<K, V, Augment>* FindMaxNode(AVLNode<K, V, Augment>* node)const;
+	//以node为根的子树的节点数(需要OrderStatistic)
+	static size_t SizeOf(AVLNode<K, V, Augment>* node) { return node == nullptr ? 0 : node->agg; }
+	//node的子节点或val变化后重新计算node的聚合值
+	static void Update(AVLNode<K, V, Augment>* node) { AugmentOps<Augment>::Pull(node, node->left(), node->right()); }
+	//重新计算从node到key所在节点路径上的聚合值(AVL节点没有parent指针,只能自顶向下递归)
+	void RefreshPath(AVLNode<K, V, Augment>* node, const K& key);
+
+	//查找key对应的节点(KT为K或透明比较器支持的其他类型)
+	template<class KT>
+	AVLNode<K, V, Augment>* FindNode(const KT& key)const;
+	//第一个key>=key的节点
+	AVLNode<K, V, Augment>* LowerBoundNode(const K& key)const;
+	//第一个key>key的节点
+	AVLNode<K, V, Augment>* UpperBoundNode(const K& key)const;
+	//[lo, hi)范围访问的辅助函数
+	template<class Visitor>
+	void RangeHelp(AVLNode<K, V, Augment>* node, const K& lo, const K& hi, Visitor& visitor);
+	//中序访问以node为根的子树的所有节点
+	template<class Visitor>
+	static void VisitInOrder(const AVLNode<K, V, Augment>* node, Visitor& visitor);
+	//子树node中key<hi的节点的聚合值
+	typename Augment::value_type ReducePrefix(AVLNode<K, V, Augment>* node, const K& hi)const;
+	//子树node中key>=lo的节点的聚合值
+	typename Augment::value_type ReduceSuffix(AVLNode<K, V, Augment>* node, const K& lo)const;
+	//用it开始的n个元素建出完全平衡的子树(平衡因子由左右子树的节点数直接算出),it随之前进
+	template<class ForwardIt>
+	AVLNode<K, V, Augment>* BuildSorted(ForwardIt& it, size_t n);
+	//插入和删除都是迭代实现:向下查找时把路径记在栈上的定长数组中,之后沿路径向上调整,子树高度不再变化时立即停止
+	//AVL树的高度不超过1.44log2(n + 2),节点数不超过地址空间时路径长度也不会超过MaxHeight
+	static const int MaxHeight = 96;
+	//把node挂到path[i]原来所在的位置(path[i - 1]的dirs[i - 1]一侧,i为0时为根)
+	void Replace(AVLNode<K, V, Augment>** path, const signed char* dirs, int i, AVLNode<K, V, Augment>* node);
+	//高度不再变化后,path[i]到根只需要重新计算附加信息(没有附加信息时什么也不做)
+	static void RefreshAncestors(AVLNode<K, V, Augment>** path, int i);
+	//插入的公共入口:沿key向下查找,找不到时才调用make()得到新节点挂在空位上(返回key对应的节点和是否插入成功)
+	template<class Make>
+	std::pair<AVLNode<K, V, Augment>*, bool> InsertWith(const K& key, Make make);
+	//node的左子树变矮后的调整,返回新的子树根
+	AVLNode<K, V, Augment>* LeftShrunk(AVLNode<K, V, Augment>* node, bool& shrunk);
+	//node的右子树变矮后的调整,返回新的子树根
+	AVLNode<K, V, Augment>* RightShrunk(AVLNode<K, V, Augment>* node, bool& shrunk);
 
-	//插入节点的辅助函数
-	AVLNode<K, V>* InsertNode(AVLNode<K, V>* node, const K& key, const V& val);
-	//删除节点的辅助函数
-	AVLNode<K, V>* DeleteNode(AVLNode<K, V>* node, const K& key);
+	//join/split:h为子树的高度(空树为0),由平衡因子沿路径推出,不需要在节点中额外存储
+	//以node为根的子树的高度(沿较高的子树向下走,O(logn))
+	static int HeightOf(AVLNode<K, V, Augment>* node);
+	//以mid为分隔连接left和right(left的key全部小于mid,right的key全部大于mid),返回新的根,h返回新的高度
+	//只沿较高一侧的边缘下降到高度相差不超过1的位置,代价为O(|leftH - rightH| + 1)
+	AVLNode<K, V, Augment>* Join(AVLNode<K, V, Augment>* left, int leftH, AVLNode<K, V, Augment>* mid, AVLNode<K, V, Augment>* right, int rightH, int& h);
+	//沿node的右侧边缘下降,把mid和right接在高度合适的位置(grown返回以node为根的子树高度是否增加)
+	AVLNode<K, V, Augment>* JoinRight(AVLNode<K, V, Augment>* node, int nodeH, AVLNode<K, V, Augment>* mid, AVLNode<K, V, Augment>* right, int rightH, bool& grown);
+	//沿node的左侧边缘下降,把left和mid接在高度合适的位置
+	AVLNode<K, V, Augment>* JoinLeft(AVLNode<K, V, Augment>* left, int leftH, AVLNode<K, V, Augment>* mid, AVLNode<K, V, Augment>* node, int nodeH, bool& grown);
+	//node的右子树变高后的调整(插入和join共用),join时变高的子树可能是平衡的(此时旋转后整体仍然变高)
+	AVLNode<K, V, Augment>* RightGrown(AVLNode<K, V, Augment>* node, bool& grown);
+	//node的左子树变高后的调整
+	AVLNode<K, V, Augment>* LeftGrown(AVLNode<K, V, Augment>* node, bool& grown);
+	//没有分隔节点的连接(取出right的最小节点作为分隔)
+	AVLNode<K, V, Augment>* Join2(AVLNode<K, V, Augment>* left, int leftH, AVLNode<K, V, Augment>* right, int rightH, int& h);
+	//把以node为根的子树按key分成三部分:left(<key)、mid(==key的节点,不存在时为nullptr)、right(>key),O(logn)
+	void Split(AVLNode<K, V, Augment>* node, int h, const K& key, AVLNode<K, V, Augment>*& left, int& leftH, AVLNode<K, V, Augment>*& mid, AVLNode<K, V, Augment>*& right, int& rightH);
+	//集合运算中被丢弃的节点,通过右子节点指针串成链表,运算结束后再统一释放
+	//(分配器不要求线程安全,并行时每个任务只往自己的链表中添加节点,最后在调用线程中释放)
+	struct DropList
+	{
+		AVLNode<K, V, Augment>* head = nullptr;
+		AVLNode<K, V, Augment>* tail = nullptr;
+		size_t count = 0;
+		//加入一个已经脱离树的节点
+		void Push(AVLNode<K, V, Augment>* node)
+		{
+			node->setRight(head);
+			if (tail == nullptr) { tail = node; }
+			head = node;
+			count++;
+		}
+		//把other的节点接到链表末尾
+		void Append(DropList& other)
+		{
+			if (other.head == nullptr) { return; }
+			if (tail == nullptr) { head = other.head; }
+			else { tail->setRight(other.head); }
+			tail = other.tail;
+			count += other.count;
+		}
+	};
+	//把以node为根的子树的所有节点加入list
+	static void DropTree(AVLNode<K, V, Augment>* node, DropList& list);
+	//释放list中的所有节点,返回释放的节点数
+	size_t FreeDropped(DropList& list);
+	//高度为h的AVL树至少有N(h) = N(h - 1) + N(h - 2) + 1个节点,返回保证子树至少有grain个节点的最小高度
+	static int GrainHeight(size_t grain);
+	//集合运算的递归部分:pool不为nullptr并且子树的高度至少为grainH时,分开的两边交给pool并行计算
+	//并集:other的节点(t2)直接接入结果,key相同时丢弃t1中的节点
+	AVLNode<K, V, Augment>* Union(AVLNode<K, V, Augment>* t1, int h1, AVLNode<K, V, Augment>* t2, int h2, int& h, DropList& dropped, TaskPool* pool, int grainH);
+	//交集:只读取t2,t1中不在t2中的节点被丢弃
+	AVLNode<K, V, Augment>* Intersect(AVLNode<K, V, Augment>* t1, int h1, const AVLNode<K, V, Augment>* t2, int& h, DropList& dropped, TaskPool* pool, int grainH);
+	//差集:只读取t2,t1中同时在t2中的节点被丢弃
+	AVLNode<K, V, Augment>* Difference(AVLNode<K, V, Augment>* t1, int h1, const AVLNode<K, V, Augment>* t2, int& h, DropList& dropped, TaskPool* pool, int grainH);
+	//集合运算的入口(pool为nullptr时串行)
+	void UnionWith(AVL& other, TaskPool* pool, size_t grain);
+	void IntersectWith(const AVL& other, TaskPool* pool, size_t grain);
+	void DifferenceWith(const AVL& other, TaskPool* pool, size_t grain);
+	//子树的节点数(维护OrderStatistic时O(1),否则需要遍历)
+	static size_t TreeSize(AVLNode<K, V, Augment>* node, std::true_type) { return SizeOf(node); }
+	static size_t TreeSize(AVLNode<K, V, Augment>* node, std::false_type);
+	//按中序把以node为根的子树的键值移动到items中(节点本身不释放)
+	static void MoveItems(AVLNode<K, V, Augment>* node, std::vector<std::pair<K, V>>& items);
+	//取走other的所有节点作为本树可以使用的子树(分配器相等时直接接管,否则移动到本树的分配器中),other被清空
+	//pool不为nullptr时移动过来的节点并行构造
+	AVLNode<K, V, Augment>* Adopt(AVL& other, int& h, TaskPool* pool, size_t grain);
+	//并行批量构造:节点先在当前线程中全部申请好,再由pool并行构造和连接(分配器不需要线程安全)
+	template<class RandomIt>
+	AVLNode<K, V, Augment>* BuildSortedParallel(RandomIt first, size_t n, TaskPool& pool, size_t grain);
+	//和BuildSorted相同的划分,第i个元素构造在slots[i]中,不小于grain个节点的子树左右两边并行构造
+	template<class RandomIt>
+	AVLNode<K, V, Augment>* BuildInSlots(RandomIt first, AVLNode<K, V, Augment>** slots, size_t n, TaskPool& pool, size_t grain);
 
 	//转,转就完事儿
+	//以下旋转函数都在preRoot失衡(平衡因子将变为±2,但还没有写入节点)时调用,并负责维护平衡因子
 	//单左旋,插入时有RR插入,即向右子树的右孩子插入节点,导致不符合AVL树的定义
-	AVLNode<K, V>* SingleRotateWithLeft(AVLNode<K, V>* preRoot);
+	AVLNode<K, V, Augment>* SingleRotateWithLeft(AVLNode<K, V, Augment>* preRoot);
 	//单右旋,插入时有LL插入,即向左子树的左孩子插入节点,导致不符合AVL树的定义
-	AVLNode<K, V>* SingleRotateWithRight(AVLNode<K, V>* preRoot);
+	AVLNode<K, V, Augment>* SingleRotateWithRight(AVLNode<K, V, Augment>* preRoot);
 	//双旋转实际是需要旋转两次
 	//双左旋(R-L双旋转,RL插入(和单旋转不同))
-	AVLNode<K, V>* DoubleRotateWithLeft(AVLNode<K, V>* preRoot);
+	AVLNode<K, V, Augment>* DoubleRotateWithLeft(AVLNode<K, V, Augment>* preRoot);
 	//双右旋(L-R双旋转,LR插入(和单旋转不同))
-	AVLNode<K, V>* DoubleRotateWithRight(AVLNode<K, V>* preRoot);
+	AVLNode<K, V, Augment>* DoubleRotateWithRight(AVLNode<K, V, Augment>* preRoot);
 public:
 	//构造函数
 	AVL() { root = nullptr; NodeSize = 0; }
+	explicit AVL(const Compare& compare, const Alloc& allocator = Alloc()) : alloc(allocator), comp(compare) { root = nullptr; NodeSize = 0; }
+	explicit AVL(const Alloc& allocator) : alloc(allocator) { root = nullptr; NodeSize = 0; }
+	//批量构造(O(n),不做比较也不旋转):[first, last)中为pair-like的元素(first为key,second为val),key必须严格递增
+	template<class ForwardIt>
+	AVL(sorted_input_t, ForwardIt first, ForwardIt last, const Compare& compare = Compare(), const Alloc& allocator = Alloc())
+		: alloc(allocator), comp(compare) { root = nullptr; NodeSize = 0; build_from_sorted(first, last); }
+	//输入无序时先按key排序再批量构造(重复的key保留最后一个,和逐个Insert的结果相同)
+	template<class InputIt>
+	AVL(InputIt first, InputIt last, const Compare& compare = Compare(), const Alloc& allocator = Alloc())
+		: alloc(allocator), comp(compare) { root = nullptr; NodeSize = 0; build(first, last); }
 	//析构函数
 	~AVL() { Clear(); }
-	//插入节点的函数
-	void Insert(const K& key, const V& val);
+	//插入节点的函数(key已存在时覆盖val)
+	void Insert(const K& key, const V& val) { insert_or_assign(key, val); }
+	void Insert(K&& key, V&& val) { insert_or_assign(std::move(key), std::move(val)); }
+	//用args原地构造节点(key为第一个参数),key已存在时不插入;返回key对应的节点和是否插入成功
+	template<class... Args>
+	std::pair<AVLNode<K, V, Augment>*, bool> emplace(Args&&... args);
+	//key不存在时才用args原地构造val(key已存在时args不会被移动)
+	template<class... Args>
+	std::pair<AVLNode<K, V, Augment>*, bool> try_emplace(const K& key, Args&&... args);
+	template<class... Args>
+	std::pair<AVLNode<K, V, Augment>*, bool> try_emplace(K&& key, Args&&... args);
+	//key不存在时插入,存在时把val赋给已有节点
+	template<class M>
+	std::pair<AVLNode<K, V, Augment>*, bool> insert_or_assign(const K& key, M&& val);
+	template<class M>
+	std::pair<AVLNode<K, V, Augment>*, bool> insert_or_assign(K&& key, M&& val);
 	//删除节点的函数
 	void Delete(const K& key);
 	//判断AVL中是否存在val
-	bool Search(const K& key)const;
-	//AVL树清空
-	void Clear() { ClearTree(this->root); root = nullptr; NodeSize = 0; }
-	//得到树的高度
-	int GetHeight() const { return root == nullptr ? 0 : root->height; }
+	bool Search(const K& key)const { return FindNode(key) != nullptr; }
+	//异构查找(需要透明比较器,例如用std::string_view查找std::string键,不会构造临时的键)
+	template<class KT, class C = Compare, class = typename C::is_transparent>
+	bool Search(const KT& key)const { return FindNode(key) != nullptr; }
+	//AVL树清空(独占内存池时整块释放slab,不需要逐个释放节点)
+	void Clear();
+	//清空后从key严格递增的[first, last)批量构造,O(n)
+	template<class ForwardIt>
+	void build_from_sorted(ForwardIt first, ForwardIt last);
+	//清空后从任意顺序的[first, last)批量构造(先排序,大规模输入使用并行排序)
+	template<class InputIt>
+	void build(InputIt first, InputIt last);
+	//并行批量构造:左右子树交给pool同时构造,小于grain个节点的子树串行构造
+	template<class RandomIt>
+	void build_from_sorted(RandomIt first, RandomIt last, TaskPool& pool, size_t grain = TaskPool::DefaultGrain);
+	template<class InputIt>
+	void build(InputIt first, InputIt last, TaskPool& pool, size_t grain = TaskPool::DefaultGrain);
+
+	//集合运算(基于join/split,m、n为两棵树的大小(m<=n),代价为O(m log(n/m + 1)),而不是逐个插入的O(m logn))
+	//把other的所有键值并入本树(key相同时保留other的val),other被清空
+	//(分配器不相等时先要用O(|other|)把other的键值移动到本树分配器的新节点中,见join)
+	void union_with(AVL& other) { UnionWith(other, nullptr, 0); }
+	//只保留同时在other中的key(保留本树的val)
+	void intersect_with(const AVL& other) { IntersectWith(other, nullptr, 0); }
+	//删除同时在other中的key
+	void difference_with(const AVL& other) { DifferenceWith(other, nullptr, 0); }
+	//并行版本:分开的两边交给pool(见TaskPool.h)同时计算,子树小于grain个节点时退回串行代码
+	//运算期间其他线程不能访问这两棵树
+	void union_with(AVL& other, TaskPool& pool, size_t grain = TaskPool::DefaultGrain) { UnionWith(other, &pool, grain); }
+	void intersect_with(const AVL& other, TaskPool& pool, size_t grain = TaskPool::DefaultGrain) { IntersectWith(other, &pool, grain); }
+	void difference_with(const AVL& other, TaskPool& pool, size_t grain = TaskPool::DefaultGrain) { DifferenceWith(other, &pool, grain); }
+	//删除key在[lo, hi)中的所有节点,O(k + logn)
+	void erase_range(const K& lo, const K& hi);
+	//把key>=key的节点移到right中(right原有的节点被清空,之后和本树共享分配器),O(logn)
+	//不维护OrderStatistic时还需要遍历移出的部分来更新节点数
+	void split(const K& key, AVL& right);
+	//把right的节点接到本树之后(要求本树的key全部小于right的key),right被清空
+	//分配器相等时(right由split得到,或者两棵树用同一个NodePool构造)直接接过right的节点,O(logn);
+	//否则要把right的键值移动到本树分配器的新节点中,O(|right|)
+	void join(AVL& right);
+	//得到树的高度(沿较高的子树向下走,O(logn))
+	int GetHeight() const { return HeightOf(this->root); }
 	//得到AVL中指定值的节点
-	AVLNode<K, V>* GetNode(const K& key)const;
+	AVLNode<K, V, Augment>* GetNode(const K& key)const { return FindNode(key); }
+	template<class KT, class C = Compare, class = typename C::is_transparent>
+	AVLNode<K, V, Augment>* GetNode(const KT& key)const { return FindNode(key); }
 	//返回AVL中最小值的节点
-	AVLNode<K, V>* GetMinNode()const;
+	AVLNode<K, V, Augment>* GetMinNode()const;
 	//返回AVL中最大值的节点
-	AVLNode<K, V>* GetMaxNode()const;
+	AVLNode<K, V, Augment>* GetMaxNode()const;
 	//前序遍历
-	void preOrder(void(*function)(AVLNode<K, V>* node)) { preOrderHelp(this->root, function); };
-	//中序遍历
-	void inOrder(void(*function)(AVLNode<K, V>* node)) { inOrderHelp(this->root, function); }
+	template<class Function>
+	void preOrder(Function&& function) { preOrderHelp(this->root, function); }
+	//中序遍历(三种遍历的function都可以是带捕获的lambda或函数指针)
+	template<class Function>
+	void inOrder(Function&& function) { inOrderHelp(this->root, function); }
 	//后序遍历
-	void backOrder(void(*function)(AVLNode<K, V>* node)) { backOrderHelp(this->root, function); }
+	template<class Function>
+	void backOrder(Function&& function) { backOrderHelp(this->root, function); }
 
-	//重载[]操作符
-	V& operator[](const K& key);
+	//有序查询(一次下降,O(logn)),AVL节点没有parent指针,因此都返回节点(没有时返回nullptr)
+	//第一个key>=key的节点
+	AVLNode<K, V, Augment>* lower_bound(const K& key)const { return LowerBoundNode(key); }
+	//第一个key>key的节点
+	AVLNode<K, V, Augment>* upper_bound(const K& key)const { return UpperBoundNode(key); }
+	//最后一个key<=key的节点
+	AVLNode<K, V, Augment>* floor(const K& key)const;
+	//第一个key>=key的节点
+	AVLNode<K, V, Augment>* ceiling(const K& key)const { return LowerBoundNode(key); }
+	//最后一个key<key的节点
+	AVLNode<K, V, Augment>* predecessor(const K& key)const;
+	//第一个key>key的节点
+	AVLNode<K, V, Augment>* successor(const K& key)const { return UpperBoundNode(key); }
+	//按key从小到大对[lo, hi)中的每个节点调用visitor(AVLNode*),只访问O(logn + k)个节点
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor) { RangeHelp(this->root, lo, hi, visitor); }
+	//冻结成只读的FrozenTree(见FrozenTree.h):键值复制到无指针的数组中,查找更快;O(n),本树不变
+	FrozenTree<K, V, Compare> freeze()const;
+
+	//顺序统计(需要Augment为OrderStatistic,均为一次下降,O(logn))
+	//key小于key的节点数
+	size_t rank(const K& key)const;
+	//第i小(从0开始)的节点,i超出范围时返回nullptr
+	AVLNode<K, V, Augment>* select(size_t i)const;
+	//key在[lo, hi)中的节点数
+	size_t count(const K& lo, const K& hi)const { return comp(lo, hi) ? rank(hi) - rank(lo) : 0; }
+
+	//聚合查询(需要Augment为聚合策略,见Augment.h)
+	//整棵树的聚合值,O(1)
+	typename Augment::value_type reduce()const { return AugmentOps<Augment>::Of(this->root); }
+	//key在[lo, hi)中的节点的聚合值,O(logn)
+	typename Augment::value_type reduce(const K& lo, const K& hi)const;
+	//通过节点指针或operator[]直接修改val之后,调用refresh(key)重新计算key所在路径上的聚合值
+	void refresh(const K& key);
+
+	//重载[]操作符(只下降一次,key不存在时插入值初始化的val)
+	V& operator[](const K& key) { return try_emplace(key).first->val; }
+	V& operator[](K&& key) { return try_emplace(std::move(key)).first->val; }
 
 	//防止拷贝构造
-	AVL(const AVL<K, V>& anotherTree) = delete;
-	AVL<K, V>& operator=(const AVL<K, V>& anotherTree) = delete;
+	AVL(const AVL& anotherTree) = delete;
+	AVL& operator=(const AVL& anotherTree) = delete;
 };
 
-//得到某节点的高度
-template<class K, class V>
-inline int AVL<K, V>::GetNodeHeight(AVLNode<K, V>* node)const
+//从分配器中申请并构造一个节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class... Args>
+inline AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::CreateNode(Args&&... args)
+{
+	AVLNode<K, V, Augment>* node = NodeTraits::allocate(alloc, 1);
+	try
+	{
+		NodeTraits::construct(alloc, node, std::forward<Args>(args)...);
+	}
+	catch (...)
+	{
+		NodeTraits::deallocate(alloc, node, 1);
+		throw;
+	}
+	return node;
+}
+
+//析构节点并归还给分配器
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline void AVL<K, V, Compare, Alloc, Augment>::DestroyNode(AVLNode<K, V, Augment>* node)
 {
-	return node == nullptr ? 0 : node->height;
+	NodeTraits::destroy(alloc, node);
+	NodeTraits::deallocate(alloc, node, 1);
 }
 
-//将树清空
-template<class K, class V>
-void AVL<K, V>::ClearTree(AVLNode<K, V>* node)
+//将树清空(逐个释放节点)
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::ClearTree(AVLNode<K, V, Augment>* node)
 {
 	if (node == nullptr) { return; }
-	ClearTree(node->left);
-	ClearTree(node->right);
-	delete node;
+	ClearTree(node->left());
+	ClearTree(node->right());
+	DestroyNode(node);
+}
+
+//只析构以node为根的所有节点,不归还内存
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::DestroyTree(AVLNode<K, V, Augment>* node)
+{
+	if (node == nullptr) { return; }
+	DestroyTree(node->left());
+	DestroyTree(node->right());
+	NodeTraits::destroy(alloc, node);
+}
+
+//AVL树清空
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::Clear()
+{
+	if (CanReleaseAll(alloc))
+	{
+		//内存池只属于这棵树:平凡析构的节点连遍历都不需要,直接整块归还slab
+		if (!std::is_trivially_destructible<AVLNode<K, V, Augment>>::value) { DestroyTree(this->root); }
+		ReleaseAll(alloc);
+	}
+	else
+	{
+		ClearTree(this->root);
+	}
+	this->root = nullptr;
+	this->NodeSize = 0;
 }
 
 //前序遍历的辅助函数(AVLNode* 可更改node的值)
-template<class K, class V>
-void AVL<K, V>::preOrderHelp(AVLNode<K, V>* node, void(*function)(AVLNode<K, V>* node))
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Function>
+void AVL<K, V, Compare, Alloc, Augment>::preOrderHelp(AVLNode<K, V, Augment>* node, Function& function)
 {
 	if (node == nullptr) { return; }
 	function(node);
-	preOrderHelp(node->left, function);
-	preOrderHelp(node->right, function);
+	preOrderHelp(node->left(), function);
+	preOrderHelp(node->right(), function);
 }
 
 //中序遍历的辅助函数(AVLNode* 可更改node的值)
-template<class K, class V>
-void AVL<K, V>::inOrderHelp(AVLNode<K, V>* node, void(*function)(AVLNode<K, V>* node))
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Function>
+void AVL<K, V, Compare, Alloc, Augment>::inOrderHelp(AVLNode<K, V, Augment>* node, Function& function)
 {
 	if (node == nullptr) { return; }
-	inOrderHelp(node->left, function);
+	inOrderHelp(node->left(), function);
 	function(node);
-	inOrderHelp(node->right, function);
+	inOrderHelp(node->right(), function);
 }
 
 //后序遍历的辅助函数(AVLNode* 可更改node的值)
-template<class K, class V>
-void AVL<K, V>::backOrderHelp(AVLNode<K, V>* node, void(*function)(AVLNode<K, V>* node))
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Function>
+void AVL<K, V, Compare, Alloc, Augment>::backOrderHelp(AVLNode<K, V, Augment>* node, Function& function)
 {
 	if (node == nullptr) { return; }
-	backOrderHelp(node->left, function);
-	backOrderHelp(node->right, function);
+	backOrderHelp(node->left(), function);
+	backOrderHelp(node->right(), function);
 	function(node);
 }
 
 //返回AVL中最小值的节点
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::FindMinNode(AVLNode<K, V>* node)const
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::FindMinNode(AVLNode<K, V, Augment>* node)const
 {
-	AVLNode<K, V>* tempNode = node;
+	AVLNode<K, V, Augment>* tempNode = node;
 	if (tempNode != nullptr)
 	{
-		while (tempNode->left != nullptr)
+		while (tempNode->left() != nullptr)
 		{
-			tempNode = tempNode->left;
+			tempNode = tempNode->left();
 		}
 	}
 	return tempNode;
 }
 
 //返回AVL中最大值的节点
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::FindMaxNode(AVLNode<K, V>* node)const
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::FindMaxNode(AVLNode<K, V, Augment>* node)const
 {
-	AVLNode<K, V>* tempNode = node;
+	AVLNode<K, V, Augment>* tempNode = node;
 	if (tempNode != nullptr)
 	{
-		while (tempNode->right != nullptr)
+		while (tempNode->right() != nullptr)
 		{
-			tempNode = tempNode->right;
+			tempNode = tempNode->right();
 		}
 	}
 	return tempNode;
@@ -172,299 +497,1273 @@ AVLNode<K, V>* AVL<K, V>::FindMaxNode(AVLNode<K, V>* node)const
 
 //旋转吧！雪月花
 //单左旋,插入时有RR插入,即向右子树的右孩子插入节点,导致不符合AVL树的定义
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::SingleRotateWithLeft(AVLNode<K, V>* preRoot)
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::SingleRotateWithLeft(AVLNode<K, V, Augment>* preRoot)
 {
+	AVL_COUNT(rotations);
 	//RR插入使得preRoot变为第一个不满足AVL树定义的节点
-	AVLNode<K, V>* newRoot = preRoot->right;		//将newRoot节点作为新的root节点
-	AVLNode<K, V>* RootR = newRoot->left;			//preRoot->right应该更新为RootR
-	newRoot->left = preRoot;					//逆袭了
-	preRoot->right = RootR;						//原root节点的右孩子现在找到了新的节点
-	//更新各点高度
-	preRoot->height = max(GetNodeHeight(preRoot->left), GetNodeHeight(preRoot->right)) + 1;
-	newRoot->height = max(GetNodeHeight(newRoot->left), GetNodeHeight(newRoot->right)) + 1;
+	AVLNode<K, V, Augment>* newRoot = preRoot->right();		//将newRoot节点作为新的root节点
+	AVLNode<K, V, Augment>* RootR = newRoot->left();			//preRoot->right应该更新为RootR
+	newRoot->setLeft(preRoot);					//逆袭了
+	preRoot->setRight(RootR);					//原root节点的右孩子现在找到了新的节点
+	//更新平衡因子(newRoot平衡只会出现在删除时,此时旋转后子树高度不变)
+	if (newRoot->balance() == 0)
+	{
+		preRoot->setBalance(1);
+		newRoot->setBalance(-1);
+	}
+	else
+	{
+		preRoot->setBalance(0);
+		newRoot->setBalance(0);
+	}
+	//preRoot成为newRoot的子节点,先更新preRoot再更新newRoot
+	Update(preRoot);
+	Update(newRoot);
 	return newRoot;
 }
 
 //单右旋,插入时有LL插入,即向左子树的左孩子插入节点,导致不符合AVL树的定义
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::SingleRotateWithRight(AVLNode<K, V>* preRoot)
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::SingleRotateWithRight(AVLNode<K, V, Augment>* preRoot)
 {
+	AVL_COUNT(rotations);
 	//LL插入使得preRoot变为第一个不满足AVL树定义的节点
-	AVLNode<K, V>* newRoot = preRoot->left;		//将newRoot节点作为新的root节点
-	AVLNode<K, V>* RootL = newRoot->right;		//原root节点现在需要新的左子节点了
-	newRoot->right = preRoot;					//更改节点信息
-	preRoot->left = RootL;						//原root节点的左孩子现在找到了新的节点
-	//更新各点高度(newNode节点的左子树的各个节点高度一定不变,node节点的高度一定改变(但其右子节点高度不变))
-	preRoot->height = max(GetNodeHeight(preRoot->left), GetNodeHeight(preRoot->right)) + 1;
-	newRoot->height = max(GetNodeHeight(newRoot->left), GetNodeHeight(newRoot->right)) + 1;
+	AVLNode<K, V, Augment>* newRoot = preRoot->left();		//将newRoot节点作为新的root节点
+	AVLNode<K, V, Augment>* RootL = newRoot->right();		//原root节点现在需要新的左子节点了
+	newRoot->setRight(preRoot);					//更改节点信息
+	preRoot->setLeft(RootL);					//原root节点的左孩子现在找到了新的节点
+	//更新平衡因子(newRoot平衡只会出现在删除时,此时旋转后子树高度不变)
+	if (newRoot->balance() == 0)
+	{
+		preRoot->setBalance(-1);
+		newRoot->setBalance(1);
+	}
+	else
+	{
+		preRoot->setBalance(0);
+		newRoot->setBalance(0);
+	}
+	//preRoot成为newRoot的子节点,先更新preRoot再更新newRoot
+	Update(preRoot);
+	Update(newRoot);
 	return newRoot;
 }
 
 //双左旋(R-L双旋转,RL插入(和单旋转不同))
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::DoubleRotateWithLeft(AVLNode<K, V>* preRoot)
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::DoubleRotateWithLeft(AVLNode<K, V, Augment>* preRoot)
 {
-	//先对preRoot->right进行右旋,转换为RR情况.再对preRoot进行左旋操作
-	preRoot->right = SingleRotateWithRight(preRoot->right);
-	//左旋单操作
-	return SingleRotateWithLeft(preRoot);
+	AVL_COUNT(rotations);
+	//相当于先对preRoot->right进行右旋,转换为RR情况.再对preRoot进行左旋操作
+	//preRoot->right->left成为新的根节点,它的左右子树分别交给preRoot和preRoot->right
+	AVLNode<K, V, Augment>* RootR = preRoot->right();
+	AVLNode<K, V, Augment>* newRoot = RootR->left();
+	RootR->setLeft(newRoot->right());
+	newRoot->setRight(RootR);
+	preRoot->setRight(newRoot->left());
+	newRoot->setLeft(preRoot);
+	//更新平衡因子(取决于newRoot原来哪一边更高)
+	int balance = newRoot->balance();
+	preRoot->setBalance(balance > 0 ? -1 : 0);
+	RootR->setBalance(balance < 0 ? 1 : 0);
+	newRoot->setBalance(0);
+	Update(preRoot);
+	Update(RootR);
+	Update(newRoot);
+	return newRoot;
 }
 
 //双右旋(L-R双旋转,LR插入(和单旋转不同))
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::DoubleRotateWithRight(AVLNode<K, V>* preRoot)
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::DoubleRotateWithRight(AVLNode<K, V, Augment>* preRoot)
+{
+	AVL_COUNT(rotations);
+	//相当于先对preRoot->left进行左旋,转换为LL情况.再对preRoot进行右旋操作
+	//preRoot->left->right成为新的根节点,它的左右子树分别交给preRoot->left和preRoot
+	AVLNode<K, V, Augment>* RootL = preRoot->left();
+	AVLNode<K, V, Augment>* newRoot = RootL->right();
+	RootL->setRight(newRoot->left());
+	newRoot->setLeft(RootL);
+	preRoot->setLeft(newRoot->right());
+	newRoot->setRight(preRoot);
+	//更新平衡因子(取决于newRoot原来哪一边更高)
+	int balance = newRoot->balance();
+	preRoot->setBalance(balance < 0 ? 1 : 0);
+	RootL->setBalance(balance > 0 ? -1 : 0);
+	newRoot->setBalance(0);
+	Update(preRoot);
+	Update(RootL);
+	Update(newRoot);
+	return newRoot;
+}
+
+//node的左子树变矮后的调整(shrunk返回以node为根的子树高度是否减小)
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::LeftShrunk(AVLNode<K, V, Augment>* node, bool& shrunk)
 {
-	//先对preRoot->left进行左旋,转换为LL情况.再对preRoot进行右旋操作
-	preRoot->left = SingleRotateWithLeft(preRoot->left);
-	//右旋单操作
-	return SingleRotateWithRight(preRoot);
+	if (node->balance() < 0)
+	{
+		//原来左高,现在平衡,整体高度减小
+		node->setBalance(0);
+		shrunk = true;
+		return node;
+	}
+	if (node->balance() == 0)
+	{
+		//原来平衡,现在右高,整体高度不变
+		node->setBalance(1);
+		shrunk = false;
+		return node;
+	}
+	//原来右高,现在失衡,相当于向右子树中插入了节点
+	AVLNode<K, V, Augment>* RootR = node->right();
+	if (RootR->balance() < 0)
+	{
+		//相当于RL插入
+		shrunk = true;
+		return DoubleRotateWithLeft(node);
+	}
+	//RR插入(RootR平衡时旋转后高度不变)
+	shrunk = RootR->balance() != 0;
+	return SingleRotateWithLeft(node);
 }
 
-//插入节点的辅助函数
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::InsertNode(AVLNode<K, V>* node, const K& key, const V& val)
+//node的右子树变矮后的调整(shrunk返回以node为根的子树高度是否减小)
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::RightShrunk(AVLNode<K, V, Augment>* node, bool& shrunk)
 {
-	if (node == nullptr)
+	if (node->balance() > 0)
+	{
+		//原来右高,现在平衡,整体高度减小
+		node->setBalance(0);
+		shrunk = true;
+		return node;
+	}
+	if (node->balance() == 0)
 	{
-		node = new AVLNode<K, V>(key, val);//height默认为0
-		this->NodeSize++;
+		//原来平衡,现在左高,整体高度不变
+		node->setBalance(-1);
+		shrunk = false;
+		return node;
+	}
+	//原来左高,现在失衡,相当于向左子树中插入了节点
+	AVLNode<K, V, Augment>* RootL = node->left();
+	if (RootL->balance() > 0)
+	{
+		//相当于LR插入
+		shrunk = true;
+		return DoubleRotateWithRight(node);
+	}
+	//LL插入(RootL平衡时旋转后高度不变)
+	shrunk = RootL->balance() != 0;
+	return SingleRotateWithRight(node);
+}
+
+//把node挂到path[i]原来所在的位置(path[i - 1]的dirs[i - 1]一侧,i为0时为根)
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline void AVL<K, V, Compare, Alloc, Augment>::Replace(AVLNode<K, V, Augment>** path, const signed char* dirs, int i, AVLNode<K, V, Augment>* node)
+{
+	if (i == 0) { this->root = node; }
+	else if (dirs[i - 1] < 0) { path[i - 1]->setLeft(node); }
+	else { path[i - 1]->setRight(node); }
+}
+
+//重新计算path[i]到根的附加信息(没有附加信息时什么也不做)
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline void AVL<K, V, Compare, Alloc, Augment>::RefreshAncestors(AVLNode<K, V, Augment>** path, int i)
+{
+	if (std::is_same<Augment, NoAugment>::value) { return; }
+	for (; i >= 0; i--) { Update(path[i]); }
+}
+
+//插入的公共入口
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Make>
+std::pair<AVLNode<K, V, Augment>*, bool> AVL<K, V, Compare, Alloc, Augment>::InsertWith(const K& key, Make make)
+{
+	AVLNode<K, V, Augment>* path[MaxHeight];	//从根到新节点父节点的路径
+	signed char dirs[MaxHeight];				//路径上每个节点向哪边走(-1为左,1为右)
+	int depth = 0;
+	AVLNode<K, V, Augment>* node = this->root;
+	while (node != nullptr)
+	{
+		//每一层只做一次三路比较
+		int cmp = KeyCompare3(comp, key, node->key);
+		if (cmp == 0)
+		{
+			//键值相同
+			return { node, false };
+		}
+		path[depth] = node;
+		dirs[depth] = cmp < 0 ? -1 : 1;
+		depth++;
+		node = cmp < 0 ? node->left() : node->right();
+	}
+	//找到空位之后才构造新节点(平衡因子默认为0)
+	AVLNode<K, V, Augment>* result = make();
+	Update(result);
+	this->NodeSize++;
+	Replace(path, dirs, depth, result);
+	//沿路径向上调整,子树变高了才需要继续;高度不变或旋转之后(旋转后高度恢复为插入前的高度),祖先节点的平衡因子都不会再变
+	int i = depth - 1;
+	bool grown = true;
+	for (; grown && i >= 0; i--)
+	{
+		AVLNode<K, V, Augment>* parent = path[i];
+		//L插入导致失衡时LL右旋、LR双旋,R插入时RR左旋、RL双旋(插入时变高的子树不可能是平衡的)
+		AVLNode<K, V, Augment>* sub = dirs[i] < 0 ? LeftGrown(parent, grown) : RightGrown(parent, grown);
+		if (sub != parent) { Replace(path, dirs, i, sub); }
+		else { Update(parent); }
+	}
+	//剩下的祖先节点只需要更新附加信息(旋转过的节点已经在旋转中更新)
+	RefreshAncestors(path, i);
+	return { result, true };
+}
+
+//用args原地构造节点,key已存在时不插入
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class... Args>
+std::pair<AVLNode<K, V, Augment>*, bool> AVL<K, V, Compare, Alloc, Augment>::emplace(Args&&... args)
+{
+	//不知道key之前只能先构造节点
+	AVLNode<K, V, Augment>* node = CreateNode(std::forward<Args>(args)...);
+	std::pair<AVLNode<K, V, Augment>*, bool> res = InsertWith(node->key, [node]() { return node; });
+	if (!res.second) { DestroyNode(node); }
+	return res;
+}
+
+//key不存在时才用args原地构造val
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class... Args>
+std::pair<AVLNode<K, V, Augment>*, bool> AVL<K, V, Compare, Alloc, Augment>::try_emplace(const K& key, Args&&... args)
+{
+	return InsertWith(key, [&]() { return CreateNode(key, std::forward<Args>(args)...); });
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class... Args>
+std::pair<AVLNode<K, V, Augment>*, bool> AVL<K, V, Compare, Alloc, Augment>::try_emplace(K&& key, Args&&... args)
+{
+	//make()只会在找到空位后调用一次,此时key已经不再用于比较
+	return InsertWith(key, [&]() { return CreateNode(std::move(key), std::forward<Args>(args)...); });
+}
+
+//key不存在时插入,存在时把val赋给已有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class M>
+std::pair<AVLNode<K, V, Augment>*, bool> AVL<K, V, Compare, Alloc, Augment>::insert_or_assign(const K& key, M&& val)
+{
+	std::pair<AVLNode<K, V, Augment>*, bool> res = InsertWith(key, [&]() { return CreateNode(key, std::forward<M>(val)); });
+	if (!res.second)
+	{
+		res.first->val = std::forward<M>(val);
+		refresh(res.first->key);
+	}
+	return res;
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class M>
+std::pair<AVLNode<K, V, Augment>*, bool> AVL<K, V, Compare, Alloc, Augment>::insert_or_assign(K&& key, M&& val)
+{
+	std::pair<AVLNode<K, V, Augment>*, bool> res = InsertWith(key, [&]() { return CreateNode(std::move(key), std::forward<M>(val)); });
+	if (!res.second)
+	{
+		res.first->val = std::forward<M>(val);
+		refresh(res.first->key);
+	}
+	return res;
+}
+
+//删除节点的函数
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::Delete(const K& key)
+{
+	AVLNode<K, V, Augment>* path[MaxHeight];	//从根到被摘下节点的父节点的路径
+	signed char dirs[MaxHeight];				//路径上每个节点向哪边走(-1为左,1为右)
+	int depth = 0;
+	AVLNode<K, V, Augment>* node = this->root;
+	while (node != nullptr)
+	{
+		int cmp = KeyCompare3(comp, key, node->key);
+		if (cmp == 0) { break; }
+		path[depth] = node;
+		dirs[depth] = cmp < 0 ? -1 : 1;
+		depth++;
+		node = cmp < 0 ? node->left() : node->right();
+	}
+	if (node == nullptr) { return; }
+
+	//标准BST操作
+	//case 1: node为叶子节点,这种情况下直接将node删除即可
+	//case 2: node节点只有左子树/右子树(这种情况可以包括case 1)
+	//case 3: node节点既有左子树又有右子树(利用前驱或后继节点来修改)
+	if (node->left() != nullptr && node->right() != nullptr)
+	{
+		//case 3:如果node的左子树比右子树高则取前驱,否则取后继
+		//接着同一次下降继续向下找到它,路径一直记录到它的父节点
+		int index = depth;	//node在路径中的位置,之后由替代节点接替
+		signed char dir = node->balance() < 0 ? -1 : 1;
+		path[depth] = node;
+		dirs[depth] = dir;
+		depth++;
+		AVLNode<K, V, Augment>* next = dir < 0 ? node->left() : node->right();
+		for (AVLNode<K, V, Augment>* child = dir < 0 ? next->right() : next->left(); child != nullptr; child = dir < 0 ? next->right() : next->left())
+		{
+			path[depth] = next;
+			dirs[depth] = -dir;
+			depth++;
+			next = child;
+		}
+		//先把替代节点从原位置摘下(它最多只有dir一侧的子节点)
+		Replace(path, dirs, depth, dir < 0 ? next->left() : next->right());
+		//再让它接替node的位置、子节点和平衡因子(重新链接而不是交换键值,其他节点的指针仍然有效)
+		next->setLeft(node->left());
+		next->setRight(node->right());
+		next->setBalance(node->balance());
+		Replace(path, dirs, index, next);
+		path[index] = next;
 	}
 	else
 	{
-		if (node->key > key)
+		//直接将node换成它的子节点
+		Replace(path, dirs, depth, node->left() != nullptr ? node->left() : node->right());
+	}
+	DestroyNode(node);		//释放原node节点的空间
+	this->NodeSize--;		//节点数减小
+	//沿路径向上调整,子树变矮了才需要继续(旋转过的节点已经在旋转中更新)
+	int i = depth - 1;
+	bool shrunk = true;
+	for (; shrunk && i >= 0; i--)
+	{
+		AVLNode<K, V, Augment>* parent = path[i];
+		AVLNode<K, V, Augment>* sub = dirs[i] < 0 ? LeftShrunk(parent, shrunk) : RightShrunk(parent, shrunk);
+		if (sub != parent) { Replace(path, dirs, i, sub); }
+		else { Update(parent); }
+	}
+	//剩下的祖先节点只需要更新附加信息
+	RefreshAncestors(path, i);
+}
+
+//以node为根的子树的高度
+template<class K, class V, class Compare, class Alloc, class Augment>
+int AVL<K, V, Compare, Alloc, Augment>::HeightOf(AVLNode<K, V, Augment>* node)
+{
+	int height = 0;
+	for (; node != nullptr; height++)
+	{
+		node = node->balance() < 0 ? node->left() : node->right();
+	}
+	return height;
+}
+
+//查找key对应的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class KT>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::FindNode(const KT& key)const
+{
+	AVLNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
+	{
+		int cmp = KeyCompare3(comp, key, tempNode->key);
+		if (cmp > 0)
 		{
-			node->left = InsertNode(node->left, key, val);
-			//查看是否需要旋转
-			//L插入,可能导致LR插入或者LL插入(L插入一定有node的左子树高度大于node右子树高度且需要旋转时差为2)
-			if (GetNodeHeight(node->left) - GetNodeHeight(node->right) == 2)
-			{
-				//此时一定需要旋转,LL插入是左旋
-				if (key < node->left->key)
-				{
-					node = SingleRotateWithRight(node);
-				}
-				else
-				{
-					//LR插入
-					node = DoubleRotateWithRight(node);
-				}
-			}
+			//走右边
+			tempNode = tempNode->right();
 		}
-		else if (node->key < key)
+		else if (cmp < 0)
 		{
-			node->right = InsertNode(node->right, key, val);
-			//查看是否需要旋转
-			//R插入,可能导致RL插入或者RR插入(R插入一定有node的右子树高度大于node左子树高度且需要旋转时差为2)
-			if (GetNodeHeight(node->right) - GetNodeHeight(node->left) == 2)
-			{
-				//此时一定需要旋转,左旋！！！左旋！！！
-				if (key > node->right->key)
-				{
-					node = SingleRotateWithLeft(node);
-				}
-				else
-				{
-					//RL插入
-					node = DoubleRotateWithLeft(node);
-				}
-			}
+			tempNode = tempNode->left();
 		}
 		else
 		{
-			//键值相同
-			node->val = val;
+			break;
 		}
 	}
-
-	//更新节点高度
-	node->height = max(GetNodeHeight(node->left), GetNodeHeight(node->right)) + 1;
-	return node;
+	return tempNode;
 }
 
-//删除节点的辅助函数
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::DeleteNode(AVLNode<K, V>* node, const K& key)
+//第一个key>=key的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::LowerBoundNode(const K& key)const
 {
-	//旋转操作会自行维护节点的高度
-	if (node == nullptr) { return node; }
-
-	if (node->key > key)
+	AVLNode<K, V, Augment>* result = nullptr;
+	AVLNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
 	{
-		//走左边
-		node->left = DeleteNode(node->left, key);
-		//判断是否失衡,删除了左子树的一个节点,因此判断右子树是否过高
-		if (GetNodeHeight(node->right) - GetNodeHeight(node->left) > 1)
+		int cmp = KeyCompare3(comp, tempNode->key, key);
+		if (cmp >= 0)
 		{
-			//右子树过高,则相当于向右子树中插入了节点
-			if (GetNodeHeight(node->right->left) > GetNodeHeight(node->right->right))
-			{
-				//相当于RL插入
-				node = DoubleRotateWithLeft(node);
-			}
-			else
-			{
-				//RR插入
-				node = SingleRotateWithLeft(node);
-			}
+			//tempNode满足条件,继续在左子树中找更小的
+			result = tempNode;
+			if (cmp == 0) { break; }
+			tempNode = tempNode->left();
+		}
+		else
+		{
+			tempNode = tempNode->right();
 		}
 	}
-	else if (node->key < key)
+	return result;
+}
+
+//第一个key>key的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::UpperBoundNode(const K& key)const
+{
+	AVLNode<K, V, Augment>* result = nullptr;
+	AVLNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
 	{
-		//走右边
-		node->right = DeleteNode(node->right, key);
-		//判断是否失衡,删除了右子树的一个节点,因此判断左子树是否过高
-		if (GetNodeHeight(node->left) - GetNodeHeight(node->right) > 1)
+		if (comp(key, tempNode->key))
 		{
-			//左子树过高,则相当于向左子树中插入了节点
-			if (GetNodeHeight(node->left->right) > GetNodeHeight(node->left->left))
-			{
-				//相当于LR插入
-				node = DoubleRotateWithRight(node);
-			}
-			else
-			{
-				//LL插入
-				node = SingleRotateWithRight(node);
-			}
+			result = tempNode;
+			tempNode = tempNode->left();
+		}
+		else
+		{
+			tempNode = tempNode->right();
 		}
 	}
-	else
+	return result;
+}
+
+//最后一个key<=key的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::floor(const K& key)const
+{
+	AVLNode<K, V, Augment>* result = nullptr;
+	AVLNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
 	{
-		//标准BST操作
-		//找到节点了,当node->val == key 时
-		//case 1: node为叶子节点,这种情况下直接将node删除即可
-		//case 2: node节点只有左子树/右子树(这种情况可以包括case 1)
-		//case 3: node节点既有左子树又有右子树(利用前驱节点来修改)
-		if (node->left == nullptr)
+		int cmp = KeyCompare3(comp, tempNode->key, key);
+		if (cmp <= 0)
+		{
+			//tempNode满足条件,继续在右子树中找更大的
+			result = tempNode;
+			if (cmp == 0) { break; }
+			tempNode = tempNode->right();
+		}
+		else
 		{
-			//只有右子树
-			AVLNode<K, V>* tempNode = node;//保存node指针
-			node = node->right;			 //直接将node换成它的子节点
-			delete tempNode;			 //释放原node节点的空间
-			this->NodeSize--;			 //节点数减小
+			tempNode = tempNode->left();
 		}
-		else if (node->right == nullptr)
+	}
+	return result;
+}
+
+//最后一个key<key的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::predecessor(const K& key)const
+{
+	AVLNode<K, V, Augment>* result = nullptr;
+	AVLNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
+	{
+		if (comp(tempNode->key, key))
 		{
-			//只有左子树
-			AVLNode<K, V>* tempNode = node;//保存node指针
-			node = node->left;			 //直接将node换成它的子节点
-			delete tempNode;			 //释放原node节点的空间
-			this->NodeSize--;			 //节点数减小
+			result = tempNode;
+			tempNode = tempNode->right();
 		}
 		else
 		{
-			//case 3,左右子树均存在
-			//如果node的左子树比右子树高则从左子树中选取
-			if (GetNodeHeight(node->left) > GetNodeHeight(node->right))
-			{
-				//找到前驱节点
-				AVLNode<K, V>* preNode = FindMaxNode(node->left);
-				//找到前驱节点之后,交换preNode和node的值
-				node->key = preNode->key;
-				node->val = preNode->val;
-				//接下来继续递归,从node的左子树出发,删除tempNode->val值的节点
-				//(此时要删除的节点一定属于case 1或case 2)
-				node->left = DeleteNode(node->left, preNode->key);
-			}
-			else
-			{
-				//找到next的后继节点
-				AVLNode<K, V>* nextNode = FindMinNode(node->right);
-				//交换node和nextNode的值
-				node->key = nextNode->key;
-				node->val = nextNode->val;
-				node->right = DeleteNode(node->right, nextNode->key);
-			}
+			tempNode = tempNode->left();
 		}
 	}
-	return node;
+	return result;
 }
 
-//插入节点的函数
-template<class K, class V>
-void AVL<K, V>::Insert(const K& key, const V& val)
+//[lo, hi)范围访问的辅助函数
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Visitor>
+void AVL<K, V, Compare, Alloc, Augment>::RangeHelp(AVLNode<K, V, Augment>* node, const K& lo, const K& hi, Visitor& visitor)
 {
-	this->root = InsertNode(this->root, key, val);
+	//只进入可能含有[lo, hi)中key的子树:node->key<lo时左子树全部<lo,node->key>=hi时右子树全部>=hi
+	while (node != nullptr)
+	{
+		bool geLo = !comp(node->key, lo);
+		bool ltHi = comp(node->key, hi);
+		if (geLo) { RangeHelp(node->left(), lo, hi, visitor); }
+		if (geLo && ltHi) { visitor(node); }
+		if (!ltHi) { return; }
+		//右子树用循环代替递归
+		node = node->right();
+	}
 }
 
-//删除节点的函数
-template<class K, class V>
-void AVL<K, V>::Delete(const K& key)
+//中序访问以node为根的子树的所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Visitor>
+void AVL<K, V, Compare, Alloc, Augment>::VisitInOrder(const AVLNode<K, V, Augment>* node, Visitor& visitor)
 {
-	this->root = DeleteNode(this->root, key);
+	while (node != nullptr)
+	{
+		VisitInOrder(node->left(), visitor);
+		visitor(node);
+		node = node->right();
+	}
 }
 
-//判断AVL中是否存在key
-template<class K, class V>
-bool AVL<K, V>::Search(const K& key)const
+//key小于key的节点数
+template<class K, class V, class Compare, class Alloc, class Augment>
+size_t AVL<K, V, Compare, Alloc, Augment>::rank(const K& key)const
 {
-	AVLNode<K, V>* tempNode = this->root;
+	static_assert(std::is_same<Augment, OrderStatistic>::value, "AVL::rank requires Augment = OrderStatistic");
+	size_t result = 0;
+	AVLNode<K, V, Augment>* tempNode = this->root;
 	while (tempNode != nullptr)
 	{
-		if (tempNode->key < key)
+		if (comp(tempNode->key, key))
 		{
-			//走右边
-			tempNode = tempNode->right;
+			//tempNode和它的左子树都小于key
+			result += SizeOf(tempNode->left()) + 1;
+			tempNode = tempNode->right();
+		}
+		else
+		{
+			tempNode = tempNode->left();
+		}
+	}
+	return result;
+}
+
+//第i小(从0开始)的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::select(size_t i)const
+{
+	static_assert(std::is_same<Augment, OrderStatistic>::value, "AVL::select requires Augment = OrderStatistic");
+	AVLNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
+	{
+		size_t leftSize = SizeOf(tempNode->left());
+		if (i < leftSize)
+		{
+			tempNode = tempNode->left();
 		}
-		else if (tempNode->key > key)
+		else if (i == leftSize)
 		{
-			tempNode = tempNode->left;
+			break;
 		}
 		else
 		{
-			return true;
+			//跳过左子树和tempNode,在右子树中找第i - leftSize - 1小的节点
+			i -= leftSize + 1;
+			tempNode = tempNode->right();
 		}
 	}
-	return nullptr;
+	return tempNode;
 }
 
-//得到AVL中指定值的节点
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::GetNode(const K& key)const
+//子树node中key<hi的节点的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename Augment::value_type AVL<K, V, Compare, Alloc, Augment>::ReducePrefix(AVLNode<K, V, Augment>* node, const K& hi)const
 {
-	AVLNode<K, V>* tempNode = this->root;
-	while (tempNode != nullptr && tempNode->key != key)
+	//从左到右累积:node<hi时node和它的左子树都在范围内,继续看右子树
+	typename Augment::value_type result = Augment::identity();
+	while (node != nullptr)
 	{
-		if (tempNode->key < key)
+		if (comp(node->key, hi))
 		{
-			//走右边
-			tempNode = tempNode->right;
+			result = Augment::combine(result, AugmentOps<Augment>::Of(node->left()));
+			result = Augment::combine(result, Augment::lift(node->key, node->val));
+			node = node->right();
 		}
-		else if (tempNode->key > key)
+		else
 		{
-			tempNode = tempNode->left;
+			node = node->left();
 		}
 	}
-	return tempNode;
+	return result;
+}
+
+//子树node中key>=lo的节点的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename Augment::value_type AVL<K, V, Compare, Alloc, Augment>::ReduceSuffix(AVLNode<K, V, Augment>* node, const K& lo)const
+{
+	//从右到左累积:node>=lo时node和它的右子树都在范围内,继续看左子树
+	typename Augment::value_type result = Augment::identity();
+	while (node != nullptr)
+	{
+		if (!comp(node->key, lo))
+		{
+			result = Augment::combine(AugmentOps<Augment>::Of(node->right()), result);
+			result = Augment::combine(Augment::lift(node->key, node->val), result);
+			node = node->left();
+		}
+		else
+		{
+			node = node->right();
+		}
+	}
+	return result;
+}
+
+//key在[lo, hi)中的节点的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename Augment::value_type AVL<K, V, Compare, Alloc, Augment>::reduce(const K& lo, const K& hi)const
+{
+	static_assert(!std::is_same<Augment, NoAugment>::value, "AVL::reduce requires an aggregate Augment");
+	//先下降到第一个落在[lo, hi)中的节点(lo和hi的查找路径在这里分开)
+	AVLNode<K, V, Augment>* split = this->root;
+	while (split != nullptr)
+	{
+		if (comp(split->key, lo)) { split = split->right(); }
+		else if (!comp(split->key, hi)) { split = split->left(); }
+		else { break; }
+	}
+	if (split == nullptr) { return Augment::identity(); }
+	//左子树中>=lo的部分 + split + 右子树中<hi的部分
+	typename Augment::value_type result = ReduceSuffix(split->left(), lo);
+	result = Augment::combine(result, Augment::lift(split->key, split->val));
+	return Augment::combine(result, ReducePrefix(split->right(), hi));
+}
+
+//重新计算从node到key所在节点路径上的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::RefreshPath(AVLNode<K, V, Augment>* node, const K& key)
+{
+	if (node == nullptr) { return; }
+	int cmp = KeyCompare3(comp, key, node->key);
+	if (cmp < 0) { RefreshPath(node->left(), key); }
+	else if (cmp > 0) { RefreshPath(node->right(), key); }
+	//子节点先更新,回溯时再更新node
+	Update(node);
+}
+
+//直接修改val之后重新计算key所在路径上的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::refresh(const K& key)
+{
+	//不维护聚合值时不需要下降
+	if (std::is_same<Augment, NoAugment>::value) { return; }
+	RefreshPath(this->root, key);
+}
+
+//清空后从key严格递增的[first, last)批量构造
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class ForwardIt>
+void AVL<K, V, Compare, Alloc, Augment>::build_from_sorted(ForwardIt first, ForwardIt last)
+{
+	Clear();
+	size_t n = size_t(std::distance(first, last));
+	this->root = BuildSorted(first, n);
+	this->NodeSize = int(n);
+}
+
+//清空后从任意顺序的[first, last)批量构造
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class InputIt>
+void AVL<K, V, Compare, Alloc, Augment>::build(InputIt first, InputIt last)
+{
+	std::vector<std::pair<K, V>> items = SortedUniqueItems<K, V>(first, last, comp);
+	build_from_sorted(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+}
+
+//并行批量构造
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class RandomIt>
+void AVL<K, V, Compare, Alloc, Augment>::build_from_sorted(RandomIt first, RandomIt last, TaskPool& pool, size_t grain)
+{
+	Clear();
+	size_t n = size_t(last - first);
+	this->root = BuildSortedParallel(first, n, pool, grain);
+	this->NodeSize = int(n);
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class InputIt>
+void AVL<K, V, Compare, Alloc, Augment>::build(InputIt first, InputIt last, TaskPool& pool, size_t grain)
+{
+	std::vector<std::pair<K, V>> items = SortedUniqueItems<K, V>(first, last, comp);
+	build_from_sorted(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()), pool, grain);
+}
+
+//并行批量构造:先申请好所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class RandomIt>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::BuildSortedParallel(RandomIt first, size_t n, TaskPool& pool, size_t grain)
+{
+	std::vector<AVLNode<K, V, Augment>*> slots(n);
+	size_t allocated = 0;
+	try
+	{
+		for (; allocated < n; allocated++) { slots[allocated] = NodeTraits::allocate(alloc, 1); }
+		return BuildInSlots(first, slots.data(), n, pool, grain);
+	}
+	catch (...)
+	{
+		//构造失败的子树已经析构,这里只归还内存
+		for (size_t i = 0; i < allocated; i++) { NodeTraits::deallocate(alloc, slots[i], 1); }
+		throw;
+	}
+}
+
+//在slots中构造以first开始的n个元素组成的子树
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class RandomIt>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::BuildInSlots(RandomIt first, AVLNode<K, V, Augment>** slots, size_t n, TaskPool& pool, size_t grain)
+{
+	if (n == 0) { return nullptr; }
+	size_t leftSize = (n - 1) / 2;
+	size_t rightSize = n - 1 - leftSize;
+	AVLNode<K, V, Augment>* left = nullptr;
+	AVLNode<K, V, Augment>* right = nullptr;
+	AVLNode<K, V, Augment>* node = slots[leftSize];
+	auto buildLeft = [&]() { left = BuildInSlots(first, slots, leftSize, pool, grain); };
+	auto buildRight = [&]() { right = BuildInSlots(first + ptrdiff_t(leftSize + 1), slots + leftSize + 1, rightSize, pool, grain); };
+	try
+	{
+		if (n >= grain) { pool.fork_join(buildLeft, buildRight); }
+		else
+		{
+			buildLeft();
+			buildRight();
+		}
+		auto&& item = first[ptrdiff_t(leftSize)];
+		NodeTraits::construct(alloc, node, std::forward<decltype(item)>(item).first, std::forward<decltype(item)>(item).second);
+	}
+	catch (...)
+	{
+		//只析构已经构造好的子树,内存由BuildSortedParallel统一归还
+		DestroyTree(left);
+		DestroyTree(right);
+		throw;
+	}
+	node->setLeft(left);
+	node->setRight(right);
+	node->setBalance(BalancedHeight(rightSize) - BalancedHeight(leftSize));
+	Update(node);
+	return node;
+}
+
+//用it开始的n个元素建出完全平衡的子树
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class ForwardIt>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::BuildSorted(ForwardIt& it, size_t n)
+{
+	if (n == 0) { return nullptr; }
+	//按中序消费元素:先建左子树,再建根,最后建右子树(左子树不比右子树大)
+	size_t leftSize = (n - 1) / 2;
+	size_t rightSize = n - 1 - leftSize;
+	AVLNode<K, V, Augment>* left = BuildSorted(it, leftSize);
+	AVLNode<K, V, Augment>* node;
+	try
+	{
+		auto&& item = *it;
+		node = CreateNode(std::forward<decltype(item)>(item).first, std::forward<decltype(item)>(item).second);
+	}
+	catch (...)
+	{
+		ClearTree(left);
+		throw;
+	}
+	++it;
+	node->setLeft(left);
+	try
+	{
+		node->setRight(BuildSorted(it, rightSize));
+	}
+	catch (...)
+	{
+		ClearTree(node);
+		throw;
+	}
+	//按中点划分时子树高度只由节点数决定,右子树最多比左子树高1
+	node->setBalance(BalancedHeight(rightSize) - BalancedHeight(leftSize));
+	Update(node);
+	return node;
+}
+
+//以mid为分隔连接left和right
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::Join(AVLNode<K, V, Augment>* left, int leftH, AVLNode<K, V, Augment>* mid, AVLNode<K, V, Augment>* right, int rightH, int& h)
+{
+	if (leftH > rightH + 1)
+	{
+		bool grown = false;
+		AVLNode<K, V, Augment>* node = JoinRight(left, leftH, mid, right, rightH, grown);
+		h = leftH + (grown ? 1 : 0);
+		return node;
+	}
+	if (rightH > leftH + 1)
+	{
+		bool grown = false;
+		AVLNode<K, V, Augment>* node = JoinLeft(left, leftH, mid, right, rightH, grown);
+		h = rightH + (grown ? 1 : 0);
+		return node;
+	}
+	//高度相差不超过1:mid直接作为根
+	mid->setLeft(left);
+	mid->setRight(right);
+	mid->setBalance(rightH - leftH);
+	Update(mid);
+	h = max(leftH, rightH) + 1;
+	return mid;
+}
+
+//沿node的右侧边缘下降,把mid和right接在高度合适的位置
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::JoinRight(AVLNode<K, V, Augment>* node, int nodeH, AVLNode<K, V, Augment>* mid, AVLNode<K, V, Augment>* right, int rightH, bool& grown)
+{
+	//此时nodeH >= rightH + 2,因此node的右子树高度至少为rightH
+	int childH = nodeH - (node->balance() < 0 ? 2 : 1);
+	if (childH <= rightH + 1)
+	{
+		//node的右子树和right高度相差不超过1,用mid连接它们,得到的子树比原来的右子树高1
+		mid->setLeft(node->right());
+		mid->setRight(right);
+		mid->setBalance(rightH - childH);
+		Update(mid);
+		node->setRight(mid);
+		grown = true;
+	}
+	else
+	{
+		node->setRight(JoinRight(node->right(), childH, mid, right, rightH, grown));
+	}
+	if (grown) { node = RightGrown(node, grown); }
+	Update(node);
+	return node;
+}
+
+//沿node的左侧边缘下降,把left和mid接在高度合适的位置
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::JoinLeft(AVLNode<K, V, Augment>* left, int leftH, AVLNode<K, V, Augment>* mid, AVLNode<K, V, Augment>* node, int nodeH, bool& grown)
+{
+	int childH = nodeH - (node->balance() > 0 ? 2 : 1);
+	if (childH <= leftH + 1)
+	{
+		mid->setLeft(left);
+		mid->setRight(node->left());
+		mid->setBalance(childH - leftH);
+		Update(mid);
+		node->setLeft(mid);
+		grown = true;
+	}
+	else
+	{
+		node->setLeft(JoinLeft(left, leftH, mid, node->left(), childH, grown));
+	}
+	if (grown) { node = LeftGrown(node, grown); }
+	Update(node);
+	return node;
+}
+
+//node的右子树变高后的调整(grown返回以node为根的子树高度是否增加)
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::RightGrown(AVLNode<K, V, Augment>* node, bool& grown)
+{
+	if (node->balance() < 0)
+	{
+		node->setBalance(0);
+		grown = false;
+		return node;
+	}
+	if (node->balance() == 0)
+	{
+		node->setBalance(1);
+		grown = true;
+		return node;
+	}
+	//失衡,右子节点左高时双旋(高度恢复),否则单旋(右子节点平衡时旋转后整体仍然变高)
+	AVLNode<K, V, Augment>* RootR = node->right();
+	if (RootR->balance() < 0)
+	{
+		grown = false;
+		return DoubleRotateWithLeft(node);
+	}
+	grown = RootR->balance() == 0;
+	return SingleRotateWithLeft(node);
+}
+
+//node的左子树变高后的调整
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::LeftGrown(AVLNode<K, V, Augment>* node, bool& grown)
+{
+	if (node->balance() > 0)
+	{
+		node->setBalance(0);
+		grown = false;
+		return node;
+	}
+	if (node->balance() == 0)
+	{
+		node->setBalance(-1);
+		grown = true;
+		return node;
+	}
+	AVLNode<K, V, Augment>* RootL = node->left();
+	if (RootL->balance() > 0)
+	{
+		grown = false;
+		return DoubleRotateWithRight(node);
+	}
+	grown = RootL->balance() == 0;
+	return SingleRotateWithRight(node);
+}
+
+//没有分隔节点的连接
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::Join2(AVLNode<K, V, Augment>* left, int leftH, AVLNode<K, V, Augment>* right, int rightH, int& h)
+{
+	if (right == nullptr) { h = leftH; return left; }
+	if (left == nullptr) { h = rightH; return right; }
+	//从right中分出最小节点作为分隔
+	AVLNode<K, V, Augment>* minNode = FindMinNode(right);
+	AVLNode<K, V, Augment>* empty;
+	AVLNode<K, V, Augment>* mid;
+	int emptyH;
+	Split(right, rightH, minNode->key, empty, emptyH, mid, right, rightH);
+	return Join(left, leftH, mid, right, rightH, h);
+}
+
+//把以node为根的子树按key分成三部分
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::Split(AVLNode<K, V, Augment>* node, int h, const K& key, AVLNode<K, V, Augment>*& left, int& leftH, AVLNode<K, V, Augment>*& mid, AVLNode<K, V, Augment>*& right, int& rightH)
+{
+	if (node == nullptr)
+	{
+		left = mid = right = nullptr;
+		leftH = rightH = 0;
+		return;
+	}
+	//由平衡因子得到左右子树的高度
+	int nodeLeftH = h - (node->balance() > 0 ? 2 : 1);
+	int nodeRightH = h - (node->balance() < 0 ? 2 : 1);
+	AVLNode<K, V, Augment>* nodeLeft = node->left();
+	AVLNode<K, V, Augment>* nodeRight = node->right();
+	int cmp = KeyCompare3(comp, key, node->key);
+	if (cmp < 0)
+	{
+		//key在左子树中:左子树分出的右半部分再和node、node的右子树连接起来
+		AVLNode<K, V, Augment>* leftRight;
+		int leftRightH;
+		Split(nodeLeft, nodeLeftH, key, left, leftH, mid, leftRight, leftRightH);
+		right = Join(leftRight, leftRightH, node, nodeRight, nodeRightH, rightH);
+	}
+	else if (cmp > 0)
+	{
+		AVLNode<K, V, Augment>* rightLeft;
+		int rightLeftH;
+		Split(nodeRight, nodeRightH, key, rightLeft, rightLeftH, mid, right, rightH);
+		left = Join(nodeLeft, nodeLeftH, node, rightLeft, rightLeftH, leftH);
+	}
+	else
+	{
+		//找到key:左右子树就是两边的结果
+		left = nodeLeft;
+		leftH = nodeLeftH;
+		right = nodeRight;
+		rightH = nodeRightH;
+		mid = node;
+		mid->setLeft(nullptr);
+		mid->setRight(nullptr);
+		mid->setBalance(0);
+		Update(mid);
+	}
+}
+
+//并集
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::Union(AVLNode<K, V, Augment>* t1, int h1, AVLNode<K, V, Augment>* t2, int h2, int& h, DropList& dropped, TaskPool* pool, int grainH)
+{
+	if (t2 == nullptr) { h = h1; return t1; }
+	if (t1 == nullptr) { h = h2; return t2; }
+	//用t2的根把t1分开,两边分别求并,再以t2的根连接
+	int t2LeftH = h2 - (t2->balance() > 0 ? 2 : 1);
+	int t2RightH = h2 - (t2->balance() < 0 ? 2 : 1);
+	AVLNode<K, V, Augment>* t2Left = t2->left();
+	AVLNode<K, V, Augment>* t2Right = t2->right();
+	AVLNode<K, V, Augment>* left;
+	AVLNode<K, V, Augment>* mid;
+	AVLNode<K, V, Augment>* right;
+	int leftH, rightH;
+	Split(t1, h1, t2->key, left, leftH, mid, right, rightH);
+	//key相同时保留t2的节点
+	if (mid != nullptr) { dropped.Push(mid); }
+	if (pool != nullptr && max(h1, h2) >= grainH)
+	{
+		//两边的子树互不相交,可以同时计算(右边使用自己的丢弃链表)
+		DropList rightDropped;
+		pool->fork_join(
+			[&]() { left = Union(left, leftH, t2Left, t2LeftH, leftH, dropped, pool, grainH); },
+			[&]() { right = Union(right, rightH, t2Right, t2RightH, rightH, rightDropped, pool, grainH); });
+		dropped.Append(rightDropped);
+	}
+	else
+	{
+		left = Union(left, leftH, t2Left, t2LeftH, leftH, dropped, pool, grainH);
+		right = Union(right, rightH, t2Right, t2RightH, rightH, dropped, pool, grainH);
+	}
+	return Join(left, leftH, t2, right, rightH, h);
+}
+
+//交集
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::Intersect(AVLNode<K, V, Augment>* t1, int h1, const AVLNode<K, V, Augment>* t2, int& h, DropList& dropped, TaskPool* pool, int grainH)
+{
+	if (t1 == nullptr) { h = 0; return nullptr; }
+	if (t2 == nullptr)
+	{
+		DropTree(t1, dropped);
+		h = 0;
+		return nullptr;
+	}
+	AVLNode<K, V, Augment>* left;
+	AVLNode<K, V, Augment>* mid;
+	AVLNode<K, V, Augment>* right;
+	int leftH, rightH;
+	Split(t1, h1, t2->key, left, leftH, mid, right, rightH);
+	if (pool != nullptr && h1 >= grainH)
+	{
+		DropList rightDropped;
+		pool->fork_join(
+			[&]() { left = Intersect(left, leftH, t2->left(), leftH, dropped, pool, grainH); },
+			[&]() { right = Intersect(right, rightH, t2->right(), rightH, rightDropped, pool, grainH); });
+		dropped.Append(rightDropped);
+	}
+	else
+	{
+		left = Intersect(left, leftH, t2->left(), leftH, dropped, pool, grainH);
+		right = Intersect(right, rightH, t2->right(), rightH, dropped, pool, grainH);
+	}
+	//t2的key在t1中时保留t1的节点
+	if (mid != nullptr) { return Join(left, leftH, mid, right, rightH, h); }
+	return Join2(left, leftH, right, rightH, h);
+}
+
+//差集
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::Difference(AVLNode<K, V, Augment>* t1, int h1, const AVLNode<K, V, Augment>* t2, int& h, DropList& dropped, TaskPool* pool, int grainH)
+{
+	if (t1 == nullptr) { h = 0; return nullptr; }
+	if (t2 == nullptr) { h = h1; return t1; }
+	AVLNode<K, V, Augment>* left;
+	AVLNode<K, V, Augment>* mid;
+	AVLNode<K, V, Augment>* right;
+	int leftH, rightH;
+	Split(t1, h1, t2->key, left, leftH, mid, right, rightH);
+	if (mid != nullptr) { dropped.Push(mid); }
+	if (pool != nullptr && h1 >= grainH)
+	{
+		DropList rightDropped;
+		pool->fork_join(
+			[&]() { left = Difference(left, leftH, t2->left(), leftH, dropped, pool, grainH); },
+			[&]() { right = Difference(right, rightH, t2->right(), rightH, rightDropped, pool, grainH); });
+		dropped.Append(rightDropped);
+	}
+	else
+	{
+		left = Difference(left, leftH, t2->left(), leftH, dropped, pool, grainH);
+		right = Difference(right, rightH, t2->right(), rightH, dropped, pool, grainH);
+	}
+	return Join2(left, leftH, right, rightH, h);
+}
+
+//把以node为根的子树的所有节点加入list
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::DropTree(AVLNode<K, V, Augment>* node, DropList& list)
+{
+	if (node == nullptr) { return; }
+	//Push会改写右子节点,先处理两个子树
+	DropTree(node->left(), list);
+	DropTree(node->right(), list);
+	list.Push(node);
+}
+
+//释放list中的所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+size_t AVL<K, V, Compare, Alloc, Augment>::FreeDropped(DropList& list)
+{
+	size_t count = list.count;
+	for (AVLNode<K, V, Augment>* node = list.head; node != nullptr;)
+	{
+		AVLNode<K, V, Augment>* next = node->right();
+		DestroyNode(node);
+		node = next;
+	}
+	list = DropList();
+	return count;
+}
+
+//保证子树至少有grain个节点的最小高度
+template<class K, class V, class Compare, class Alloc, class Augment>
+int AVL<K, V, Compare, Alloc, Augment>::GrainHeight(size_t grain)
+{
+	//least为高度h的AVL树最少的节点数,next为高度h + 1时最少的节点数
+	int h = 0;
+	for (size_t least = 0, next = 1; least < grain; h++)
+	{
+		size_t following = least + next + 1;
+		least = next;
+		next = following;
+	}
+	return h;
+}
+
+//子树的节点数(遍历)
+template<class K, class V, class Compare, class Alloc, class Augment>
+size_t AVL<K, V, Compare, Alloc, Augment>::TreeSize(AVLNode<K, V, Augment>* node, std::false_type)
+{
+	if (node == nullptr) { return 0; }
+	return TreeSize(node->left(), std::false_type()) + TreeSize(node->right(), std::false_type()) + 1;
+}
+
+//按中序把以node为根的子树的键值移动到items中
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::MoveItems(AVLNode<K, V, Augment>* node, std::vector<std::pair<K, V>>& items)
+{
+	if (node == nullptr) { return; }
+	MoveItems(node->left(), items);
+	items.emplace_back(std::move(node->key), std::move(node->val));
+	MoveItems(node->right(), items);
+}
+
+//取走other的所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::Adopt(AVL& other, int& h, TaskPool* pool, size_t grain)
+{
+	AVLNode<K, V, Augment>* node;
+	if (alloc == other.alloc)
+	{
+		//分配器相等(例如共享同一个内存池):节点可以直接接管,由本树释放
+		node = other.root;
+		other.root = nullptr;
+		other.NodeSize = 0;
+	}
+	else
+	{
+		//否则把键值移动到本树分配器的新节点中(按中序取出,直接批量构造)
+		std::vector<std::pair<K, V>> items;
+		items.reserve(size_t(other.NodeSize));
+		MoveItems(other.root, items);
+		other.Clear();
+		auto it = std::make_move_iterator(items.begin());
+		if (pool != nullptr) { node = BuildSortedParallel(it, items.size(), *pool, grain); }
+		else { node = BuildSorted(it, items.size()); }
+	}
+	h = HeightOf(node);
+	return node;
+}
+
+//并入other的所有键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::UnionWith(AVL& other, TaskPool* pool, size_t grain)
+{
+	if (&other == this) { return; }
+	int otherSize = other.NodeSize;
+	int h2;
+	AVLNode<K, V, Augment>* t2 = Adopt(other, h2, pool, grain);
+	DropList dropped;
+	int h;
+	this->root = Union(this->root, HeightOf(this->root), t2, h2, h, dropped, pool, GrainHeight(grain));
+	this->NodeSize += otherSize - int(FreeDropped(dropped));
+}
+
+//只保留同时在other中的key
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::IntersectWith(const AVL& other, TaskPool* pool, size_t grain)
+{
+	if (&other == this) { return; }
+	DropList dropped;
+	int h;
+	this->root = Intersect(this->root, HeightOf(this->root), other.root, h, dropped, pool, GrainHeight(grain));
+	this->NodeSize -= int(FreeDropped(dropped));
+}
+
+//删除同时在other中的key
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::DifferenceWith(const AVL& other, TaskPool* pool, size_t grain)
+{
+	if (&other == this) { Clear(); return; }
+	DropList dropped;
+	int h;
+	this->root = Difference(this->root, HeightOf(this->root), other.root, h, dropped, pool, GrainHeight(grain));
+	this->NodeSize -= int(FreeDropped(dropped));
+}
+
+//删除key在[lo, hi)中的所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::erase_range(const K& lo, const K& hi)
+{
+	if (!comp(lo, hi)) { return; }
+	//先在lo处分开,再把右半部分在hi处分开,中间的部分整体释放
+	AVLNode<K, V, Augment>* left;
+	AVLNode<K, V, Augment>* mid;
+	AVLNode<K, V, Augment>* right;
+	int leftH, rightH;
+	Split(this->root, HeightOf(this->root), lo, left, leftH, mid, right, rightH);
+	DropList dropped;
+	if (mid != nullptr) { dropped.Push(mid); }
+	AVLNode<K, V, Augment>* middle;
+	int middleH;
+	Split(right, rightH, hi, middle, middleH, mid, right, rightH);
+	DropTree(middle, dropped);
+	int h;
+	//key为hi的节点保留下来,正好作为连接两边的分隔
+	this->root = mid != nullptr ? Join(left, leftH, mid, right, rightH, h) : Join2(left, leftH, right, rightH, h);
+	this->NodeSize -= int(FreeDropped(dropped));
+}
+
+//把key>=key的节点移到right中
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::split(const K& key, AVL& right)
+{
+	if (&right == this) { return; }
+	//right改为和本树共享分配器,移过去的节点之后由right释放
+	right.Clear();
+	right.alloc = alloc;
+	right.comp = comp;
+	AVLNode<K, V, Augment>* left;
+	AVLNode<K, V, Augment>* mid;
+	AVLNode<K, V, Augment>* rightPart;
+	int leftH, rightH;
+	Split(this->root, HeightOf(this->root), key, left, leftH, mid, rightPart, rightH);
+	//key本身属于右半部分(作为最小节点连接进去)
+	if (mid != nullptr) { rightPart = Join(nullptr, 0, mid, rightPart, rightH, rightH); }
+	this->root = left;
+	right.root = rightPart;
+	right.NodeSize = int(TreeSize(rightPart, std::is_same<Augment, OrderStatistic>()));
+	this->NodeSize -= right.NodeSize;
+}
+
+//把right的节点接到本树之后
+template<class K, class V, class Compare, class Alloc, class Augment>
+void AVL<K, V, Compare, Alloc, Augment>::join(AVL& right)
+{
+	if (&right == this) { return; }
+	int rightSize = right.NodeSize;
+	int rightH;
+	AVLNode<K, V, Augment>* rightPart = Adopt(right, rightH, nullptr, 0);
+	int h;
+	this->root = Join2(this->root, HeightOf(this->root), rightPart, rightH, h);
+	this->NodeSize += rightSize;
 }
 
 //返回AVL中最小值的节点
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::GetMinNode()const
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::GetMinNode()const
 {
 	return FindMinNode(this->root);
 }
 
 //返回AVL中最大值的节点
-template<class K, class V>
-AVLNode<K, V>* AVL<K, V>::GetMaxNode()const
+template<class K, class V, class Compare, class Alloc, class Augment>
+AVLNode<K, V, Augment>* AVL<K, V, Compare, Alloc, Augment>::GetMaxNode()const
 {
 	return FindMaxNode(this->root);
 }
 
-//重载[]操作符
-template<class K, class V>
-V& AVL<K, V>::operator[](const K& key)
+//冻结成只读的FrozenTree
+template<class K, class V, class Compare, class Alloc, class Augment>
+FrozenTree<K, V, Compare> AVL<K, V, Compare, Alloc, Augment>::freeze()const
 {
-	AVLNode<K, V>* node = GetNode(key);
-	if (node == nullptr)
+	return FrozenTree<K, V, Compare>(size_t(this->NodeSize), [this](auto&& push)
 	{
-		V val{};//C++ 11
-		Insert(key, val);
-		node = GetNode(key);
-	}
-	return node->val;
+		auto visit = [&push](const AVLNode<K, V, Augment>* node) { push(node->key, node->val); };
+		VisitInOrder(this->root, visit);
+	}, comp);
 }
 
 #endif // !AVLTREE_H
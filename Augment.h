@@ -0,0 +1,101 @@
+﻿#pragma once
+#ifndef AUGMENT_H
+#define AUGMENT_H
+#include <cstddef>
+#include <limits>
+
+//树节点附加信息(augmentation)的策略,作为RBT/AVL的Augment模板参数
+//策略是一个幺半群:每个节点保存以它为根的子树上所有(key, val)的聚合值
+//	value_type						聚合值的类型
+//	static value_type identity()	单位元(空子树的聚合值)
+//	static value_type combine(a, b)	合并两个相邻区间的聚合值(a在b的左边,需满足结合律)
+//	static value_type lift(key, val)单个节点的聚合值
+//树在旋转和插入/删除路径上自动维护聚合值,并提供reduce(lo, hi)在O(logn)内求出[lo, hi)的聚合值
+
+//不维护任何附加信息(默认),节点不占用额外空间
+struct NoAugment
+{
+	using value_type = void;	//没有聚合值
+};
+
+//子树大小,树因此可以在O(logn)内完成rank/select/count
+struct OrderStatistic
+{
+	using value_type = size_t;
+	static value_type identity() { return 0; }
+	static value_type combine(value_type a, value_type b) { return a + b; }
+	template<class K, class V>
+	static value_type lift(const K&, const V&) { return 1; }
+};
+
+//val的和
+template<class T>
+struct SumAggregate
+{
+	using value_type = T;
+	static value_type identity() { return T(); }
+	static value_type combine(const T& a, const T& b) { return a + b; }
+	template<class K, class V>
+	static value_type lift(const K&, const V& val) { return T(val); }
+};
+
+//val的最小值
+template<class T>
+struct MinAggregate
+{
+	using value_type = T;
+	static value_type identity() { return std::numeric_limits<T>::max(); }
+	static value_type combine(const T& a, const T& b) { return b < a ? b : a; }
+	template<class K, class V>
+	static value_type lift(const K&, const V& val) { return T(val); }
+};
+
+//val的最大值
+//区间树:key为区间左端点,val为区间右端点,子树的最大右端点即可用于剪枝查找相交的区间
+template<class T>
+struct MaxAggregate
+{
+	using value_type = T;
+	static value_type identity() { return std::numeric_limits<T>::lowest(); }
+	static value_type combine(const T& a, const T& b) { return a < b ? b : a; }
+	template<class K, class V>
+	static value_type lift(const K&, const V& val) { return T(val); }
+};
+
+//节点中存放聚合值的基类(节点类型继承它),NoAugment时为空基类
+template<class Augment>
+struct AugmentSlot
+{
+	typename Augment::value_type agg;	//以该节点为根的子树的聚合值
+};
+
+template<>
+struct AugmentSlot<NoAugment> {};
+
+//聚合值的计算
+template<class Augment>
+struct AugmentOps
+{
+	using value_type = typename Augment::value_type;
+	//空子树的聚合值为单位元
+	template<class Node>
+	static value_type Of(const Node* node) { return node == nullptr ? Augment::identity() : node->agg; }
+	//node的子树发生变化后,根据左右子节点重新计算node的聚合值
+	template<class Node>
+	static void Pull(Node* node, const Node* left, const Node* right)
+	{
+		value_type agg = Augment::lift(node->key, node->val);
+		if (left != nullptr) { agg = Augment::combine(left->agg, agg); }
+		if (right != nullptr) { agg = Augment::combine(agg, right->agg); }
+		node->agg = agg;
+	}
+};
+
+template<>
+struct AugmentOps<NoAugment>
+{
+	template<class Node>
+	static void Pull(Node*, const Node*, const Node*) {}
+};
+
+#endif // !AUGMENT_H
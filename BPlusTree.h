@@ -0,0 +1,814 @@
+﻿#pragma once
+#ifndef BPLUSTREE_H
+#define BPLUSTREE_H
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "KeySearch.h"
+#include "NodePool.h"
+
+//B+树节点的公共部分
+struct BPlusNodeBase
+{
+	int count;		//节点中键的个数
+	bool leaf;		//是否为叶子
+	explicit BPlusNodeBase(bool leaf) : count(0), leaf(leaf) {}
+};
+
+//B+树的叶子:键和值分别连续存放(查找时只扫描键数组),叶子之间按key的顺序双向链接
+template<class K, class V, int Slots>
+struct BPlusLeaf : BPlusNodeBase
+{
+	K keys[Slots];						//键
+	V vals[Slots];						//值
+	BPlusLeaf<K, V, Slots>* prev;		//前一个叶子
+	BPlusLeaf<K, V, Slots>* next;		//后一个叶子
+	BPlusLeaf() : BPlusNodeBase(true), prev(nullptr), next(nullptr) {}
+};
+
+//B+树的内部节点:children[i]中的key都小于keys[i],children[i + 1]中的key都大于等于keys[i]
+template<class K, int Slots>
+struct BPlusInner : BPlusNodeBase
+{
+	K keys[Slots];						//分隔键
+	BPlusNodeBase* children[Slots + 1];	//子节点
+	BPlusInner() : BPlusNodeBase(false) {}
+};
+
+//B+树中一个键值的引用(键值存放在叶子的数组中,没有单独的节点)
+template<class K, class V>
+struct BPlusEntry
+{
+	const K& key;
+	V& val;
+};
+
+//指向B+树中一个键值的句柄,用法和RBTNode*相同:node->key、node->val、node == nullptr(需要C++17的std::optional)
+//树被修改(插入或删除)之后失效
+template<class K, class V>
+class BPlusRef
+{
+private:
+	std::optional<BPlusEntry<K, V>> entry;	//空句柄时为空
+public:
+	BPlusRef() = default;
+	BPlusRef(std::nullptr_t) {}
+	BPlusRef(const K& key, V& val) : entry(BPlusEntry<K, V>{ key, val }) {}
+	BPlusRef(const BPlusRef&) = default;
+	//BPlusEntry中是引用,不能赋值,只能重新构造
+	BPlusRef& operator=(const BPlusRef& other)
+	{
+		if (other.entry) { entry.emplace(*other.entry); }
+		else { entry.reset(); }
+		return *this;
+	}
+	const BPlusEntry<K, V>* operator->() const { return &*entry; }
+	const BPlusEntry<K, V>& operator*() const { return *entry; }
+	explicit operator bool() const { return entry.has_value(); }
+	friend bool operator==(const BPlusRef& ref, std::nullptr_t) { return !ref.entry; }
+	friend bool operator!=(const BPlusRef& ref, std::nullptr_t) { return ref.entry.has_value(); }
+	friend bool operator==(std::nullptr_t, const BPlusRef& ref) { return !ref.entry; }
+	friend bool operator!=(std::nullptr_t, const BPlusRef& ref) { return ref.entry.has_value(); }
+};
+
+//bytes字节的节点除去overhead之后能放下几个大小为entry的元素(至少为4)
+constexpr int BPlusSlots(size_t bytes, size_t overhead, size_t entry)
+{
+	return bytes >= overhead + 4 * entry ? int((bytes - overhead) / entry) : 4;
+}
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
+//B+树:键值都存放在叶子中,每个节点大约NodeBytes字节,存放几十个键
+//树高约为log_B(n)而不是log2(n),一次查找只有几次缓存未命中;节点内的查找见KeySearch.h(整数键使用SIMD)
+//叶子串成双向链表,范围扫描和中序遍历沿链表顺序访问连续的数组
+//接口和RBT相同(Insert/Delete/Search/GetNode/operator[]/inOrder/range...),GetNode等返回BPlusRef句柄代替节点指针
+//K和V需要可以默认构造和移动赋值(节点中的数组预先构造好,插入删除时移动元素)
+template<class K, class V, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, V>>, size_t NodeBytes = 256>
+class BPlusTree
+{
+	friend struct TreeTestAccess;
+public:
+	//每个叶子和内部节点最多存放的键数(按NodeBytes估算,至少为4)
+	static const int LeafSlots = BPlusSlots(NodeBytes, sizeof(BPlusNodeBase) + 2 * sizeof(void*), sizeof(K) + sizeof(V));
+	static const int InnerSlots = BPlusSlots(NodeBytes, sizeof(BPlusNodeBase) + sizeof(void*), sizeof(K) + sizeof(void*));
+private:
+	using Leaf = BPlusLeaf<K, V, LeafSlots>;
+	using Inner = BPlusInner<K, InnerSlots>;
+	using LeafAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Leaf>;
+	using LeafTraits = std::allocator_traits<LeafAlloc>;
+	using InnerAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Inner>;
+	using InnerTraits = std::allocator_traits<InnerAlloc>;
+	static const int MinLeaf = LeafSlots / 2;		//非根叶子最少的键数
+	static const int MinInner = InnerSlots / 2;		//非根内部节点最少的键数
+	static const int MaxDepth = 64;					//内部节点的最大层数(每个内部节点至少3个子节点,足够使用)
+
+	BPlusNodeBase* root;	//根节点
+	Leaf* head;				//最左边的叶子
+	Leaf* tail;				//最右边的叶子
+	int NodeSize;			//键值数
+	int height;				//树的层数(空树为0)
+	Compare comp;			//键的比较器
+	LeafAlloc leafAlloc;	//叶子分配器
+	InnerAlloc innerAlloc;	//内部节点分配器
+
+	//从根到叶子的路径(path[d]为第d层的内部节点,index[d]为走向的子节点下标)
+	struct Path
+	{
+		Inner* nodes[MaxDepth];
+		int index[MaxDepth];
+		int depth;
+	};
+
+	//申请并构造节点
+	Leaf* NewLeaf();
+	Inner* NewInner();
+	//空树中建立根叶子(插入时在键值构造好之后才调用,构造抛出异常时树仍然为空)
+	Leaf* NewRootLeaf();
+	//析构节点并归还给分配器
+	void FreeLeaf(Leaf* leaf) { LeafTraits::destroy(leafAlloc, leaf); LeafTraits::deallocate(leafAlloc, leaf, 1); }
+	void FreeInner(Inner* inner) { InnerTraits::destroy(innerAlloc, inner); InnerTraits::deallocate(innerAlloc, inner, 1); }
+	//释放以node为根的子树
+	void ClearTree(BPlusNodeBase* node);
+	void DestroyTree(BPlusNodeBase* node);
+	//下降到key所在的叶子(path不为nullptr时记录路径)
+	Leaf* FindLeaf(const K& key, Path* path) const;
+	//叶子中第i个键值的句柄
+	static BPlusRef<K, V> RefOf(Leaf* leaf, int i) { return BPlusRef<K, V>(leaf->keys[i], leaf->vals[i]); }
+	//在叶子的pos位置插入(叶子未满)
+	static void LeafInsert(Leaf* leaf, int pos, K&& key, V&& val);
+	//在内部节点的pos位置插入分隔键key和它右边的子节点child(节点未满)
+	static void InnerInsert(Inner* inner, int pos, K&& key, BPlusNodeBase* child);
+	//在path的叶子的pos位置插入,需要时分裂并向上传递,返回插入位置的句柄
+	BPlusRef<K, V> InsertAt(Path& path, Leaf* leaf, int pos, K&& key, V&& val);
+	//叶子删除后键数不足时,向兄弟借或者和兄弟合并
+	void FixLeaf(Path& path, Leaf* leaf);
+	//path中第d层的内部节点删除后键数不足时,向兄弟借或者和兄弟合并
+	void FixInner(Path& path, int d);
+	//从内部节点中删除第pos个分隔键和它右边的子节点
+	static void InnerErase(Inner* inner, int pos);
+public:
+	//双向迭代器,按key从小到大访问,*it得到BPlusEntry(it->key、it->val),树被修改后失效
+	class iterator
+	{
+	private:
+		friend class BPlusTree;
+		Leaf* leaf;				//当前叶子(end()时为nullptr)
+		int index;				//叶子中的下标
+		const BPlusTree* tree;	//所属的树(--end()时需要找到最后一个叶子)
+		iterator(Leaf* leaf, int index, const BPlusTree* tree) : leaf(leaf), index(index), tree(tree) {}
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = BPlusEntry<K, V>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = BPlusRef<K, V>;
+		using reference = BPlusEntry<K, V>;
+
+		iterator() : leaf(nullptr), index(0), tree(nullptr) {}
+		reference operator*() const { return BPlusEntry<K, V>{ leaf->keys[index], leaf->vals[index] }; }
+		pointer operator->() const { return RefOf(leaf, index); }
+		iterator& operator++()
+		{
+			if (++index == leaf->count)
+			{
+				leaf = leaf->next;
+				index = 0;
+			}
+			return *this;
+		}
+		iterator operator++(int) { iterator old = *this; ++*this; return old; }
+		iterator& operator--()
+		{
+			if (leaf == nullptr)
+			{
+				leaf = tree->tail;
+				index = leaf->count - 1;
+			}
+			else if (index-- == 0)
+			{
+				leaf = leaf->prev;
+				index = leaf->count - 1;
+			}
+			return *this;
+		}
+		iterator operator--(int) { iterator old = *this; --*this; return old; }
+		friend bool operator==(const iterator& a, const iterator& b) { return a.leaf == b.leaf && a.index == b.index; }
+		friend bool operator!=(const iterator& a, const iterator& b) { return !(a == b); }
+	};
+
+	//构造函数
+	BPlusTree() : root(nullptr), head(nullptr), tail(nullptr), NodeSize(0), height(0) {}
+	explicit BPlusTree(const Compare& compare, const Alloc& allocator = Alloc())
+		: root(nullptr), head(nullptr), tail(nullptr), NodeSize(0), height(0), comp(compare), leafAlloc(allocator), innerAlloc(allocator) {}
+	//析构函数
+	~BPlusTree() { Clear(); }
+	//防止拷贝构造
+	BPlusTree(const BPlusTree&) = delete;
+	BPlusTree& operator=(const BPlusTree&) = delete;
+
+	//插入键值(key已存在时覆盖val)
+	void Insert(const K& key, const V& val) { insert_or_assign(key, val); }
+	//key不存在时才用args构造val,返回键值的句柄和是否插入
+	template<class... Args>
+	std::pair<BPlusRef<K, V>, bool> try_emplace(const K& key, Args&&... args);
+	//key不存在时插入,存在时把val赋给已有的键值
+	template<class M>
+	std::pair<BPlusRef<K, V>, bool> insert_or_assign(const K& key, M&& val);
+	//删除key,返回是否删除
+	bool Delete(const K& key);
+	//判断key是否存在
+	bool Search(const K& key) const { return GetNode(key) != nullptr; }
+	//清空
+	void Clear();
+	//得到key所在的键值(不存在时返回空句柄)
+	BPlusRef<K, V> GetNode(const K& key) const;
+	//最小、最大的键值
+	BPlusRef<K, V> GetMinNode() const { return head == nullptr ? BPlusRef<K, V>() : RefOf(head, 0); }
+	BPlusRef<K, V> GetMaxNode() const { return tail == nullptr ? BPlusRef<K, V>() : RefOf(tail, tail->count - 1); }
+	//树的层数
+	int GetHeight() const { return height; }
+	//键值数
+	int getNodeSize() const { return NodeSize; }
+	//中序遍历:按key从小到大对每个键值调用function(BPlusRef)
+	template<class Function>
+	void inOrder(Function&& function) const;
+
+	//有序查询(一次下降,没有时返回空句柄)
+	//最后一个key<=key的键值
+	BPlusRef<K, V> floor(const K& key) const;
+	//第一个key>=key的键值
+	BPlusRef<K, V> ceiling(const K& key) const;
+	//最后一个key<key的键值
+	BPlusRef<K, V> predecessor(const K& key) const;
+	//第一个key>key的键值
+	BPlusRef<K, V> successor(const K& key) const;
+	//按key从小到大对[lo, hi)中的每个键值调用visitor(BPlusRef),一次下降之后沿叶子链表扫描
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor) const;
+
+	//迭代器
+	iterator begin() const { return iterator(head, 0, this); }
+	iterator end() const { return iterator(nullptr, 0, this); }
+	//第一个key>=key的位置
+	iterator lower_bound(const K& key) const;
+
+	//重载[]操作符(只下降一次,key不存在时插入值初始化的val)
+	V& operator[](const K& key) { return try_emplace(key).first->val; }
+};
+
+//申请并构造叶子
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+typename BPlusTree<K, V, Compare, Alloc, NodeBytes>::Leaf* BPlusTree<K, V, Compare, Alloc, NodeBytes>::NewLeaf()
+{
+	Leaf* leaf = LeafTraits::allocate(leafAlloc, 1);
+	try
+	{
+		LeafTraits::construct(leafAlloc, leaf);
+	}
+	catch (...)
+	{
+		LeafTraits::deallocate(leafAlloc, leaf, 1);
+		throw;
+	}
+	return leaf;
+}
+
+//申请并构造内部节点
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+typename BPlusTree<K, V, Compare, Alloc, NodeBytes>::Inner* BPlusTree<K, V, Compare, Alloc, NodeBytes>::NewInner()
+{
+	Inner* inner = InnerTraits::allocate(innerAlloc, 1);
+	try
+	{
+		InnerTraits::construct(innerAlloc, inner);
+	}
+	catch (...)
+	{
+		InnerTraits::deallocate(innerAlloc, inner, 1);
+		throw;
+	}
+	return inner;
+}
+
+//空树中建立根叶子
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+typename BPlusTree<K, V, Compare, Alloc, NodeBytes>::Leaf* BPlusTree<K, V, Compare, Alloc, NodeBytes>::NewRootLeaf()
+{
+	Leaf* leaf = NewLeaf();
+	root = head = tail = leaf;
+	height = 1;
+	return leaf;
+}
+
+//释放以node为根的子树
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::ClearTree(BPlusNodeBase* node)
+{
+	if (node->leaf)
+	{
+		FreeLeaf(static_cast<Leaf*>(node));
+		return;
+	}
+	Inner* inner = static_cast<Inner*>(node);
+	for (int i = 0; i <= inner->count; i++) { ClearTree(inner->children[i]); }
+	FreeInner(inner);
+}
+
+//只析构以node为根的所有节点,不归还内存
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::DestroyTree(BPlusNodeBase* node)
+{
+	if (node->leaf)
+	{
+		LeafTraits::destroy(leafAlloc, static_cast<Leaf*>(node));
+		return;
+	}
+	Inner* inner = static_cast<Inner*>(node);
+	for (int i = 0; i <= inner->count; i++) { DestroyTree(inner->children[i]); }
+	InnerTraits::destroy(innerAlloc, inner);
+}
+
+//清空
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::Clear()
+{
+	if (root != nullptr)
+	{
+		if (CanReleaseAll(leafAlloc) && CanReleaseAll(innerAlloc))
+		{
+			//内存池只属于这棵树:平凡析构的节点连遍历都不需要,直接整块归还slab
+			if (!std::is_trivially_destructible<Leaf>::value || !std::is_trivially_destructible<Inner>::value) { DestroyTree(root); }
+			ReleaseAll(leafAlloc);
+			ReleaseAll(innerAlloc);
+		}
+		else
+		{
+			ClearTree(root);
+		}
+	}
+	root = nullptr;
+	head = tail = nullptr;
+	NodeSize = 0;
+	height = 0;
+}
+
+//下降到key所在的叶子
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+typename BPlusTree<K, V, Compare, Alloc, NodeBytes>::Leaf* BPlusTree<K, V, Compare, Alloc, NodeBytes>::FindLeaf(const K& key, Path* path) const
+{
+	if (path != nullptr) { path->depth = 0; }
+	BPlusNodeBase* node = root;
+	if (node == nullptr) { return nullptr; }
+	while (!node->leaf)
+	{
+		Inner* inner = static_cast<Inner*>(node);
+		//等于分隔键的key在右边的子树中
+		int i = CountLessEqual(inner->keys, inner->count, key, comp);
+		if (path != nullptr)
+		{
+			path->nodes[path->depth] = inner;
+			path->index[path->depth] = i;
+			path->depth++;
+		}
+		node = inner->children[i];
+	}
+	return static_cast<Leaf*>(node);
+}
+
+//在叶子的pos位置插入
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::LeafInsert(Leaf* leaf, int pos, K&& key, V&& val)
+{
+	std::move_backward(leaf->keys + pos, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+	std::move_backward(leaf->vals + pos, leaf->vals + leaf->count, leaf->vals + leaf->count + 1);
+	leaf->keys[pos] = std::move(key);
+	leaf->vals[pos] = std::move(val);
+	leaf->count++;
+}
+
+//在内部节点的pos位置插入分隔键和它右边的子节点
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::InnerInsert(Inner* inner, int pos, K&& key, BPlusNodeBase* child)
+{
+	std::move_backward(inner->keys + pos, inner->keys + inner->count, inner->keys + inner->count + 1);
+	std::move_backward(inner->children + pos + 1, inner->children + inner->count + 1, inner->children + inner->count + 2);
+	inner->keys[pos] = std::move(key);
+	inner->children[pos + 1] = child;
+	inner->count++;
+}
+
+//从内部节点中删除第pos个分隔键和它右边的子节点
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::InnerErase(Inner* inner, int pos)
+{
+	std::move(inner->keys + pos + 1, inner->keys + inner->count, inner->keys + pos);
+	std::move(inner->children + pos + 2, inner->children + inner->count + 1, inner->children + pos + 1);
+	inner->count--;
+}
+
+//在path的叶子的pos位置插入
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+BPlusRef<K, V> BPlusTree<K, V, Compare, Alloc, NodeBytes>::InsertAt(Path& path, Leaf* leaf, int pos, K&& key, V&& val)
+{
+	NodeSize++;
+	if (leaf->count < LeafSlots)
+	{
+		LeafInsert(leaf, pos, std::move(key), std::move(val));
+		return RefOf(leaf, pos);
+	}
+	//先申请好所有要分裂的节点:叶子,连续已满的祖先,以及根分裂时的新根
+	//之后的步骤只移动元素,不会在树改到一半时抛出异常
+	int fullAncestors = 0;
+	while (fullAncestors < path.depth && path.nodes[path.depth - 1 - fullAncestors]->count == InnerSlots) { fullAncestors++; }
+	bool newRoot = fullAncestors == path.depth;
+	Leaf* right;
+	Inner* spare[MaxDepth + 1];
+	int spareCount = 0;
+	try
+	{
+		right = NewLeaf();
+		try
+		{
+			for (; spareCount < fullAncestors + (newRoot ? 1 : 0); spareCount++) { spare[spareCount] = NewInner(); }
+		}
+		catch (...)
+		{
+			FreeLeaf(right);
+			throw;
+		}
+	}
+	catch (...)
+	{
+		for (int i = 0; i < spareCount; i++) { FreeInner(spare[i]); }
+		NodeSize--;
+		throw;
+	}
+	//分裂叶子:后一半移到right,再把新键值插入所在的一半
+	//在最右边的叶子末尾追加(按key递增插入)时不移动,新键值单独放进right,叶子保持全满
+	int half = pos == LeafSlots && leaf->next == nullptr ? LeafSlots : LeafSlots / 2;
+	std::move(leaf->keys + half, leaf->keys + LeafSlots, right->keys);
+	std::move(leaf->vals + half, leaf->vals + LeafSlots, right->vals);
+	right->count = LeafSlots - half;
+	leaf->count = half;
+	right->next = leaf->next;
+	right->prev = leaf;
+	if (leaf->next != nullptr) { leaf->next->prev = right; }
+	else { tail = right; }
+	leaf->next = right;
+	BPlusRef<K, V> result;
+	if (pos < half)
+	{
+		LeafInsert(leaf, pos, std::move(key), std::move(val));
+		result = RefOf(leaf, pos);
+	}
+	else
+	{
+		LeafInsert(right, pos - half, std::move(key), std::move(val));
+		result = RefOf(right, pos - half);
+	}
+	//把(right的第一个键, right)插入父节点,父节点满时继续分裂
+	K separator = right->keys[0];
+	BPlusNodeBase* child = right;
+	int used = 0;
+	for (int d = path.depth - 1; d >= 0; d--)
+	{
+		Inner* parent = path.nodes[d];
+		int i = path.index[d];
+		if (parent->count < InnerSlots)
+		{
+			InnerInsert(parent, i, std::move(separator), child);
+			return result;
+		}
+		//分裂内部节点:中间的键上移,右边的一半移到sibling
+		Inner* sibling = spare[used++];
+		int mid = (InnerSlots + 1) / 2;
+		if (i < mid)
+		{
+			//新键在左半部分:先把[mid - 1, InnerSlots)移走,keys[mid - 1]上移
+			std::move(parent->keys + mid, parent->keys + InnerSlots, sibling->keys);
+			std::move(parent->children + mid, parent->children + InnerSlots + 1, sibling->children);
+			sibling->count = InnerSlots - mid;
+			K up = std::move(parent->keys[mid - 1]);
+			parent->count = mid - 1;
+			InnerInsert(parent, i, std::move(separator), child);
+			separator = std::move(up);
+		}
+		else if (i == mid)
+		{
+			//新键正好在中间:它本身上移,child成为sibling的第一个子节点
+			std::move(parent->keys + mid, parent->keys + InnerSlots, sibling->keys);
+			std::move(parent->children + mid + 1, parent->children + InnerSlots + 1, sibling->children + 1);
+			sibling->children[0] = child;
+			sibling->count = InnerSlots - mid;
+			parent->count = mid;
+		}
+		else
+		{
+			//新键在右半部分:keys[mid]上移,[mid + 1, InnerSlots)移到sibling后再插入
+			std::move(parent->keys + mid + 1, parent->keys + InnerSlots, sibling->keys);
+			std::move(parent->children + mid + 1, parent->children + InnerSlots + 1, sibling->children);
+			sibling->count = InnerSlots - mid - 1;
+			K up = std::move(parent->keys[mid]);
+			parent->count = mid;
+			InnerInsert(sibling, i - mid - 1, std::move(separator), child);
+			separator = std::move(up);
+		}
+		child = sibling;
+	}
+	//根也分裂了:树长高一层
+	Inner* top = spare[used];
+	top->keys[0] = std::move(separator);
+	top->children[0] = root;
+	top->children[1] = child;
+	top->count = 1;
+	root = top;
+	height++;
+	return result;
+}
+
+//key不存在时才用args构造val
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+template<class... Args>
+std::pair<BPlusRef<K, V>, bool> BPlusTree<K, V, Compare, Alloc, NodeBytes>::try_emplace(const K& key, Args&&... args)
+{
+	Path path;
+	Leaf* leaf = FindLeaf(key, &path);
+	int pos = 0;
+	if (leaf != nullptr)
+	{
+		pos = CountLess(leaf->keys, leaf->count, key, comp);
+		if (pos < leaf->count && !comp(key, leaf->keys[pos])) { return std::make_pair(RefOf(leaf, pos), false); }
+	}
+	//先构造好键值再修改树
+	K newKey(key);
+	V newVal(std::forward<Args>(args)...);
+	if (leaf == nullptr) { leaf = NewRootLeaf(); }
+	return std::make_pair(InsertAt(path, leaf, pos, std::move(newKey), std::move(newVal)), true);
+}
+
+//key不存在时插入,存在时把val赋给已有的键值
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+template<class M>
+std::pair<BPlusRef<K, V>, bool> BPlusTree<K, V, Compare, Alloc, NodeBytes>::insert_or_assign(const K& key, M&& val)
+{
+	Path path;
+	Leaf* leaf = FindLeaf(key, &path);
+	int pos = 0;
+	if (leaf != nullptr)
+	{
+		pos = CountLess(leaf->keys, leaf->count, key, comp);
+		if (pos < leaf->count && !comp(key, leaf->keys[pos]))
+		{
+			leaf->vals[pos] = std::forward<M>(val);
+			return std::make_pair(RefOf(leaf, pos), false);
+		}
+	}
+	K newKey(key);
+	V newVal(std::forward<M>(val));
+	if (leaf == nullptr) { leaf = NewRootLeaf(); }
+	return std::make_pair(InsertAt(path, leaf, pos, std::move(newKey), std::move(newVal)), true);
+}
+
+//删除key
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+bool BPlusTree<K, V, Compare, Alloc, NodeBytes>::Delete(const K& key)
+{
+	Path path;
+	Leaf* leaf = FindLeaf(key, &path);
+	if (leaf == nullptr) { return false; }
+	int pos = CountLess(leaf->keys, leaf->count, key, comp);
+	if (pos == leaf->count || comp(key, leaf->keys[pos])) { return false; }
+	std::move(leaf->keys + pos + 1, leaf->keys + leaf->count, leaf->keys + pos);
+	std::move(leaf->vals + pos + 1, leaf->vals + leaf->count, leaf->vals + pos);
+	leaf->count--;
+	NodeSize--;
+	if (path.depth == 0)
+	{
+		//根是叶子:删空时整棵树为空
+		if (leaf->count == 0)
+		{
+			FreeLeaf(leaf);
+			root = nullptr;
+			head = tail = nullptr;
+			height = 0;
+		}
+		return true;
+	}
+	if (leaf->count < MinLeaf) { FixLeaf(path, leaf); }
+	return true;
+}
+
+//叶子键数不足时向兄弟借或者合并
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::FixLeaf(Path& path, Leaf* leaf)
+{
+	Inner* parent = path.nodes[path.depth - 1];
+	int i = path.index[path.depth - 1];
+	Leaf* left = i > 0 ? static_cast<Leaf*>(parent->children[i - 1]) : nullptr;
+	Leaf* right = i < parent->count ? static_cast<Leaf*>(parent->children[i + 1]) : nullptr;
+	if (left != nullptr && left->count > MinLeaf)
+	{
+		//从左兄弟借最后一个键值
+		std::move_backward(leaf->keys, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+		std::move_backward(leaf->vals, leaf->vals + leaf->count, leaf->vals + leaf->count + 1);
+		leaf->keys[0] = std::move(left->keys[left->count - 1]);
+		leaf->vals[0] = std::move(left->vals[left->count - 1]);
+		left->count--;
+		leaf->count++;
+		parent->keys[i - 1] = leaf->keys[0];
+		return;
+	}
+	if (right != nullptr && right->count > MinLeaf)
+	{
+		//从右兄弟借第一个键值
+		leaf->keys[leaf->count] = std::move(right->keys[0]);
+		leaf->vals[leaf->count] = std::move(right->vals[0]);
+		leaf->count++;
+		std::move(right->keys + 1, right->keys + right->count, right->keys);
+		std::move(right->vals + 1, right->vals + right->count, right->vals);
+		right->count--;
+		parent->keys[i] = right->keys[0];
+		return;
+	}
+	//和兄弟合并:右边的叶子并入左边的叶子,再从父节点中删除分隔键
+	int sep = i;
+	if (left != nullptr)
+	{
+		right = leaf;
+		leaf = left;
+		sep = i - 1;
+	}
+	std::move(right->keys, right->keys + right->count, leaf->keys + leaf->count);
+	std::move(right->vals, right->vals + right->count, leaf->vals + leaf->count);
+	leaf->count += right->count;
+	leaf->next = right->next;
+	if (right->next != nullptr) { right->next->prev = leaf; }
+	else { tail = leaf; }
+	FreeLeaf(right);
+	InnerErase(parent, sep);
+	FixInner(path, path.depth - 1);
+}
+
+//内部节点键数不足时向兄弟借或者合并
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::FixInner(Path& path, int d)
+{
+	Inner* node = path.nodes[d];
+	if (d == 0)
+	{
+		//根只剩一个子节点时树降低一层
+		if (node->count == 0)
+		{
+			root = node->children[0];
+			FreeInner(node);
+			height--;
+		}
+		return;
+	}
+	if (node->count >= MinInner) { return; }
+	Inner* parent = path.nodes[d - 1];
+	int i = path.index[d - 1];
+	Inner* left = i > 0 ? static_cast<Inner*>(parent->children[i - 1]) : nullptr;
+	Inner* right = i < parent->count ? static_cast<Inner*>(parent->children[i + 1]) : nullptr;
+	if (left != nullptr && left->count > MinInner)
+	{
+		//父节点的分隔键下移到node的最前面,左兄弟的最后一个键上移
+		std::move_backward(node->keys, node->keys + node->count, node->keys + node->count + 1);
+		std::move_backward(node->children, node->children + node->count + 1, node->children + node->count + 2);
+		node->keys[0] = std::move(parent->keys[i - 1]);
+		node->children[0] = left->children[left->count];
+		node->count++;
+		parent->keys[i - 1] = std::move(left->keys[left->count - 1]);
+		left->count--;
+		return;
+	}
+	if (right != nullptr && right->count > MinInner)
+	{
+		//父节点的分隔键下移到node的最后面,右兄弟的第一个键上移
+		node->keys[node->count] = std::move(parent->keys[i]);
+		node->children[node->count + 1] = right->children[0];
+		node->count++;
+		parent->keys[i] = std::move(right->keys[0]);
+		std::move(right->keys + 1, right->keys + right->count, right->keys);
+		std::move(right->children + 1, right->children + right->count + 1, right->children);
+		right->count--;
+		return;
+	}
+	//和兄弟合并:父节点的分隔键下移到两者之间
+	int sep = i;
+	if (left != nullptr)
+	{
+		right = node;
+		node = left;
+		sep = i - 1;
+	}
+	node->keys[node->count] = std::move(parent->keys[sep]);
+	std::move(right->keys, right->keys + right->count, node->keys + node->count + 1);
+	std::move(right->children, right->children + right->count + 1, node->children + node->count + 1);
+	node->count += right->count + 1;
+	FreeInner(right);
+	InnerErase(parent, sep);
+	FixInner(path, d - 1);
+}
+
+//得到key所在的键值
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+BPlusRef<K, V> BPlusTree<K, V, Compare, Alloc, NodeBytes>::GetNode(const K& key) const
+{
+	Leaf* leaf = FindLeaf(key, nullptr);
+	if (leaf == nullptr) { return BPlusRef<K, V>(); }
+	int pos = CountLess(leaf->keys, leaf->count, key, comp);
+	if (pos == leaf->count || comp(key, leaf->keys[pos])) { return BPlusRef<K, V>(); }
+	return RefOf(leaf, pos);
+}
+
+//中序遍历
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+template<class Function>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::inOrder(Function&& function) const
+{
+	for (Leaf* leaf = head; leaf != nullptr; leaf = leaf->next)
+	{
+		for (int i = 0; i < leaf->count; i++) { function(RefOf(leaf, i)); }
+	}
+}
+
+//最后一个key<=key的键值
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+BPlusRef<K, V> BPlusTree<K, V, Compare, Alloc, NodeBytes>::floor(const K& key) const
+{
+	Leaf* leaf = FindLeaf(key, nullptr);
+	if (leaf == nullptr) { return BPlusRef<K, V>(); }
+	int pos = CountLessEqual(leaf->keys, leaf->count, key, comp);
+	if (pos > 0) { return RefOf(leaf, pos - 1); }
+	//叶子中的key都大于key:答案是前一个叶子的最后一个
+	leaf = leaf->prev;
+	return leaf == nullptr ? BPlusRef<K, V>() : RefOf(leaf, leaf->count - 1);
+}
+
+//第一个key>=key的键值
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+BPlusRef<K, V> BPlusTree<K, V, Compare, Alloc, NodeBytes>::ceiling(const K& key) const
+{
+	iterator it = lower_bound(key);
+	return it == end() ? BPlusRef<K, V>() : RefOf(it.leaf, it.index);
+}
+
+//最后一个key<key的键值
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+BPlusRef<K, V> BPlusTree<K, V, Compare, Alloc, NodeBytes>::predecessor(const K& key) const
+{
+	Leaf* leaf = FindLeaf(key, nullptr);
+	if (leaf == nullptr) { return BPlusRef<K, V>(); }
+	int pos = CountLess(leaf->keys, leaf->count, key, comp);
+	if (pos > 0) { return RefOf(leaf, pos - 1); }
+	leaf = leaf->prev;
+	return leaf == nullptr ? BPlusRef<K, V>() : RefOf(leaf, leaf->count - 1);
+}
+
+//第一个key>key的键值
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+BPlusRef<K, V> BPlusTree<K, V, Compare, Alloc, NodeBytes>::successor(const K& key) const
+{
+	Leaf* leaf = FindLeaf(key, nullptr);
+	if (leaf == nullptr) { return BPlusRef<K, V>(); }
+	int pos = CountLessEqual(leaf->keys, leaf->count, key, comp);
+	if (pos < leaf->count) { return RefOf(leaf, pos); }
+	leaf = leaf->next;
+	return leaf == nullptr ? BPlusRef<K, V>() : RefOf(leaf, 0);
+}
+
+//第一个key>=key的位置
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+typename BPlusTree<K, V, Compare, Alloc, NodeBytes>::iterator BPlusTree<K, V, Compare, Alloc, NodeBytes>::lower_bound(const K& key) const
+{
+	Leaf* leaf = FindLeaf(key, nullptr);
+	if (leaf == nullptr) { return end(); }
+	int pos = CountLess(leaf->keys, leaf->count, key, comp);
+	//叶子中的key都小于key:答案是下一个叶子的第一个(叶子不为空)
+	if (pos == leaf->count) { return iterator(leaf->next, 0, this); }
+	return iterator(leaf, pos, this);
+}
+
+//按key从小到大访问[lo, hi)中的键值
+template<class K, class V, class Compare, class Alloc, size_t NodeBytes>
+template<class Visitor>
+void BPlusTree<K, V, Compare, Alloc, NodeBytes>::range(const K& lo, const K& hi, Visitor&& visitor) const
+{
+	iterator it = lower_bound(lo);
+	for (Leaf* leaf = it.leaf; leaf != nullptr; leaf = leaf->next)
+	{
+		for (int i = leaf == it.leaf ? it.index : 0; i < leaf->count; i++)
+		{
+			if (!comp(leaf->keys[i], hi)) { return; }
+			visitor(RefOf(leaf, i));
+		}
+	}
+}
+
+#endif // !BPLUSTREE_H
@@ -1,14 +1,43 @@
 ﻿#pragma once
 #ifndef _BSTTREE_H
 #define _BSTTREE_H
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "BulkBuild.h"
+#include "NodePool.h"
 #include "Tree.h"
 
-template<class T>
+//BST是多重集合:相等的值只保存一个节点,节点的count记录重复次数(重复插入同一个值不会让树变高)
+//getNodeSize()为不同值的个数,size()为包括重复在内的值的总数
+//BST插入时不旋转,但插入路径的深度超过RebalanceFactor * log2(节点数)时,按替罪羊树的方法找到失衡的祖先,
+//用Day-Stout-Warren算法原地重建那棵子树(O(子树大小)时间,O(1)额外空间),查找的最坏深度因此有上界;也可以调用rebalance()重建整棵树
+//Alloc为节点分配器(默认为NodePool内存池),会被rebind为TreeNode<T>的分配器
+template<class T, class Alloc = NodePool<T>>
 class BST :virtual public Tree<T>
 {
 protected:
-	//将树清空
+	using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<TreeNode<T>>;
+	using NodeTraits = std::allocator_traits<NodeAlloc>;
+	NodeAlloc alloc;	//节点分配器
+	size_t ValueSize = 0;	//包括重复在内的值的总数
+	double RebalanceFactor = 2.0;	//深度超过RebalanceFactor * log2(节点数)时重建(0为不自动重建)
+	size_t MaxNodeSize = 0;			//上次重建整棵树之后节点数的最大值(删除过多时重建整棵树)
+	bool DeleteFromLeft = false;	//删除有两个子节点的节点时,交替使用前驱和后继
+
+	//从分配器中申请并构造一个节点
+	template<class... Args>
+	TreeNode<T>* CreateNode(Args&&... args);
+	//析构节点并归还给分配器
+	void DestroyNode(TreeNode<T>* node);
+	//将树清空(逐个释放节点)
 	void ClearTree(TreeNode<T>* node);
+	//只析构以node为根的所有节点,不归还内存(内存随后由分配器整体释放)
+	void DestroyTree(TreeNode<T>* node);
 	//插入节点的辅助函数(递归实现)
 	virtual TreeNode<T>* InsertNode(TreeNode<T>* node, const T& val);
 	//删除节点的辅助函数
@@ -17,16 +46,61 @@ protected:
 	TreeNode<T>* FindMinNode(TreeNode<T>* node)const;
 	//找到以node节点为根节点的的最大值节点
 	TreeNode<T>* FindMaxNode(TreeNode<T>* node)const;
+	//用it开始的n个不同的值(相等的连续值合并为一个节点)建出完全平衡的子树,it随之前进
+	template<class ForwardIt>
+	TreeNode<T>* BuildSorted(ForwardIt& it, ForwardIt last, size_t n);
+	//node的val又出现了一次
+	static void AddCount(TreeNode<T>* node);
+	//DSW第一步:通过右旋把以root为根的子树拉直成只有右链的"藤",返回节点数
+	static size_t TreeToVine(TreeNode<T>*& root);
+	//沿藤的右链做count次左旋,每次把右链上相邻的两个节点中的上一个变成下一个的左子节点
+	static void Compress(TreeNode<T>*& root, size_t count);
+	//DSW第二步:把n个节点的藤压缩成完全平衡的树(最后一层从左边填起)
+	static void VineToTree(TreeNode<T>*& root, size_t n);
+	//原地重建以root为根的子树
+	static void Rebuild(TreeNode<T>*& root);
+	//在depth深度插入了新节点val后,找到替罪羊(高度超过RebalanceFactor * log2(子树大小)的最低祖先)并重建它
+	void RebalanceAfterInsert(const T& val, size_t depth);
+	//删除节点之后,节点数降到MaxNodeSize的2^(-1/RebalanceFactor)以下时重建整棵树(深度上限随节点数变小了)
+	void RebalanceAfterDelete();
 public:
 	//构造函数(会自动调用父类的构造函数)
 	BST() {}
+	explicit BST(const Alloc& allocator) : alloc(allocator) {}
+	//批量构造(O(n),不做比较):[first, last)中的值必须非递减
+	template<class ForwardIt>
+	BST(sorted_input_t, ForwardIt first, ForwardIt last, const Alloc& allocator = Alloc()) : alloc(allocator) { build_from_sorted(first, last); }
+	//输入无序时先排序再批量构造
+	template<class InputIt>
+	BST(InputIt first, InputIt last, const Alloc& allocator = Alloc()) : alloc(allocator) { build(first, last); }
 	//析构函数
-	~BST() { ClearTree(this->root); this->root = nullptr; this->NodeSize = 0; }
+	~BST() { Clear(); }
+
+	//BST树清空(独占内存池时整块释放slab,不需要逐个释放节点)
+	void Clear();
+	//清空后从非递减的[first, last)批量构造,O(n)
+	template<class ForwardIt>
+	void build_from_sorted(ForwardIt first, ForwardIt last);
+	//清空后从任意顺序的[first, last)批量构造(先排序,大规模输入使用并行排序)
+	template<class InputIt>
+	void build(InputIt first, InputIt last);
 
-	//插入节点的函数
+	//插入节点的函数(val已存在时只增加它的count)
 	void Insert(const T& val);
-	//删除节点的函数
+	//删除一个val(count大于1时只减少count)
 	void Delete(const T& val);
+	//删除所有的val,返回删除的个数
+	size_t DeleteAll(const T& val);
+	//val出现的次数,O(h)
+	size_t count(const T& val) { TreeNode<T>* node = GetNode(val); return node == nullptr ? 0 : node->count; }
+	//和val相等的所有值:相等的值只保存一个节点,返回(节点中保存的值, 出现次数),不存在时为(nullptr, 0),O(h)
+	std::pair<const T*, size_t> equal_range(const T& val);
+	//包括重复在内的值的总数
+	size_t size()const { return ValueSize; }
+	//原地把整棵树重建成完全平衡的树,O(n)时间,O(1)额外空间
+	void rebalance() { Rebuild(this->root); MaxNodeSize = size_t(this->NodeSize); }
+	//设置自动重建的深度上限倍数(必须大于1,0表示不自动重建);倍数越小树越矮,但重建越频繁
+	void set_rebalance_factor(double factor);
 	//判断BST中是否存在val
 	bool Search(const T& val);
 	//得到BST中指定值的节点
@@ -42,30 +116,221 @@ public:
 //但是.cpp太难看了,去掉.cpp使得BSTree.cpp变为BSTree文件(就像iostream一样)也可以编译使用,但感觉还是挺难看的
 //所以还是直接全都写在一起算了,定义在前,实现在后
 
+//从分配器中申请并构造一个节点
+template<class T, class Alloc>
+template<class... Args>
+inline TreeNode<T>* BST<T, Alloc>::CreateNode(Args&&... args)
+{
+	TreeNode<T>* node = NodeTraits::allocate(alloc, 1);
+	try
+	{
+		NodeTraits::construct(alloc, node, std::forward<Args>(args)...);
+	}
+	catch (...)
+	{
+		NodeTraits::deallocate(alloc, node, 1);
+		throw;
+	}
+	return node;
+}
+
+//析构节点并归还给分配器
+template<class T, class Alloc>
+inline void BST<T, Alloc>::DestroyNode(TreeNode<T>* node)
+{
+	NodeTraits::destroy(alloc, node);
+	NodeTraits::deallocate(alloc, node, 1);
+}
+
 //将树清空,inline 内联函数
-template<class T>
-inline void BST<T>::ClearTree(TreeNode<T>* node)
+template<class T, class Alloc>
+inline void BST<T, Alloc>::ClearTree(TreeNode<T>* node)
 {
 	if (node != nullptr)
 	{
 		ClearTree(node->left);
 		ClearTree(node->right);
-		delete node;
+		DestroyNode(node);
+	}
+}
+
+//只析构以node为根的所有节点,不归还内存
+template<class T, class Alloc>
+void BST<T, Alloc>::DestroyTree(TreeNode<T>* node)
+{
+	if (node != nullptr)
+	{
+		DestroyTree(node->left);
+		DestroyTree(node->right);
+		NodeTraits::destroy(alloc, node);
+	}
+}
+
+//BST树清空
+template<class T, class Alloc>
+void BST<T, Alloc>::Clear()
+{
+	if (CanReleaseAll(alloc))
+	{
+		//内存池只属于这棵树:平凡析构的节点连遍历都不需要,直接整块归还slab
+		if (!std::is_trivially_destructible<TreeNode<T>>::value) { DestroyTree(this->root); }
+		ReleaseAll(alloc);
+	}
+	else
+	{
+		ClearTree(this->root);
+	}
+	this->root = nullptr;
+	this->NodeSize = 0;
+	ValueSize = 0;
+	MaxNodeSize = 0;
+}
+
+//设置自动重建的深度上限倍数
+template<class T, class Alloc>
+void BST<T, Alloc>::set_rebalance_factor(double factor)
+{
+	//完全平衡的树深度也接近log2(n),倍数不大于1时几乎每次插入都要重建
+	if (factor != 0 && !(factor > 1)) { throw std::invalid_argument("BST: rebalance factor must be greater than 1"); }
+	RebalanceFactor = factor;
+	MaxNodeSize = size_t(this->NodeSize);
+}
+
+//把子树拉直成藤
+template<class T, class Alloc>
+size_t BST<T, Alloc>::TreeToVine(TreeNode<T>*& root)
+{
+	size_t n = 0;
+	//link指向藤上当前位置的指针(root或上一个节点的right)
+	TreeNode<T>** link = &root;
+	while (*link != nullptr)
+	{
+		TreeNode<T>* node = *link;
+		if (node->left != nullptr)
+		{
+			//右旋,把左子节点提到藤上
+			TreeNode<T>* left = node->left;
+			node->left = left->right;
+			left->right = node;
+			*link = left;
+		}
+		else
+		{
+			//没有左子节点,node已经在藤上
+			n++;
+			link = &node->right;
+		}
+	}
+	return n;
+}
+
+//沿右链做count次左旋
+template<class T, class Alloc>
+void BST<T, Alloc>::Compress(TreeNode<T>*& root, size_t count)
+{
+	TreeNode<T>** link = &root;
+	for (size_t i = 0; i < count; i++)
+	{
+		TreeNode<T>* child = *link;
+		TreeNode<T>* next = child->right;
+		child->right = next->left;
+		next->left = child;
+		*link = next;
+		link = &next->right;
+	}
+}
+
+//把藤压缩成完全平衡的树
+template<class T, class Alloc>
+void BST<T, Alloc>::VineToTree(TreeNode<T>*& root, size_t n)
+{
+	//先把最后一层(不满的那层)的节点旋下去,剩下的size个节点正好是满二叉树
+	size_t full = 1;
+	while (full <= (n + 1) / 2) { full *= 2; }
+	size_t size = full - 1;
+	Compress(root, n - size);
+	//每一轮把右链上的节点数减半
+	while (size > 1)
+	{
+		size /= 2;
+		Compress(root, size);
+	}
+}
+
+//原地重建子树
+template<class T, class Alloc>
+inline void BST<T, Alloc>::Rebuild(TreeNode<T>*& root)
+{
+	VineToTree(root, TreeToVine(root));
+}
+
+//删除节点之后检查是否需要重建整棵树
+template<class T, class Alloc>
+inline void BST<T, Alloc>::RebalanceAfterDelete()
+{
+	if (RebalanceFactor != 0 && double(this->NodeSize) < double(MaxNodeSize) * std::exp2(-1.0 / RebalanceFactor))
+	{
+		rebalance();
+	}
+}
+
+//插入之后找到替罪羊并重建
+template<class T, class Alloc>
+void BST<T, Alloc>::RebalanceAfterInsert(const T& val, size_t depth)
+{
+	//重新下降一次,记录从根到新节点路径上的每个链接(深度已经超过上限,只在很少的插入中发生)
+	std::vector<TreeNode<T>**> path;
+	path.reserve(depth);
+	TreeNode<T>** link = &this->root;
+	while (!((*link)->val == val))
+	{
+		path.push_back(link);
+		link = (*link)->val > val ? &(*link)->left : &(*link)->right;
+	}
+	//从新节点向上,逐个计算祖先的子树大小
+	//兄弟子树的大小用TreeToVine来数(不需要栈):它属于替罪羊的子树,反正马上就要被重建
+	//在根处深度一定超过上限,所以一定能找到替罪羊;计数的代价和重建替罪羊的代价相同
+	TreeNode<T>* child = *link;
+	size_t size = 1;
+	for (size_t i = path.size(); i-- > 0;)
+	{
+		TreeNode<T>* parent = *path[i];
+		size += 1 + TreeToVine(parent->left == child ? parent->right : parent->left);
+		if (double(path.size() - i) > RebalanceFactor * std::log2(double(size)))
+		{
+			VineToTree(*path[i], TreeToVine(*path[i]));
+			//重建了整棵树时重新开始计算删除的次数
+			if (i == 0) { MaxNodeSize = size_t(this->NodeSize); }
+			return;
+		}
+		child = parent;
 	}
 }
 
+//node的val又出现了一次
+template<class T, class Alloc>
+inline void BST<T, Alloc>::AddCount(TreeNode<T>* node)
+{
+	if (node->count == UINT32_MAX) { throw std::length_error("BST: too many copies of one value"); }
+	node->count++;
+}
+
 //插入节点的辅助函数(递归实现)
-template <class T>
-TreeNode<T>* BST<T>::InsertNode(TreeNode<T>* node, const T& val)
+template<class T, class Alloc>
+TreeNode<T>* BST<T, Alloc>::InsertNode(TreeNode<T>* node, const T& val)
 {
 	if (node == nullptr)
 	{
-		node = new TreeNode<T>(val);
+		node = CreateNode(val);
 		this->NodeSize++;
 	}
 	else
 	{
-		if (node->val >= val)
+		if (node->val == val)
+		{
+			AddCount(node);
+		}
+		else if (node->val > val)
 		{
 			node->left = InsertNode(node->left, val);
 		}
@@ -78,8 +343,8 @@ TreeNode<T>* BST<T>::InsertNode(TreeNode<T>* node, const T& val)
 }
 
 //删除节点的辅助函数(递归实现)
-template<class T>
-TreeNode<T>* BST<T>::DeleteNode(TreeNode<T>* node, const T& key)
+template<class T, class Alloc>
+TreeNode<T>* BST<T, Alloc>::DeleteNode(TreeNode<T>* node, const T& key)
 {
 	//递归终止条件
 	if (node == nullptr) { return node; }
@@ -97,6 +362,12 @@ TreeNode<T>* BST<T>::DeleteNode(TreeNode<T>* node, const T& key)
 	else
 	{
 		//当node->val == key 时
+		//还有重复的值时只减少count
+		if (node->count > 1)
+		{
+			node->count--;
+			return node;
+		}
 		//case 1: node为叶子节点,这种情况下直接将node删除即可
 		//case 2: node节点只有左子树/右子树(这种情况可以包括case 1)
 		//case 3: node节点既有左子树又有右子树(利用前驱节点来修改)
@@ -105,7 +376,7 @@ TreeNode<T>* BST<T>::DeleteNode(TreeNode<T>* node, const T& key)
 			//只有右子树
 			TreeNode<T>* tempNode = node;//保存node指针
 			node = node->right;			 //直接将node换成它的子节点
-			delete tempNode;			 //释放原node节点的空间
+			DestroyNode(tempNode);		 //释放原node节点的空间
 			this->NodeSize--;			 //节点数减小
 		}
 		else if (node->right == nullptr)
@@ -113,7 +384,7 @@ TreeNode<T>* BST<T>::DeleteNode(TreeNode<T>* node, const T& key)
 			//只有左子树
 			TreeNode<T>* tempNode = node;//保存node指针
 			node = node->left;			 //直接将node换成它的子节点
-			delete tempNode;			 //释放原node节点的空间
+			DestroyNode(tempNode);		 //释放原node节点的空间
 			this->NodeSize--;			 //节点数减小
 		}
 		else
@@ -123,17 +394,18 @@ TreeNode<T>* BST<T>::DeleteNode(TreeNode<T>* node, const T& key)
 			//由于BST树的中序遍历为有序上升数组
 			//因此对node的前驱一定为中序遍历中排在node前面的那个数
 			//因此node的前驱pre一定为叶子节点或者只有左子树的节点（因为node是第一个大于pre的节点）
-			srand(time(NULL));
-			int randNum = rand() % 100;
-			//为了避免一直删除前驱节点造成的不平衡影响,使用rand使得随机删除前驱或者后继
-			if ((randNum & 1) == 0)
+			//为了避免一直删除前驱节点造成的不平衡影响,交替删除前驱或者后继
+			DeleteFromLeft = !DeleteFromLeft;
+			if (DeleteFromLeft)
 			{
 				//找到前驱节点
 				TreeNode<T>* preNode = FindMaxNode(node->left);
-				//找到前驱节点之后,交换preNode和node的值
+				//找到前驱节点之后,交换preNode和node的值(连同count一起)
 				node->val = preNode->val;
+				node->count = preNode->count;
 				//接下来继续递归,从node的左子树出发,删除tempNode->val值的节点
-				//(此时要删除的节点一定属于case 1或case 2)
+				//(此时要删除的节点一定属于case 1或case 2,先把count置为1使它被整个删除)
+				preNode->count = 1;
 				node->left = DeleteNode(node->left, preNode->val);
 			}
 			else
@@ -142,6 +414,8 @@ TreeNode<T>* BST<T>::DeleteNode(TreeNode<T>* node, const T& key)
 				TreeNode<T>* nextNode = FindMinNode(node->right);
 				//交换node和nextNode的值
 				node->val = nextNode->val;
+				node->count = nextNode->count;
+				nextNode->count = 1;
 				node->right = DeleteNode(node->right, nextNode->val);
 			}
 		}
@@ -151,8 +425,8 @@ TreeNode<T>* BST<T>::DeleteNode(TreeNode<T>* node, const T& key)
 }
 
 //返回BST中最小值的节点
-template<class T>
-TreeNode<T>* BST<T>::FindMinNode(TreeNode<T>* node)const
+template<class T, class Alloc>
+TreeNode<T>* BST<T, Alloc>::FindMinNode(TreeNode<T>* node)const
 {
 	TreeNode<T>* tempNode = node;
 	if (tempNode != nullptr)
@@ -166,8 +440,8 @@ TreeNode<T>* BST<T>::FindMinNode(TreeNode<T>* node)const
 }
 
 //返回BST中最大值的节点
-template<class T>
-TreeNode<T>* BST<T>::FindMaxNode(TreeNode<T>* node)const
+template<class T, class Alloc>
+TreeNode<T>* BST<T, Alloc>::FindMaxNode(TreeNode<T>* node)const
 {
 	TreeNode<T>* tempNode = node;
 	if (tempNode != nullptr)
@@ -180,63 +454,155 @@ TreeNode<T>* BST<T>::FindMaxNode(TreeNode<T>* node)const
 	return tempNode;
 }
 
+//用it开始的n个不同的值建出完全平衡的子树
+template<class T, class Alloc>
+template<class ForwardIt>
+TreeNode<T>* BST<T, Alloc>::BuildSorted(ForwardIt& it, ForwardIt last, size_t n)
+{
+	if (n == 0) { return nullptr; }
+	//按中序消费元素:先建左子树,再建根,最后建右子树
+	size_t leftSize = (n - 1) / 2;
+	TreeNode<T>* left = BuildSorted(it, last, leftSize);
+	TreeNode<T>* node;
+	try
+	{
+		node = CreateNode(*it);
+		//和它相等的连续值并入这个节点
+		for (++it; it != last && *it == node->val; ++it) { AddCount(node); }
+	}
+	catch (...)
+	{
+		ClearTree(left);
+		throw;
+	}
+	node->left = left;
+	try
+	{
+		node->right = BuildSorted(it, last, n - 1 - leftSize);
+	}
+	catch (...)
+	{
+		ClearTree(node);
+		throw;
+	}
+	return node;
+}
+
+//清空后从非递减的[first, last)批量构造
+template<class T, class Alloc>
+template<class ForwardIt>
+void BST<T, Alloc>::build_from_sorted(ForwardIt first, ForwardIt last)
+{
+	Clear();
+	//先数出不同的值的个数,相等的连续值合并为一个节点
+	size_t total = 0;
+	size_t n = 0;
+	for (ForwardIt it = first, prev = first; it != last; ++it, total++)
+	{
+		if (it == first || !(*it == *prev)) { n++; }
+		prev = it;
+	}
+	this->root = BuildSorted(first, last, n);
+	this->NodeSize = int(n);
+	ValueSize = total;
+	MaxNodeSize = n;
+}
+
+//清空后从任意顺序的[first, last)批量构造
+template<class T, class Alloc>
+template<class InputIt>
+void BST<T, Alloc>::build(InputIt first, InputIt last)
+{
+	//BST允许重复值,排序后直接构造(相等的值合并为一个节点)
+	std::vector<T> items(first, last);
+	BulkSort(items.begin(), items.end(), [](const T& a, const T& b) { return a < b; });
+	build_from_sorted(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+}
+
 //插入函数的实现
-template<class T>
-void BST<T>::Insert(const T& val)
+template<class T, class Alloc>
+void BST<T, Alloc>::Insert(const T& val)
 {
 	//迭代实现
 	if (this->root == nullptr)
 	{
-		this->root = new TreeNode<T>(val);
+		this->root = CreateNode(val);
 		this->NodeSize++;
 	}
 	else
 	{
 		//否则寻找合适的位置插入
 		TreeNode<T>* tempNode = this->root;
-		while (tempNode != nullptr)
+		size_t depth = 1;	//新节点的深度(根为0)
+		for (;; depth++)
 		{
-			if (tempNode->val >= val)
+			if (tempNode->val == val)
 			{
-				//说明应该向左走
-				if (tempNode->left == nullptr)
-				{
-					tempNode->left = new TreeNode<T>(val);
-					this->NodeSize++;
-					return;
-				}
-				tempNode = tempNode->left;
+				//已经存在,只增加count
+				AddCount(tempNode);
+				break;
 			}
-			else
+			//说明应该向左走,否则走右边
+			TreeNode<T>*& child = tempNode->val > val ? tempNode->left : tempNode->right;
+			if (child == nullptr)
 			{
-				//否则走右边
-				if (tempNode->right == nullptr)
+				child = CreateNode(val);
+				this->NodeSize++;
+				if (size_t(this->NodeSize) > MaxNodeSize) { MaxNodeSize = size_t(this->NodeSize); }
+				//太深了就找到替罪羊重建
+				if (RebalanceFactor != 0 && double(depth) > RebalanceFactor * std::log2(double(this->NodeSize)))
 				{
-					tempNode->right = new TreeNode<T>(val);
-					this->NodeSize++;
-					return;
+					RebalanceAfterInsert(val, depth);
 				}
-				tempNode = tempNode->right;
+				break;
 			}
+			tempNode = child;
 		}
 	}
+	ValueSize++;
 
 	//递归实现(调用递归函数)
 	//this->root = InsertNode(this->root, val);
+	//ValueSize++;
 }
 
 //删除值为val的节点
-template<class T>
-void BST<T>::Delete(const T& val)
+template<class T, class Alloc>
+void BST<T, Alloc>::Delete(const T& val)
 {
 	if (this->NodeSize <= 0) { return; }
-	//删除一个值为val的节点
+	TreeNode<T>* node = GetNode(val);
+	if (node == nullptr) { return; }
+	ValueSize--;
+	//还有重复的值时只减少count,否则删除这个节点
+	if (node->count > 1)
+	{
+		node->count--;
+		return;
+	}
 	this->root = DeleteNode(this->root, val);
+	RebalanceAfterDelete();
+}
+
+//删除所有的val
+template<class T, class Alloc>
+size_t BST<T, Alloc>::DeleteAll(const T& val)
+{
+	if (this->NodeSize <= 0) { return 0; }
+	TreeNode<T>* node = GetNode(val);
+	if (node == nullptr) { return 0; }
+	size_t removed = node->count;
+	ValueSize -= removed;
+	//count置为1后DeleteNode会删除整个节点
+	node->count = 1;
+	this->root = DeleteNode(this->root, val);
+	RebalanceAfterDelete();
+	return removed;
 }
 
 //判断BST中是否存在val
-template<class T>
-bool BST<T>::Search(const T& val)
+template<class T, class Alloc>
+bool BST<T, Alloc>::Search(const T& val)
 {
 	TreeNode<T>* tempNode = this->root;
 	while (tempNode != nullptr)
@@ -260,9 +626,18 @@ bool BST<T>::Search(const T& val)
 	return false;
 }
 
+//和val相等的所有值
+template<class T, class Alloc>
+std::pair<const T*, size_t> BST<T, Alloc>::equal_range(const T& val)
+{
+	TreeNode<T>* node = GetNode(val);
+	if (node == nullptr) { return std::pair<const T*, size_t>(nullptr, 0); }
+	return std::pair<const T*, size_t>(&node->val, node->count);
+}
+
 //得到BST中指定值的节点
-template<class T>
-TreeNode<T>* BST<T>::GetNode(const T& val)
+template<class T, class Alloc>
+TreeNode<T>* BST<T, Alloc>::GetNode(const T& val)
 {
 	TreeNode<T>* tempNode = this->root;
 	while (tempNode != nullptr && tempNode->val != val)
@@ -281,15 +656,15 @@ TreeNode<T>* BST<T>::GetNode(const T& val)
 }
 
 //返回BST中最小值的节点
-template<class T>
-TreeNode<T>* BST<T>::GetMinNode()
+template<class T, class Alloc>
+TreeNode<T>* BST<T, Alloc>::GetMinNode()
 {
 	return FindMinNode(this->root);
 }
 
 //返回BST中最大值的节点
-template<class T>
-TreeNode<T>* BST<T>::GetMaxNode()
+template<class T, class Alloc>
+TreeNode<T>* BST<T, Alloc>::GetMaxNode()
 {
 	return FindMaxNode(this->root);
 }
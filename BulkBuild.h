@@ -0,0 +1,77 @@
+﻿#pragma once
+#ifndef BULKBUILD_H
+#define BULKBUILD_H
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+//并行排序:自带并行后端的标准库(如MSVC)默认开启
+//libstdc++的并行算法需要链接TBB(-ltbb),因此要定义TREE_PARALLEL_SORT才会开启
+#if defined(__cpp_lib_parallel_algorithm) && (defined(TREE_PARALLEL_SORT) || !defined(__GLIBCXX__))
+#define TREE_USE_PARALLEL_SORT
+#include <execution>
+#endif
+
+//批量构造:从有序序列在O(n)内直接建出完全平衡的树,不做任何比较,也没有旋转
+
+//标记输入已经有序的构造函数参数
+//RBT/AVL要求key严格递增(没有重复key),BST要求val非递减
+struct sorted_input_t { explicit sorted_input_t() = default; };
+constexpr sorted_input_t sorted_input{};
+
+//n个节点按中点递归建树时的高度(即n的二进制位数)
+inline int BalancedHeight(size_t n)
+{
+	int height = 0;
+	for (; n != 0; n >>= 1) { height++; }
+	return height;
+}
+
+//n个节点按中点递归建树时需要染成红色的层(根为第0层)
+//只有最深的一层可能不满,把这一层染红,其余层全黑,所有路径上的黑节点数就相同了
+//n = 2^k - 1时树是满的,返回的层不存在,所有节点都是黑色
+inline int RedLevel(size_t n)
+{
+	int level = 0;
+	for (ptrdiff_t m = ptrdiff_t(n) - 1; m >= 0; m = m / 2 - 1) { level++; }
+	return level;
+}
+
+//排序达到这个规模才使用并行排序(规模太小时线程开销大于收益)
+const size_t ParallelSortThreshold = size_t(1) << 15;
+
+//稳定排序(相等元素保持原来的顺序),开启并行排序时对大规模输入使用std::execution::par
+template<class RandomIt, class Less>
+void BulkSort(RandomIt first, RandomIt last, Less less)
+{
+#ifdef TREE_USE_PARALLEL_SORT
+	if (size_t(last - first) >= ParallelSortThreshold)
+	{
+		std::stable_sort(std::execution::par, first, last, less);
+		return;
+	}
+#endif
+	std::stable_sort(first, last, less);
+}
+
+//把[first, last)复制到连续的缓冲区中按key稳定排序,相同的key只保留最后一个(和逐个Insert的结果相同)
+//返回的序列key严格递增,可以直接用于RBT/AVL的build_from_sorted
+template<class K, class V, class InputIt, class Compare>
+std::vector<std::pair<K, V>> SortedUniqueItems(InputIt first, InputIt last, const Compare& comp)
+{
+	//稳定排序后相同的key相邻并保持输入顺序
+	std::vector<std::pair<K, V>> items(first, last);
+	BulkSort(items.begin(), items.end(), [&comp](const std::pair<K, V>& a, const std::pair<K, V>& b) { return comp(a.first, b.first); });
+	size_t count = 0;
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		if (i + 1 < items.size() && !comp(items[i].first, items[i + 1].first)) { continue; }
+		if (count != i) { items[count] = std::move(items[i]); }
+		count++;
+	}
+	items.erase(items.begin() + count, items.end());
+	return items;
+}
+
+#endif // !BULKBUILD_H
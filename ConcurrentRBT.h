@@ -0,0 +1,120 @@
+﻿#pragma once
+#ifndef CONCURRENTRBT_H
+#define CONCURRENTRBT_H
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "RBTree.h"
+#include "NodeEntry.h"
+#include "ReadWriteLock.h"
+
+//线程安全的红黑树:用一把读写锁保护一棵RBT
+//查询(Search/Get/有序查询/范围扫描/聚合)持有共享锁,多个读线程可以同时进行;修改持有独占锁
+//锁为写优先的ReadWriteLock(见ReadWriteLock.h),读线程之间不争用缓存行,持续的读也不会饿死写者
+//查询结果都按值返回(拷贝出key和val,见NodeEntry.h),RBTNode*不会离开锁的保护范围
+//visitor和read/write的回调在锁内执行,不能再调用同一个ConcurrentRBT(读写锁不可重入)
+template<class K, class V, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, V>>, class Augment = NoAugment>
+class ConcurrentRBT
+{
+private:
+	using Tree = RBT<K, V, Compare, Alloc, Augment>;
+	using Node = RBTNode<K, V, Augment>;
+	using ReadLock = std::shared_lock<ReadWriteLock>;
+	using WriteLock = std::unique_lock<ReadWriteLock>;
+	mutable ReadWriteLock lock;			//读写锁
+	Tree tree;							//被保护的树
+
+public:
+	//构造函数
+	ConcurrentRBT() = default;
+	explicit ConcurrentRBT(const Compare& compare, const Alloc& allocator = Alloc()) : tree(compare, allocator) {}
+	explicit ConcurrentRBT(const Alloc& allocator) : tree(allocator) {}
+	//防止拷贝构造
+	ConcurrentRBT(const ConcurrentRBT&) = delete;
+	ConcurrentRBT& operator=(const ConcurrentRBT&) = delete;
+
+	//修改(独占锁)
+	//插入键值(key已存在时覆盖val)
+	void Insert(const K& key, const V& val) { WriteLock guard(lock); tree.Insert(key, val); }
+	void Insert(K&& key, V&& val) { WriteLock guard(lock); tree.Insert(std::move(key), std::move(val)); }
+	//用args原地构造节点(key为第一个参数),key已存在时不插入,返回是否插入
+	template<class... Args>
+	bool emplace(Args&&... args) { WriteLock guard(lock); return tree.emplace(std::forward<Args>(args)...).second; }
+	//key不存在时才用args构造val,返回是否插入
+	template<class... Args>
+	bool try_emplace(const K& key, Args&&... args) { WriteLock guard(lock); return tree.try_emplace(key, std::forward<Args>(args)...).second; }
+	//key不存在时插入,存在时覆盖val,返回是否插入了新节点
+	template<class M>
+	bool insert_or_assign(const K& key, M&& val) { WriteLock guard(lock); return tree.insert_or_assign(key, std::forward<M>(val)).second; }
+	//删除key
+	void Delete(const K& key) { WriteLock guard(lock); tree.Delete(key); }
+	//删除key在[lo, hi)中的所有节点
+	void erase_range(const K& lo, const K& hi) { WriteLock guard(lock); tree.erase_range(lo, hi); }
+	//清空
+	void Clear() { WriteLock guard(lock); tree.Clear(); }
+	//key存在时在锁内调用f(V&)原地修改val(并重新计算聚合值),返回key是否存在
+	template<class F>
+	bool update(const K& key, F&& f)
+	{
+		WriteLock guard(lock);
+		Node* node = tree.GetNode(key);
+		if (node == nullptr) { return false; }
+		f(node->val);
+		tree.refresh(key);
+		return true;
+	}
+	//在独占锁内调用f(RBT&)做一组修改(例如批量插入),只加一次锁;f返回后不能再保留树中的节点指针
+	template<class F>
+	auto write(F&& f) -> decltype(f(std::declval<Tree&>())) { WriteLock guard(lock); return f(tree); }
+
+	//查询(共享锁)
+	//判断key是否存在
+	bool Search(const K& key) const { ReadLock guard(lock); return tree.Search(key); }
+	//key对应的val的拷贝(不存在时返回空)
+	std::optional<V> Get(const K& key) const
+	{
+		ReadLock guard(lock);
+		const Node* node = tree.GetNode(key);
+		if (node == nullptr) { return std::nullopt; }
+		return node->val;
+	}
+	//节点数
+	int getNodeSize() const { ReadLock guard(lock); return tree.getNodeSize(); }
+	//最小、最大的键值
+	std::optional<std::pair<K, V>> GetMin() const { ReadLock guard(lock); return CopyEntry<K, V>(tree.GetMinNode()); }
+	std::optional<std::pair<K, V>> GetMax() const { ReadLock guard(lock); return CopyEntry<K, V>(tree.GetMaxNode()); }
+	//最后一个key<=key的键值
+	std::optional<std::pair<K, V>> floor(const K& key) const { ReadLock guard(lock); return CopyEntry<K, V>(tree.floor(key)); }
+	//第一个key>=key的键值
+	std::optional<std::pair<K, V>> ceiling(const K& key) const { ReadLock guard(lock); return CopyEntry<K, V>(tree.ceiling(key)); }
+	//最后一个key<key的键值
+	std::optional<std::pair<K, V>> predecessor(const K& key) const { ReadLock guard(lock); return CopyEntry<K, V>(tree.predecessor(key)); }
+	//第一个key>key的键值
+	std::optional<std::pair<K, V>> successor(const K& key) const { ReadLock guard(lock); return CopyEntry<K, V>(tree.successor(key)); }
+	//按key从小到大对[lo, hi)中的每个键值在锁内调用visitor(const K&, const V&)
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor) const
+	{
+		ReadLock guard(lock);
+		tree.range(lo, hi, [&visitor](const Node* node) { visitor(node->key, node->val); });
+	}
+	//拷贝出[lo, hi)中的所有键值(拷贝完成后立即释放锁)
+	std::vector<std::pair<K, V>> range_copy(const K& lo, const K& hi) const
+	{
+		std::vector<std::pair<K, V>> result;
+		range(lo, hi, [&result](const K& key, const V& val) { result.emplace_back(key, val); });
+		return result;
+	}
+	//整棵树的聚合值
+	typename Augment::value_type reduce() const { ReadLock guard(lock); return tree.reduce(); }
+	//key在[lo, hi)中的节点的聚合值
+	typename Augment::value_type reduce(const K& lo, const K& hi) const { ReadLock guard(lock); return tree.reduce(lo, hi); }
+	//在共享锁内调用f(const RBT&)做一组查询;const的树上GetNode/floor/ceiling等只给出const节点,读者不能修改val
+	//f返回后不能再保留树中的节点指针
+	template<class F>
+	auto read(F&& f) const -> decltype(f(std::declval<const Tree&>())) { ReadLock guard(lock); return f(tree); }
+};
+
+#endif // !CONCURRENTRBT_H
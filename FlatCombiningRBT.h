@@ -0,0 +1,271 @@
+﻿#pragma once
+#ifndef FLATCOMBININGRBT_H
+#define FLATCOMBININGRBT_H
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <thread>
+#include <utility>
+#include "RBTree.h"
+#include "ThreadSlot.h"
+
+//flat combining的线程安全红黑树(需要C++17的std::optional)
+//每个线程把请求(插入/删除/查找)写进自己独占缓存行的槽,然后尝试成为combiner:
+//抢到combiner标志的线程扫描所有槽,把收集到的一批请求按key排序后依次在树上执行,再逐个通知请求者
+//没抢到的线程只在自己的槽上自旋等待结果,不去争用锁
+//这样一批请求只有一次"加锁",树和排序后相邻的下降路径都留在combiner的缓存中,不会在线程之间来回传递
+//超过ThreadSlot::MaxThreads个线程同时存在时,多出来的线程没有槽,自己抢到combiner标志后直接执行
+template<class K, class V, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, V>>, class Augment = NoAugment>
+class FlatCombiningRBT
+{
+private:
+	using Tree = RBT<K, V, Compare, Alloc, Augment>;
+	using Node = RBTNode<K, V, Augment>;
+	static const size_t CacheLine = 64;
+	static const int SpinCount = 64;	//等待时先自旋这么多次,之后让出时间片
+	//请求的种类
+	enum Operation { OpInsert, OpDelete, OpSearch, OpGet };
+	//请求的状态
+	enum State { Idle, Pending, Done };
+	//一个线程的请求槽
+	struct alignas(CacheLine) Request
+	{
+		std::atomic<int> state{ Idle };		//Pending由请求者写入,Done由combiner写入
+		Operation op = OpSearch;			//请求的种类
+		const K* key = nullptr;				//请求的key(指向请求者栈上的参数)
+		const V* val = nullptr;				//插入的val
+		bool found = false;					//OpSearch的结果
+		std::optional<V> result;			//OpGet的结果
+		std::exception_ptr error;			//执行请求时抛出的异常
+	};
+
+	Request requests[ThreadSlot::MaxThreads];
+	std::atomic<size_t> requestCount{ 0 };	//使用过的槽的编号上限(ThreadSlot优先分配小编号,只需扫描前面一段)
+	std::atomic<bool> combining{ false };	//combiner标志
+	Compare comp;							//排序请求用的比较器
+	Tree tree;								//被保护的树(只由持有combiner标志的线程访问)
+	Request* batch[ThreadSlot::MaxThreads];	//combiner收集的一批请求
+
+	//尝试获得combiner标志
+	bool TryCombine()
+	{
+		return !combining.load(std::memory_order_relaxed) && !combining.exchange(true, std::memory_order_acquire);
+	}
+	//获得combiner标志(先自旋,再让出时间片)
+	void LockCombine()
+	{
+		for (int spin = 0; !TryCombine(); spin++)
+		{
+			if (spin >= SpinCount) { std::this_thread::yield(); }
+		}
+	}
+	void UnlockCombine() { combining.store(false, std::memory_order_release); }
+	//在树上执行一个请求,异常留给请求者重新抛出
+	void Apply(Request& request);
+	//收集所有等待中的请求,排序后执行(调用者持有combiner标志)
+	void Combine();
+	//当前线程的请求槽(编号用完时返回nullptr,此时调用者通过write直接执行)
+	Request* MyRequest();
+	//发布request并等待它完成
+	void Execute(Request& request);
+public:
+	//构造函数
+	FlatCombiningRBT() = default;
+	explicit FlatCombiningRBT(const Compare& compare, const Alloc& allocator = Alloc()) : comp(compare), tree(compare, allocator) {}
+	//防止拷贝构造
+	FlatCombiningRBT(const FlatCombiningRBT&) = delete;
+	FlatCombiningRBT& operator=(const FlatCombiningRBT&) = delete;
+
+	//插入键值(key已存在时覆盖val)
+	void Insert(const K& key, const V& val);
+	//删除key
+	void Delete(const K& key);
+	//判断key是否存在
+	bool Search(const K& key);
+	//key对应的val的拷贝(不存在时返回空)
+	std::optional<V> Get(const K& key);
+	//独占地调用f(RBT&)(例如范围扫描或批量修改),等待当前这一批请求执行完;f中不能再调用同一个FlatCombiningRBT,f返回后也不能再保留树中的节点指针
+	template<class F>
+	auto write(F&& f) -> decltype(f(std::declval<Tree&>()));
+	//节点数
+	int getNodeSize() { return write([](Tree& t) { return t.getNodeSize(); }); }
+};
+
+//在树上执行一个请求
+template<class K, class V, class Compare, class Alloc, class Augment>
+void FlatCombiningRBT<K, V, Compare, Alloc, Augment>::Apply(Request& request)
+{
+	try
+	{
+		switch (request.op)
+		{
+		case OpInsert:
+			tree.Insert(*request.key, *request.val);
+			break;
+		case OpDelete:
+			tree.Delete(*request.key);
+			break;
+		case OpSearch:
+			request.found = tree.Search(*request.key);
+			break;
+		case OpGet:
+		{
+			const Node* node = tree.GetNode(*request.key);
+			if (node != nullptr) { request.result = node->val; }
+			break;
+		}
+		}
+	}
+	catch (...)
+	{
+		request.error = std::current_exception();
+	}
+}
+
+//收集所有等待中的请求,排序后执行
+template<class K, class V, class Compare, class Alloc, class Augment>
+void FlatCombiningRBT<K, V, Compare, Alloc, Augment>::Combine()
+{
+	size_t size = 0;
+	size_t count = requestCount.load(std::memory_order_acquire);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (requests[i].state.load(std::memory_order_acquire) == Pending) { batch[size++] = &requests[i]; }
+	}
+	//按key排序:相邻的请求沿相同的路径下降,访问的节点还在缓存中;同一个key的请求保持槽的顺序
+	//(batch按槽的地址收集,以地址作为第二关键字,不需要stable_sort申请临时内存)
+	if (size > 1)
+	{
+		std::sort(batch, batch + size, [this](const Request* a, const Request* b)
+		{
+			if (comp(*a->key, *b->key)) { return true; }
+			if (comp(*b->key, *a->key)) { return false; }
+			return a < b;
+		});
+	}
+	for (size_t i = 0; i < size; i++)
+	{
+		Apply(*batch[i]);
+		batch[i]->state.store(Done, std::memory_order_release);
+	}
+}
+
+//当前线程的请求槽
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename FlatCombiningRBT<K, V, Compare, Alloc, Augment>::Request* FlatCombiningRBT<K, V, Compare, Alloc, Augment>::MyRequest()
+{
+	size_t index = ThreadSlot::Get();
+	if (index == ThreadSlot::None) { return nullptr; }
+	//扩大combiner需要扫描的范围
+	size_t count = requestCount.load(std::memory_order_relaxed);
+	while (count <= index && !requestCount.compare_exchange_weak(count, index + 1, std::memory_order_release, std::memory_order_relaxed)) {}
+	return &requests[index];
+}
+
+//发布request并等待它完成
+template<class K, class V, class Compare, class Alloc, class Augment>
+void FlatCombiningRBT<K, V, Compare, Alloc, Augment>::Execute(Request& request)
+{
+	request.state.store(Pending, std::memory_order_release);
+	for (int spin = 0;; spin++)
+	{
+		//抢到combiner标志时自己的请求已经发布,这一轮一定会被执行(或者已经被上一个combiner执行)
+		if (TryCombine())
+		{
+			Combine();
+			UnlockCombine();
+		}
+		if (request.state.load(std::memory_order_acquire) == Done) { break; }
+		if (spin >= SpinCount) { std::this_thread::yield(); }
+	}
+	request.state.store(Idle, std::memory_order_relaxed);
+	if (request.error)
+	{
+		std::exception_ptr error = std::move(request.error);
+		request.error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+//插入键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+void FlatCombiningRBT<K, V, Compare, Alloc, Augment>::Insert(const K& key, const V& val)
+{
+	Request* request = MyRequest();
+	if (request == nullptr)
+	{
+		write([&](Tree& t) { t.Insert(key, val); });
+		return;
+	}
+	request->op = OpInsert;
+	request->key = &key;
+	request->val = &val;
+	Execute(*request);
+}
+
+//删除key
+template<class K, class V, class Compare, class Alloc, class Augment>
+void FlatCombiningRBT<K, V, Compare, Alloc, Augment>::Delete(const K& key)
+{
+	Request* request = MyRequest();
+	if (request == nullptr)
+	{
+		write([&](Tree& t) { t.Delete(key); });
+		return;
+	}
+	request->op = OpDelete;
+	request->key = &key;
+	Execute(*request);
+}
+
+//判断key是否存在
+template<class K, class V, class Compare, class Alloc, class Augment>
+bool FlatCombiningRBT<K, V, Compare, Alloc, Augment>::Search(const K& key)
+{
+	Request* request = MyRequest();
+	if (request == nullptr) { return write([&](Tree& t) { return t.Search(key); }); }
+	request->op = OpSearch;
+	request->key = &key;
+	Execute(*request);
+	return request->found;
+}
+
+//key对应的val的拷贝
+template<class K, class V, class Compare, class Alloc, class Augment>
+std::optional<V> FlatCombiningRBT<K, V, Compare, Alloc, Augment>::Get(const K& key)
+{
+	Request* request = MyRequest();
+	if (request == nullptr)
+	{
+		return write([&](Tree& t) -> std::optional<V>
+		{
+			const Node* node = t.GetNode(key);
+			if (node == nullptr) { return std::nullopt; }
+			return node->val;
+		});
+	}
+	request->op = OpGet;
+	request->key = &key;
+	Execute(*request);
+	std::optional<V> result = std::move(request->result);
+	request->result.reset();
+	return result;
+}
+
+//独占地调用f(RBT&)
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class F>
+auto FlatCombiningRBT<K, V, Compare, Alloc, Augment>::write(F&& f) -> decltype(f(std::declval<Tree&>()))
+{
+	LockCombine();
+	struct Unlock
+	{
+		FlatCombiningRBT* self;
+		~Unlock() { self->UnlockCombine(); }
+	} unlock{ this };
+	return f(tree);
+}
+
+#endif // !FLATCOMBININGRBT_H
@@ -0,0 +1,265 @@
+﻿#pragma once
+#ifndef FROZENTREE_H
+#define FROZENTREE_H
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "BulkBuild.h"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace FrozenDetail
+{
+	//预取p所在的缓存行(不支持的编译器上什么也不做)
+	inline void Prefetch(const void* p)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(p);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_prefetch(static_cast<const char*>(p), _MM_HINT_T0);
+#else
+		(void)p;
+#endif
+	}
+	//x最低位开始连续的1的个数
+	inline unsigned TrailingOnes(size_t x)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return unsigned(__builtin_ctzll(~static_cast<unsigned long long>(x)));
+#else
+		unsigned count = 0;
+		for (; x & 1; x >>= 1) { count++; }
+		return count;
+#endif
+	}
+}
+
+//FrozenTree中一个键值的引用
+template<class K, class V>
+struct FrozenEntry
+{
+	const K& key;
+	const V& val;
+};
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
+//冻结的只读有序表:键值按Eytzinger(BFS)顺序存放在两个数组中,没有指针,只占键和值的空间
+//下标从1开始的数组中,i的左右子节点为2i和2i+1,查找就是从1开始的无分支下降:i = 2i + (keys[i] < key)
+//树的前几层都落在开头的几个缓存行中,一直留在缓存里;每一步预取几层之后的子孙所在的缓存行,下降时的缓存未命中大部分被重叠
+//由RBT/AVL的freeze()得到,或者从严格递增的键值直接构造;构造之后不能再修改
+//K和V需要可以默认构造和移动赋值(数组先构造好,再按中序填入)
+template<class K, class V, class Compare = std::less<K>>
+class FrozenTree
+{
+	friend struct TreeTestAccess;
+private:
+	std::vector<K> keys;	//keys[i - 1]为下标i的key
+	std::vector<V> vals;	//vals[i - 1]为下标i的val
+	Compare comp;			//键的比较器
+	//每隔几层预取一次:一个缓存行能放下的key数(2的幂),预取i * PrefetchStride就是log2(PrefetchStride)层以下最左边的子孙
+	static const size_t PrefetchStride = sizeof(K) >= 64 ? 1 : sizeof(K) >= 32 ? 2 : sizeof(K) >= 16 ? 4 : sizeof(K) >= 8 ? 8 : 16;
+
+	//中序遍历中i的后继、前驱(0表示end())
+	static size_t NextIndex(size_t i, size_t n);
+	static size_t PrevIndex(size_t i, size_t n);
+	//中序的第一个、最后一个下标
+	static size_t FirstIndex(size_t n);
+	static size_t LastIndex(size_t n);
+	//第一个key>=key、key>key的下标(没有时为0)
+	size_t LowerBoundIndex(const K& key)const;
+	size_t UpperBoundIndex(const K& key)const;
+public:
+	//双向迭代器,按key从小到大访问,*it得到FrozenEntry(it->key、it->val)
+	class iterator
+	{
+	private:
+		friend class FrozenTree;
+		size_t index;				//当前下标(end()时为0)
+		const FrozenTree* tree;		//所属的表
+		iterator(size_t index, const FrozenTree* tree) : index(index), tree(tree) {}
+		//operator->返回的代理
+		struct Arrow
+		{
+			FrozenEntry<K, V> entry;
+			const FrozenEntry<K, V>* operator->() const { return &entry; }
+		};
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = FrozenEntry<K, V>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = Arrow;
+		using reference = FrozenEntry<K, V>;
+
+		iterator() : index(0), tree(nullptr) {}
+		reference operator*() const { return FrozenEntry<K, V>{ tree->keys[index - 1], tree->vals[index - 1] }; }
+		pointer operator->() const { return Arrow{ **this }; }
+		iterator& operator++() { index = NextIndex(index, tree->keys.size()); return *this; }
+		iterator operator++(int) { iterator old = *this; ++*this; return old; }
+		iterator& operator--() { index = PrevIndex(index, tree->keys.size()); return *this; }
+		iterator operator--(int) { iterator old = *this; --*this; return old; }
+		friend bool operator==(const iterator& a, const iterator& b) { return a.index == b.index; }
+		friend bool operator!=(const iterator& a, const iterator& b) { return a.index != b.index; }
+	};
+	using const_iterator = iterator;
+
+	//构造函数
+	FrozenTree() = default;
+	//从key严格递增的[first, last)构造(元素为pair-like,first为key,second为val),O(n)
+	template<class ForwardIt>
+	FrozenTree(sorted_input_t, ForwardIt first, ForwardIt last, const Compare& compare = Compare());
+	//fill(push)必须按key严格递增的顺序调用push(key, val)恰好n次(RBT/AVL的freeze()使用)
+	template<class Fill>
+	FrozenTree(size_t n, Fill&& fill, const Compare& compare = Compare());
+
+	//判断是否存在key
+	bool Search(const K& key)const { return find(key) != end(); }
+	//查找key,不存在时返回end()
+	iterator find(const K& key)const;
+	//第一个key>=key的位置
+	iterator lower_bound(const K& key)const { return iterator(LowerBoundIndex(key), this); }
+	//第一个key>key的位置
+	iterator upper_bound(const K& key)const { return iterator(UpperBoundIndex(key), this); }
+	//按key从小到大对[lo, hi)中的每个键值调用visitor(const FrozenEntry*),用法和RBT的range相同(node->key、node->val)
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor)const;
+	//迭代器
+	iterator begin()const { return iterator(FirstIndex(keys.size()), this); }
+	iterator end()const { return iterator(0, this); }
+	//键值数
+	int getNodeSize()const { return int(keys.size()); }
+	size_t size()const { return keys.size(); }
+	bool empty()const { return keys.empty(); }
+};
+
+//中序遍历中i的后继
+template<class K, class V, class Compare>
+inline size_t FrozenTree<K, V, Compare>::NextIndex(size_t i, size_t n)
+{
+	if (2 * i + 1 <= n)
+	{
+		//有右子树:右子树中最左边的节点
+		i = 2 * i + 1;
+		while (2 * i <= n) { i = 2 * i; }
+		return i;
+	}
+	//没有右子树:向上走到第一个从左边上来的祖先(去掉末尾的1,再去掉一位)
+	return i >> (FrozenDetail::TrailingOnes(i) + 1);
+}
+
+//中序遍历中i的前驱(i为0时返回最后一个)
+template<class K, class V, class Compare>
+inline size_t FrozenTree<K, V, Compare>::PrevIndex(size_t i, size_t n)
+{
+	if (i == 0) { return LastIndex(n); }
+	if (2 * i <= n)
+	{
+		//有左子树:左子树中最右边的节点
+		i = 2 * i;
+		while (2 * i + 1 <= n) { i = 2 * i + 1; }
+		return i;
+	}
+	//没有左子树:向上走到第一个从右边上来的祖先
+	while (i != 0 && (i & 1) == 0) { i >>= 1; }
+	return i >> 1;
+}
+
+//中序的第一个下标
+template<class K, class V, class Compare>
+inline size_t FrozenTree<K, V, Compare>::FirstIndex(size_t n)
+{
+	if (n == 0) { return 0; }
+	size_t i = 1;
+	while (2 * i <= n) { i = 2 * i; }
+	return i;
+}
+
+//中序的最后一个下标
+template<class K, class V, class Compare>
+inline size_t FrozenTree<K, V, Compare>::LastIndex(size_t n)
+{
+	if (n == 0) { return 0; }
+	size_t i = 1;
+	while (2 * i + 1 <= n) { i = 2 * i + 1; }
+	return i;
+}
+
+//从key严格递增的[first, last)构造
+template<class K, class V, class Compare>
+template<class ForwardIt>
+FrozenTree<K, V, Compare>::FrozenTree(sorted_input_t, ForwardIt first, ForwardIt last, const Compare& compare)
+	: FrozenTree(size_t(std::distance(first, last)), [&](auto&& push)
+	{
+		for (; first != last; ++first) { push(first->first, first->second); }
+	}, compare) {}
+
+//按中序依次填入
+template<class K, class V, class Compare>
+template<class Fill>
+FrozenTree<K, V, Compare>::FrozenTree(size_t n, Fill&& fill, const Compare& compare) : keys(n), vals(n), comp(compare)
+{
+	size_t i = FirstIndex(n);
+	fill([&](const K& key, const V& val)
+	{
+		keys[i - 1] = key;
+		vals[i - 1] = val;
+		i = NextIndex(i, n);
+	});
+}
+
+//第一个key>=key的下标
+//无分支下降:走到叶子以下,路径上每一位记录了向左(0)还是向右(1);最后一次向左的位置就是答案,去掉末尾的1和这一位即可
+template<class K, class V, class Compare>
+size_t FrozenTree<K, V, Compare>::LowerBoundIndex(const K& key)const
+{
+	size_t n = keys.size();
+	size_t i = 1;
+	while (i <= n)
+	{
+		if (i * PrefetchStride <= n) { FrozenDetail::Prefetch(&keys[i * PrefetchStride - 1]); }
+		i = 2 * i + (comp(keys[i - 1], key) ? 1 : 0);
+	}
+	return i >> (FrozenDetail::TrailingOnes(i) + 1);
+}
+
+//第一个key>key的下标
+template<class K, class V, class Compare>
+size_t FrozenTree<K, V, Compare>::UpperBoundIndex(const K& key)const
+{
+	size_t n = keys.size();
+	size_t i = 1;
+	while (i <= n)
+	{
+		if (i * PrefetchStride <= n) { FrozenDetail::Prefetch(&keys[i * PrefetchStride - 1]); }
+		i = 2 * i + (comp(key, keys[i - 1]) ? 0 : 1);
+	}
+	return i >> (FrozenDetail::TrailingOnes(i) + 1);
+}
+
+//查找key
+template<class K, class V, class Compare>
+typename FrozenTree<K, V, Compare>::iterator FrozenTree<K, V, Compare>::find(const K& key)const
+{
+	size_t i = LowerBoundIndex(key);
+	if (i == 0 || comp(key, keys[i - 1])) { return end(); }
+	return iterator(i, this);
+}
+
+//按key从小到大访问[lo, hi)中的键值
+template<class K, class V, class Compare>
+template<class Visitor>
+void FrozenTree<K, V, Compare>::range(const K& lo, const K& hi, Visitor&& visitor)const
+{
+	size_t n = keys.size();
+	for (size_t i = LowerBoundIndex(lo); i != 0 && comp(keys[i - 1], hi); i = NextIndex(i, n))
+	{
+		FrozenEntry<K, V> entry{ keys[i - 1], vals[i - 1] };
+		visitor(&entry);
+	}
+}
+
+#endif // !FROZENTREE_H
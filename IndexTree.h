@@ -0,0 +1,880 @@
+﻿#pragma once
+#ifndef INDEXTREE_H
+#define INDEXTREE_H
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "KeyCompare.h"
+
+//下标存储的红黑树/AVL树
+//所有节点存放在一个连续的vector中,左右子节点(以及红黑树的父节点)用32位下标代替指针:
+//64位下每条链接从8字节降为4字节,整棵树可以直接拷贝/移动(不含任何指针),GetNode查找时节点也更集中
+//下标0是哨兵节点(相当于nullptr),因此最多存放2^32-1个节点
+//注意:插入可能使vector扩容,之前由GetNode得到的节点指针会失效(下标不会)
+
+//下标存储的红黑树节点
+template<class K, class V>
+struct IRBTNode
+{
+	K key;				//键
+	V val;				//值
+	uint32_t left;		//左子节点下标
+	uint32_t right;		//右子节点下标
+	uint32_t parent;	//父节点下标
+	uint8_t color;		//颜色(0为RED,1为BLACK)
+	IRBTNode() : key(), val(), left(0), right(0), parent(0), color(1) {}
+	//key由第一个参数构造,val由剩余参数原地构造(没有剩余参数时值初始化)
+	template<class KArg, class... VArgs, class = typename std::enable_if<!std::is_same<typename std::decay<KArg>::type, IRBTNode>::value>::type>
+	IRBTNode(KArg&& key, VArgs&&... val)
+		: key(std::forward<KArg>(key)), val(std::forward<VArgs>(val)...), left(0), right(0), parent(0), color(0) {}
+};
+
+//下标存储的AVL树节点
+template<class K, class V>
+struct IAVLNode
+{
+	K key;				//键
+	V val;				//值
+	uint32_t left;		//左子节点下标
+	uint32_t right;		//右子节点下标
+	int8_t balance;		//平衡因子(右子树高度-左子树高度)
+	IAVLNode() : key(), val(), left(0), right(0), balance(0) {}
+	//key由第一个参数构造,val由剩余参数原地构造(没有剩余参数时值初始化)
+	template<class KArg, class... VArgs, class = typename std::enable_if<!std::is_same<typename std::decay<KArg>::type, IAVLNode>::value>::type>
+	IAVLNode(KArg&& key, VArgs&&... val)
+		: key(std::forward<KArg>(key)), val(std::forward<VArgs>(val)...), left(0), right(0), balance(0) {}
+};
+
+//节点大小检查:三条/两条链接只占12/8字节
+static_assert(sizeof(IRBTNode<int, int>) == 2 * sizeof(int) + 4 * sizeof(uint32_t), "IRBTNode<int, int>: key + val + 3 index links + color");
+static_assert(sizeof(IAVLNode<int, int>) == 2 * sizeof(int) + 3 * sizeof(uint32_t), "IAVLNode<int, int>: key + val + 2 index links + balance");
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
+//下标存储的红黑树(规则与RBT相同,下标0的哨兵节点为黑色的NIL)
+template<class K, class V, class Compare = std::less<K>>
+class IndexRBT
+{
+	friend struct TreeTestAccess;
+private:
+	//颜色
+	enum color { RED, BLACK };
+	std::vector<IRBTNode<K, V>> nodes;	//所有节点(nodes[0]为哨兵)
+	uint32_t root;						//根节点下标
+	uint32_t freeHead;					//被删除节点组成的空闲链表(通过left串起来)
+	uint32_t NodeSize;					//树节点总数(最多2^32-1个,和下标的范围相同)
+	Compare comp;						//键的比较器
+
+	//申请一个新节点(优先复用空闲链表),val由args原地构造,返回下标
+	template<class... VArgs>
+	uint32_t NewNode(const K& key, VArgs&&... val);
+	//回收一个节点
+	void FreeNode(uint32_t x);
+	//返回以x为根的最小key节点
+	uint32_t FindMin(uint32_t x)const;
+	//返回以x为根的最大key节点
+	uint32_t FindMax(uint32_t x)const;
+	//查找key所在的节点下标(不存在返回0)
+	uint32_t Find(const K& key)const;
+	//左旋
+	void LeftRotate(uint32_t x);
+	//右旋
+	void RightRotate(uint32_t x);
+	//插入调整函数
+	void InsertFixUp(uint32_t z);
+	//一次下降找到key所在的节点,不存在时用val原地构造新节点插入;返回节点下标,inserted返回是否插入了新节点
+	template<class... VArgs>
+	uint32_t InsertSlot(const K& key, bool& inserted, VArgs&&... val);
+	//用以v为根的子树替换以u为根的子树
+	void Transplant(uint32_t u, uint32_t v);
+	//删除调整函数
+	void DeleteFixUp(uint32_t x);
+	//中序遍历的辅助函数
+	template<class Function>
+	void inOrderHelp(uint32_t x, Function& function);
+	//得到树的高度的辅助函数
+	int get_Height_Help(uint32_t x)const;
+public:
+	//构造函数
+	IndexRBT() : nodes(1), root(0), freeHead(0), NodeSize(0) {}
+	explicit IndexRBT(const Compare& compare) : nodes(1), root(0), freeHead(0), NodeSize(0), comp(compare) {}
+
+	//插入节点的函数
+	void Insert(const K& key, const V& val);
+	//删除节点的函数
+	void Delete(const K& key);
+	//判断是否存在键值为key的节点
+	bool Search(const K& key)const { return Find(key) != 0; }
+	//树清空
+	void Clear() { nodes.resize(1); root = 0; freeHead = 0; NodeSize = 0; }
+	//预留n个节点的空间(避免插入时扩容)
+	void Reserve(size_t n) { nodes.reserve(n + 1); }
+	//树节点总数
+	size_t size()const { return NodeSize; }
+	//得到指定key值节点(插入后失效)
+	IRBTNode<K, V>* GetNode(const K& key);
+	//返回最小值的节点
+	IRBTNode<K, V>* GetMinNode() { return root == 0 ? nullptr : &nodes[FindMin(root)]; }
+	//返回最大值的节点
+	IRBTNode<K, V>* GetMaxNode() { return root == 0 ? nullptr : &nodes[FindMax(root)]; }
+	//得到树的高度
+	int GetHeight()const { return get_Height_Help(root); }
+	//中序遍历,对每个节点调用function(IRBTNode*)(可以是带捕获的lambda)
+	template<class Function>
+	void inOrder(Function&& function) { inOrderHelp(root, function); }
+
+	//重载[]操作符
+	V& operator[](const K& key);
+};
+
+//申请一个新节点,返回下标
+template<class K, class V, class Compare>
+template<class... VArgs>
+uint32_t IndexRBT<K, V, Compare>::NewNode(const K& key, VArgs&&... val)
+{
+	uint32_t x = freeHead;
+	if (x != 0)
+	{
+		freeHead = nodes[x].left;
+		nodes[x] = IRBTNode<K, V>(key, std::forward<VArgs>(val)...);
+		return x;
+	}
+	if (nodes.size() > UINT32_MAX) { throw std::length_error("IndexRBT: more than 2^32-1 nodes"); }
+	nodes.emplace_back(key, std::forward<VArgs>(val)...);
+	return uint32_t(nodes.size() - 1);
+}
+
+//回收一个节点
+template<class K, class V, class Compare>
+void IndexRBT<K, V, Compare>::FreeNode(uint32_t x)
+{
+	//释放键值持有的资源,并挂到空闲链表上
+	nodes[x] = IRBTNode<K, V>();
+	nodes[x].left = freeHead;
+	freeHead = x;
+}
+
+//返回以x为根的最小key节点
+template<class K, class V, class Compare>
+uint32_t IndexRBT<K, V, Compare>::FindMin(uint32_t x)const
+{
+	while (nodes[x].left != 0) { x = nodes[x].left; }
+	return x;
+}
+
+//返回以x为根的最大key节点
+template<class K, class V, class Compare>
+uint32_t IndexRBT<K, V, Compare>::FindMax(uint32_t x)const
+{
+	while (nodes[x].right != 0) { x = nodes[x].right; }
+	return x;
+}
+
+//查找key所在的节点下标
+template<class K, class V, class Compare>
+uint32_t IndexRBT<K, V, Compare>::Find(const K& key)const
+{
+	uint32_t x = root;
+	while (x != 0)
+	{
+		int cmp = KeyCompare3(comp, key, nodes[x].key);
+		if (cmp == 0) { break; }
+		x = cmp < 0 ? nodes[x].left : nodes[x].right;
+	}
+	return x;
+}
+
+//左旋(示意图见RBT::LeftRotate)
+template<class K, class V, class Compare>
+void IndexRBT<K, V, Compare>::LeftRotate(uint32_t x)
+{
+	uint32_t y = nodes[x].right;
+	nodes[x].right = nodes[y].left;
+	if (nodes[y].left != 0) { nodes[nodes[y].left].parent = x; }
+	uint32_t p = nodes[x].parent;
+	nodes[y].parent = p;
+	if (p == 0) { root = y; }
+	else if (nodes[p].left == x) { nodes[p].left = y; }
+	else { nodes[p].right = y; }
+	nodes[y].left = x;
+	nodes[x].parent = y;
+}
+
+//右旋(示意图见RBT::RightRotate)
+template<class K, class V, class Compare>
+void IndexRBT<K, V, Compare>::RightRotate(uint32_t x)
+{
+	uint32_t y = nodes[x].left;
+	nodes[x].left = nodes[y].right;
+	if (nodes[y].right != 0) { nodes[nodes[y].right].parent = x; }
+	uint32_t p = nodes[x].parent;
+	nodes[y].parent = p;
+	if (p == 0) { root = y; }
+	else if (nodes[p].left == x) { nodes[p].left = y; }
+	else { nodes[p].right = y; }
+	nodes[y].right = x;
+	nodes[x].parent = y;
+}
+
+//插入调整函数(情景划分见RBT::InsertFixUp)
+template<class K, class V, class Compare>
+void IndexRBT<K, V, Compare>::InsertFixUp(uint32_t z)
+{
+	while (nodes[nodes[z].parent].color == RED)
+	{
+		uint32_t father = nodes[z].parent;
+		uint32_t grandFather = nodes[father].parent;
+		if (father == nodes[grandFather].left)
+		{
+			uint32_t uncle = nodes[grandFather].right;
+			if (nodes[uncle].color == RED)
+			{
+				//父-叔双红
+				nodes[father].color = BLACK;
+				nodes[uncle].color = BLACK;
+				nodes[grandFather].color = RED;
+				z = grandFather;
+				continue;
+			}
+			if (z == nodes[father].right)
+			{
+				//LR情况,先对父节点左旋
+				z = father;
+				LeftRotate(z);
+				father = nodes[z].parent;
+			}
+			//LL情况
+			nodes[father].color = BLACK;
+			nodes[grandFather].color = RED;
+			RightRotate(grandFather);
+		}
+		else
+		{
+			uint32_t uncle = nodes[grandFather].left;
+			if (nodes[uncle].color == RED)
+			{
+				nodes[father].color = BLACK;
+				nodes[uncle].color = BLACK;
+				nodes[grandFather].color = RED;
+				z = grandFather;
+				continue;
+			}
+			if (z == nodes[father].left)
+			{
+				//RL情况,先对父节点右旋
+				z = father;
+				RightRotate(z);
+				father = nodes[z].parent;
+			}
+			//RR情况
+			nodes[father].color = BLACK;
+			nodes[grandFather].color = RED;
+			LeftRotate(grandFather);
+		}
+	}
+	nodes[root].color = BLACK;
+}
+
+//用以v为根的子树替换以u为根的子树(v可以是哨兵,此时哨兵的parent被临时使用)
+template<class K, class V, class Compare>
+void IndexRBT<K, V, Compare>::Transplant(uint32_t u, uint32_t v)
+{
+	uint32_t p = nodes[u].parent;
+	if (p == 0) { root = v; }
+	else if (u == nodes[p].left) { nodes[p].left = v; }
+	else { nodes[p].right = v; }
+	nodes[v].parent = p;
+}
+
+//删除调整函数
+template<class K, class V, class Compare>
+void IndexRBT<K, V, Compare>::DeleteFixUp(uint32_t x)
+{
+	while (x != root && nodes[x].color == BLACK)
+	{
+		uint32_t p = nodes[x].parent;
+		if (x == nodes[p].left)
+		{
+			uint32_t brother = nodes[p].right;
+			if (nodes[brother].color == RED)		//情况1
+			{
+				nodes[brother].color = BLACK;
+				nodes[p].color = RED;
+				LeftRotate(p);
+				brother = nodes[p].right;
+			}
+			if (nodes[nodes[brother].left].color == BLACK && nodes[nodes[brother].right].color == BLACK)	//情况2
+			{
+				nodes[brother].color = RED;
+				x = p;
+			}
+			else
+			{
+				if (nodes[nodes[brother].right].color == BLACK)	//情况3
+				{
+					nodes[nodes[brother].left].color = BLACK;
+					nodes[brother].color = RED;
+					RightRotate(brother);
+					brother = nodes[p].right;
+				}
+				//情况4
+				nodes[brother].color = nodes[p].color;
+				nodes[p].color = BLACK;
+				nodes[nodes[brother].right].color = BLACK;
+				LeftRotate(p);
+				x = root;
+			}
+		}
+		else
+		{
+			uint32_t brother = nodes[p].left;
+			if (nodes[brother].color == RED)
+			{
+				nodes[brother].color = BLACK;
+				nodes[p].color = RED;
+				RightRotate(p);
+				brother = nodes[p].left;
+			}
+			if (nodes[nodes[brother].left].color == BLACK && nodes[nodes[brother].right].color == BLACK)
+			{
+				nodes[brother].color = RED;
+				x = p;
+			}
+			else
+			{
+				if (nodes[nodes[brother].left].color == BLACK)
+				{
+					nodes[nodes[brother].right].color = BLACK;
+					nodes[brother].color = RED;
+					LeftRotate(brother);
+					brother = nodes[p].left;
+				}
+				nodes[brother].color = nodes[p].color;
+				nodes[p].color = BLACK;
+				nodes[nodes[brother].left].color = BLACK;
+				RightRotate(p);
+				x = root;
+			}
+		}
+	}
+	nodes[x].color = BLACK;
+}
+
+//中序遍历的辅助函数
+template<class K, class V, class Compare>
+template<class Function>
+void IndexRBT<K, V, Compare>::inOrderHelp(uint32_t x, Function& function)
+{
+	if (x == 0) { return; }
+	inOrderHelp(nodes[x].left, function);
+	function(&nodes[x]);
+	inOrderHelp(nodes[x].right, function);
+}
+
+//得到树的高度的辅助函数
+template<class K, class V, class Compare>
+int IndexRBT<K, V, Compare>::get_Height_Help(uint32_t x)const
+{
+	if (x == 0) { return 0; }
+	return std::max(get_Height_Help(nodes[x].left), get_Height_Help(nodes[x].right)) + 1;
+}
+
+//一次下降找到或插入key
+template<class K, class V, class Compare>
+template<class... VArgs>
+uint32_t IndexRBT<K, V, Compare>::InsertSlot(const K& key, bool& inserted, VArgs&&... val)
+{
+	uint32_t parent = 0;
+	uint32_t x = root;
+	int cmp = 0;
+	while (x != 0)
+	{
+		parent = x;
+		cmp = KeyCompare3(comp, key, nodes[x].key);
+		if (cmp < 0) { x = nodes[x].left; }
+		else if (cmp > 0) { x = nodes[x].right; }
+		else
+		{
+			//节点值相同
+			inserted = false;
+			return x;
+		}
+	}
+	//先找到位置再申请节点(申请可能使nodes扩容,因此只保存下标)
+	uint32_t z = NewNode(key, std::forward<VArgs>(val)...);
+	nodes[z].parent = parent;
+	if (parent == 0) { root = z; }
+	else if (cmp < 0) { nodes[parent].left = z; }
+	else { nodes[parent].right = z; }
+	InsertFixUp(z);
+	NodeSize++;
+	inserted = true;
+	return z;
+}
+
+//插入节点的函数
+template<class K, class V, class Compare>
+void IndexRBT<K, V, Compare>::Insert(const K& key, const V& val)
+{
+	bool inserted;
+	uint32_t x = InsertSlot(key, inserted, val);
+	if (!inserted) { nodes[x].val = val; }
+}
+
+//删除节点的函数
+template<class K, class V, class Compare>
+void IndexRBT<K, V, Compare>::Delete(const K& key)
+{
+	uint32_t z = Find(key);
+	if (z == 0) { return; }
+	uint32_t y = z;
+	int yColor = nodes[y].color;
+	uint32_t x;
+	if (nodes[z].left == 0)
+	{
+		x = nodes[z].right;
+		Transplant(z, x);
+	}
+	else if (nodes[z].right == 0)
+	{
+		x = nodes[z].left;
+		Transplant(z, x);
+	}
+	else
+	{
+		//双子树:用后继节点y顶替z的位置
+		y = FindMin(nodes[z].right);
+		yColor = nodes[y].color;
+		x = nodes[y].right;
+		if (nodes[y].parent == z)
+		{
+			nodes[x].parent = y;
+		}
+		else
+		{
+			Transplant(y, x);
+			nodes[y].right = nodes[z].right;
+			nodes[nodes[y].right].parent = y;
+		}
+		Transplant(z, y);
+		nodes[y].left = nodes[z].left;
+		nodes[nodes[y].left].parent = y;
+		nodes[y].color = nodes[z].color;
+	}
+	if (yColor == BLACK) { DeleteFixUp(x); }
+	//哨兵节点可能被临时修改,恢复它
+	nodes[0].parent = 0;
+	nodes[0].color = BLACK;
+	FreeNode(z);
+	NodeSize--;
+}
+
+//得到指定key值节点
+template<class K, class V, class Compare>
+IRBTNode<K, V>* IndexRBT<K, V, Compare>::GetNode(const K& key)
+{
+	uint32_t x = Find(key);
+	return x == 0 ? nullptr : &nodes[x];
+}
+
+//重载[]操作符(只下降一次,key不存在时插入值初始化的val)
+template<class K, class V, class Compare>
+V& IndexRBT<K, V, Compare>::operator[](const K& key)
+{
+	bool inserted;
+	return nodes[InsertSlot(key, inserted)].val;
+}
+
+//下标存储的AVL树(规则与AVL相同,下标0的哨兵节点表示空子树)
+template<class K, class V, class Compare = std::less<K>>
+class IndexAVL
+{
+	friend struct TreeTestAccess;
+private:
+	std::vector<IAVLNode<K, V>> nodes;	//所有节点(nodes[0]为哨兵)
+	uint32_t root;						//根节点下标
+	uint32_t freeHead;					//被删除节点组成的空闲链表(通过left串起来)
+	uint32_t NodeSize;					//树节点总数(最多2^32-1个,和下标的范围相同)
+	Compare comp;						//键的比较器
+
+	//申请一个新节点(优先复用空闲链表),val由args原地构造,返回下标
+	template<class... VArgs>
+	uint32_t NewNode(const K& key, VArgs&&... val);
+	//回收一个节点
+	void FreeNode(uint32_t x);
+	//返回以x为根的最小key节点
+	uint32_t FindMin(uint32_t x)const;
+	//返回以x为根的最大key节点
+	uint32_t FindMax(uint32_t x)const;
+	//查找key所在的节点下标(不存在返回0)
+	uint32_t Find(const K& key)const;
+
+	//插入节点的辅助函数:找不到key时用val原地构造新节点(grown返回子树高度是否增加)
+	//result返回key所在的节点下标,inserted返回是否插入了新节点
+	template<class... VArgs>
+	uint32_t InsertNode(uint32_t x, const K& key, bool& grown, uint32_t& result, bool& inserted, VArgs&&... val);
+	//删除节点的辅助函数(shrunk返回子树高度是否减小)
+	uint32_t DeleteNode(uint32_t x, const K& key, bool& shrunk);
+	//x的左子树变矮后的调整,返回新的子树根
+	uint32_t LeftShrunk(uint32_t x, bool& shrunk);
+	//x的右子树变矮后的调整,返回新的子树根
+	uint32_t RightShrunk(uint32_t x, bool& shrunk);
+	//以下旋转函数与AVL中的同名函数相同,在preRoot失衡时调用并维护平衡因子
+	//单左旋(RR)
+	uint32_t SingleRotateWithLeft(uint32_t preRoot);
+	//单右旋(LL)
+	uint32_t SingleRotateWithRight(uint32_t preRoot);
+	//双左旋(RL)
+	uint32_t DoubleRotateWithLeft(uint32_t preRoot);
+	//双右旋(LR)
+	uint32_t DoubleRotateWithRight(uint32_t preRoot);
+	//中序遍历的辅助函数
+	template<class Function>
+	void inOrderHelp(uint32_t x, Function& function);
+public:
+	//构造函数
+	IndexAVL() : nodes(1), root(0), freeHead(0), NodeSize(0) {}
+	explicit IndexAVL(const Compare& compare) : nodes(1), root(0), freeHead(0), NodeSize(0), comp(compare) {}
+
+	//插入节点的函数
+	void Insert(const K& key, const V& val);
+	//删除节点的函数
+	void Delete(const K& key) { bool shrunk = false; root = DeleteNode(root, key, shrunk); }
+	//判断是否存在键值为key的节点
+	bool Search(const K& key)const { return Find(key) != 0; }
+	//树清空
+	void Clear() { nodes.resize(1); root = 0; freeHead = 0; NodeSize = 0; }
+	//预留n个节点的空间(避免插入时扩容)
+	void Reserve(size_t n) { nodes.reserve(n + 1); }
+	//树节点总数
+	size_t size()const { return NodeSize; }
+	//得到指定key值节点(插入后失效)
+	IAVLNode<K, V>* GetNode(const K& key);
+	//返回最小值的节点
+	IAVLNode<K, V>* GetMinNode() { return root == 0 ? nullptr : &nodes[FindMin(root)]; }
+	//返回最大值的节点
+	IAVLNode<K, V>* GetMaxNode() { return root == 0 ? nullptr : &nodes[FindMax(root)]; }
+	//得到树的高度
+	int GetHeight()const;
+	//中序遍历,对每个节点调用function(IAVLNode*)(可以是带捕获的lambda)
+	template<class Function>
+	void inOrder(Function&& function) { inOrderHelp(root, function); }
+
+	//重载[]操作符
+	V& operator[](const K& key);
+};
+
+//申请一个新节点,返回下标
+template<class K, class V, class Compare>
+template<class... VArgs>
+uint32_t IndexAVL<K, V, Compare>::NewNode(const K& key, VArgs&&... val)
+{
+	uint32_t x = freeHead;
+	if (x != 0)
+	{
+		freeHead = nodes[x].left;
+		nodes[x] = IAVLNode<K, V>(key, std::forward<VArgs>(val)...);
+		return x;
+	}
+	if (nodes.size() > UINT32_MAX) { throw std::length_error("IndexAVL: more than 2^32-1 nodes"); }
+	nodes.emplace_back(key, std::forward<VArgs>(val)...);
+	return uint32_t(nodes.size() - 1);
+}
+
+//回收一个节点
+template<class K, class V, class Compare>
+void IndexAVL<K, V, Compare>::FreeNode(uint32_t x)
+{
+	nodes[x] = IAVLNode<K, V>();
+	nodes[x].left = freeHead;
+	freeHead = x;
+}
+
+//返回以x为根的最小key节点
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::FindMin(uint32_t x)const
+{
+	while (nodes[x].left != 0) { x = nodes[x].left; }
+	return x;
+}
+
+//返回以x为根的最大key节点
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::FindMax(uint32_t x)const
+{
+	while (nodes[x].right != 0) { x = nodes[x].right; }
+	return x;
+}
+
+//查找key所在的节点下标
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::Find(const K& key)const
+{
+	uint32_t x = root;
+	while (x != 0)
+	{
+		int cmp = KeyCompare3(comp, key, nodes[x].key);
+		if (cmp == 0) { break; }
+		x = cmp < 0 ? nodes[x].left : nodes[x].right;
+	}
+	return x;
+}
+
+//单左旋(RR)
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::SingleRotateWithLeft(uint32_t preRoot)
+{
+	uint32_t newRoot = nodes[preRoot].right;
+	nodes[preRoot].right = nodes[newRoot].left;
+	nodes[newRoot].left = preRoot;
+	if (nodes[newRoot].balance == 0)
+	{
+		nodes[preRoot].balance = 1;
+		nodes[newRoot].balance = -1;
+	}
+	else
+	{
+		nodes[preRoot].balance = 0;
+		nodes[newRoot].balance = 0;
+	}
+	return newRoot;
+}
+
+//单右旋(LL)
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::SingleRotateWithRight(uint32_t preRoot)
+{
+	uint32_t newRoot = nodes[preRoot].left;
+	nodes[preRoot].left = nodes[newRoot].right;
+	nodes[newRoot].right = preRoot;
+	if (nodes[newRoot].balance == 0)
+	{
+		nodes[preRoot].balance = -1;
+		nodes[newRoot].balance = 1;
+	}
+	else
+	{
+		nodes[preRoot].balance = 0;
+		nodes[newRoot].balance = 0;
+	}
+	return newRoot;
+}
+
+//双左旋(RL)
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::DoubleRotateWithLeft(uint32_t preRoot)
+{
+	uint32_t rootR = nodes[preRoot].right;
+	uint32_t newRoot = nodes[rootR].left;
+	nodes[rootR].left = nodes[newRoot].right;
+	nodes[newRoot].right = rootR;
+	nodes[preRoot].right = nodes[newRoot].left;
+	nodes[newRoot].left = preRoot;
+	int balance = nodes[newRoot].balance;
+	nodes[preRoot].balance = balance > 0 ? -1 : 0;
+	nodes[rootR].balance = balance < 0 ? 1 : 0;
+	nodes[newRoot].balance = 0;
+	return newRoot;
+}
+
+//双右旋(LR)
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::DoubleRotateWithRight(uint32_t preRoot)
+{
+	uint32_t rootL = nodes[preRoot].left;
+	uint32_t newRoot = nodes[rootL].right;
+	nodes[rootL].right = nodes[newRoot].left;
+	nodes[newRoot].left = rootL;
+	nodes[preRoot].left = nodes[newRoot].right;
+	nodes[newRoot].right = preRoot;
+	int balance = nodes[newRoot].balance;
+	nodes[preRoot].balance = balance < 0 ? 1 : 0;
+	nodes[rootL].balance = balance > 0 ? -1 : 0;
+	nodes[newRoot].balance = 0;
+	return newRoot;
+}
+
+//x的左子树变矮后的调整
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::LeftShrunk(uint32_t x, bool& shrunk)
+{
+	if (nodes[x].balance < 0) { nodes[x].balance = 0; shrunk = true; return x; }
+	if (nodes[x].balance == 0) { nodes[x].balance = 1; shrunk = false; return x; }
+	uint32_t rootR = nodes[x].right;
+	if (nodes[rootR].balance < 0) { shrunk = true; return DoubleRotateWithLeft(x); }
+	shrunk = nodes[rootR].balance != 0;
+	return SingleRotateWithLeft(x);
+}
+
+//x的右子树变矮后的调整
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::RightShrunk(uint32_t x, bool& shrunk)
+{
+	if (nodes[x].balance > 0) { nodes[x].balance = 0; shrunk = true; return x; }
+	if (nodes[x].balance == 0) { nodes[x].balance = -1; shrunk = false; return x; }
+	uint32_t rootL = nodes[x].left;
+	if (nodes[rootL].balance > 0) { shrunk = true; return DoubleRotateWithRight(x); }
+	shrunk = nodes[rootL].balance != 0;
+	return SingleRotateWithRight(x);
+}
+
+//插入节点的辅助函数(递归返回后nodes可能已经扩容,因此不持有节点引用)
+template<class K, class V, class Compare>
+template<class... VArgs>
+uint32_t IndexAVL<K, V, Compare>::InsertNode(uint32_t x, const K& key, bool& grown, uint32_t& result, bool& inserted, VArgs&&... val)
+{
+	if (x == 0)
+	{
+		//val只在找到空位时使用一次
+		result = NewNode(key, std::forward<VArgs>(val)...);
+		NodeSize++;
+		grown = true;
+		inserted = true;
+		return result;
+	}
+	int cmp = KeyCompare3(comp, key, nodes[x].key);
+	if (cmp < 0)
+	{
+		uint32_t child = InsertNode(nodes[x].left, key, grown, result, inserted, std::forward<VArgs>(val)...);
+		nodes[x].left = child;
+		if (grown)
+		{
+			if (nodes[x].balance > 0) { nodes[x].balance = 0; grown = false; }
+			else if (nodes[x].balance == 0) { nodes[x].balance = -1; }
+			else
+			{
+				x = nodes[child].balance < 0 ? SingleRotateWithRight(x) : DoubleRotateWithRight(x);
+				grown = false;
+			}
+		}
+	}
+	else if (cmp > 0)
+	{
+		uint32_t child = InsertNode(nodes[x].right, key, grown, result, inserted, std::forward<VArgs>(val)...);
+		nodes[x].right = child;
+		if (grown)
+		{
+			if (nodes[x].balance < 0) { nodes[x].balance = 0; grown = false; }
+			else if (nodes[x].balance == 0) { nodes[x].balance = 1; }
+			else
+			{
+				x = nodes[child].balance > 0 ? SingleRotateWithLeft(x) : DoubleRotateWithLeft(x);
+				grown = false;
+			}
+		}
+	}
+	else
+	{
+		//键值相同
+		result = x;
+		inserted = false;
+		grown = false;
+	}
+	return x;
+}
+
+//插入节点的函数
+template<class K, class V, class Compare>
+void IndexAVL<K, V, Compare>::Insert(const K& key, const V& val)
+{
+	bool grown = false;
+	bool inserted;
+	uint32_t x;
+	root = InsertNode(root, key, grown, x, inserted, val);
+	if (!inserted) { nodes[x].val = val; }
+}
+
+//删除节点的辅助函数
+template<class K, class V, class Compare>
+uint32_t IndexAVL<K, V, Compare>::DeleteNode(uint32_t x, const K& key, bool& shrunk)
+{
+	if (x == 0) { shrunk = false; return 0; }
+	int cmp = KeyCompare3(comp, key, nodes[x].key);
+	if (cmp < 0)
+	{
+		nodes[x].left = DeleteNode(nodes[x].left, key, shrunk);
+		if (shrunk) { x = LeftShrunk(x, shrunk); }
+	}
+	else if (cmp > 0)
+	{
+		nodes[x].right = DeleteNode(nodes[x].right, key, shrunk);
+		if (shrunk) { x = RightShrunk(x, shrunk); }
+	}
+	else if (nodes[x].left == 0 || nodes[x].right == 0)
+	{
+		//只有一颗子树(或叶子节点),直接用子节点顶替
+		uint32_t child = nodes[x].left != 0 ? nodes[x].left : nodes[x].right;
+		FreeNode(x);
+		NodeSize--;
+		shrunk = true;
+		return child;
+	}
+	else if (nodes[x].balance < 0)
+	{
+		//双子树且左子树更高:用前驱节点的键值替换,再从左子树删除前驱
+		uint32_t pre = FindMax(nodes[x].left);
+		nodes[x].key = nodes[pre].key;
+		nodes[x].val = nodes[pre].val;
+		nodes[x].left = DeleteNode(nodes[x].left, nodes[x].key, shrunk);
+		if (shrunk) { x = LeftShrunk(x, shrunk); }
+	}
+	else
+	{
+		//双子树:用后继节点的键值替换,再从右子树删除后继
+		uint32_t next = FindMin(nodes[x].right);
+		nodes[x].key = nodes[next].key;
+		nodes[x].val = nodes[next].val;
+		nodes[x].right = DeleteNode(nodes[x].right, nodes[x].key, shrunk);
+		if (shrunk) { x = RightShrunk(x, shrunk); }
+	}
+	return x;
+}
+
+//中序遍历的辅助函数
+template<class K, class V, class Compare>
+template<class Function>
+void IndexAVL<K, V, Compare>::inOrderHelp(uint32_t x, Function& function)
+{
+	if (x == 0) { return; }
+	inOrderHelp(nodes[x].left, function);
+	function(&nodes[x]);
+	inOrderHelp(nodes[x].right, function);
+}
+
+//得到树的高度(沿较高的子树向下走)
+template<class K, class V, class Compare>
+int IndexAVL<K, V, Compare>::GetHeight()const
+{
+	int height = 0;
+	for (uint32_t x = root; x != 0; height++)
+	{
+		x = nodes[x].balance < 0 ? nodes[x].left : nodes[x].right;
+	}
+	return height;
+}
+
+//得到指定key值节点
+template<class K, class V, class Compare>
+IAVLNode<K, V>* IndexAVL<K, V, Compare>::GetNode(const K& key)
+{
+	uint32_t x = Find(key);
+	return x == 0 ? nullptr : &nodes[x];
+}
+
+//重载[]操作符(只下降一次,key不存在时插入值初始化的val)
+template<class K, class V, class Compare>
+V& IndexAVL<K, V, Compare>::operator[](const K& key)
+{
+	bool grown = false;
+	bool inserted;
+	uint32_t x;
+	root = InsertNode(root, key, grown, x, inserted);
+	return nodes[x].val;
+}
+
+#endif // !INDEXTREE_H
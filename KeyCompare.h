@@ -0,0 +1,42 @@
+﻿#pragma once
+#ifndef KEYCOMPARE_H
+#define KEYCOMPARE_H
+#include <functional>
+#include <type_traits>
+#if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#include <compare>
+#include <concepts>
+#endif
+
+//比较器是否为标准库的std::less(此时可以直接使用<=>,而不是调用两次comp)
+template<class Compare>
+struct IsStdLess : std::false_type {};
+template<class T>
+struct IsStdLess<std::less<T>> : std::true_type {};
+
+//三路比较:a<b返回负数,a>b返回正数,相等返回0
+//树的每一层只需要调用一次KeyCompare3,而不是分别判断>、<、!=
+//比较器为std::less且键支持<=>时,只做一次真正的比较(例如std::string只扫描一遍字符)
+#if defined(__cpp_lib_three_way_comparison) && defined(__cpp_lib_concepts)
+template<class Compare, class A, class B>
+inline int KeyCompare3(const Compare& comp, const A& a, const B& b)
+{
+	if constexpr (IsStdLess<Compare>::value && std::three_way_comparable_with<A, B>)
+	{
+		auto order = a <=> b;
+		return order < 0 ? -1 : (order > 0 ? 1 : 0);
+	}
+	else
+	{
+		return comp(a, b) ? -1 : (comp(b, a) ? 1 : 0);
+	}
+}
+#else
+template<class Compare, class A, class B>
+inline int KeyCompare3(const Compare& comp, const A& a, const B& b)
+{
+	return comp(a, b) ? -1 : (comp(b, a) ? 1 : 0);
+}
+#endif
+
+#endif // !KEYCOMPARE_H
@@ -0,0 +1,182 @@
+﻿#pragma once
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "KeyCompare.h"
+//节点内查找的SIMD实现:x86上按编译选项自动选择AVX2或SSE2(64位键的SSE版本需要SSE4.2),定义TREE_DISABLE_SIMD可以关闭
+#if !defined(TREE_DISABLE_SIMD) && (defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64))
+#define TREE_USE_SIMD
+#include <immintrin.h>
+#endif
+
+//在一个节点内有序的键数组中查找(B+树等多路树使用)
+//CountLess(keys, n, key, comp)返回keys[0, n)中小于key的个数,即lower_bound的下标
+//CountLessEqual(keys, n, key, comp)返回小于等于key的个数,即upper_bound的下标
+//4或8字节的整数键、比较器为std::less时用SIMD一次比较多个键再数出结果(节点很小,逐个比较整个节点也比二分查找的分支预测失败便宜)
+//其他情况退回二分查找
+
+//能否使用SIMD查找
+template<class K, class Compare>
+struct SimdSearchable : std::integral_constant<bool,
+	IsStdLess<Compare>::value && std::is_integral<K>::value && !std::is_same<K, bool>::value && (sizeof(K) == 4 || sizeof(K) == 8)> {};
+
+namespace KeySearchDetail
+{
+	//二分查找(通用版本)
+	template<class K, class Compare>
+	inline int CountLess(const K* keys, int n, const K& key, const Compare& comp, std::false_type)
+	{
+		int lo = 0;
+		while (n > 0)
+		{
+			int half = n / 2;
+			if (comp(keys[lo + half], key))
+			{
+				lo += half + 1;
+				n -= half + 1;
+			}
+			else
+			{
+				n = half;
+			}
+		}
+		return lo;
+	}
+	template<class K, class Compare>
+	inline int CountLessEqual(const K* keys, int n, const K& key, const Compare& comp, std::false_type)
+	{
+		int lo = 0;
+		while (n > 0)
+		{
+			int half = n / 2;
+			if (!comp(key, keys[lo + half]))
+			{
+				lo += half + 1;
+				n -= half + 1;
+			}
+			else
+			{
+				n = half;
+			}
+		}
+		return lo;
+	}
+
+	//mask中置位的个数(最多8位)
+	inline int PopCount(unsigned mask)
+	{
+		int count = 0;
+		for (; mask != 0; mask &= mask - 1) { count++; }
+		return count;
+	}
+
+	//统计keys[0, n)中大于key的个数(整数键,从头到尾比较整个数组),i返回SIMD处理到的位置
+	//无符号数先把最高位取反,变成有符号比较
+	template<class K>
+	inline int CountGreaterSimd(const K* keys, int n, K key, int& i, std::integral_constant<size_t, 4>)
+	{
+		int count = 0;
+#ifdef TREE_USE_SIMD
+		const int32_t bias = std::is_signed<K>::value ? 0 : INT32_MIN;
+		int32_t target;
+		std::memcpy(&target, &key, 4);
+		target ^= bias;
+#ifdef __AVX2__
+		__m256i target8 = _mm256_set1_epi32(target);
+		__m256i bias8 = _mm256_set1_epi32(bias);
+		for (; i + 8 <= n; i += 8)
+		{
+			__m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias8);
+			count += PopCount(unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, target8)))));
+		}
+#endif
+		__m128i target4 = _mm_set1_epi32(target);
+		__m128i bias4 = _mm_set1_epi32(bias);
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias4);
+			count += PopCount(unsigned(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, target4)))));
+		}
+#else
+		(void)keys; (void)n; (void)key; (void)i;
+#endif
+		return count;
+	}
+	template<class K>
+	inline int CountGreaterSimd(const K* keys, int n, K key, int& i, std::integral_constant<size_t, 8>)
+	{
+		int count = 0;
+#if defined(TREE_USE_SIMD) && (defined(__AVX2__) || defined(__SSE4_2__))
+		const int64_t bias = std::is_signed<K>::value ? 0 : INT64_MIN;
+		int64_t target;
+		std::memcpy(&target, &key, 8);
+		target ^= bias;
+#ifdef __AVX2__
+		__m256i target4 = _mm256_set1_epi64x(target);
+		__m256i bias4 = _mm256_set1_epi64x(bias);
+		for (; i + 4 <= n; i += 4)
+		{
+			__m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), bias4);
+			count += PopCount(unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, target4)))));
+		}
+#endif
+		__m128i target2 = _mm_set1_epi64x(target);
+		__m128i bias2 = _mm_set1_epi64x(bias);
+		for (; i + 2 <= n; i += 2)
+		{
+			__m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias2);
+			count += PopCount(unsigned(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, target2)))));
+		}
+#else
+		(void)keys; (void)n; (void)key; (void)i;
+#endif
+		return count;
+	}
+	template<class K>
+	inline int CountGreater(const K* keys, int n, K key)
+	{
+		int i = 0;
+		int count = CountGreaterSimd(keys, n, key, i, std::integral_constant<size_t, sizeof(K)>());
+		//剩下的(或没有SIMD时全部)逐个比较
+		for (; i < n; i++) { count += keys[i] > key ? 1 : 0; }
+		return count;
+	}
+	template<class K>
+	inline int CountGreaterEqual(const K* keys, int n, K key)
+	{
+		//key为最小值时所有键都>=key,否则等价于 > key - 1
+		if (key == std::numeric_limits<K>::min()) { return n; }
+		return CountGreater(keys, n, K(key - 1));
+	}
+
+	//SIMD版本:有序数组中小于key的个数 = n - (>=key的个数)
+	template<class K, class Compare>
+	inline int CountLess(const K* keys, int n, const K& key, const Compare&, std::true_type)
+	{
+		return n - CountGreaterEqual(keys, n, key);
+	}
+	template<class K, class Compare>
+	inline int CountLessEqual(const K* keys, int n, const K& key, const Compare&, std::true_type)
+	{
+		return n - CountGreater(keys, n, key);
+	}
+}
+
+//keys[0, n)中小于key的个数(lower_bound的下标)
+template<class K, class Compare>
+inline int CountLess(const K* keys, int n, const K& key, const Compare& comp)
+{
+	return KeySearchDetail::CountLess(keys, n, key, comp, SimdSearchable<K, Compare>());
+}
+
+//keys[0, n)中小于等于key的个数(upper_bound的下标)
+template<class K, class Compare>
+inline int CountLessEqual(const K* keys, int n, const K& key, const Compare& comp)
+{
+	return KeySearchDetail::CountLessEqual(keys, n, key, comp, SimdSearchable<K, Compare>());
+}
+
+#endif // !KEYSEARCH_H
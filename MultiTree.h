@@ -0,0 +1,252 @@
+﻿#pragma once
+#ifndef MULTITREE_H
+#define MULTITREE_H
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "NodePool.h"
+#include "RBTree.h"
+
+//RBT上的多重集合/多重映射:相等的key只占一个节点,重复的部分放在节点的val中
+//RBTMultiSet的val为出现次数,RBTMultiMap的val为保存所有值的桶(std::vector,按插入顺序)
+//树中只有不同的key,重复再多也不会让树变高;count和equal_range都是一次O(logn)的下降
+//Alloc会被rebind为RBT节点的分配器(默认为NodePool内存池)
+
+//多重映射
+template<class K, class V, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, V>>>
+class RBTMultiMap
+{
+private:
+	using Bucket = std::vector<V>;
+	using BucketAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const K, Bucket>>;
+	RBT<K, Bucket, Compare, BucketAlloc> tree;	//key -> 该key的所有值
+	size_t ValueSize = 0;						//值的总数
+public:
+	//构造函数
+	RBTMultiMap() = default;
+	explicit RBTMultiMap(const Alloc& allocator) : tree(BucketAlloc(allocator)) {}
+
+	//插入一个键值(key已存在时追加到它的桶中)
+	void Insert(const K& key, const V& val);
+	void Insert(const K& key, V&& val);
+	//删除key的所有值,返回删除的个数
+	size_t Delete(const K& key);
+	//删除key的一个等于val的值,返回是否删除
+	bool DeleteValue(const K& key, const V& val);
+	//判断是否存在key
+	bool Search(const K& key)const { return tree.Search(key); }
+	//key对应的值的个数,O(logn)
+	size_t count(const K& key)const;
+	//key对应的所有值[first, second)(按插入顺序),不存在时为空区间,O(logn)
+	std::pair<V*, V*> equal_range(const K& key);
+	std::pair<const V*, const V*> equal_range(const K& key)const;
+	//按key从小到大对[lo, hi)中的每个值调用visitor(const K& key, V& val),同一个key的值按插入顺序
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor);
+	//清空
+	void Clear() { tree.Clear(); ValueSize = 0; }
+	//值的总数
+	size_t size()const { return ValueSize; }
+	bool empty()const { return ValueSize == 0; }
+	//不同的key的个数
+	int getNodeSize()const { return tree.getNodeSize(); }
+	//得到树的高度
+	int GetHeight()const { return tree.GetHeight(); }
+};
+
+//多重集合
+template<class K, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, size_t>>>
+class RBTMultiSet
+{
+private:
+	using CountAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const K, size_t>>;
+	RBT<K, size_t, Compare, CountAlloc> tree;	//key -> 出现次数
+	size_t ValueSize = 0;						//包括重复在内的key的总数
+public:
+	//构造函数
+	RBTMultiSet() = default;
+	explicit RBTMultiSet(const Alloc& allocator) : tree(CountAlloc(allocator)) {}
+
+	//插入一个key
+	void Insert(const K& key);
+	//删除一个key,返回是否删除
+	bool Delete(const K& key);
+	//删除所有的key,返回删除的个数
+	size_t DeleteAll(const K& key);
+	//判断是否存在key
+	bool Search(const K& key)const { return tree.Search(key); }
+	//key出现的次数,O(logn)
+	size_t count(const K& key)const;
+	//和key相等的所有key:相等的key只保存一个节点,返回(节点中保存的key, 出现次数),不存在时为(nullptr, 0),O(logn)
+	std::pair<const K*, size_t> equal_range(const K& key)const;
+	//按key从小到大对[lo, hi)中的每个不同的key调用visitor(const K& key, size_t count)
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor)const;
+	//清空
+	void Clear() { tree.Clear(); ValueSize = 0; }
+	//包括重复在内的key的总数
+	size_t size()const { return ValueSize; }
+	bool empty()const { return ValueSize == 0; }
+	//不同的key的个数
+	int getNodeSize()const { return tree.getNodeSize(); }
+	//得到树的高度
+	int GetHeight()const { return tree.GetHeight(); }
+};
+
+
+//插入一个键值
+template<class K, class V, class Compare, class Alloc>
+void RBTMultiMap<K, V, Compare, Alloc>::Insert(const K& key, const V& val)
+{
+	Insert(key, V(val));
+}
+
+template<class K, class V, class Compare, class Alloc>
+void RBTMultiMap<K, V, Compare, Alloc>::Insert(const K& key, V&& val)
+{
+	auto result = tree.try_emplace(key);
+	try
+	{
+		result.first->val.push_back(std::move(val));
+	}
+	catch (...)
+	{
+		//新建的桶不能空着留在树中
+		if (result.second) { tree.Delete(key); }
+		throw;
+	}
+	ValueSize++;
+}
+
+//删除key的所有值
+template<class K, class V, class Compare, class Alloc>
+size_t RBTMultiMap<K, V, Compare, Alloc>::Delete(const K& key)
+{
+	auto node = tree.GetNode(key);
+	if (node == nullptr) { return 0; }
+	size_t removed = node->val.size();
+	tree.Delete(key);
+	ValueSize -= removed;
+	return removed;
+}
+
+//删除key的一个等于val的值(桶中第一个相等的)
+template<class K, class V, class Compare, class Alloc>
+bool RBTMultiMap<K, V, Compare, Alloc>::DeleteValue(const K& key, const V& val)
+{
+	auto node = tree.GetNode(key);
+	if (node == nullptr) { return false; }
+	Bucket& bucket = node->val;
+	for (auto it = bucket.begin(); it != bucket.end(); ++it)
+	{
+		if (*it == val)
+		{
+			//保持其余值的插入顺序
+			bucket.erase(it);
+			ValueSize--;
+			//桶空了就删除节点
+			if (bucket.empty()) { tree.Delete(key); }
+			return true;
+		}
+	}
+	return false;
+}
+
+//key对应的值的个数
+template<class K, class V, class Compare, class Alloc>
+size_t RBTMultiMap<K, V, Compare, Alloc>::count(const K& key)const
+{
+	auto node = tree.GetNode(key);
+	return node == nullptr ? 0 : node->val.size();
+}
+
+//key对应的所有值
+template<class K, class V, class Compare, class Alloc>
+std::pair<V*, V*> RBTMultiMap<K, V, Compare, Alloc>::equal_range(const K& key)
+{
+	auto node = tree.GetNode(key);
+	if (node == nullptr) { return std::pair<V*, V*>(nullptr, nullptr); }
+	V* first = node->val.data();
+	return std::pair<V*, V*>(first, first + node->val.size());
+}
+
+template<class K, class V, class Compare, class Alloc>
+std::pair<const V*, const V*> RBTMultiMap<K, V, Compare, Alloc>::equal_range(const K& key)const
+{
+	auto node = tree.GetNode(key);
+	if (node == nullptr) { return std::pair<const V*, const V*>(nullptr, nullptr); }
+	const V* first = node->val.data();
+	return std::pair<const V*, const V*>(first, first + node->val.size());
+}
+
+//按key从小到大访问[lo, hi)中的所有值
+template<class K, class V, class Compare, class Alloc>
+template<class Visitor>
+void RBTMultiMap<K, V, Compare, Alloc>::range(const K& lo, const K& hi, Visitor&& visitor)
+{
+	tree.range(lo, hi, [&](RBTNode<K, Bucket>* node)
+	{
+		for (V& val : node->val) { visitor(static_cast<const K&>(node->key), val); }
+	});
+}
+
+//插入一个key
+template<class K, class Compare, class Alloc>
+void RBTMultiSet<K, Compare, Alloc>::Insert(const K& key)
+{
+	tree.try_emplace(key, size_t(0)).first->val++;
+	ValueSize++;
+}
+
+//删除一个key
+template<class K, class Compare, class Alloc>
+bool RBTMultiSet<K, Compare, Alloc>::Delete(const K& key)
+{
+	auto node = tree.GetNode(key);
+	if (node == nullptr) { return false; }
+	//还有重复的key时只减少次数
+	if (--node->val == 0) { tree.Delete(key); }
+	ValueSize--;
+	return true;
+}
+
+//删除所有的key
+template<class K, class Compare, class Alloc>
+size_t RBTMultiSet<K, Compare, Alloc>::DeleteAll(const K& key)
+{
+	auto node = tree.GetNode(key);
+	if (node == nullptr) { return 0; }
+	size_t removed = node->val;
+	tree.Delete(key);
+	ValueSize -= removed;
+	return removed;
+}
+
+//key出现的次数
+template<class K, class Compare, class Alloc>
+size_t RBTMultiSet<K, Compare, Alloc>::count(const K& key)const
+{
+	auto node = tree.GetNode(key);
+	return node == nullptr ? 0 : node->val;
+}
+
+//和key相等的所有key
+template<class K, class Compare, class Alloc>
+std::pair<const K*, size_t> RBTMultiSet<K, Compare, Alloc>::equal_range(const K& key)const
+{
+	auto node = tree.GetNode(key);
+	if (node == nullptr) { return std::pair<const K*, size_t>(nullptr, 0); }
+	return std::pair<const K*, size_t>(&node->key, node->val);
+}
+
+//按key从小到大访问[lo, hi)中的不同的key
+template<class K, class Compare, class Alloc>
+template<class Visitor>
+void RBTMultiSet<K, Compare, Alloc>::range(const K& lo, const K& hi, Visitor&& visitor)const
+{
+	tree.range(lo, hi, [&](const RBTNode<K, size_t>* node) { visitor(node->key, node->val); });
+}
+
+#endif // !MULTITREE_H
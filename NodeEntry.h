@@ -0,0 +1,18 @@
+﻿#pragma once
+#ifndef NODEENTRY_H
+#define NODEENTRY_H
+#include <optional>
+#include <utility>
+
+//并发容器(ConcurrentRBT、RCUMap、ShardedMap)的查询结果都按值返回,节点指针不会离开锁或读临界区的保护范围
+//需要C++17的std::optional
+
+//拷贝出节点的键值(node为nullptr时返回空),Node只需要有key和val成员
+template<class K, class V, class Node>
+inline std::optional<std::pair<K, V>> CopyEntry(const Node* node)
+{
+	if (node == nullptr) { return std::nullopt; }
+	return std::pair<K, V>(node->key, node->val);
+}
+
+#endif // !NODEENTRY_H
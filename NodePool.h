@@ -0,0 +1,178 @@
+﻿#pragma once
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+//节点内存池的实际存储
+//节点从slab中按指针递增的方式分配,被释放的节点挂到空闲链表上等待复用
+//Release()直接归还所有slab,代价为O(slab数)而不是O(节点数)
+class PoolArena
+{
+private:
+	struct FreeSlot { FreeSlot* next; };
+	static const size_t MinSlabSlots = 64;		//第一个slab可容纳的节点数
+	static const size_t MaxSlabSlots = 16384;	//slab大小的上限(之后每个slab都是这么大)
+
+	std::vector<void*> slabs;	//已申请的slab
+	FreeSlot* freeList;			//被回收的节点链表
+	char* cur;					//当前slab中下一个可用的位置
+	char* end;					//当前slab的末尾
+	size_t slotSize;			//每个节点占用的字节数
+	size_t nextSlabSlots;		//下一个slab可容纳的节点数
+
+	//申请一个新的slab
+	void NewSlab()
+	{
+		size_t bytes = slotSize * nextSlabSlots;
+		cur = static_cast<char*>(::operator new(bytes));
+		end = cur + bytes;
+		slabs.push_back(cur);
+		if (nextSlabSlots < MaxSlabSlots) { nextSlabSlots *= 2; }
+	}
+public:
+	//slotSize会被调整为能够存放空闲链表指针,并满足指针对齐
+	explicit PoolArena(size_t size)
+		: freeList(nullptr), cur(nullptr), end(nullptr), nextSlabSlots(MinSlabSlots)
+	{
+		slotSize = size < sizeof(FreeSlot) ? sizeof(FreeSlot) : size;
+		slotSize = (slotSize + alignof(FreeSlot) - 1) / alignof(FreeSlot) * alignof(FreeSlot);
+	}
+	~PoolArena() { Release(); }
+	PoolArena(const PoolArena&) = delete;
+	PoolArena& operator=(const PoolArena&) = delete;
+
+	//分配一个节点的空间(优先复用空闲链表)
+	void* Allocate()
+	{
+		if (freeList != nullptr)
+		{
+			FreeSlot* slot = freeList;
+			freeList = slot->next;
+			return slot;
+		}
+		if (cur == end) { NewSlab(); }
+		void* p = cur;
+		cur += slotSize;
+		return p;
+	}
+	//回收一个节点的空间
+	void Deallocate(void* p)
+	{
+		FreeSlot* slot = static_cast<FreeSlot*>(p);
+		slot->next = freeList;
+		freeList = slot;
+	}
+	//归还所有slab(调用者需保证池中已经没有存活的节点)
+	void Release()
+	{
+		for (void* slab : slabs) { ::operator delete(slab); }
+		slabs.clear();
+		freeList = nullptr;
+		cur = end = nullptr;
+		nextSlabSlots = MinSlabSlots;
+	}
+	//已申请的slab数
+	size_t SlabCount() const { return slabs.size(); }
+};
+
+//共享同一组内存池的所有NodePool(互相拷贝和rebind得到的)
+//每种节点类型一个PoolArena,用类型对应的静态变量的地址区分;只要还有这种类型的NodePool存在,它的PoolArena就一直保留
+class PoolGroup
+{
+private:
+	std::vector<std::pair<const void*, std::weak_ptr<PoolArena>>> arenas;	//类型标识和它的PoolArena
+public:
+	//类型标识为tag、节点大小为size的PoolArena,不存在(或者已经没有NodePool使用)时创建
+	std::shared_ptr<PoolArena> Get(const void* tag, size_t size)
+	{
+		for (auto& entry : arenas)
+		{
+			if (entry.first != tag) { continue; }
+			std::shared_ptr<PoolArena> arena = entry.second.lock();
+			if (arena == nullptr)
+			{
+				arena = std::make_shared<PoolArena>(size);
+				entry.second = arena;
+			}
+			return arena;
+		}
+		std::shared_ptr<PoolArena> arena = std::make_shared<PoolArena>(size);
+		arenas.emplace_back(tag, arena);
+		return arena;
+	}
+};
+
+//默认的节点分配器,满足标准库Allocator的要求,可以作为RBT/AVL/BST的Alloc模板参数
+//默认构造时创建新的PoolGroup,拷贝和rebind得到的NodePool共享同一个PoolGroup,因此它们都相等(A(B(a)) == a),
+//同一类型的NodePool使用同一个PoolArena,可以互相释放对方分配的节点;
+//用同一个NodePool构造的两棵树共享内存池,join/union_with等可以直接接过对方的节点
+//PoolArena和PoolGroup都不加锁:共享内存池的树不能在多个线程中同时修改(需要时用IndependentAllocator)
+template<class T>
+class NodePool
+{
+private:
+	template<class U> friend class NodePool;
+	std::shared_ptr<PoolGroup> group;		//共享的一组内存池
+	std::shared_ptr<PoolArena> arena;		//其中T类型节点的内存池
+
+	//T的类型标识
+	static const void* Tag()
+	{
+		static const char tag = 0;
+		return &tag;
+	}
+public:
+	using value_type = T;
+	template<class U> struct rebind { using other = NodePool<U>; };
+
+	//构造函数
+	NodePool() : group(std::make_shared<PoolGroup>()), arena(group->Get(Tag(), sizeof(T))) {}
+	template<class U> NodePool(const NodePool<U>& other) : group(other.group), arena(group->Get(Tag(), sizeof(T))) {}
+
+	//分配n个T的空间,单个节点走内存池
+	T* allocate(size_t n)
+	{
+		static_assert(alignof(T) <= alignof(std::max_align_t), "NodePool: over-aligned node type");
+		if (n == 1) { return static_cast<T*>(arena->Allocate()); }
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+	//释放allocate得到的空间
+	void deallocate(T* p, size_t n)
+	{
+		if (n == 1) { arena->Deallocate(p); }
+		else { ::operator delete(p); }
+	}
+	//整体归还T类型节点的内存池中的所有slab
+	void release() { arena->Release(); }
+	//T类型节点的内存池是否只被当前分配器使用(此时才可以整体释放)
+	bool unique() const { return arena.use_count() == 1; }
+	//T类型节点的内存池已申请的slab数
+	size_t slab_count() const { return arena->SlabCount(); }
+
+	template<class U> bool operator==(const NodePool<U>& other) const { return group == other.group; }
+	template<class U> bool operator!=(const NodePool<U>& other) const { return group != other.group; }
+};
+
+//判断分配器能否整体释放所有节点(只有独占内存池的NodePool可以)
+template<class A>
+inline bool CanReleaseAll(const A&) { return false; }
+template<class T>
+inline bool CanReleaseAll(const NodePool<T>& pool) { return pool.unique(); }
+
+//整体释放分配器的所有节点
+template<class A>
+inline void ReleaseAll(A&) {}
+template<class T>
+inline void ReleaseAll(NodePool<T>& pool) { pool.release(); }
+
+//和a同类型、可以在另一个线程中和a同时使用的分配器:NodePool返回使用新PoolGroup的分配器,其他分配器返回拷贝
+template<class A>
+inline A IndependentAllocator(const A& a) { return a; }
+template<class T>
+inline NodePool<T> IndependentAllocator(const NodePool<T>&) { return NodePool<T>(); }
+
+#endif // !NODEPOOL_H
@@ -0,0 +1,254 @@
+﻿#pragma once
+#ifndef PATHCOPYAVL_H
+#define PATHCOPYAVL_H
+#include <utility>
+#include "KeyCompare.h"
+
+//复制路径的AVL树的公共算法(PersistentAVL和RCUMap共用)
+//修改时不改动任何已有节点:从根到目标的路径和旋转涉及的节点都重新生成,返回新子树的根
+//节点的所有权由Owner决定,Owner需要提供:
+//	Node* Make(key, val, left, right)	新建节点(引用left和right)
+//	Node* Share(Node* node)				新版本继续使用已有的子树node
+//	void Retire(Node* node)				node不再属于新版本
+//	void Release(Node* node)			递归返回的新子树已经被Make引用,放弃这个中间结果
+//PersistentAVL用引用计数实现这几个操作,RCUMap把新建和替换下来的节点记录到created和replaced中
+template<class K, class Node, class Compare, class Owner>
+struct PathCopyAVL
+{
+	//离开作用域时放弃递归返回的中间结果
+	class Temp
+	{
+	public:
+		Owner& owner;
+		Node* node;
+		Temp(Owner& owner, Node* node) : owner(owner), node(node) {}
+		~Temp() { owner.Release(node); }
+		Temp(const Temp&) = delete;
+		Temp& operator=(const Temp&) = delete;
+	};
+
+	static int HeightOf(const Node* node) { return node == nullptr ? 0 : node->height; }
+	//复制src的键值,换上新的子节点
+	static Node* Copy(Owner& owner, const Node* src, Node* left, Node* right) { return owner.Make(src->key, src->val, left, right); }
+	//用src的键值和left、right组成平衡的新子树(高度差最多为2,需要时旋转),src和旋转到的旧节点被替换
+	static Node* Balance(Owner& owner, Node* src, Node* left, Node* right);
+	//复制路径插入,返回新子树;key已存在且assign为false时树不变,返回nullptr
+	template<class M>
+	static Node* InsertPath(Owner& owner, const Compare& comp, Node* node, const K& key, M&& val, bool assign, bool& inserted);
+	//复制路径删除,返回新子树(erased为false时返回nullptr,不表示空树)
+	static Node* DeletePath(Owner& owner, const Compare& comp, Node* node, const K& key, bool& erased);
+	//删除最小节点,返回新子树,minNode返回被删除的节点(由调用者替换)
+	static Node* RemoveMin(Owner& owner, Node* node, Node*& minNode);
+
+	//只读的查询,不需要Owner
+	//查找key所在的节点
+	static const Node* Find(const Node* node, const Compare& comp, const K& key);
+	//最后一个key<=key的节点
+	static const Node* Floor(const Node* node, const Compare& comp, const K& key);
+	//第一个key>=key的节点
+	static const Node* Ceiling(const Node* node, const Compare& comp, const K& key);
+	//按key从小到大对[lo, hi)中的每个节点调用visitor(const Node*),只访问O(logn + k)个节点
+	template<class Visitor>
+	static void RangeHelp(const Node* node, const Compare& comp, const K& lo, const K& hi, Visitor& visitor);
+};
+
+//用src的键值和left、right组成平衡的新子树
+template<class K, class Node, class Compare, class Owner>
+Node* PathCopyAVL<K, Node, Compare, Owner>::Balance(Owner& owner, Node* src, Node* left, Node* right)
+{
+	//和AVL的四种旋转相同,只是旋转涉及的节点都重新生成,不修改旧节点
+	int hl = HeightOf(left);
+	int hr = HeightOf(right);
+	Node* result;
+	if (hl > hr + 1)
+	{
+		if (HeightOf(left->left) >= HeightOf(left->right))
+		{
+			//LL:单右旋
+			Temp newRight(owner, Copy(owner, src, left->right, right));
+			result = Copy(owner, left, left->left, newRight.node);
+		}
+		else
+		{
+			//LR:双右旋,left->right成为新的根
+			Node* pivot = left->right;
+			Temp newLeft(owner, Copy(owner, left, left->left, pivot->left));
+			Temp newRight(owner, Copy(owner, src, pivot->right, right));
+			result = Copy(owner, pivot, newLeft.node, newRight.node);
+			owner.Retire(pivot);
+		}
+		owner.Retire(left);
+	}
+	else if (hr > hl + 1)
+	{
+		if (HeightOf(right->right) >= HeightOf(right->left))
+		{
+			//RR:单左旋
+			Temp newLeft(owner, Copy(owner, src, left, right->left));
+			result = Copy(owner, right, newLeft.node, right->right);
+		}
+		else
+		{
+			//RL:双左旋,right->left成为新的根
+			Node* pivot = right->left;
+			Temp newLeft(owner, Copy(owner, src, left, pivot->left));
+			Temp newRight(owner, Copy(owner, right, pivot->right, right->right));
+			result = Copy(owner, pivot, newLeft.node, newRight.node);
+			owner.Retire(pivot);
+		}
+		owner.Retire(right);
+	}
+	else
+	{
+		result = Copy(owner, src, left, right);
+	}
+	owner.Retire(src);
+	return result;
+}
+
+//复制路径插入
+template<class K, class Node, class Compare, class Owner>
+template<class M>
+Node* PathCopyAVL<K, Node, Compare, Owner>::InsertPath(Owner& owner, const Compare& comp, Node* node, const K& key, M&& val, bool assign, bool& inserted)
+{
+	if (node == nullptr)
+	{
+		inserted = true;
+		return owner.Make(key, std::forward<M>(val), nullptr, nullptr);
+	}
+	int cmp = KeyCompare3(comp, key, node->key);
+	if (cmp == 0)
+	{
+		//key已存在:覆盖时只复制这一个节点,否则树不变
+		inserted = false;
+		if (!assign) { return nullptr; }
+		Node* result = owner.Make(node->key, std::forward<M>(val), node->left, node->right);
+		owner.Retire(node);
+		return result;
+	}
+	if (cmp < 0)
+	{
+		Temp left(owner, InsertPath(owner, comp, node->left, key, std::forward<M>(val), assign, inserted));
+		return left.node == nullptr ? nullptr : Balance(owner, node, left.node, node->right);
+	}
+	Temp right(owner, InsertPath(owner, comp, node->right, key, std::forward<M>(val), assign, inserted));
+	return right.node == nullptr ? nullptr : Balance(owner, node, node->left, right.node);
+}
+
+//复制路径删除
+template<class K, class Node, class Compare, class Owner>
+Node* PathCopyAVL<K, Node, Compare, Owner>::DeletePath(Owner& owner, const Compare& comp, Node* node, const K& key, bool& erased)
+{
+	if (node == nullptr)
+	{
+		erased = false;
+		return nullptr;
+	}
+	int cmp = KeyCompare3(comp, key, node->key);
+	if (cmp < 0)
+	{
+		Temp left(owner, DeletePath(owner, comp, node->left, key, erased));
+		return erased ? Balance(owner, node, left.node, node->right) : nullptr;
+	}
+	if (cmp > 0)
+	{
+		Temp right(owner, DeletePath(owner, comp, node->right, key, erased));
+		return erased ? Balance(owner, node, node->left, right.node) : nullptr;
+	}
+	erased = true;
+	if (node->left == nullptr || node->right == nullptr)
+	{
+		//最多只有一个子树:直接用子树代替
+		owner.Retire(node);
+		return owner.Share(node->left != nullptr ? node->left : node->right);
+	}
+	//用右子树的最小节点代替node
+	Node* minNode;
+	Temp right(owner, RemoveMin(owner, node->right, minNode));
+	owner.Retire(node);
+	return Balance(owner, minNode, node->left, right.node);
+}
+
+//删除最小节点
+template<class K, class Node, class Compare, class Owner>
+Node* PathCopyAVL<K, Node, Compare, Owner>::RemoveMin(Owner& owner, Node* node, Node*& minNode)
+{
+	if (node->left == nullptr)
+	{
+		minNode = node;
+		return owner.Share(node->right);
+	}
+	Temp left(owner, RemoveMin(owner, node->left, minNode));
+	return Balance(owner, node, left.node, node->right);
+}
+
+//查找key所在的节点
+template<class K, class Node, class Compare, class Owner>
+const Node* PathCopyAVL<K, Node, Compare, Owner>::Find(const Node* node, const Compare& comp, const K& key)
+{
+	while (node != nullptr)
+	{
+		int cmp = KeyCompare3(comp, key, node->key);
+		if (cmp == 0) { return node; }
+		node = cmp < 0 ? node->left : node->right;
+	}
+	return nullptr;
+}
+
+//最后一个key<=key的节点
+template<class K, class Node, class Compare, class Owner>
+const Node* PathCopyAVL<K, Node, Compare, Owner>::Floor(const Node* node, const Compare& comp, const K& key)
+{
+	const Node* result = nullptr;
+	while (node != nullptr)
+	{
+		if (comp(key, node->key))
+		{
+			node = node->left;
+		}
+		else
+		{
+			result = node;
+			node = node->right;
+		}
+	}
+	return result;
+}
+
+//第一个key>=key的节点
+template<class K, class Node, class Compare, class Owner>
+const Node* PathCopyAVL<K, Node, Compare, Owner>::Ceiling(const Node* node, const Compare& comp, const K& key)
+{
+	const Node* result = nullptr;
+	while (node != nullptr)
+	{
+		if (comp(node->key, key))
+		{
+			node = node->right;
+		}
+		else
+		{
+			result = node;
+			node = node->left;
+		}
+	}
+	return result;
+}
+
+//[lo, hi)范围访问的辅助函数
+template<class K, class Node, class Compare, class Owner>
+template<class Visitor>
+void PathCopyAVL<K, Node, Compare, Owner>::RangeHelp(const Node* node, const Compare& comp, const K& lo, const K& hi, Visitor& visitor)
+{
+	while (node != nullptr)
+	{
+		bool geLo = !comp(node->key, lo);
+		bool ltHi = comp(node->key, hi);
+		if (geLo) { RangeHelp(node->left, comp, lo, hi, visitor); }
+		if (geLo && ltHi) { visitor(node); }
+		if (!ltHi) { return; }
+		node = node->right;
+	}
+}
+
+#endif // !PATHCOPYAVL_H
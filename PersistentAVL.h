@@ -0,0 +1,243 @@
+﻿#pragma once
+#ifndef PERSISTENTAVL_H
+#define PERSISTENTAVL_H
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include "PathCopyAVL.h"
+
+//PersistentAVL的节点,构造之后不再修改,可以同时属于多个版本
+template<class K, class V>
+struct PersistentNode
+{
+	K key;							//键
+	V val;							//值
+	PersistentNode<K, V>* left;		//左子节点
+	PersistentNode<K, V>* right;	//右子节点
+	int height;						//子树高度
+	mutable std::atomic<size_t> refs;	//引用计数(父节点和版本的根各算一个)
+	template<class KArg, class VArg>
+	PersistentNode(KArg&& key, VArg&& val, PersistentNode<K, V>* left, PersistentNode<K, V>* right, int height)
+		: key(std::forward<KArg>(key)), val(std::forward<VArg>(val)), left(left), right(right), height(height), refs(1) {}
+};
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
+//持久化(不可变)的AVL树
+//每个PersistentAVL对象是一个版本:修改时只复制从根到目标的路径,其余子树和旧版本共享,旧版本保持不变
+//拷贝和snapshot()只增加根的引用计数,O(1);长时间的扫描可以在快照上进行,不阻塞继续修改的写者
+//节点用原子的引用计数管理,最后一个引用它的版本析构时释放;不同线程可以各自持有和析构共享节点的版本
+//(节点可能在任意线程上释放,所以直接使用全局堆,而不是非线程安全的NodePool)
+//同一个PersistentAVL对象的修改和读取之间仍需要调用者同步,不同的版本之间不需要
+template<class K, class V, class Compare = std::less<K>>
+class PersistentAVL
+{
+	friend struct TreeTestAccess;
+private:
+	using Node = PersistentNode<K, V>;
+	//复制路径的插入、删除和旋转(节点的所有权用引用计数管理)
+	using Path = PathCopyAVL<K, Node, Compare, PersistentAVL>;
+	friend Path;
+	Node* root;			//根节点
+	int NodeSize;		//节点数
+	Compare comp;		//键的比较器
+
+	static int HeightOf(const Node* node) { return Path::HeightOf(node); }
+	//增加一个引用
+	static Node* Share(Node* node)
+	{
+		if (node != nullptr) { node->refs.fetch_add(1, std::memory_order_relaxed); }
+		return node;
+	}
+	//减少一个引用,减到0时释放节点并减少子节点的引用
+	static void Release(Node* node);
+	//新建节点,引用left和right(只在构造成功后增加它们的引用计数)
+	template<class KArg, class VArg>
+	static Node* Make(KArg&& key, VArg&& val, Node* left, Node* right);
+	//旧节点由仍然引用它的版本管理,新版本只是不再引用它
+	static void Retire(Node*) {}
+	//遍历的辅助函数
+	template<class Visitor>
+	static void inOrderHelp(const Node* node, Visitor& visitor);
+	//用新的根替换当前版本
+	void Reset(Node* newRoot, int newSize)
+	{
+		Release(root);
+		root = newRoot;
+		NodeSize = newSize;
+	}
+public:
+	//构造函数
+	PersistentAVL() : root(nullptr), NodeSize(0) {}
+	explicit PersistentAVL(const Compare& compare) : root(nullptr), NodeSize(0), comp(compare) {}
+	//拷贝得到同一个版本,O(1)
+	PersistentAVL(const PersistentAVL& other) : root(Share(other.root)), NodeSize(other.NodeSize), comp(other.comp) {}
+	PersistentAVL(PersistentAVL&& other) noexcept : root(other.root), NodeSize(other.NodeSize), comp(other.comp)
+	{
+		other.root = nullptr;
+		other.NodeSize = 0;
+	}
+	PersistentAVL& operator=(PersistentAVL other) noexcept
+	{
+		std::swap(root, other.root);
+		std::swap(NodeSize, other.NodeSize);
+		std::swap(comp, other.comp);
+		return *this;
+	}
+	//析构函数(只释放不再被其他版本引用的节点)
+	~PersistentAVL() { Release(root); }
+
+	//当前版本的快照,O(1)
+	PersistentAVL snapshot() const { return *this; }
+
+	//生成新版本(当前版本不变),O(logn)
+	//插入键值后的版本(key已存在时覆盖val)
+	[[nodiscard]] PersistentAVL Insert(const K& key, const V& val) const;
+	//删除key后的版本
+	[[nodiscard]] PersistentAVL Delete(const K& key) const;
+
+	//修改当前对象,使它指向新版本(之前取得的快照不受影响)
+	//key不存在时插入,存在时覆盖val,返回是否插入了新节点
+	template<class M>
+	bool insert_or_assign(const K& key, M&& val);
+	//key不存在时才插入,返回是否插入
+	template<class M>
+	bool try_insert(const K& key, M&& val);
+	//删除key,返回是否删除
+	bool erase(const K& key);
+	//清空
+	void Clear() { Reset(nullptr, 0); }
+
+	//查询
+	//判断key是否存在
+	bool Search(const K& key) const { return Path::Find(root, comp, key) != nullptr; }
+	//得到key所在的节点(不存在时返回nullptr),节点在引用它的版本都析构之前一直有效
+	const Node* GetNode(const K& key) const { return Path::Find(root, comp, key); }
+	//节点数
+	int getNodeSize() const { return NodeSize; }
+	//得到树的高度
+	int GetHeight() const { return HeightOf(root); }
+	//返回最小、最大值的节点
+	const Node* GetMinNode() const;
+	const Node* GetMaxNode() const;
+	//最后一个key<=key的节点
+	const Node* floor(const K& key) const { return Path::Floor(root, comp, key); }
+	//第一个key>=key的节点
+	const Node* ceiling(const K& key) const { return Path::Ceiling(root, comp, key); }
+	//按key从小到大对每个节点调用visitor(const PersistentNode*)
+	template<class Visitor>
+	void inOrder(Visitor&& visitor) const { inOrderHelp(root, visitor); }
+	//按key从小到大对[lo, hi)中的每个节点调用visitor(const PersistentNode*),只访问O(logn + k)个节点
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor) const { Path::RangeHelp(root, comp, lo, hi, visitor); }
+};
+
+//减少一个引用
+template<class K, class V, class Compare>
+void PersistentAVL<K, V, Compare>::Release(Node* node)
+{
+	//沿着只被当前节点引用的链向下释放,右子树递归,左子树循环
+	while (node != nullptr && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		Node* left = node->left;
+		Release(node->right);
+		delete node;
+		node = left;
+	}
+}
+
+//新建节点
+template<class K, class V, class Compare>
+template<class KArg, class VArg>
+PersistentNode<K, V>* PersistentAVL<K, V, Compare>::Make(KArg&& key, VArg&& val, Node* left, Node* right)
+{
+	Node* node = new Node(std::forward<KArg>(key), std::forward<VArg>(val), left, right, std::max(HeightOf(left), HeightOf(right)) + 1);
+	Share(left);
+	Share(right);
+	return node;
+}
+
+//插入键值后的版本
+template<class K, class V, class Compare>
+PersistentAVL<K, V, Compare> PersistentAVL<K, V, Compare>::Insert(const K& key, const V& val) const
+{
+	PersistentAVL result(*this);
+	result.insert_or_assign(key, val);
+	return result;
+}
+
+//删除key后的版本
+template<class K, class V, class Compare>
+PersistentAVL<K, V, Compare> PersistentAVL<K, V, Compare>::Delete(const K& key) const
+{
+	PersistentAVL result(*this);
+	result.erase(key);
+	return result;
+}
+
+//key不存在时插入,存在时覆盖val
+template<class K, class V, class Compare>
+template<class M>
+bool PersistentAVL<K, V, Compare>::insert_or_assign(const K& key, M&& val)
+{
+	bool inserted = false;
+	Node* newRoot = Path::InsertPath(*this, comp, root, key, std::forward<M>(val), true, inserted);
+	Reset(newRoot, NodeSize + (inserted ? 1 : 0));
+	return inserted;
+}
+
+//key不存在时才插入
+template<class K, class V, class Compare>
+template<class M>
+bool PersistentAVL<K, V, Compare>::try_insert(const K& key, M&& val)
+{
+	bool inserted = false;
+	Node* newRoot = Path::InsertPath(*this, comp, root, key, std::forward<M>(val), false, inserted);
+	if (inserted) { Reset(newRoot, NodeSize + 1); }
+	return inserted;
+}
+
+//删除key
+template<class K, class V, class Compare>
+bool PersistentAVL<K, V, Compare>::erase(const K& key)
+{
+	bool erased = false;
+	Node* newRoot = Path::DeletePath(*this, comp, root, key, erased);
+	if (erased) { Reset(newRoot, NodeSize - 1); }
+	return erased;
+}
+
+//返回最小值的节点
+template<class K, class V, class Compare>
+const PersistentNode<K, V>* PersistentAVL<K, V, Compare>::GetMinNode() const
+{
+	const Node* node = root;
+	while (node != nullptr && node->left != nullptr) { node = node->left; }
+	return node;
+}
+
+//返回最大值的节点
+template<class K, class V, class Compare>
+const PersistentNode<K, V>* PersistentAVL<K, V, Compare>::GetMaxNode() const
+{
+	const Node* node = root;
+	while (node != nullptr && node->right != nullptr) { node = node->right; }
+	return node;
+}
+
+//中序遍历的辅助函数
+template<class K, class V, class Compare>
+template<class Visitor>
+void PersistentAVL<K, V, Compare>::inOrderHelp(const Node* node, Visitor& visitor)
+{
+	while (node != nullptr)
+	{
+		inOrderHelp(node->left, visitor);
+		visitor(node);
+		node = node->right;
+	}
+}
+
+#endif // !PERSISTENTAVL_H
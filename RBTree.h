@@ -1,126 +1,520 @@
 ﻿#pragma once
 #ifndef RETREE_H
 #define RBTREE_H
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Augment.h"
+#include "BulkBuild.h"
+#include "FrozenTree.h"
+#include "KeyCompare.h"
+#include "NodePool.h"
+#include "TaskPool.h"
 using std::max;
 using std::swap;
 
-template<class K, class V>
-struct RBTNode
+//红黑树的节点
+//颜色压缩在父节点指针的最低位中(节点按指针对齐,指针的最低位一定为0),因此节点只比键值多出三个指针
+//Augment为附加信息策略(见Augment.h),默认的NoAugment是空基类,不占空间
+template<class K, class V, class Augment = NoAugment>
+struct RBTNode : AugmentSlot<Augment>
 {
 	K key;					//键
 	V val;					//值
-	int color;				//颜色(0为RED,1为BLACK)
-	RBTNode<K, V>* left;
-	RBTNode<K, V>* right;
-	RBTNode<K, V>* parent;
+	RBTNode<K, V, Augment>* left;
+	RBTNode<K, V, Augment>* right;
+	uintptr_t parentColor;	//父节点指针|颜色(0为RED,1为BLACK)
 	RBTNode() = default;
-	RBTNode(K key, V val) : key(key), val(val), color(0), left(nullptr), right(nullptr), parent(nullptr) {}
+	//key由第一个参数构造,val由剩余参数原地构造(没有剩余参数时值初始化)
+	template<class KArg, class... VArgs>
+	RBTNode(KArg&& key, VArgs&&... val)
+		: key(std::forward<KArg>(key)), val(std::forward<VArgs>(val)...), left(nullptr), right(nullptr), parentColor(0) {}
+
+	//父节点
+	RBTNode<K, V, Augment>* parent() const { return reinterpret_cast<RBTNode<K, V, Augment>*>(parentColor & ~uintptr_t(1)); }
+	//颜色
+	int color() const { return int(parentColor & 1); }
+	//设置父节点(保留颜色)
+	void setParent(RBTNode<K, V, Augment>* node) { parentColor = reinterpret_cast<uintptr_t>(node) | (parentColor & 1); }
+	//设置颜色(保留父节点)
+	void setColor(int color) { parentColor = (parentColor & ~uintptr_t(1)) | uintptr_t(color); }
 };
 
+//节点大小检查:颜色不额外占用空间,节点只比键值多出三个指针
+static_assert(alignof(RBTNode<char, char>) >= 2, "RBTNode: color bit needs 2-byte alignment");
+static_assert(sizeof(RBTNode<int, int>) == 2 * sizeof(int) + 3 * sizeof(void*), "RBTNode<int, int>: key + val + 3 links");
+static_assert(sizeof(RBTNode<long long, long long>) == 2 * sizeof(long long) + 3 * sizeof(void*), "RBTNode<long long, long long>: key + val + 3 links");
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
 //红黑树
 //（1）每个节点或者是黑色，或者是红色。
 //（2）根节点是黑色。
 //（3）每个叶子节点（NIL）是黑色。[注意：这里叶子节点，是指为空(NIL或NULL)的叶子节点！]
 //（4）如果一个节点是红色的，则它的子节点必须是黑色的。
 //（5）从一个节点到该节点的子孙节点的所有路径上包含相同数目的黑节点。
-template<class K, class V>
+//Compare为键的比较器(默认为std::less<K>),带is_transparent的比较器(如std::less<>)支持异构查找
+//Alloc为节点分配器(默认为NodePool内存池),会被rebind为RBTNode<K, V, Augment>的分配器
+//Augment为节点聚合值策略(默认为NoAugment,见Augment.h),由旋转和插入/删除自动维护,支持reduce(lo, hi)
+//为OrderStatistic时聚合值为子树大小,额外支持rank/select/count
+template<class K, class V, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, V>>, class Augment = NoAugment>
 class RBT
 {
+	friend struct TreeTestAccess;
 private:
+	using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<RBTNode<K, V, Augment>>;
+	using NodeTraits = std::allocator_traits<NodeAlloc>;
 	//颜色
 	enum color { RED, BLACK };	//RAD为0,BLACK为1
-	RBTNode<K, V>* root;		//树的根节点
+	RBTNode<K, V, Augment>* root;		//树的根节点
 	int NodeSize;				//树节点总数
+	NodeAlloc alloc;			//节点分配器
+	Compare comp;				//键的比较器
 
-	//将树清空
-	void ClearTree(RBTNode<K, V>* node);
+	//从分配器中申请并构造一个节点
+	template<class... Args>
+	RBTNode<K, V, Augment>* CreateNode(Args&&... args);
+	//析构节点并归还给分配器
+	void DestroyNode(RBTNode<K, V, Augment>* node);
+	//将树清空(逐个释放节点)
+	void ClearTree(RBTNode<K, V, Augment>* node);
+	//只析构以node为根的所有节点,不归还内存(内存随后由分配器整体释放)
+	void DestroyTree(RBTNode<K, V, Augment>* node);
 	//返回RBT中以node节点为根节点的最小key节点
-	RBTNode<K, V>* FindMinNode(RBTNode<K, V>* node);
+	RBTNode<K, V, Augment>* FindMinNode(RBTNode<K, V, Augment>* node)const;
 	//返回RBT中以node节点为根节点的最大key节点
-	RBTNode<K, V>* FindMaxNode(RBTNode<K, V>* node);
+	RBTNode<K, V, Augment>* FindMaxNode(RBTNode<K, V, Augment>* node)const;
+	//node的中序后继(没有时返回nullptr),沿parent指针移动,遍历整棵树时每步均摊O(1)
+	static RBTNode<K, V, Augment>* NextNode(RBTNode<K, V, Augment>* node);
+	//node的中序前驱(没有时返回nullptr)
+	static RBTNode<K, V, Augment>* PrevNode(RBTNode<K, V, Augment>* node);
+	//以node为根的子树的节点数(需要OrderStatistic)
+	static size_t SizeOf(RBTNode<K, V, Augment>* node) { return node == nullptr ? 0 : node->agg; }
+	//node的子节点或val变化后重新计算node的聚合值
+	static void Update(RBTNode<K, V, Augment>* node) { AugmentOps<Augment>::Pull(node, node->left, node->right); }
+	//从node开始沿parent指针向上重新计算到根为止的附加信息
+	static void UpdatePath(RBTNode<K, V, Augment>* node);
 
+	//旋转和插入调整都可以作用在一棵单独的子树上,root为这棵树的根(旋转到根时更新它)
 	//左旋
-	void LeftRotate(RBTNode<K, V>* x);
+	void LeftRotate(RBTNode<K, V, Augment>* x, RBTNode<K, V, Augment>*& root);
+	void LeftRotate(RBTNode<K, V, Augment>* x) { LeftRotate(x, this->root); }
 	//右旋
-	void RightRotate(RBTNode<K, V>* x);
+	void RightRotate(RBTNode<K, V, Augment>* x, RBTNode<K, V, Augment>*& root);
+	void RightRotate(RBTNode<K, V, Augment>* x) { RightRotate(x, this->root); }
 	//插入调整函数
-	void InsertFixUp(RBTNode<K, V>* node);
-	//删除调整函数
-	void DeleteFixUp(RBTNode<K, V>* node);
-	//删除节点
-	void DeleteNode(RBTNode<K, V>* node);
+	//返回整棵树的黑高是否增加了1(情景3.1一直递归到根节点时)
+	bool InsertFixUp(RBTNode<K, V, Augment>* node, RBTNode<K, V, Augment>*& root);
+	bool InsertFixUp(RBTNode<K, V, Augment>* node) { return InsertFixUp(node, this->root); }
+	//删除调整函数(node可能为nullptr,因此需要同时给出它的父节点parent)
+	void DeleteFixUp(RBTNode<K, V, Augment>* node, RBTNode<K, V, Augment>* parent);
+	//用v(可以为nullptr)顶替u在父节点中的位置
+	void Transplant(RBTNode<K, V, Augment>* u, RBTNode<K, V, Augment>* v);
+	//把node从树中摘下并释放(不修改其他节点的键值)
+	void DeleteNode(RBTNode<K, V, Augment>* node);
+	//查找key对应的节点(KT为K或透明比较器支持的其他类型)
+	template<class KT>
+	RBTNode<K, V, Augment>* FindNode(const KT& key)const;
+	//第一个key>=key的节点
+	RBTNode<K, V, Augment>* LowerBoundNode(const K& key)const;
+	//第一个key>key的节点
+	RBTNode<K, V, Augment>* UpperBoundNode(const K& key)const;
+	//最后一个key<=key的节点
+	RBTNode<K, V, Augment>* FloorNode(const K& key)const;
+	//最后一个key<key的节点
+	RBTNode<K, V, Augment>* PredecessorNode(const K& key)const;
+	//第i小(从0开始)的节点
+	RBTNode<K, V, Augment>* SelectNode(size_t i)const;
+	//子树node中key<hi的节点的聚合值
+	typename Augment::value_type ReducePrefix(RBTNode<K, V, Augment>* node, const K& hi)const;
+	//子树node中key>=lo的节点的聚合值
+	typename Augment::value_type ReduceSuffix(RBTNode<K, V, Augment>* node, const K& lo)const;
+	//一次下降找到key:存在时返回该节点,否则返回nullptr,并通过parent/isLeft返回新节点应挂的位置
+	RBTNode<K, V, Augment>* FindSlot(const K& key, RBTNode<K, V, Augment>*& parent, bool& isLeft)const;
+	//把新节点挂到FindSlot找到的位置上,并调整平衡
+	void LinkNode(RBTNode<K, V, Augment>* node, RBTNode<K, V, Augment>* parent, bool isLeft);
+	//用it开始的n个元素建出完全平衡的子树(level为子树根所在的层,redLevel层染红,其余染黑),it随之前进
+	template<class ForwardIt>
+	RBTNode<K, V, Augment>* BuildSorted(ForwardIt& it, size_t n, int level, int redLevel);
+
+	//join/split:在脱离了树的子树(根的parent为nullptr)上工作,bh为子树的黑高(不含nil,红色的根不计入)
+	//Join借用InsertFixUp和旋转来调整平衡,只修改参与连接的节点,不同子树上的join/split可以在多个线程中同时进行
+	//以node为根的子树的黑高(沿左侧链计数,O(logn))
+	int BlackHeight(RBTNode<K, V, Augment>* node);
+	//以mid为分隔连接left和right(left的key全部小于mid,right的key全部大于mid),返回新的根,bh返回新的黑高
+	//只沿较高一侧的边缘下降到黑高相同的位置,代价为O(|leftBH - rightBH| + 1)
+	RBTNode<K, V, Augment>* Join(RBTNode<K, V, Augment>* left, int leftBH, RBTNode<K, V, Augment>* mid, RBTNode<K, V, Augment>* right, int rightBH, int& bh);
+	//没有分隔节点的连接(取出right的最小节点作为分隔)
+	RBTNode<K, V, Augment>* Join2(RBTNode<K, V, Augment>* left, int leftBH, RBTNode<K, V, Augment>* right, int rightBH, int& bh);
+	//把以node为根的子树按key分成三部分:left(<key)、mid(==key的节点,不存在时为nullptr)、right(>key),O(logn)
+	void Split(RBTNode<K, V, Augment>* node, int bh, const K& key, RBTNode<K, V, Augment>*& left, int& leftBH,
+		RBTNode<K, V, Augment>*& mid, RBTNode<K, V, Augment>*& right, int& rightBH);
+	//集合运算中被丢弃的节点,通过right指针串成链表,运算结束后再统一释放
+	//(分配器不要求线程安全,并行时每个任务只往自己的链表中添加节点,最后在调用线程中释放)
+	struct DropList
+	{
+		RBTNode<K, V, Augment>* head = nullptr;
+		RBTNode<K, V, Augment>* tail = nullptr;
+		size_t count = 0;
+		//加入一个已经脱离树的节点
+		void Push(RBTNode<K, V, Augment>* node)
+		{
+			node->right = head;
+			if (tail == nullptr) { tail = node; }
+			head = node;
+			count++;
+		}
+		//把other的节点接到链表末尾
+		void Append(DropList& other)
+		{
+			if (other.head == nullptr) { return; }
+			if (tail == nullptr) { head = other.head; }
+			else { tail->right = other.head; }
+			tail = other.tail;
+			count += other.count;
+		}
+	};
+	//把以node为根的子树的所有节点加入list
+	static void DropTree(RBTNode<K, V, Augment>* node, DropList& list);
+	//释放list中的所有节点,返回释放的节点数
+	size_t FreeDropped(DropList& list);
+	//集合运算的递归部分:pool不为nullptr并且子树的黑高至少为grainBH时,分开的两边交给pool并行计算
+	//并集:other的节点(t2)直接接入结果,key相同时丢弃t1中的节点
+	RBTNode<K, V, Augment>* Union(RBTNode<K, V, Augment>* t1, int bh1, RBTNode<K, V, Augment>* t2, int bh2, int& bh, DropList& dropped, TaskPool* pool, int grainBH);
+	//交集:只读取t2,t1中不在t2中的节点被丢弃
+	RBTNode<K, V, Augment>* Intersect(RBTNode<K, V, Augment>* t1, int bh1, const RBTNode<K, V, Augment>* t2, int& bh, DropList& dropped, TaskPool* pool, int grainBH);
+	//差集:只读取t2,t1中同时在t2中的节点被丢弃
+	RBTNode<K, V, Augment>* Difference(RBTNode<K, V, Augment>* t1, int bh1, const RBTNode<K, V, Augment>* t2, int& bh, DropList& dropped, TaskPool* pool, int grainBH);
+	//集合运算的入口(pool为nullptr时串行)
+	void UnionWith(RBT& other, TaskPool* pool, size_t grain);
+	void IntersectWith(const RBT& other, TaskPool* pool, size_t grain);
+	void DifferenceWith(const RBT& other, TaskPool* pool, size_t grain);
+	//子树的节点数(维护OrderStatistic时O(1),否则需要遍历)
+	static size_t TreeSize(RBTNode<K, V, Augment>* node, std::true_type) { return SizeOf(node); }
+	static size_t TreeSize(RBTNode<K, V, Augment>* node, std::false_type);
+	//取走other的所有节点作为本树可以使用的子树(分配器相等时直接接管,否则移动到本树的分配器中),other被清空
+	//pool不为nullptr时移动过来的节点并行构造
+	RBTNode<K, V, Augment>* Adopt(RBT& other, int& bh, TaskPool* pool, size_t grain);
+	//并行批量构造:节点先在当前线程中全部申请好,再由pool并行构造和连接(分配器不需要线程安全)
+	template<class RandomIt>
+	RBTNode<K, V, Augment>* BuildSortedParallel(RandomIt first, size_t n, TaskPool& pool, size_t grain);
+	//和BuildSorted相同的划分,第i个元素构造在slots[i]中,不小于grain个节点的子树左右两边并行构造
+	template<class RandomIt>
+	RBTNode<K, V, Augment>* BuildInSlots(RandomIt first, RBTNode<K, V, Augment>** slots, size_t n, int level, int redLevel, TaskPool& pool, size_t grain);
 
 	//前序遍历的辅助函数(RBTNode* 可更改node的值)
-	void preOrderHelp(RBTNode<K, V>* node, void(*function)(RBTNode<K, V>* node));
+	template<class Function>
+	void preOrderHelp(RBTNode<K, V, Augment>* node, Function& function);
 	//中序遍历的辅助函数(RBTNode* 可更改node的值)
-	void inOrderHelp(RBTNode<K, V>* node, void(*function)(RBTNode<K, V>* node));
+	template<class Function>
+	void inOrderHelp(RBTNode<K, V, Augment>* node, Function& function);
 	//后序遍历的辅助函数(RBTNode* 可更改node的值)
-	void backOrderHelp(RBTNode<K, V>* node, void(*function)(RBTNode<K, V>* node));
+	template<class Function>
+	void backOrderHelp(RBTNode<K, V, Augment>* node, Function& function);
 
 	//node节点的颜色
-	int colorOf(RBTNode<K, V>* node);
+	int colorOf(RBTNode<K, V, Augment>* node);
 	//node节点的左子节点
-	RBTNode<K, V>* leftOf(RBTNode<K, V>* node);
+	RBTNode<K, V, Augment>* leftOf(RBTNode<K, V, Augment>* node);
 	//node节点的右子节点
-	RBTNode<K, V>* rightOf(RBTNode<K, V>* node);
+	RBTNode<K, V, Augment>* rightOf(RBTNode<K, V, Augment>* node);
 	//node节点的父节点
-	RBTNode<K, V>* parentOf(RBTNode<K, V>* node);
+	RBTNode<K, V, Augment>* parentOf(RBTNode<K, V, Augment>* node);
 	//设置node节点的颜色
-	void setColor(RBTNode<K, V>* node, int color);
+	void setColor(RBTNode<K, V, Augment>* node, int color);
 	//得到树的高度的辅助函数
-	int get_Height_Help(RBTNode<K, V>* node)const;
+	int get_Height_Help(RBTNode<K, V, Augment>* node)const;
 public:
+	//双向迭代器(IsConst为true时为const_iterator),按key从小到大访问节点,通过it->key/it->val访问键值
+	//只保存当前节点和所属的树,++/--沿parent指针移动,不需要递归或栈
+	template<bool IsConst>
+	class Iter
+	{
+	private:
+		friend class RBT;
+		template<bool> friend class Iter;
+		RBTNode<K, V, Augment>* node;	//当前节点(end()时为nullptr)
+		const RBT* tree;		//所属的树(--end()时需要找到最大节点)
+		Iter(RBTNode<K, V, Augment>* node, const RBT* tree) : node(node), tree(tree) {}
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = RBTNode<K, V, Augment>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = typename std::conditional<IsConst, const RBTNode<K, V, Augment>*, RBTNode<K, V, Augment>*>::type;
+		using reference = typename std::conditional<IsConst, const RBTNode<K, V, Augment>&, RBTNode<K, V, Augment>&>::type;
+
+		Iter() : node(nullptr), tree(nullptr) {}
+		//iterator可以隐式转换为const_iterator
+		template<bool OtherConst, class = typename std::enable_if<IsConst && !OtherConst>::type>
+		Iter(const Iter<OtherConst>& other) : node(other.node), tree(other.tree) {}
+
+		reference operator*() const { return *node; }
+		pointer operator->() const { return node; }
+		Iter& operator++() { node = NextNode(node); return *this; }
+		Iter operator++(int) { Iter old = *this; node = NextNode(node); return old; }
+		Iter& operator--() { node = node == nullptr ? tree->FindMaxNode(tree->root) : PrevNode(node); return *this; }
+		Iter operator--(int) { Iter old = *this; --*this; return old; }
+		friend bool operator==(const Iter& a, const Iter& b) { return a.node == b.node; }
+		friend bool operator!=(const Iter& a, const Iter& b) { return a.node != b.node; }
+	};
+	using iterator = Iter<false>;
+	using const_iterator = Iter<true>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
 	//构造函数
 	RBT() { root = nullptr; NodeSize = 0; }
+	explicit RBT(const Compare& compare, const Alloc& allocator = Alloc()) : alloc(allocator), comp(compare) { root = nullptr; NodeSize = 0; }
+	explicit RBT(const Alloc& allocator) : alloc(allocator) { root = nullptr; NodeSize = 0; }
+	//批量构造(O(n),不做比较也不旋转):[first, last)中为pair-like的元素(first为key,second为val),key必须严格递增
+	template<class ForwardIt>
+	RBT(sorted_input_t, ForwardIt first, ForwardIt last, const Compare& compare = Compare(), const Alloc& allocator = Alloc())
+		: alloc(allocator), comp(compare) { root = nullptr; NodeSize = 0; build_from_sorted(first, last); }
+	//输入无序时先按key排序再批量构造(重复的key保留最后一个,和逐个Insert的结果相同)
+	template<class InputIt>
+	RBT(InputIt first, InputIt last, const Compare& compare = Compare(), const Alloc& allocator = Alloc())
+		: alloc(allocator), comp(compare) { root = nullptr; NodeSize = 0; build(first, last); }
 	//析构函数
 	~RBT() { Clear(); }
-	//插入节点的函数
-	void Insert(const K& key, const V& val);
+	//插入节点的函数(key已存在时覆盖val)
+	void Insert(const K& key, const V& val) { insert_or_assign(key, val); }
+	void Insert(K&& key, V&& val) { insert_or_assign(std::move(key), std::move(val)); }
+	//用args原地构造节点(key为第一个参数),key已存在时不插入;返回key对应的节点和是否插入成功
+	template<class... Args>
+	std::pair<RBTNode<K, V, Augment>*, bool> emplace(Args&&... args);
+	//key不存在时才用args原地构造val(key已存在时args不会被移动)
+	template<class... Args>
+	std::pair<RBTNode<K, V, Augment>*, bool> try_emplace(const K& key, Args&&... args);
+	template<class... Args>
+	std::pair<RBTNode<K, V, Augment>*, bool> try_emplace(K&& key, Args&&... args);
+	//key不存在时插入,存在时把val赋给已有节点
+	template<class M>
+	std::pair<RBTNode<K, V, Augment>*, bool> insert_or_assign(const K& key, M&& val);
+	template<class M>
+	std::pair<RBTNode<K, V, Augment>*, bool> insert_or_assign(K&& key, M&& val);
 	//删除节点的函数
 	void Delete(const K& key);
 	//判断RBT中是否存在键值为key的节点
-	bool Search(const K& key)const;
-	//RBT树清空
-	void Clear() { ClearTree(this->root); this->root = nullptr; this->NodeSize = 0; }
-	//得到RBT中指定key值节点
-	RBTNode<K, V>* GetNode(const K& key)const;
+	bool Search(const K& key)const { return FindNode(key) != nullptr; }
+	//异构查找(需要透明比较器,例如用std::string_view查找std::string键,不会构造临时的键)
+	template<class KT, class C = Compare, class = typename C::is_transparent>
+	bool Search(const KT& key)const { return FindNode(key) != nullptr; }
+	//RBT树清空(独占内存池时整块释放slab,不需要逐个释放节点)
+	void Clear();
+	//清空后从key严格递增的[first, last)批量构造,O(n)
+	template<class ForwardIt>
+	void build_from_sorted(ForwardIt first, ForwardIt last);
+	//清空后从任意顺序的[first, last)批量构造(先排序,大规模输入使用并行排序)
+	template<class InputIt>
+	void build(InputIt first, InputIt last);
+	//并行批量构造:左右子树交给pool同时构造,小于grain个节点的子树串行构造
+	template<class RandomIt>
+	void build_from_sorted(RandomIt first, RandomIt last, TaskPool& pool, size_t grain = TaskPool::DefaultGrain);
+	template<class InputIt>
+	void build(InputIt first, InputIt last, TaskPool& pool, size_t grain = TaskPool::DefaultGrain);
+
+	//集合运算(基于join/split,m、n为两棵树的大小(m<=n),代价为O(m log(n/m + 1)),而不是逐个插入的O(m logn))
+	//把other的所有键值并入本树(key相同时保留other的val),other被清空
+	//(分配器不相等时先要用O(|other|)把other的键值移动到本树分配器的新节点中,见join)
+	void union_with(RBT& other) { UnionWith(other, nullptr, 0); }
+	//只保留同时在other中的key(保留本树的val)
+	void intersect_with(const RBT& other) { IntersectWith(other, nullptr, 0); }
+	//删除同时在other中的key
+	void difference_with(const RBT& other) { DifferenceWith(other, nullptr, 0); }
+	//并行版本:分开的两边交给pool(见TaskPool.h)同时计算,子树小于grain个节点时退回串行代码
+	//运算期间其他线程不能访问这两棵树
+	void union_with(RBT& other, TaskPool& pool, size_t grain = TaskPool::DefaultGrain) { UnionWith(other, &pool, grain); }
+	void intersect_with(const RBT& other, TaskPool& pool, size_t grain = TaskPool::DefaultGrain) { IntersectWith(other, &pool, grain); }
+	void difference_with(const RBT& other, TaskPool& pool, size_t grain = TaskPool::DefaultGrain) { DifferenceWith(other, &pool, grain); }
+	//删除key在[lo, hi)中的所有节点,O(k + logn)
+	void erase_range(const K& lo, const K& hi);
+	//删除pos指向的节点(不再重新查找),返回下一个位置;指向其他节点的迭代器仍然有效
+	iterator erase(const_iterator pos);
+	//删除[first, last)中的节点,返回last;和erase_range一样基于split/join,O(k + logn)
+	iterator erase(const_iterator first, const_iterator last);
+	//把key>=key的节点移到right中(right原有的节点被清空,之后和本树共享分配器),O(logn)
+	//不维护OrderStatistic时还需要遍历移出的部分来更新节点数
+	void split(const K& key, RBT& right);
+	//把right的节点接到本树之后(要求本树的key全部小于right的key),right被清空
+	//分配器相等时(right由split得到,或者两棵树用同一个NodePool构造)直接接过right的节点,O(logn);
+	//否则要把right的键值移动到本树分配器的新节点中,O(|right|)
+	void join(RBT& right);
+	//得到RBT中指定key值节点(和find一样,const的树只给出const节点;下面的floor/ceiling/select等同理)
+	RBTNode<K, V, Augment>* GetNode(const K& key) { return FindNode(key); }
+	const RBTNode<K, V, Augment>* GetNode(const K& key)const { return FindNode(key); }
+	template<class KT, class C = Compare, class = typename C::is_transparent>
+	RBTNode<K, V, Augment>* GetNode(const KT& key) { return FindNode(key); }
+	template<class KT, class C = Compare, class = typename C::is_transparent>
+	const RBTNode<K, V, Augment>* GetNode(const KT& key)const { return FindNode(key); }
 	//返回RBT中最小值的节点
-	RBTNode<K, V>* GetMinNode()const;
+	RBTNode<K, V, Augment>* GetMinNode() { return FindMinNode(this->root); }
+	const RBTNode<K, V, Augment>* GetMinNode()const { return FindMinNode(this->root); }
 	//返回RBT中最大值的节点
-	RBTNode<K, V>* GetMaxNode()const;
+	RBTNode<K, V, Augment>* GetMaxNode() { return FindMaxNode(this->root); }
+	const RBTNode<K, V, Augment>* GetMaxNode()const { return FindMaxNode(this->root); }
 	//得到RBT树的高度
 	int GetHeight()const { return get_Height_Help(this->root); }
+	//得到RBT的节点数
+	int getNodeSize()const { return NodeSize; }
 	//先序遍历
-	void preOrder(void(*function)(RBTNode<K, V>* node)) { preOrderHelp(this->root, function); }
-	//中序遍历
-	void inOrder(void(*function)(RBTNode<K, V>* node)) { inOrderHelp(this->root, function); }
+	template<class Function>
+	void preOrder(Function&& function) { preOrderHelp(this->root, function); }
+	//中序遍历(三种遍历的function都可以是带捕获的lambda或函数指针)
+	template<class Function>
+	void inOrder(Function&& function) { inOrderHelp(this->root, function); }
 	//后序遍历
-	void backOrder(void(*function)(RBTNode<K, V>* node)) { backOrderHelp(this->root, function); }
+	template<class Function>
+	void backOrder(Function&& function) { backOrderHelp(this->root, function); }
+
+	//迭代器
+	iterator begin() { return iterator(FindMinNode(this->root), this); }
+	const_iterator begin()const { return const_iterator(FindMinNode(this->root), this); }
+	const_iterator cbegin()const { return begin(); }
+	iterator end() { return iterator(nullptr, this); }
+	const_iterator end()const { return const_iterator(nullptr, this); }
+	const_iterator cend()const { return end(); }
+	reverse_iterator rbegin() { return reverse_iterator(end()); }
+	const_reverse_iterator rbegin()const { return const_reverse_iterator(end()); }
+	reverse_iterator rend() { return reverse_iterator(begin()); }
+	const_reverse_iterator rend()const { return const_reverse_iterator(begin()); }
+	//查找key,不存在时返回end()
+	iterator find(const K& key) { return iterator(FindNode(key), this); }
+	const_iterator find(const K& key)const { return const_iterator(FindNode(key), this); }
+	template<class KT, class C = Compare, class = typename C::is_transparent>
+	iterator find(const KT& key) { return iterator(FindNode(key), this); }
+	template<class KT, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const KT& key)const { return const_iterator(FindNode(key), this); }
+
+	//有序查询(一次下降,O(logn))
+	//第一个key>=key的位置
+	iterator lower_bound(const K& key) { return iterator(LowerBoundNode(key), this); }
+	const_iterator lower_bound(const K& key)const { return const_iterator(LowerBoundNode(key), this); }
+	//第一个key>key的位置
+	iterator upper_bound(const K& key) { return iterator(UpperBoundNode(key), this); }
+	const_iterator upper_bound(const K& key)const { return const_iterator(UpperBoundNode(key), this); }
+	//最后一个key<=key的节点(没有时返回nullptr)
+	RBTNode<K, V, Augment>* floor(const K& key) { return FloorNode(key); }
+	const RBTNode<K, V, Augment>* floor(const K& key)const { return FloorNode(key); }
+	//第一个key>=key的节点(没有时返回nullptr)
+	RBTNode<K, V, Augment>* ceiling(const K& key) { return LowerBoundNode(key); }
+	const RBTNode<K, V, Augment>* ceiling(const K& key)const { return LowerBoundNode(key); }
+	//最后一个key<key的节点(没有时返回nullptr)
+	RBTNode<K, V, Augment>* predecessor(const K& key) { return PredecessorNode(key); }
+	const RBTNode<K, V, Augment>* predecessor(const K& key)const { return PredecessorNode(key); }
+	//第一个key>key的节点(没有时返回nullptr)
+	RBTNode<K, V, Augment>* successor(const K& key) { return UpperBoundNode(key); }
+	const RBTNode<K, V, Augment>* successor(const K& key)const { return UpperBoundNode(key); }
+	//按key从小到大对[lo, hi)中的每个节点调用visitor(RBTNode*),只访问O(logn + k)个节点
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor);
+	//只读版本,visitor的参数为const RBTNode*
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor)const;
+	//冻结成只读的FrozenTree(见FrozenTree.h):键值复制到无指针的数组中,查找更快;O(n),本树不变
+	FrozenTree<K, V, Compare> freeze()const;
+
+	//顺序统计(需要Augment为OrderStatistic,均为一次下降,O(logn))
+	//key小于key的节点数
+	size_t rank(const K& key)const;
+	//第i小(从0开始)的节点,i超出范围时返回nullptr
+	RBTNode<K, V, Augment>* select(size_t i) { return SelectNode(i); }
+	const RBTNode<K, V, Augment>* select(size_t i)const { return SelectNode(i); }
+	//key在[lo, hi)中的节点数
+	size_t count(const K& lo, const K& hi)const { return comp(lo, hi) ? rank(hi) - rank(lo) : 0; }
 
-	//重载[]操作符
-	V& operator[](const K& key);
+	//聚合查询(需要Augment为聚合策略,见Augment.h)
+	//整棵树的聚合值,O(1)
+	typename Augment::value_type reduce()const { return AugmentOps<Augment>::Of(this->root); }
+	//key在[lo, hi)中的节点的聚合值,O(logn)
+	typename Augment::value_type reduce(const K& lo, const K& hi)const;
+	//通过节点指针或operator[]直接修改val之后,调用refresh(key)重新计算key所在路径上的聚合值
+	void refresh(const K& key);
+
+	//重载[]操作符(只下降一次,key不存在时插入值初始化的val)
+	V& operator[](const K& key) { return try_emplace(key).first->val; }
+	V& operator[](K&& key) { return try_emplace(std::move(key)).first->val; }
 
 	//防止拷贝构造
-	RBT(const RBT<K, V>& anotherTree) = delete;
-	RBT<K, V>& operator=(const RBT<K, V>& anotherTree) = delete;
+	RBT(const RBT& anotherTree) = delete;
+	RBT& operator=(const RBT& anotherTree) = delete;
 };
 
 
-//将树清空
-template<class K, class V>
-void RBT<K, V>::ClearTree(RBTNode<K, V>* node)
+//从分配器中申请并构造一个节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class... Args>
+inline RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::CreateNode(Args&&... args)
+{
+	RBTNode<K, V, Augment>* node = NodeTraits::allocate(alloc, 1);
+	try
+	{
+		NodeTraits::construct(alloc, node, std::forward<Args>(args)...);
+	}
+	catch (...)
+	{
+		NodeTraits::deallocate(alloc, node, 1);
+		throw;
+	}
+	return node;
+}
+
+//析构节点并归还给分配器
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline void RBT<K, V, Compare, Alloc, Augment>::DestroyNode(RBTNode<K, V, Augment>* node)
+{
+	NodeTraits::destroy(alloc, node);
+	NodeTraits::deallocate(alloc, node, 1);
+}
+
+//将树清空(逐个释放节点)
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::ClearTree(RBTNode<K, V, Augment>* node)
 {
 	if (node == nullptr) { return; }
 	ClearTree(node->left);
 	ClearTree(node->right);
-	delete node;
+	DestroyNode(node);
+}
+
+//只析构以node为根的所有节点,不归还内存
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::DestroyTree(RBTNode<K, V, Augment>* node)
+{
+	if (node == nullptr) { return; }
+	DestroyTree(node->left);
+	DestroyTree(node->right);
+	NodeTraits::destroy(alloc, node);
+}
+
+//RBT树清空
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::Clear()
+{
+	if (CanReleaseAll(alloc))
+	{
+		//内存池只属于这棵树:平凡析构的节点连遍历都不需要,直接整块归还slab
+		if (!std::is_trivially_destructible<RBTNode<K, V, Augment>>::value) { DestroyTree(this->root); }
+		ReleaseAll(alloc);
+	}
+	else
+	{
+		ClearTree(this->root);
+	}
+	this->root = nullptr;
+	this->NodeSize = 0;
 }
 
 //返回RBT中以node节点为根节点的最小key节点
-template<class K, class V>
-RBTNode<K, V>* RBT<K, V>::FindMinNode(RBTNode<K, V>* node)
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::FindMinNode(RBTNode<K, V, Augment>* node)const
 {
-	RBTNode<K, V>* tempNode = node;
+	RBTNode<K, V, Augment>* tempNode = node;
 	if (tempNode != nullptr)
 	{
 		while (tempNode->left != nullptr)
@@ -132,10 +526,10 @@ RBTNode<K, V>* RBT<K, V>::FindMinNode(RBTNode<K, V>* node)
 }
 
 //返回RBT中以node节点为根节点的最大key节点
-template<class K, class V>
-RBTNode<K, V>* RBT<K, V>::FindMaxNode(RBTNode<K, V>* node)
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::FindMaxNode(RBTNode<K, V, Augment>* node)const
 {
-	RBTNode<K, V>* tempNode = node;
+	RBTNode<K, V, Augment>* tempNode = node;
 	if (tempNode != nullptr)
 	{
 		while (tempNode->right != nullptr)
@@ -146,53 +540,107 @@ RBTNode<K, V>* RBT<K, V>::FindMaxNode(RBTNode<K, V>* node)
 	return tempNode;
 }
 
+//node的中序后继
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::NextNode(RBTNode<K, V, Augment>* node)
+{
+	if (node->right != nullptr)
+	{
+		//有右子树:后继为右子树的最小节点
+		node = node->right;
+		while (node->left != nullptr) { node = node->left; }
+		return node;
+	}
+	//否则向上找到第一个"自己在其左子树中"的祖先
+	RBTNode<K, V, Augment>* parent = node->parent();
+	while (parent != nullptr && node == parent->right)
+	{
+		node = parent;
+		parent = parent->parent();
+	}
+	return parent;
+}
+
+//node的中序前驱
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::PrevNode(RBTNode<K, V, Augment>* node)
+{
+	if (node->left != nullptr)
+	{
+		//有左子树:前驱为左子树的最大节点
+		node = node->left;
+		while (node->right != nullptr) { node = node->right; }
+		return node;
+	}
+	//否则向上找到第一个"自己在其右子树中"的祖先
+	RBTNode<K, V, Augment>* parent = node->parent();
+	while (parent != nullptr && node == parent->left)
+	{
+		node = parent;
+		parent = parent->parent();
+	}
+	return parent;
+}
+
+//从node开始向上重新计算到根为止的附加信息
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::UpdatePath(RBTNode<K, V, Augment>* node)
+{
+	//不维护附加信息时不需要向上走
+	if (std::is_same<Augment, NoAugment>::value) { return; }
+	for (; node != nullptr; node = node->parent())
+	{
+		Update(node);
+	}
+}
+
 //node节点的颜色
-template<class K, class V>
-inline int RBT<K, V>::colorOf(RBTNode<K, V>* node)
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline int RBT<K, V, Compare, Alloc, Augment>::colorOf(RBTNode<K, V, Augment>* node)
 {
-	return node == nullptr ? BLACK : node->color;
+	return node == nullptr ? BLACK : node->color();
 }
 
 //node节点的左子节点
-template<class K, class V>
-inline RBTNode<K, V>* RBT<K, V>::leftOf(RBTNode<K, V>* node)
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::leftOf(RBTNode<K, V, Augment>* node)
 {
 	return node == nullptr ? nullptr : node->left;
 }
 
 //node节点的右子节点
-template<class K, class V>
-inline RBTNode<K, V>* RBT<K, V>::rightOf(RBTNode<K, V>* node)
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::rightOf(RBTNode<K, V, Augment>* node)
 {
 	return node == nullptr ? nullptr : node->right;
 }
 
 //node节点的父节点
-template<class K, class V>
-inline RBTNode<K, V>* RBT<K, V>::parentOf(RBTNode<K, V>* node)
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::parentOf(RBTNode<K, V, Augment>* node)
 {
-	return node == nullptr ? nullptr : node->parent;
+	return node == nullptr ? nullptr : node->parent();
 }
 
 //设置node节点的颜色
-template<class K, class V>
-inline void RBT<K, V>::setColor(RBTNode<K, V>* node, int color)
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline void RBT<K, V, Compare, Alloc, Augment>::setColor(RBTNode<K, V, Augment>* node, int color)
 {
 	if (node != nullptr)
-		node->color = color;
+		node->setColor(color);
 }
 
 //得到树的高度的辅助函数
-template<class K, class V>
-int RBT<K, V>::get_Height_Help(RBTNode<K, V>* node)const
+template<class K, class V, class Compare, class Alloc, class Augment>
+int RBT<K, V, Compare, Alloc, Augment>::get_Height_Help(RBTNode<K, V, Augment>* node)const
 {
 	if (node == nullptr) { return 0; }
 	return max(get_Height_Help(node->left), get_Height_Help(node->right)) + 1;
 }
 
 //左旋
-template<class K, class V>
-void RBT<K, V>::LeftRotate(RBTNode<K, V>* x)
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::LeftRotate(RBTNode<K, V, Augment>* x, RBTNode<K, V, Augment>*& root)
 {
 	/*示意图
 	*		p							p
@@ -203,39 +651,42 @@ void RBT<K, V>::LeftRotate(RBTNode<K, V>* x)
 	*        / \					 / \
 	*       ly ry					lx ly
 	*/
-	RBTNode<K, V>* y = x->right;
+	RBTNode<K, V, Augment>* y = x->right;
 	//1.将x的右子节点指向y的左子节点(ly),将y的左子节点的父节点更新为x
 	x->right = y->left;
 	if (y->left != nullptr)
 	{
-		y->left->parent = x;
+		y->left->setParent(x);
 	}
 
 	//2.当x的父节点(不为空时),更新y的父节点为x的父节点，并将x的父节点指定子树(当前x的子树位置)指定为y
-	y->parent = x->parent;
+	y->setParent(x->parent());
 
-	if (x->parent == nullptr)
+	if (x->parent() == nullptr)
 	{
 		//如果x为根节点
-		this->root = y;
+		root = y;
 	}
-	else if (x->parent->left == x)
+	else if (x->parent()->left == x)
 	{
-		x->parent->left = y;
+		x->parent()->left = y;
 	}
 	else
 	{
-		x->parent->right = y;
+		x->parent()->right = y;
 	}
 
 	//3.将x的父节点更新为y，将y的左子节点更新为x
-	x->parent = y;
+	x->setParent(y);
 	y->left = x;
+	//x成为y的子节点,先更新x再更新y
+	Update(x);
+	Update(y);
 }
 
 //右旋
-template<class K, class V>
-void RBT<K, V>::RightRotate(RBTNode<K, V>* x)
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::RightRotate(RBTNode<K, V, Augment>* x, RBTNode<K, V, Augment>*& root)
 {
 	/*示意图
 	*		p							p
@@ -246,36 +697,38 @@ void RBT<K, V>::RightRotate(RBTNode<K, V>* x)
 	*	 / \							 / \
 	*   ly ry							ry rx
 	*/
-	RBTNode<K, V>* y = x->left;
+	RBTNode<K, V, Augment>* y = x->left;
 	x->left = y->right;
 	if (y->right != nullptr)
 	{
-		y->right->parent = x;
+		y->right->setParent(x);
 	}
 
-	y->parent = x->parent;
+	y->setParent(x->parent());
 	//将p左子树或者右子树的位置指向y(看x具体在那边)
-	if (x->parent == nullptr)
+	if (x->parent() == nullptr)
 	{
-		this->root = y;
+		root = y;
 	}
-	else if (x->parent->left == x)
+	else if (x->parent()->left == x)
 	{
-		x->parent->left = y;
+		x->parent()->left = y;
 	}
 	else
 	{
-		x->parent->right = y;
+		x->parent()->right = y;
 	}
 
 	//将y的右子节点更新为x,x的父节点更新为y
 	y->right = x;
-	x->parent = y;
+	x->setParent(y);
+	Update(x);
+	Update(y);
 }
 
 //插入调整函数
-template<class K, class V>
-void RBT<K, V>::InsertFixUp(RBTNode<K, V>* node)
+template<class K, class V, class Compare, class Alloc, class Augment>
+bool RBT<K, V, Compare, Alloc, Augment>::InsertFixUp(RBTNode<K, V, Augment>* node, RBTNode<K, V, Augment>*& root)
 {
 	//情景1:红黑树为空树，将跟节点染色为黑色（插入时已经处理,调整不需要处理）
 	//情景2: 插入节点的父节点为黑色(不会破坏平衡,因此也不需要处理)
@@ -287,15 +740,17 @@ void RBT<K, V>::InsertFixUp(RBTNode<K, V>* node)
 	//---- 情景3.3 : 叔叔节点不存在，或者为黑色，父节点为爷爷节点的右子树
 	//		—-- 情景3.3.1 : 插入节点为其父节点的右子节点(RR情况),(父节点染黑,爷爷节点染红,并对爷爷节点左旋)
 	//		---- 情景3.3.2 : 插入节点为其父节点的左子节点(RL情况),(先对父节点右旋,转换为RR情况)
-	setColor(this->root, BLACK);
-	if (parentOf(node) == nullptr || colorOf(parentOf(node)) == BLACK) { return; }
+	//根节点为红色只可能是情景1或者情景3.1递归到了根节点,此时染黑会使黑高加1
+	bool grown = colorOf(root) == RED;
+	setColor(root, BLACK);
+	if (parentOf(node) == nullptr || colorOf(parentOf(node)) == BLACK) { return grown; }
 	//找到叔叔节点
-	RBTNode<K, V>* Father = parentOf(node);
-	RBTNode<K, V>* GrandFather = parentOf(Father);
+	RBTNode<K, V, Augment>* Father = parentOf(node);
+	RBTNode<K, V, Augment>* GrandFather = parentOf(Father);
 	int LRFlag = leftOf(GrandFather) == Father ? 1 : -1;//父节点为左子树则LRFlag = 1,否则LRFlag = -1
-	RBTNode<K, V>* Uncle = LRFlag == 1 ? rightOf(GrandFather) : leftOf(GrandFather);
+	RBTNode<K, V, Augment>* Uncle = LRFlag == 1 ? rightOf(GrandFather) : leftOf(GrandFather);
 
-	if (Uncle != nullptr && Uncle->color == RED)
+	if (Uncle != nullptr && Uncle->color() == RED)
 	{
 		//情景3.1
 		//先染色
@@ -303,7 +758,7 @@ void RBT<K, V>::InsertFixUp(RBTNode<K, V>* node)
 		setColor(Father, BLACK);
 		setColor(GrandFather, RED);
 		//递归
-		InsertFixUp(GrandFather);
+		return InsertFixUp(GrandFather, root);
 	}
 	else if (Uncle == nullptr || colorOf(Uncle) == BLACK)
 	{
@@ -314,7 +769,7 @@ void RBT<K, V>::InsertFixUp(RBTNode<K, V>* node)
 			if (node == rightOf(Father))
 			{
 				//LR情况,先对父节点左旋
-				LeftRotate(Father);
+				LeftRotate(Father, root);
 				//此时的Father和node已经改变
 				//交换Father和node
 				swap(Father, node);
@@ -322,7 +777,7 @@ void RBT<K, V>::InsertFixUp(RBTNode<K, V>* node)
 			//情况3.2.1(LL情况)
 			setColor(Father, BLACK);
 			setColor(GrandFather, RED);
-			RightRotate(GrandFather);
+			RightRotate(GrandFather, root);
 		}
 		else
 		{
@@ -330,7 +785,7 @@ void RBT<K, V>::InsertFixUp(RBTNode<K, V>* node)
 			if (node == leftOf(Father))
 			{
 				//RL情况,先对父节点右旋
-				RightRotate(Father);
+				RightRotate(Father, root);
 				//此时的Father和node已经改变
 				//交换Father和node
 				swap(Father, node);
@@ -338,147 +793,164 @@ void RBT<K, V>::InsertFixUp(RBTNode<K, V>* node)
 			//情况3.3.1,RR情况
 			setColor(Father, BLACK);
 			setColor(GrandFather, RED);
-			LeftRotate(GrandFather);
+			LeftRotate(GrandFather, root);
 		}
 	}
+	//旋转不会改变黑高
+	return false;
 }
 
 //删除调整函数
-template<class K, class V>
-void RBT<K, V>::DeleteFixUp(RBTNode<K, V>* node)
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::DeleteFixUp(RBTNode<K, V, Augment>* node, RBTNode<K, V, Augment>* parent)
 {
 	while (node != this->root && colorOf(node) == BLACK) //当结点node不为根并且它的颜色不是黑色
 	{
-		if (node == leftOf(parentOf(node)))
+		if (node == parent->left)
 		{
 			//node在左子树
-			RBTNode<K, V> brother = rightOf(parentOf(node));    //brother节点是node节点的兄弟结点
+			RBTNode<K, V, Augment>* brother = parent->right;    //brother节点是node节点的兄弟结点
 			if (colorOf(brother) == RED)    //情况1
 			{
 				setColor(brother, BLACK);
-				setColor(parentOf(node), RED);
-				LeftRotate(parentOf(node));
-				brother = rightOf(parentOf(node));
+				setColor(parent, RED);
+				LeftRotate(parent, this->root);
+				brother = parent->right;
 			}
 
-			if (colorOf(leftOf(brother)) == BLACK && colorOf(rightOf(brother)) == BLACK)    //情况2
+			if (colorOf(brother->left) == BLACK && colorOf(brother->right) == BLACK)    //情况2
 			{
 				setColor(brother, RED);
-				node = parentOf(node);
+				node = parent;
+				parent = node->parent();
 			}
 			else
 			{
-				if (colorOf(rightOf(brother)) == BLACK)        //情况3
+				if (colorOf(brother->right) == BLACK)        //情况3
 				{
 					setColor(brother, RED);
-					setColor(leftOf(brother), BLACK);
-					RightRotate(brother);
-					brother = rightOf(parentOf(node));
+					setColor(brother->left, BLACK);
+					RightRotate(brother, this->root);
+					brother = parent->right;
 				}
 				//情况4
-				setColor(brother, colorOf(parentOf(node)));
-				setColor(parentOf(node), BLACK);
-				setColor(rightOf(brother), BLACK);
-				LeftRotate(parentOf(node));
-				node = this.root;    //结束循环
+				setColor(brother, colorOf(parent));
+				setColor(parent, BLACK);
+				setColor(brother->right, BLACK);
+				LeftRotate(parent, this->root);
+				node = this->root;    //结束循环
 			}
 		}
 		else
 		{
 			//node在右子树
-			RBTNode<K, V> brother = leftOf(parentOf(node));		//brother节点为node节点的兄弟节点
+			RBTNode<K, V, Augment>* brother = parent->left;		//brother节点为node节点的兄弟节点
 			if (colorOf(brother) == RED)    //情况1
 			{
 				setColor(brother, BLACK);
-				setColor(parentOf(node), RED);
-				RightRotate(parentOf(node));
-				brother = rightOf(parentOf(node));
+				setColor(parent, RED);
+				RightRotate(parent, this->root);
+				brother = parent->left;
 			}
-			if (colorOf(leftOf(brother)) == BLACK && colorOf(rightOf(brother)) == BLACK)        //情况2
+			if (colorOf(brother->left) == BLACK && colorOf(brother->right) == BLACK)        //情况2
 			{
 				setColor(brother, RED);
-				node = parentOf(node);
+				node = parent;
+				parent = node->parent();
 			}
 			else
 			{
-				if (colorOf(leftOf(brother)) == BLACK)    //情况3
+				if (colorOf(brother->left) == BLACK)    //情况3
 				{
 					setColor(brother, RED);
-					setColor(rightOf(brother), BLACK);
-					LeftRotate(brother);
-					brother = leftOf(parentOf(node));
+					setColor(brother->right, BLACK);
+					LeftRotate(brother, this->root);
+					brother = parent->left;
 				}
 				//情况4
-				setColor(brother, colorOf(parentOf(node)));
-				setColor(parentOf(node), BLACK);
-				setColor(leftOf(brother), BLACK);
-				RightRotate(parentOf(node));
+				setColor(brother, colorOf(parent));
+				setColor(parent, BLACK);
+				setColor(brother->left, BLACK);
+				RightRotate(parent, this->root);
 				node = this->root;    //结束循环
 			}
 		}
 	}
-	node->color = BLACK;
+	setColor(node, BLACK);
 }
 
-//删除辅助函数
-template<class K, class V>
-void RBT<K, V>::DeleteNode(RBTNode<K, V>* node)
+//用v(可以为nullptr)顶替u在父节点中的位置
+template<class K, class V, class Compare, class Alloc, class Augment>
+inline void RBT<K, V, Compare, Alloc, Augment>::Transplant(RBTNode<K, V, Augment>* u, RBTNode<K, V, Augment>* v)
 {
-	if (node->left != nullptr && node->right != nullptr)
-	{
-		//node有双子树
-		//找到后继节点
-		RBTNode<K, V>* nextNode = this->FindMinNode(node->right);
-		node->val = nextNode->val;		//将node节点的值改为其后继节点的值,则后续只需删除后继节点
-		node = nextNode;				//node指针现在指向原node节点的后继节点,然后准备平衡
-	}
-
-	//观察node节点是否有左右子树(此时的node节点的孩子一定不为双子树),node节点也可能是叶子节点
-	RBTNode<K, V>* replacement = node->left != nullptr ? node->left : node->right;
+	RBTNode<K, V, Augment>* parent = u->parent();
+	if (parent == nullptr)
+		this->root = v;
+	else if (u == parent->left)
+		parent->left = v;			//u原来是其父节点的左儿子
+	else
+		parent->right = v;			//u原来是其父节点的右儿子
+	if (v != nullptr)
+		v->setParent(parent);
+}
 
-	if (replacement != nullptr)
+//删除辅助函数
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::DeleteNode(RBTNode<K, V, Augment>* node)
+{
+	RBTNode<K, V, Augment>* replacement;	//接替实际被摘下位置的节点(可能为nullptr)
+	RBTNode<K, V, Augment>* parent;			//replacement的父节点
+	int color = node->color();				//实际被摘下的位置原来的颜色
+	if (node->left == nullptr)
 	{
-		// Link replacement to parent
-		replacement->parent = node->parent;
-		//node->parent要找到replacement做其儿子(将replacement代替掉node)
-		if (node->parent == nullptr)
-			this->root = replacement;
-		else if (node == node->parent->left)
-			node->parent->left = replacement;		//node节点原来是其父节点的左儿子
-		else
-			node->parent->right = replacement;		//node节点原来是其父节点的右儿子
-
-		// 如果删除的是个黑色节点,则需要调整平衡,否则直接删除即可
-		if (node->color == BLACK)
-			DeleteFixUp(replacement);
+		//node只有右子树或者是叶子节点,直接用右子树代替它
+		replacement = node->right;
+		parent = node->parent();
+		Transplant(node, replacement);
 	}
-	else if (node->parent == nullptr)
+	else if (node->right == nullptr)
 	{
-		//如果要删除的节点node为叶子节点,则删除掉node节点后一定为root空
-		this->root = nullptr;
+		//node只有左子树
+		replacement = node->left;
+		parent = node->parent();
+		Transplant(node, replacement);
 	}
 	else
 	{
-		//如果要删除的node节点为叶子节点(如果是红色节点,直接删除即可,但黑色节点需要旋转调整)
-		if (node->color == BLACK)
-			DeleteFixUp(node);//以node节点为支点调整红黑树平衡
-		//调整后的node节点的父节点不为nullptr(或者一开始node->color = RED,一定要避免野指针)
-		if (node->parent != nullptr)
+		//node有双子树:找到后继节点,让它连同颜色一起顶替node的位置,实际被摘下的是后继节点原来的位置
+		//(重新链接而不是拷贝键值,其他节点的指针和迭代器仍然有效)
+		RBTNode<K, V, Augment>* nextNode = this->FindMinNode(node->right);
+		color = nextNode->color();
+		replacement = nextNode->right;
+		if (nextNode->parent() == node)
+		{
+			parent = nextNode;
+		}
+		else
 		{
-			//指针清空(避免野指针)
-			if (node == node->parent->left)
-				node->parent->left = nullptr;
-			else if (node == node->parent->right)
-				node->parent->right = nullptr;
-			node->parent = nullptr;
+			//后继节点没有左子树,它的右子树接到它原来的位置
+			parent = nextNode->parent();
+			Transplant(nextNode, replacement);
+			nextNode->right = node->right;
+			nextNode->right->setParent(nextNode);
 		}
+		Transplant(node, nextNode);
+		nextNode->left = node->left;
+		nextNode->left->setParent(nextNode);
+		nextNode->setColor(node->color());
 	}
-	delete node;
+	//node已经摘下,更新从parent到根的附加信息
+	UpdatePath(parent);
+	// 如果摘下的是个黑色位置,则需要调整平衡,否则直接删除即可
+	if (color == BLACK)
+		DeleteFixUp(replacement, parent);
+	DestroyNode(node);
 }
 
 //前序遍历的辅助函数(RBTNode* 可更改node的值)
-template<class K, class V>
-void RBT<K, V>::preOrderHelp(RBTNode<K, V>* node, void(*function)(RBTNode<K, V>* node))
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Function>
+void RBT<K, V, Compare, Alloc, Augment>::preOrderHelp(RBTNode<K, V, Augment>* node, Function& function)
 {
 	if (node == nullptr) { return; }
 	function(node);
@@ -487,8 +959,9 @@ void RBT<K, V>::preOrderHelp(RBTNode<K, V>* node, void(*function)(RBTNode<K, V>*
 }
 
 //中序遍历的辅助函数(RBTNode* 可更改node的值)
-template<class K, class V>
-void RBT<K, V>::inOrderHelp(RBTNode<K, V>* node, void(*function)(RBTNode<K, V>* node))
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Function>
+void RBT<K, V, Compare, Alloc, Augment>::inOrderHelp(RBTNode<K, V, Augment>* node, Function& function)
 {
 	if (node == nullptr) { return; }
 	inOrderHelp(node->left, function);
@@ -497,8 +970,9 @@ void RBT<K, V>::inOrderHelp(RBTNode<K, V>* node, void(*function)(RBTNode<K, V>*
 }
 
 //后序遍历的辅助函数(RBTNode* 可更改node的值)
-template<class K, class V>
-void RBT<K, V>::backOrderHelp(RBTNode<K, V>* node, void(*function)(RBTNode<K, V>* node))
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Function>
+void RBT<K, V, Compare, Alloc, Augment>::backOrderHelp(RBTNode<K, V, Augment>* node, Function& function)
 {
 	if (node == nullptr) { return; }
 	backOrderHelp(node->left, function);
@@ -506,124 +980,1018 @@ void RBT<K, V>::backOrderHelp(RBTNode<K, V>* node, void(*function)(RBTNode<K, V>
 	function(node);
 }
 
-//插入节点的函数
-template<class K, class V>
-void RBT<K, V>::Insert(const K& key, const V& val)
+//一次下降找到key的节点或插入位置
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::FindSlot(const K& key, RBTNode<K, V, Augment>*& parent, bool& isLeft)const
 {
-	//新节点的color为RED(0)
-	RBTNode<K, V>* node = new RBTNode<K, V>(key, val);
-	//插入后可能破坏红黑树颜色平衡
-	if (this->root == nullptr)
-	{
-		node->color = BLACK;
-		this->root = node;
-	}
-	else
+	parent = nullptr;
+	isLeft = false;
+	RBTNode<K, V, Augment>* curNode = this->root;
+	while (curNode != nullptr)
 	{
-		RBTNode<K, V>* parent = nullptr;	//node可能的父节点
-		RBTNode<K, V>* curNode = this->root;
-		while (curNode != nullptr)
+		//每一层只做一次三路比较
+		int cmp = KeyCompare3(comp, key, curNode->key);
+		if (cmp < 0)
 		{
+			//左走
 			parent = curNode;
-			//查找node可插入位置
-			if (curNode->key > node->key)
-			{
-				//左走
-				curNode = curNode->left;
-			}
-			else if (curNode->key < node->key)
-			{
-				//右走
-				curNode = curNode->right;
-			}
-			else
-			{
-				//节点值相同
-				curNode->val = val;
-				return;
-			}
+			isLeft = true;
+			curNode = curNode->left;
 		}
-		//设置父节点(退出时curNode为空,但parent一定不为空)
-		node->parent = parent;
-		//将父节点的左右孩子设置为node
-		if (parent->key > node->key)
+		else if (cmp > 0)
 		{
-			parent->left = node;
+			//右走
+			parent = curNode;
+			isLeft = false;
+			curNode = curNode->right;
 		}
 		else
 		{
-			parent->right = node;
+			//节点值相同
+			return curNode;
 		}
-		//调整平衡
-		InsertFixUp(node);
 	}
+	return nullptr;
+}
+
+//把新节点挂到FindSlot找到的位置上
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::LinkNode(RBTNode<K, V, Augment>* node, RBTNode<K, V, Augment>* parent, bool isLeft)
+{
+	//新节点的color为RED(0)
+	node->setParent(parent);
+	if (parent == nullptr)
+	{
+		this->root = node;
+	}
+	else if (isLeft)
+	{
+		parent->left = node;
+	}
+	else
+	{
+		parent->right = node;
+	}
+	//先更新新节点所有祖先的附加信息,之后InsertFixUp中的旋转只需要局部更新
+	UpdatePath(node);
+	//插入后可能破坏红黑树颜色平衡(根节点也在InsertFixUp中染黑)
+	InsertFixUp(node);
 	this->NodeSize++;
 }
 
+//用args原地构造节点,key已存在时不插入
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class... Args>
+std::pair<RBTNode<K, V, Augment>*, bool> RBT<K, V, Compare, Alloc, Augment>::emplace(Args&&... args)
+{
+	//不知道key之前只能先构造节点
+	RBTNode<K, V, Augment>* node = CreateNode(std::forward<Args>(args)...);
+	RBTNode<K, V, Augment>* parent;
+	bool isLeft;
+	RBTNode<K, V, Augment>* oldNode = FindSlot(node->key, parent, isLeft);
+	if (oldNode != nullptr)
+	{
+		DestroyNode(node);
+		return { oldNode, false };
+	}
+	LinkNode(node, parent, isLeft);
+	return { node, true };
+}
+
+//key不存在时才用args原地构造val
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class... Args>
+std::pair<RBTNode<K, V, Augment>*, bool> RBT<K, V, Compare, Alloc, Augment>::try_emplace(const K& key, Args&&... args)
+{
+	RBTNode<K, V, Augment>* parent;
+	bool isLeft;
+	RBTNode<K, V, Augment>* oldNode = FindSlot(key, parent, isLeft);
+	if (oldNode != nullptr) { return { oldNode, false }; }
+	//找到位置之后才申请节点
+	RBTNode<K, V, Augment>* node = CreateNode(key, std::forward<Args>(args)...);
+	LinkNode(node, parent, isLeft);
+	return { node, true };
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class... Args>
+std::pair<RBTNode<K, V, Augment>*, bool> RBT<K, V, Compare, Alloc, Augment>::try_emplace(K&& key, Args&&... args)
+{
+	RBTNode<K, V, Augment>* parent;
+	bool isLeft;
+	RBTNode<K, V, Augment>* oldNode = FindSlot(key, parent, isLeft);
+	if (oldNode != nullptr) { return { oldNode, false }; }
+	RBTNode<K, V, Augment>* node = CreateNode(std::move(key), std::forward<Args>(args)...);
+	LinkNode(node, parent, isLeft);
+	return { node, true };
+}
+
+//key不存在时插入,存在时把val赋给已有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class M>
+std::pair<RBTNode<K, V, Augment>*, bool> RBT<K, V, Compare, Alloc, Augment>::insert_or_assign(const K& key, M&& val)
+{
+	RBTNode<K, V, Augment>* parent;
+	bool isLeft;
+	RBTNode<K, V, Augment>* oldNode = FindSlot(key, parent, isLeft);
+	if (oldNode != nullptr)
+	{
+		oldNode->val = std::forward<M>(val);
+		UpdatePath(oldNode);
+		return { oldNode, false };
+	}
+	RBTNode<K, V, Augment>* node = CreateNode(key, std::forward<M>(val));
+	LinkNode(node, parent, isLeft);
+	return { node, true };
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class M>
+std::pair<RBTNode<K, V, Augment>*, bool> RBT<K, V, Compare, Alloc, Augment>::insert_or_assign(K&& key, M&& val)
+{
+	RBTNode<K, V, Augment>* parent;
+	bool isLeft;
+	RBTNode<K, V, Augment>* oldNode = FindSlot(key, parent, isLeft);
+	if (oldNode != nullptr)
+	{
+		oldNode->val = std::forward<M>(val);
+		UpdatePath(oldNode);
+		return { oldNode, false };
+	}
+	RBTNode<K, V, Augment>* node = CreateNode(std::move(key), std::forward<M>(val));
+	LinkNode(node, parent, isLeft);
+	return { node, true };
+}
+
 //删除节点的函数
-template<class K, class V>
-void RBT<K, V>::Delete(const K& key)
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::Delete(const K& key)
 {
 	//删除操作,参考BST标准删除操作,由于可能破坏RBT的平衡状态,因此需要重新平衡
 	//设要删除的节点为x,则找到其前驱或者后继节点p,p一定为叶子节点或者只有一颗子树
 	//替换x的值,则真正删除的节点为p,若p为红色节点,则可直接删除,若p为黑色节点,则不可直接删除,否则会导致黑色失衡
-	RBTNode<K, V>* delNode = this->GetNode(key);
+	RBTNode<K, V, Augment>* delNode = this->GetNode(key);
 	if (delNode != nullptr) { DeleteNode(delNode); this->NodeSize--; }
 }
 
-//判断RBT中是否存在键值为key的节点
-template<class K, class V>
-bool RBT<K, V>::Search(const K& key)const
+//查找key对应的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class KT>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::FindNode(const KT& key)const
 {
-	return GetNode(key) != nullptr;
+	RBTNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
+	{
+		int cmp = KeyCompare3(comp, key, tempNode->key);
+		if (cmp < 0)
+		{
+			//走左边
+			tempNode = tempNode->left;
+		}
+		else if (cmp > 0)
+		{
+			tempNode = tempNode->right;
+		}
+		else
+		{
+			break;
+		}
+	}
+	return tempNode;
 }
 
-//得到指定key值节点
-template<class K, class V>
-RBTNode<K, V>* RBT<K, V>::GetNode(const K& key)const
+//第一个key>=key的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::LowerBoundNode(const K& key)const
 {
-	RBTNode<K, V>* tempNode = this->root;
-	while (tempNode != nullptr && tempNode->key != key)
+	RBTNode<K, V, Augment>* result = nullptr;
+	RBTNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
 	{
-		if (tempNode->key > key)
+		int cmp = KeyCompare3(comp, tempNode->key, key);
+		if (cmp >= 0)
 		{
-			//走左边
+			//tempNode满足条件,继续在左子树中找更小的
+			result = tempNode;
+			if (cmp == 0) { break; }
 			tempNode = tempNode->left;
 		}
-		else if (tempNode->key < key)
+		else
 		{
 			tempNode = tempNode->right;
 		}
 	}
+	return result;
+}
+
+//第一个key>key的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::UpperBoundNode(const K& key)const
+{
+	RBTNode<K, V, Augment>* result = nullptr;
+	RBTNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
+	{
+		if (comp(key, tempNode->key))
+		{
+			result = tempNode;
+			tempNode = tempNode->left;
+		}
+		else
+		{
+			tempNode = tempNode->right;
+		}
+	}
+	return result;
+}
+
+//最后一个key<=key的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::FloorNode(const K& key)const
+{
+	RBTNode<K, V, Augment>* result = nullptr;
+	RBTNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
+	{
+		int cmp = KeyCompare3(comp, tempNode->key, key);
+		if (cmp <= 0)
+		{
+			//tempNode满足条件,继续在右子树中找更大的
+			result = tempNode;
+			if (cmp == 0) { break; }
+			tempNode = tempNode->right;
+		}
+		else
+		{
+			tempNode = tempNode->left;
+		}
+	}
+	return result;
+}
+
+//最后一个key<key的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::PredecessorNode(const K& key)const
+{
+	RBTNode<K, V, Augment>* result = nullptr;
+	RBTNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
+	{
+		if (comp(tempNode->key, key))
+		{
+			result = tempNode;
+			tempNode = tempNode->right;
+		}
+		else
+		{
+			tempNode = tempNode->left;
+		}
+	}
+	return result;
+}
+
+//按key从小到大访问[lo, hi)中的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Visitor>
+void RBT<K, V, Compare, Alloc, Augment>::range(const K& lo, const K& hi, Visitor&& visitor)
+{
+	//先下降到第一个>=lo的节点,之后沿后继移动直到key>=hi
+	for (RBTNode<K, V, Augment>* node = LowerBoundNode(lo); node != nullptr && comp(node->key, hi); node = NextNode(node))
+	{
+		visitor(node);
+	}
+}
+
+//按key从小到大只读访问[lo, hi)中的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Visitor>
+void RBT<K, V, Compare, Alloc, Augment>::range(const K& lo, const K& hi, Visitor&& visitor)const
+{
+	for (RBTNode<K, V, Augment>* node = LowerBoundNode(lo); node != nullptr && comp(node->key, hi); node = NextNode(node))
+	{
+		visitor(static_cast<const RBTNode<K, V, Augment>*>(node));
+	}
+}
+
+//key小于key的节点数
+template<class K, class V, class Compare, class Alloc, class Augment>
+size_t RBT<K, V, Compare, Alloc, Augment>::rank(const K& key)const
+{
+	static_assert(std::is_same<Augment, OrderStatistic>::value, "RBT::rank requires Augment = OrderStatistic");
+	size_t result = 0;
+	RBTNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
+	{
+		if (comp(tempNode->key, key))
+		{
+			//tempNode和它的左子树都小于key
+			result += SizeOf(tempNode->left) + 1;
+			tempNode = tempNode->right;
+		}
+		else
+		{
+			tempNode = tempNode->left;
+		}
+	}
+	return result;
+}
+
+//第i小(从0开始)的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::SelectNode(size_t i)const
+{
+	static_assert(std::is_same<Augment, OrderStatistic>::value, "RBT::select requires Augment = OrderStatistic");
+	RBTNode<K, V, Augment>* tempNode = this->root;
+	while (tempNode != nullptr)
+	{
+		size_t leftSize = SizeOf(tempNode->left);
+		if (i < leftSize)
+		{
+			tempNode = tempNode->left;
+		}
+		else if (i == leftSize)
+		{
+			break;
+		}
+		else
+		{
+			//跳过左子树和tempNode,在右子树中找第i - leftSize - 1小的节点
+			i -= leftSize + 1;
+			tempNode = tempNode->right;
+		}
+	}
 	return tempNode;
 }
 
-//返回RBT中最小值的节点
-template<class K, class V>
-inline RBTNode<K, V>* RBT<K, V>::GetMinNode()const
+//子树node中key<hi的节点的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename Augment::value_type RBT<K, V, Compare, Alloc, Augment>::ReducePrefix(RBTNode<K, V, Augment>* node, const K& hi)const
+{
+	//从左到右累积:node<hi时node和它的左子树都在范围内,继续看右子树
+	typename Augment::value_type result = Augment::identity();
+	while (node != nullptr)
+	{
+		if (comp(node->key, hi))
+		{
+			result = Augment::combine(result, AugmentOps<Augment>::Of(node->left));
+			result = Augment::combine(result, Augment::lift(node->key, node->val));
+			node = node->right;
+		}
+		else
+		{
+			node = node->left;
+		}
+	}
+	return result;
+}
+
+//子树node中key>=lo的节点的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename Augment::value_type RBT<K, V, Compare, Alloc, Augment>::ReduceSuffix(RBTNode<K, V, Augment>* node, const K& lo)const
+{
+	//从右到左累积:node>=lo时node和它的右子树都在范围内,继续看左子树
+	typename Augment::value_type result = Augment::identity();
+	while (node != nullptr)
+	{
+		if (!comp(node->key, lo))
+		{
+			result = Augment::combine(AugmentOps<Augment>::Of(node->right), result);
+			result = Augment::combine(Augment::lift(node->key, node->val), result);
+			node = node->left;
+		}
+		else
+		{
+			node = node->right;
+		}
+	}
+	return result;
+}
+
+//key在[lo, hi)中的节点的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename Augment::value_type RBT<K, V, Compare, Alloc, Augment>::reduce(const K& lo, const K& hi)const
+{
+	static_assert(!std::is_same<Augment, NoAugment>::value, "RBT::reduce requires an aggregate Augment");
+	//先下降到第一个落在[lo, hi)中的节点(lo和hi的查找路径在这里分开)
+	RBTNode<K, V, Augment>* split = this->root;
+	while (split != nullptr)
+	{
+		if (comp(split->key, lo)) { split = split->right; }
+		else if (!comp(split->key, hi)) { split = split->left; }
+		else { break; }
+	}
+	if (split == nullptr) { return Augment::identity(); }
+	//左子树中>=lo的部分 + split + 右子树中<hi的部分
+	typename Augment::value_type result = ReduceSuffix(split->left, lo);
+	result = Augment::combine(result, Augment::lift(split->key, split->val));
+	return Augment::combine(result, ReducePrefix(split->right, hi));
+}
+
+//直接修改val之后重新计算key所在路径上的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::refresh(const K& key)
+{
+	UpdatePath(FindNode(key));
+}
+
+//清空后从key严格递增的[first, last)批量构造
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class ForwardIt>
+void RBT<K, V, Compare, Alloc, Augment>::build_from_sorted(ForwardIt first, ForwardIt last)
+{
+	Clear();
+	size_t n = size_t(std::distance(first, last));
+	this->root = BuildSorted(first, n, 0, RedLevel(n));
+	this->NodeSize = int(n);
+}
+
+//清空后从任意顺序的[first, last)批量构造
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class InputIt>
+void RBT<K, V, Compare, Alloc, Augment>::build(InputIt first, InputIt last)
+{
+	std::vector<std::pair<K, V>> items = SortedUniqueItems<K, V>(first, last, comp);
+	build_from_sorted(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+}
+
+//并行批量构造
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class RandomIt>
+void RBT<K, V, Compare, Alloc, Augment>::build_from_sorted(RandomIt first, RandomIt last, TaskPool& pool, size_t grain)
+{
+	Clear();
+	size_t n = size_t(last - first);
+	this->root = BuildSortedParallel(first, n, pool, grain);
+	this->NodeSize = int(n);
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class InputIt>
+void RBT<K, V, Compare, Alloc, Augment>::build(InputIt first, InputIt last, TaskPool& pool, size_t grain)
+{
+	std::vector<std::pair<K, V>> items = SortedUniqueItems<K, V>(first, last, comp);
+	build_from_sorted(std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()), pool, grain);
+}
+
+//并行批量构造:先申请好所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class RandomIt>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::BuildSortedParallel(RandomIt first, size_t n, TaskPool& pool, size_t grain)
+{
+	std::vector<RBTNode<K, V, Augment>*> slots(n);
+	size_t allocated = 0;
+	try
+	{
+		for (; allocated < n; allocated++) { slots[allocated] = NodeTraits::allocate(alloc, 1); }
+		return BuildInSlots(first, slots.data(), n, 0, RedLevel(n), pool, grain);
+	}
+	catch (...)
+	{
+		//构造失败的子树已经析构,这里只归还内存
+		for (size_t i = 0; i < allocated; i++) { NodeTraits::deallocate(alloc, slots[i], 1); }
+		throw;
+	}
+}
+
+//在slots中构造以first开始的n个元素组成的子树
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class RandomIt>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::BuildInSlots(RandomIt first, RBTNode<K, V, Augment>** slots, size_t n, int level, int redLevel, TaskPool& pool, size_t grain)
+{
+	if (n == 0) { return nullptr; }
+	size_t leftSize = (n - 1) / 2;
+	size_t rightSize = n - 1 - leftSize;
+	RBTNode<K, V, Augment>* left = nullptr;
+	RBTNode<K, V, Augment>* right = nullptr;
+	RBTNode<K, V, Augment>* node = slots[leftSize];
+	auto buildLeft = [&]() { left = BuildInSlots(first, slots, leftSize, level + 1, redLevel, pool, grain); };
+	auto buildRight = [&]() { right = BuildInSlots(first + ptrdiff_t(leftSize + 1), slots + leftSize + 1, rightSize, level + 1, redLevel, pool, grain); };
+	try
+	{
+		if (n >= grain) { pool.fork_join(buildLeft, buildRight); }
+		else
+		{
+			buildLeft();
+			buildRight();
+		}
+		auto&& item = first[ptrdiff_t(leftSize)];
+		NodeTraits::construct(alloc, node, std::forward<decltype(item)>(item).first, std::forward<decltype(item)>(item).second);
+	}
+	catch (...)
+	{
+		//只析构已经构造好的子树,内存由BuildSortedParallel统一归还
+		DestroyTree(left);
+		DestroyTree(right);
+		throw;
+	}
+	node->left = left;
+	node->right = right;
+	if (left != nullptr) { left->setParent(node); }
+	if (right != nullptr) { right->setParent(node); }
+	node->setColor(level == redLevel ? RED : BLACK);
+	Update(node);
+	return node;
+}
+
+//用it开始的n个元素建出完全平衡的子树
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class ForwardIt>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::BuildSorted(ForwardIt& it, size_t n, int level, int redLevel)
+{
+	if (n == 0) { return nullptr; }
+	//按中序消费元素:先建左子树,再建根,最后建右子树(左子树不比右子树大)
+	size_t leftSize = (n - 1) / 2;
+	RBTNode<K, V, Augment>* left = BuildSorted(it, leftSize, level + 1, redLevel);
+	RBTNode<K, V, Augment>* node;
+	try
+	{
+		auto&& item = *it;
+		node = CreateNode(std::forward<decltype(item)>(item).first, std::forward<decltype(item)>(item).second);
+	}
+	catch (...)
+	{
+		ClearTree(left);
+		throw;
+	}
+	++it;
+	node->left = left;
+	if (left != nullptr) { left->setParent(node); }
+	try
+	{
+		node->right = BuildSorted(it, n - 1 - leftSize, level + 1, redLevel);
+	}
+	catch (...)
+	{
+		ClearTree(node);
+		throw;
+	}
+	if (node->right != nullptr) { node->right->setParent(node); }
+	node->setColor(level == redLevel ? RED : BLACK);
+	Update(node);
+	return node;
+}
+
+//以node为根的子树的黑高
+template<class K, class V, class Compare, class Alloc, class Augment>
+int RBT<K, V, Compare, Alloc, Augment>::BlackHeight(RBTNode<K, V, Augment>* node)
+{
+	//所有路径的黑节点数相同,沿任意一条路径计数即可
+	int bh = 0;
+	for (; node != nullptr; node = node->left)
+	{
+		if (node->color() == BLACK) { bh++; }
+	}
+	return bh;
+}
+
+//以mid为分隔连接left和right
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::Join(RBTNode<K, V, Augment>* left, int leftBH, RBTNode<K, V, Augment>* mid, RBTNode<K, V, Augment>* right, int rightBH, int& bh)
+{
+	//mid作为一个新的红色节点
+	mid->left = nullptr;
+	mid->right = nullptr;
+	mid->parentColor = 0;
+	//两边的根先染黑(红色的根染黑后黑高加1),之后挂在mid下面的子树的根都是黑色
+	if (left != nullptr)
+	{
+		left->setParent(nullptr);
+		if (left->color() == RED) { left->setColor(BLACK); leftBH++; }
+	}
+	if (right != nullptr)
+	{
+		right->setParent(nullptr);
+		if (right->color() == RED) { right->setColor(BLACK); rightBH++; }
+	}
+	if (leftBH == rightBH)
+	{
+		//黑高相同:mid直接作为黑色的根
+		mid->left = left;
+		mid->right = right;
+		if (left != nullptr) { left->setParent(mid); }
+		if (right != nullptr) { right->setParent(mid); }
+		mid->setColor(BLACK);
+		Update(mid);
+		bh = leftBH + 1;
+		return mid;
+	}
+	//沿较高一侧的边缘向下,找到黑高和另一侧相同的黑色节点cur(可能为nil),用红色的mid代替它
+	RBTNode<K, V, Augment>* root;
+	RBTNode<K, V, Augment>* parent = nullptr;
+	RBTNode<K, V, Augment>* cur;
+	if (leftBH > rightBH)
+	{
+		root = left;
+		cur = left;
+		for (int h = leftBH; colorOf(cur) == RED || h != rightBH; cur = cur->right)
+		{
+			if (cur->color() == BLACK) { h--; }
+			parent = cur;
+		}
+		mid->left = cur;
+		mid->right = right;
+		parent->right = mid;
+		bh = leftBH;
+	}
+	else
+	{
+		root = right;
+		cur = right;
+		for (int h = rightBH; colorOf(cur) == RED || h != leftBH; cur = cur->left)
+		{
+			if (cur->color() == BLACK) { h--; }
+			parent = cur;
+		}
+		mid->left = left;
+		mid->right = cur;
+		parent->left = mid;
+		bh = rightBH;
+	}
+	mid->setParent(parent);
+	if (mid->left != nullptr) { mid->left->setParent(mid); }
+	if (mid->right != nullptr) { mid->right->setParent(mid); }
+	//此时只可能有mid和它父节点的双红,和插入一个新节点的情况相同(情景3.1递归到根时黑高加1)
+	UpdatePath(mid);
+	if (InsertFixUp(mid, root)) { bh++; }
+	return root;
+}
+
+//没有分隔节点的连接
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::Join2(RBTNode<K, V, Augment>* left, int leftBH, RBTNode<K, V, Augment>* right, int rightBH, int& bh)
+{
+	if (right == nullptr) { bh = leftBH; return left; }
+	if (left == nullptr) { bh = rightBH; return right; }
+	//从right中分出最小节点作为分隔
+	RBTNode<K, V, Augment>* minNode = FindMinNode(right);
+	RBTNode<K, V, Augment>* empty;
+	RBTNode<K, V, Augment>* mid;
+	int emptyBH;
+	Split(right, rightBH, minNode->key, empty, emptyBH, mid, right, rightBH);
+	return Join(left, leftBH, mid, right, rightBH, bh);
+}
+
+//把以node为根的子树按key分成三部分
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::Split(RBTNode<K, V, Augment>* node, int bh, const K& key, RBTNode<K, V, Augment>*& left, int& leftBH,
+	RBTNode<K, V, Augment>*& mid, RBTNode<K, V, Augment>*& right, int& rightBH)
+{
+	if (node == nullptr)
+	{
+		left = mid = right = nullptr;
+		leftBH = rightBH = 0;
+		return;
+	}
+	//子树的黑高(黑色的node本身不计入子树)
+	int childBH = bh - (node->color() == BLACK ? 1 : 0);
+	RBTNode<K, V, Augment>* nodeLeft = node->left;
+	RBTNode<K, V, Augment>* nodeRight = node->right;
+	int cmp = KeyCompare3(comp, key, node->key);
+	if (cmp < 0)
+	{
+		//key在左子树中:左子树分出的右半部分再和node、node的右子树连接起来
+		RBTNode<K, V, Augment>* leftRight;
+		int leftRightBH;
+		Split(nodeLeft, childBH, key, left, leftBH, mid, leftRight, leftRightBH);
+		right = Join(leftRight, leftRightBH, node, nodeRight, childBH, rightBH);
+	}
+	else if (cmp > 0)
+	{
+		RBTNode<K, V, Augment>* rightLeft;
+		int rightLeftBH;
+		Split(nodeRight, childBH, key, rightLeft, rightLeftBH, mid, right, rightBH);
+		left = Join(nodeLeft, childBH, node, rightLeft, rightLeftBH, leftBH);
+	}
+	else
+	{
+		//找到key:左右子树就是两边的结果
+		left = nodeLeft;
+		leftBH = childBH;
+		right = nodeRight;
+		rightBH = childBH;
+		if (left != nullptr) { left->setParent(nullptr); }
+		if (right != nullptr) { right->setParent(nullptr); }
+		mid = node;
+		mid->left = nullptr;
+		mid->right = nullptr;
+		mid->setParent(nullptr);
+	}
+}
+
+//并集
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::Union(RBTNode<K, V, Augment>* t1, int bh1, RBTNode<K, V, Augment>* t2, int bh2, int& bh, DropList& dropped, TaskPool* pool, int grainBH)
 {
-	return FindMinNode(this->root);
+	if (t2 == nullptr) { bh = bh1; return t1; }
+	if (t1 == nullptr) { bh = bh2; return t2; }
+	//用t2的根把t1分开,两边分别求并,再以t2的根连接
+	int childBH = bh2 - (t2->color() == BLACK ? 1 : 0);
+	RBTNode<K, V, Augment>* t2Left = t2->left;
+	RBTNode<K, V, Augment>* t2Right = t2->right;
+	RBTNode<K, V, Augment>* left;
+	RBTNode<K, V, Augment>* mid;
+	RBTNode<K, V, Augment>* right;
+	int leftBH, rightBH;
+	Split(t1, bh1, t2->key, left, leftBH, mid, right, rightBH);
+	//key相同时保留t2的节点
+	if (mid != nullptr) { dropped.Push(mid); }
+	if (pool != nullptr && max(bh1, bh2) >= grainBH)
+	{
+		//两边的子树互不相交,可以同时计算(右边使用自己的丢弃链表)
+		DropList rightDropped;
+		pool->fork_join(
+			[&]() { left = Union(left, leftBH, t2Left, childBH, leftBH, dropped, pool, grainBH); },
+			[&]() { right = Union(right, rightBH, t2Right, childBH, rightBH, rightDropped, pool, grainBH); });
+		dropped.Append(rightDropped);
+	}
+	else
+	{
+		left = Union(left, leftBH, t2Left, childBH, leftBH, dropped, pool, grainBH);
+		right = Union(right, rightBH, t2Right, childBH, rightBH, dropped, pool, grainBH);
+	}
+	return Join(left, leftBH, t2, right, rightBH, bh);
 }
 
-//返回RBT中最大值的节点
-template<class K, class V>
-inline RBTNode<K, V>* RBT<K, V>::GetMaxNode()const
+//交集
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::Intersect(RBTNode<K, V, Augment>* t1, int bh1, const RBTNode<K, V, Augment>* t2, int& bh, DropList& dropped, TaskPool* pool, int grainBH)
 {
-	return FindMaxNode(this->root);
+	if (t1 == nullptr) { bh = 0; return nullptr; }
+	if (t2 == nullptr)
+	{
+		DropTree(t1, dropped);
+		bh = 0;
+		return nullptr;
+	}
+	RBTNode<K, V, Augment>* left;
+	RBTNode<K, V, Augment>* mid;
+	RBTNode<K, V, Augment>* right;
+	int leftBH, rightBH;
+	Split(t1, bh1, t2->key, left, leftBH, mid, right, rightBH);
+	if (pool != nullptr && bh1 >= grainBH)
+	{
+		DropList rightDropped;
+		pool->fork_join(
+			[&]() { left = Intersect(left, leftBH, t2->left, leftBH, dropped, pool, grainBH); },
+			[&]() { right = Intersect(right, rightBH, t2->right, rightBH, rightDropped, pool, grainBH); });
+		dropped.Append(rightDropped);
+	}
+	else
+	{
+		left = Intersect(left, leftBH, t2->left, leftBH, dropped, pool, grainBH);
+		right = Intersect(right, rightBH, t2->right, rightBH, dropped, pool, grainBH);
+	}
+	//t2的key在t1中时保留t1的节点
+	if (mid != nullptr) { return Join(left, leftBH, mid, right, rightBH, bh); }
+	return Join2(left, leftBH, right, rightBH, bh);
 }
 
-//重载[]操作符
-template<class K, class V>
-V& RBT<K, V>::operator[](const K& key)
+//差集
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::Difference(RBTNode<K, V, Augment>* t1, int bh1, const RBTNode<K, V, Augment>* t2, int& bh, DropList& dropped, TaskPool* pool, int grainBH)
 {
-	RBTNode<K, V>* tempNode = GetNode(key);
-	if (tempNode == nullptr)
+	if (t1 == nullptr) { bh = 0; return nullptr; }
+	if (t2 == nullptr) { bh = bh1; return t1; }
+	RBTNode<K, V, Augment>* left;
+	RBTNode<K, V, Augment>* mid;
+	RBTNode<K, V, Augment>* right;
+	int leftBH, rightBH;
+	Split(t1, bh1, t2->key, left, leftBH, mid, right, rightBH);
+	if (mid != nullptr) { dropped.Push(mid); }
+	if (pool != nullptr && bh1 >= grainBH)
+	{
+		DropList rightDropped;
+		pool->fork_join(
+			[&]() { left = Difference(left, leftBH, t2->left, leftBH, dropped, pool, grainBH); },
+			[&]() { right = Difference(right, rightBH, t2->right, rightBH, rightDropped, pool, grainBH); });
+		dropped.Append(rightDropped);
+	}
+	else
 	{
-		V val{};			//C++ 11
-		Insert(key, val);
-		tempNode = GetNode(key);
+		left = Difference(left, leftBH, t2->left, leftBH, dropped, pool, grainBH);
+		right = Difference(right, rightBH, t2->right, rightBH, dropped, pool, grainBH);
 	}
-	return tempNode->val;
+	return Join2(left, leftBH, right, rightBH, bh);
+}
+
+//把以node为根的子树的所有节点加入list
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::DropTree(RBTNode<K, V, Augment>* node, DropList& list)
+{
+	if (node == nullptr) { return; }
+	//Push会改写right,先处理两个子树
+	DropTree(node->left, list);
+	DropTree(node->right, list);
+	list.Push(node);
+}
+
+//释放list中的所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+size_t RBT<K, V, Compare, Alloc, Augment>::FreeDropped(DropList& list)
+{
+	size_t count = list.count;
+	for (RBTNode<K, V, Augment>* node = list.head; node != nullptr;)
+	{
+		RBTNode<K, V, Augment>* next = node->right;
+		DestroyNode(node);
+		node = next;
+	}
+	list = DropList();
+	return count;
+}
+
+//子树的节点数(遍历)
+template<class K, class V, class Compare, class Alloc, class Augment>
+size_t RBT<K, V, Compare, Alloc, Augment>::TreeSize(RBTNode<K, V, Augment>* node, std::false_type)
+{
+	if (node == nullptr) { return 0; }
+	return TreeSize(node->left, std::false_type()) + TreeSize(node->right, std::false_type()) + 1;
+}
+
+//取走other的所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+RBTNode<K, V, Augment>* RBT<K, V, Compare, Alloc, Augment>::Adopt(RBT& other, int& bh, TaskPool* pool, size_t grain)
+{
+	RBTNode<K, V, Augment>* node;
+	if (alloc == other.alloc)
+	{
+		//分配器相等(例如共享同一个内存池):节点可以直接接管,由本树释放
+		node = other.root;
+		other.root = nullptr;
+		other.NodeSize = 0;
+		if (node != nullptr) { node->setColor(BLACK); }
+	}
+	else
+	{
+		//否则把键值移动到本树分配器的新节点中(按中序取出,直接批量构造)
+		std::vector<std::pair<K, V>> items;
+		items.reserve(size_t(other.NodeSize));
+		for (RBTNode<K, V, Augment>* cur = other.FindMinNode(other.root); cur != nullptr; cur = NextNode(cur))
+		{
+			items.emplace_back(std::move(cur->key), std::move(cur->val));
+		}
+		other.Clear();
+		auto it = std::make_move_iterator(items.begin());
+		if (pool != nullptr) { node = BuildSortedParallel(it, items.size(), *pool, grain); }
+		else { node = BuildSorted(it, items.size(), 0, RedLevel(items.size())); }
+	}
+	bh = BlackHeight(node);
+	return node;
+}
+
+//并入other的所有键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::UnionWith(RBT& other, TaskPool* pool, size_t grain)
+{
+	if (&other == this) { return; }
+	int otherSize = other.NodeSize;
+	int bh1 = BlackHeight(this->root);
+	int bh2;
+	RBTNode<K, V, Augment>* t1 = this->root;
+	RBTNode<K, V, Augment>* t2 = Adopt(other, bh2, pool, grain);
+	DropList dropped;
+	int bh;
+	//黑高为b的子树至少有2^b - 1个节点
+	RBTNode<K, V, Augment>* result = Union(t1, bh1, t2, bh2, bh, dropped, pool, BalancedHeight(grain));
+	this->root = result;
+	if (result != nullptr) { result->setParent(nullptr); result->setColor(BLACK); }
+	this->NodeSize += otherSize - int(FreeDropped(dropped));
+}
+
+//只保留同时在other中的key
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::IntersectWith(const RBT& other, TaskPool* pool, size_t grain)
+{
+	if (&other == this) { return; }
+	DropList dropped;
+	int bh;
+	RBTNode<K, V, Augment>* result = Intersect(this->root, BlackHeight(this->root), other.root, bh, dropped, pool, BalancedHeight(grain));
+	this->root = result;
+	if (result != nullptr) { result->setParent(nullptr); result->setColor(BLACK); }
+	this->NodeSize -= int(FreeDropped(dropped));
+}
+
+//删除同时在other中的key
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::DifferenceWith(const RBT& other, TaskPool* pool, size_t grain)
+{
+	if (&other == this) { Clear(); return; }
+	DropList dropped;
+	int bh;
+	RBTNode<K, V, Augment>* result = Difference(this->root, BlackHeight(this->root), other.root, bh, dropped, pool, BalancedHeight(grain));
+	this->root = result;
+	if (result != nullptr) { result->setParent(nullptr); result->setColor(BLACK); }
+	this->NodeSize -= int(FreeDropped(dropped));
+}
+
+//删除key在[lo, hi)中的所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::erase_range(const K& lo, const K& hi)
+{
+	if (!comp(lo, hi)) { return; }
+	//先在lo处分开,再把右半部分在hi处分开,中间的部分整体释放
+	RBTNode<K, V, Augment>* left;
+	RBTNode<K, V, Augment>* mid;
+	RBTNode<K, V, Augment>* right;
+	int leftBH, rightBH;
+	Split(this->root, BlackHeight(this->root), lo, left, leftBH, mid, right, rightBH);
+	DropList dropped;
+	if (mid != nullptr) { dropped.Push(mid); }
+	RBTNode<K, V, Augment>* middle;
+	int middleBH;
+	Split(right, rightBH, hi, middle, middleBH, mid, right, rightBH);
+	DropTree(middle, dropped);
+	int bh;
+	//key为hi的节点保留下来,正好作为连接两边的分隔
+	RBTNode<K, V, Augment>* result = mid != nullptr ? Join(left, leftBH, mid, right, rightBH, bh) : Join2(left, leftBH, right, rightBH, bh);
+	this->root = result;
+	if (result != nullptr) { result->setParent(nullptr); result->setColor(BLACK); }
+	this->NodeSize -= int(FreeDropped(dropped));
+}
+
+//删除pos指向的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename RBT<K, V, Compare, Alloc, Augment>::iterator RBT<K, V, Compare, Alloc, Augment>::erase(const_iterator pos)
+{
+	RBTNode<K, V, Augment>* next = NextNode(pos.node);
+	DeleteNode(pos.node);
+	this->NodeSize--;
+	return iterator(next, this);
+}
+
+//删除[first, last)中的节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename RBT<K, V, Compare, Alloc, Augment>::iterator RBT<K, V, Compare, Alloc, Augment>::erase(const_iterator first, const_iterator last)
+{
+	if (first == last) { return iterator(last.node, this); }
+	if (last.node != nullptr)
+	{
+		//last节点在第二次split中作为分隔保留下来,first节点在释放之前key一直有效
+		erase_range(first->key, last->key);
+		return iterator(last.node, this);
+	}
+	//一直删除到末尾:在first处分开,右边整体释放
+	RBTNode<K, V, Augment>* left;
+	RBTNode<K, V, Augment>* mid;
+	RBTNode<K, V, Augment>* right;
+	int leftBH, rightBH;
+	Split(this->root, BlackHeight(this->root), first->key, left, leftBH, mid, right, rightBH);
+	DropList dropped;
+	dropped.Push(mid);
+	DropTree(right, dropped);
+	this->root = left;
+	if (left != nullptr) { left->setParent(nullptr); left->setColor(BLACK); }
+	this->NodeSize -= int(FreeDropped(dropped));
+	return end();
+}
+
+//把key>=key的节点移到right中
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::split(const K& key, RBT& right)
+{
+	if (&right == this) { return; }
+	//right改为和本树共享分配器,移过去的节点之后由right释放
+	right.Clear();
+	right.alloc = alloc;
+	right.comp = comp;
+	RBTNode<K, V, Augment>* left;
+	RBTNode<K, V, Augment>* mid;
+	RBTNode<K, V, Augment>* rightPart;
+	int leftBH, rightBH;
+	Split(this->root, BlackHeight(this->root), key, left, leftBH, mid, rightPart, rightBH);
+	//key本身属于右半部分(作为最小节点连接进去)
+	if (mid != nullptr) { rightPart = Join(nullptr, 0, mid, rightPart, rightBH, rightBH); }
+	this->root = left;
+	if (left != nullptr) { left->setParent(nullptr); left->setColor(BLACK); }
+	right.root = rightPart;
+	if (rightPart != nullptr) { rightPart->setParent(nullptr); rightPart->setColor(BLACK); }
+	right.NodeSize = int(TreeSize(rightPart, std::is_same<Augment, OrderStatistic>()));
+	this->NodeSize -= right.NodeSize;
+}
+
+//把right的节点接到本树之后
+template<class K, class V, class Compare, class Alloc, class Augment>
+void RBT<K, V, Compare, Alloc, Augment>::join(RBT& right)
+{
+	if (&right == this) { return; }
+	int rightSize = right.NodeSize;
+	int rightBH;
+	RBTNode<K, V, Augment>* rightPart = Adopt(right, rightBH, nullptr, 0);
+	int bh;
+	RBTNode<K, V, Augment>* result = Join2(this->root, BlackHeight(this->root), rightPart, rightBH, bh);
+	this->root = result;
+	if (result != nullptr) { result->setParent(nullptr); result->setColor(BLACK); }
+	this->NodeSize += rightSize;
+}
+
+//冻结成只读的FrozenTree
+template<class K, class V, class Compare, class Alloc, class Augment>
+FrozenTree<K, V, Compare> RBT<K, V, Compare, Alloc, Augment>::freeze()const
+{
+	return FrozenTree<K, V, Compare>(size_t(this->NodeSize), [this](auto&& push)
+	{
+		for (const RBTNode<K, V, Augment>& node : *this) { push(node.key, node.val); }
+	}, comp);
 }
 
 #endif // RETREE_H
@@ -0,0 +1,424 @@
+﻿#pragma once
+#ifndef RCUMAP_H
+#define RCUMAP_H
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "NodeEntry.h"
+#include "NodePool.h"
+#include "PathCopyAVL.h"
+#include "ThreadSlot.h"
+
+//基于epoch的内存回收
+//每个线程有一个独占缓存行的槽,进入读临界区时只把当前的全局epoch写进自己的槽(没有加锁,也没有原子的读-改-写)
+//写者把替换下来的节点标记上当时的epoch后推进全局epoch,等所有活跃读者的epoch都大于这个标记时才释放这些节点
+class EpochManager
+{
+private:
+	static const size_t CacheLine = 64;
+	//一个线程的槽
+	struct alignas(CacheLine) Slot
+	{
+		std::atomic<uint64_t> epoch{ 0 };	//进入读临界区时的epoch,0表示不在读临界区中
+		size_t depth = 0;					//读临界区的嵌套层数(只由所属线程访问)
+	};
+	Slot slots[ThreadSlot::MaxThreads];
+	std::atomic<uint64_t> globalEpoch{ 1 };	//只由写者修改
+public:
+	//线程index进入读临界区(可以嵌套)
+	void Enter(size_t index)
+	{
+		Slot& slot = slots[index];
+		if (slot.depth++ != 0) { return; }
+		slot.epoch.store(globalEpoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+		//登记必须在读取任何共享指针之前对写者可见
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+	//线程index离开读临界区
+	void Leave(size_t index)
+	{
+		Slot& slot = slots[index];
+		if (--slot.depth != 0) { return; }
+		slot.epoch.store(0, std::memory_order_release);
+	}
+	//写者:新版本发布之后调用,返回被替换节点的标记,并推进全局epoch
+	uint64_t Advance()
+	{
+		uint64_t epoch = globalEpoch.load(std::memory_order_relaxed);
+		globalEpoch.store(epoch + 1, std::memory_order_release);
+		return epoch;
+	}
+	//写者:标记小于返回值的节点已经没有读者能访问到
+	uint64_t SafeBefore() const
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		uint64_t least = UINT64_MAX;
+		for (const Slot& slot : slots)
+		{
+			uint64_t epoch = slot.epoch.load(std::memory_order_acquire);
+			if (epoch != 0 && epoch < least) { least = epoch; }
+		}
+		return least;
+	}
+};
+
+//RCUMap的节点,发布之后就不再修改(修改时复制从根到目标的路径)
+template<class K, class V>
+struct RCUNode
+{
+	K key;					//键
+	V val;					//值
+	RCUNode<K, V>* left;	//左子节点
+	RCUNode<K, V>* right;	//右子节点
+	int height;				//子树高度
+	template<class KArg, class VArg>
+	RCUNode(KArg&& key, VArg&& val, RCUNode<K, V>* left, RCUNode<K, V>* right, int height)
+		: key(std::forward<KArg>(key)), val(std::forward<VArg>(val)), left(left), right(right), height(height) {}
+};
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
+//读者无锁的有序表:写者复制路径生成新版本的AVL树,再原子地发布新的根
+//读者只读取一次根指针,之后遍历的都是不会再变的节点,不加锁也没有原子的读-改-写,只在自己的槽中登记epoch
+//被替换下来的节点由EpochManager延迟到所有可能看到它的读者离开之后才释放
+//写者之间用互斥锁串行(节点的申请和释放都在写锁内,分配器不需要线程安全)
+//超过ThreadSlot::MaxThreads个线程同时存在时,多出来的线程退化为持有写锁读取
+//V需要可以拷贝(复制路径时拷贝)
+template<class K, class V, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, V>>>
+class RCUMap
+{
+	friend struct TreeTestAccess;
+private:
+	using Node = RCUNode<K, V>;
+	using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+	using NodeTraits = std::allocator_traits<NodeAlloc>;
+	//复制路径的插入、删除和旋转(新建和替换下来的节点记录在created和replaced中)
+	using Path = PathCopyAVL<K, Node, Compare, RCUMap>;
+	friend Path;
+	static const size_t CollectThreshold = 256;	//等待释放的节点达到这么多时才检查一次读者
+
+	std::atomic<Node*> root;				//当前版本的根
+	std::atomic<int> NodeSize;				//节点数
+	Compare comp;							//键的比较器
+	mutable std::recursive_mutex writeLock;	//写者之间互斥(也给没有槽的读者使用)
+	mutable EpochManager epochs;			//读者登记
+	NodeAlloc alloc;						//节点分配器(只在写锁内使用)
+	std::vector<std::pair<uint64_t, Node*>> retired;	//等待释放的节点和它们被替换时的epoch
+	std::vector<Node*> created;				//当前写操作新建的节点(出现异常时释放)
+	std::vector<Node*> replaced;			//当前写操作替换下来的节点(发布成功后才交给retired)
+
+	//读临界区
+	class ReadGuard
+	{
+	private:
+		const RCUMap* map;
+		size_t index;
+	public:
+		explicit ReadGuard(const RCUMap* map) : map(map), index(ThreadSlot::Get())
+		{
+			if (index == ThreadSlot::None) { map->writeLock.lock(); }
+			else { map->epochs.Enter(index); }
+		}
+		~ReadGuard()
+		{
+			if (index == ThreadSlot::None) { map->writeLock.unlock(); }
+			else { map->epochs.Leave(index); }
+		}
+		ReadGuard(const ReadGuard&) = delete;
+		ReadGuard& operator=(const ReadGuard&) = delete;
+	};
+
+	static int HeightOf(const Node* node) { return Path::HeightOf(node); }
+	//保证vec还能再放入count个元素(按倍数扩容)
+	template<class T>
+	static void Reserve(std::vector<T>& vec, size_t count)
+	{
+		if (vec.capacity() - vec.size() < count) { vec.reserve(std::max(vec.size() + count, vec.capacity() * 2)); }
+	}
+	//新建节点
+	template<class KArg, class VArg>
+	Node* Make(KArg&& key, VArg&& val, Node* left, Node* right);
+	//已有的子树直接放进新版本
+	static Node* Share(Node* node) { return node; }
+	//node在发布之后交给retired
+	void Retire(Node* node) { replaced.push_back(node); }
+	//中间结果已经记录在created中,由Publish或Abandon处理
+	static void Release(Node*) {}
+	//把以node为根的子树全部加入replaced
+	void ReplaceTree(Node* node);
+	//发布新的根,把替换下来的节点交给retired,必要时回收
+	void Publish(Node* newRoot, int sizeDelta);
+	//当前写操作失败:释放新建的节点,旧版本保持不变
+	void Abandon();
+	//释放没有读者能访问到的节点(all为true时全部释放,只在析构时使用)
+	void Collect(bool all);
+	//析构节点并归还给分配器
+	void DestroyNode(Node* node);
+public:
+	//构造函数
+	RCUMap() : root(nullptr), NodeSize(0) {}
+	explicit RCUMap(const Compare& compare, const Alloc& allocator = Alloc()) : root(nullptr), NodeSize(0), comp(compare), alloc(allocator) {}
+	//析构函数(此时不能再有其他线程访问)
+	~RCUMap();
+	//防止拷贝构造
+	RCUMap(const RCUMap&) = delete;
+	RCUMap& operator=(const RCUMap&) = delete;
+
+	//修改(写者之间互斥,不阻塞读者)
+	//插入键值(key已存在时覆盖val)
+	void Insert(const K& key, const V& val) { insert_or_assign(key, val); }
+	//key不存在时插入,存在时覆盖val,返回是否插入了新节点
+	template<class M>
+	bool insert_or_assign(const K& key, M&& val);
+	//key不存在时才插入,返回是否插入
+	template<class M>
+	bool try_insert(const K& key, M&& val);
+	//删除key,返回是否删除
+	bool Delete(const K& key);
+	//清空
+	void Clear();
+
+	//查询(无锁,只在自己的槽中登记epoch)
+	//判断key是否存在
+	bool Search(const K& key) const;
+	//key对应的val的拷贝(不存在时返回空)
+	std::optional<V> Get(const K& key) const;
+	//节点数
+	int getNodeSize() const { return NodeSize.load(std::memory_order_relaxed); }
+	//最后一个key<=key的键值
+	std::optional<std::pair<K, V>> floor(const K& key) const;
+	//第一个key>=key的键值
+	std::optional<std::pair<K, V>> ceiling(const K& key) const;
+	//按key从小到大对[lo, hi)中的每个键值调用visitor(const K&, const V&)
+	//整个扫描都在同一个版本上进行,扫描期间的修改不可见
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor) const;
+	//拷贝出[lo, hi)中的所有键值
+	std::vector<std::pair<K, V>> range_copy(const K& lo, const K& hi) const;
+};
+
+//析构函数
+template<class K, class V, class Compare, class Alloc>
+RCUMap<K, V, Compare, Alloc>::~RCUMap()
+{
+	ReplaceTree(root.load(std::memory_order_relaxed));
+	for (Node* node : replaced) { DestroyNode(node); }
+	Collect(true);
+}
+
+//新建节点
+template<class K, class V, class Compare, class Alloc>
+template<class KArg, class VArg>
+RCUNode<K, V>* RCUMap<K, V, Compare, Alloc>::Make(KArg&& key, VArg&& val, Node* left, Node* right)
+{
+	//先保证created有空间,push_back就不会再抛出异常
+	Reserve(created, 1);
+	Node* node = NodeTraits::allocate(alloc, 1);
+	try
+	{
+		NodeTraits::construct(alloc, node, std::forward<KArg>(key), std::forward<VArg>(val), left, right, std::max(HeightOf(left), HeightOf(right)) + 1);
+	}
+	catch (...)
+	{
+		NodeTraits::deallocate(alloc, node, 1);
+		throw;
+	}
+	created.push_back(node);
+	return node;
+}
+
+//把以node为根的子树全部加入replaced
+template<class K, class V, class Compare, class Alloc>
+void RCUMap<K, V, Compare, Alloc>::ReplaceTree(Node* node)
+{
+	if (node == nullptr) { return; }
+	ReplaceTree(node->left);
+	ReplaceTree(node->right);
+	replaced.push_back(node);
+}
+
+//发布新的根
+template<class K, class V, class Compare, class Alloc>
+void RCUMap<K, V, Compare, Alloc>::Publish(Node* newRoot, int sizeDelta)
+{
+	//先保证retired有空间,发布之后的步骤都不会抛出异常
+	Reserve(retired, replaced.size());
+	//release:新节点的内容对读到新根的读者可见
+	root.store(newRoot, std::memory_order_release);
+	NodeSize.store(NodeSize.load(std::memory_order_relaxed) + sizeDelta, std::memory_order_relaxed);
+	uint64_t epoch = epochs.Advance();
+	for (Node* node : replaced) { retired.emplace_back(epoch, node); }
+	replaced.clear();
+	created.clear();
+	if (retired.size() >= CollectThreshold) { Collect(false); }
+}
+
+//当前写操作失败
+template<class K, class V, class Compare, class Alloc>
+void RCUMap<K, V, Compare, Alloc>::Abandon()
+{
+	for (Node* node : created) { DestroyNode(node); }
+	created.clear();
+	replaced.clear();
+}
+
+//释放没有读者能访问到的节点
+template<class K, class V, class Compare, class Alloc>
+void RCUMap<K, V, Compare, Alloc>::Collect(bool all)
+{
+	//retired中的epoch是非递减的,只需要释放前面一段
+	uint64_t safe = all ? UINT64_MAX : epochs.SafeBefore();
+	size_t count = 0;
+	while (count < retired.size() && retired[count].first < safe)
+	{
+		DestroyNode(retired[count].second);
+		count++;
+	}
+	retired.erase(retired.begin(), retired.begin() + count);
+}
+
+//析构节点并归还给分配器
+template<class K, class V, class Compare, class Alloc>
+inline void RCUMap<K, V, Compare, Alloc>::DestroyNode(Node* node)
+{
+	NodeTraits::destroy(alloc, node);
+	NodeTraits::deallocate(alloc, node, 1);
+}
+
+//key不存在时插入,存在时覆盖val
+template<class K, class V, class Compare, class Alloc>
+template<class M>
+bool RCUMap<K, V, Compare, Alloc>::insert_or_assign(const K& key, M&& val)
+{
+	std::lock_guard<std::recursive_mutex> guard(writeLock);
+	bool inserted = false;
+	try
+	{
+		Node* newRoot = Path::InsertPath(*this, comp, root.load(std::memory_order_relaxed), key, std::forward<M>(val), true, inserted);
+		Publish(newRoot, inserted ? 1 : 0);
+	}
+	catch (...)
+	{
+		Abandon();
+		throw;
+	}
+	return inserted;
+}
+
+//key不存在时才插入
+template<class K, class V, class Compare, class Alloc>
+template<class M>
+bool RCUMap<K, V, Compare, Alloc>::try_insert(const K& key, M&& val)
+{
+	std::lock_guard<std::recursive_mutex> guard(writeLock);
+	bool inserted = false;
+	try
+	{
+		Node* newRoot = Path::InsertPath(*this, comp, root.load(std::memory_order_relaxed), key, std::forward<M>(val), false, inserted);
+		if (inserted) { Publish(newRoot, 1); }
+	}
+	catch (...)
+	{
+		Abandon();
+		throw;
+	}
+	return inserted;
+}
+
+//删除key
+template<class K, class V, class Compare, class Alloc>
+bool RCUMap<K, V, Compare, Alloc>::Delete(const K& key)
+{
+	std::lock_guard<std::recursive_mutex> guard(writeLock);
+	bool erased = false;
+	try
+	{
+		Node* newRoot = Path::DeletePath(*this, comp, root.load(std::memory_order_relaxed), key, erased);
+		if (erased) { Publish(newRoot, -1); }
+	}
+	catch (...)
+	{
+		Abandon();
+		throw;
+	}
+	return erased;
+}
+
+//清空
+template<class K, class V, class Compare, class Alloc>
+void RCUMap<K, V, Compare, Alloc>::Clear()
+{
+	std::lock_guard<std::recursive_mutex> guard(writeLock);
+	try
+	{
+		ReplaceTree(root.load(std::memory_order_relaxed));
+		Publish(nullptr, -NodeSize.load(std::memory_order_relaxed));
+	}
+	catch (...)
+	{
+		Abandon();
+		throw;
+	}
+}
+
+//判断key是否存在
+template<class K, class V, class Compare, class Alloc>
+bool RCUMap<K, V, Compare, Alloc>::Search(const K& key) const
+{
+	ReadGuard guard(this);
+	return Path::Find(root.load(std::memory_order_acquire), comp, key) != nullptr;
+}
+
+//key对应的val的拷贝
+template<class K, class V, class Compare, class Alloc>
+std::optional<V> RCUMap<K, V, Compare, Alloc>::Get(const K& key) const
+{
+	ReadGuard guard(this);
+	const Node* node = Path::Find(root.load(std::memory_order_acquire), comp, key);
+	if (node == nullptr) { return std::nullopt; }
+	return node->val;
+}
+
+//最后一个key<=key的键值
+template<class K, class V, class Compare, class Alloc>
+std::optional<std::pair<K, V>> RCUMap<K, V, Compare, Alloc>::floor(const K& key) const
+{
+	ReadGuard guard(this);
+	return CopyEntry<K, V>(Path::Floor(root.load(std::memory_order_acquire), comp, key));
+}
+
+//第一个key>=key的键值
+template<class K, class V, class Compare, class Alloc>
+std::optional<std::pair<K, V>> RCUMap<K, V, Compare, Alloc>::ceiling(const K& key) const
+{
+	ReadGuard guard(this);
+	return CopyEntry<K, V>(Path::Ceiling(root.load(std::memory_order_acquire), comp, key));
+}
+
+//按key从小到大访问[lo, hi)中的键值
+template<class K, class V, class Compare, class Alloc>
+template<class Visitor>
+void RCUMap<K, V, Compare, Alloc>::range(const K& lo, const K& hi, Visitor&& visitor) const
+{
+	ReadGuard guard(this);
+	auto entry = [&visitor](const Node* node) { visitor(node->key, node->val); };
+	Path::RangeHelp(root.load(std::memory_order_acquire), comp, lo, hi, entry);
+}
+
+//拷贝出[lo, hi)中的所有键值
+template<class K, class V, class Compare, class Alloc>
+std::vector<std::pair<K, V>> RCUMap<K, V, Compare, Alloc>::range_copy(const K& lo, const K& hi) const
+{
+	std::vector<std::pair<K, V>> result;
+	range(lo, hi, [&result](const K& key, const V& val) { result.emplace_back(key, val); });
+	return result;
+}
+
+#endif // !RCUMAP_H
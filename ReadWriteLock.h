@@ -0,0 +1,96 @@
+﻿#pragma once
+#ifndef READWRITELOCK_H
+#define READWRITELOCK_H
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+//写优先的读写锁,满足SharedMutex的要求(可以用于std::shared_lock和std::unique_lock)
+//读者计数分散在多个独占缓存行的槽中,每个线程固定使用一个槽,读线程之间不会争用同一个缓存行
+//(std::shared_mutex所有读者都修改同一个计数,核数多时读操作本身就成为瓶颈;glibc的实现还是读优先的,连续不断的读会让写者一直等待)
+//写者先置位writer,之后新来的读者都会让路,再等所有槽中的读者离开,因此写者不会被饿死
+//等待时只是让出时间片(适合读多写少、临界区很短的场景)
+class ReadWriteLock
+{
+private:
+	static const size_t SlotCount = 64;		//读者计数槽的数量
+	static const size_t CacheLine = 64;		//缓存行大小
+	//读者计数槽(每个槽独占一个缓存行)
+	struct alignas(CacheLine) Slot
+	{
+		std::atomic<size_t> readers{ 0 };
+	};
+	Slot slots[SlotCount];
+	std::atomic<bool> writer{ false };		//有写者持有或正在等待锁
+	std::mutex writeLock;					//写者之间互斥
+
+	//当前线程使用的槽(线程按创建顺序轮流分配)
+	static size_t MySlot()
+	{
+		static std::atomic<size_t> nextSlot{ 0 };
+		static thread_local size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % SlotCount;
+		return slot;
+	}
+public:
+	ReadWriteLock() = default;
+	ReadWriteLock(const ReadWriteLock&) = delete;
+	ReadWriteLock& operator=(const ReadWriteLock&) = delete;
+
+	//共享锁
+	//先登记再检查writer,写者先置位writer再检查读者,两边都是seq_cst,至少有一方能看到另一方
+	void lock_shared()
+	{
+		Slot& slot = slots[MySlot()];
+		for (;;)
+		{
+			slot.readers.fetch_add(1, std::memory_order_seq_cst);
+			if (!writer.load(std::memory_order_seq_cst)) { return; }
+			//有写者:撤销登记,等它结束后再试
+			slot.readers.fetch_sub(1, std::memory_order_release);
+			while (writer.load(std::memory_order_acquire)) { std::this_thread::yield(); }
+		}
+	}
+	bool try_lock_shared()
+	{
+		Slot& slot = slots[MySlot()];
+		slot.readers.fetch_add(1, std::memory_order_seq_cst);
+		if (!writer.load(std::memory_order_seq_cst)) { return true; }
+		slot.readers.fetch_sub(1, std::memory_order_release);
+		return false;
+	}
+	//必须由加锁的线程解锁(计数记在这个线程的槽中)
+	void unlock_shared() { slots[MySlot()].readers.fetch_sub(1, std::memory_order_release); }
+
+	//独占锁
+	void lock()
+	{
+		writeLock.lock();
+		writer.store(true, std::memory_order_seq_cst);
+		for (Slot& slot : slots)
+		{
+			while (slot.readers.load(std::memory_order_seq_cst) != 0) { std::this_thread::yield(); }
+		}
+	}
+	bool try_lock()
+	{
+		if (!writeLock.try_lock()) { return false; }
+		writer.store(true, std::memory_order_seq_cst);
+		for (Slot& slot : slots)
+		{
+			if (slot.readers.load(std::memory_order_seq_cst) != 0)
+			{
+				unlock();
+				return false;
+			}
+		}
+		return true;
+	}
+	void unlock()
+	{
+		writer.store(false, std::memory_order_release);
+		writeLock.unlock();
+	}
+};
+
+#endif // !READWRITELOCK_H
@@ -1,28 +1,551 @@
-﻿#ifndef SPLAYTREE_H
+﻿#pragma once
+#ifndef SPLAYTREE_H
 #define SPLAYTREE_H
-#include "BSTree.h"
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "KeyCompare.h"
+#include "NodePool.h"
 
-//伸展树
-template<class T>
-class SPLAY :virtual public BST<T>
+//伸展树的节点(没有平衡信息,节点只比键值多出两个指针)
+template<class K, class V>
+struct SPLAYNode
 {
+	K key;					//键
+	V val;					//值
+	SPLAYNode<K, V>* left;
+	SPLAYNode<K, V>* right;
+	SPLAYNode() = default;
+	//key由第一个参数构造,val由剩余参数原地构造(没有剩余参数时值初始化)
+	template<class KArg, class... VArgs>
+	SPLAYNode(KArg&& key, VArgs&&... val)
+		: key(std::forward<KArg>(key)), val(std::forward<VArgs>(val)...), left(nullptr), right(nullptr) {}
+};
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
+//伸展树:每次访问都把访问的节点旋转到根,单次操作均摊O(logn)
+//访问集中在少数key上(例如Zipf分布)时,热点key一直留在根附近,比红黑树/AVL的固定O(logn)下降更短
+//使用自顶向下伸展:下降的同时把路径拆成左右两棵树,最后和找到的节点重新组装,不需要parent指针、递归或栈
+//伸展树可能退化成一条链(例如按顺序插入后),所以遍历、清空和求高度都不使用递归
+//读操作(Search/GetNode)默认也会伸展,会修改树;set_splay_period/set_splay_depth可以减少读操作带来的结构调整(见下面)
+//Compare为键的比较器(默认为std::less<K>),Alloc为节点分配器(默认为NodePool内存池),会被rebind为SPLAYNode<K, V>的分配器
+template<class K, class V, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, V>>>
+class SPLAY
+{
+	friend struct TreeTestAccess;
 private:
-	// 旋转key对应的节点为根节点，并返回值为根节点。
-	TreeNode<T>* splayHelp(TreeNode<T>* node, T& key);
+	using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<SPLAYNode<K, V>>;
+	using NodeTraits = std::allocator_traits<NodeAlloc>;
+	SPLAYNode<K, V>* root;		//树的根节点
+	int NodeSize;				//树节点总数
+	NodeAlloc alloc;			//节点分配器
+	Compare comp;				//键的比较器
+	unsigned splayPeriod;		//读操作平均每splayPeriod次伸展一次(1为每次都伸展,0为从不伸展)
+	int splayDepth;				//读操作只在节点深度超过splayDepth时伸展
+	uint32_t seed;				//决定读操作是否伸展的随机数状态(xorshift)
+
+	//从分配器中申请并构造一个节点
+	template<class... Args>
+	SPLAYNode<K, V>* CreateNode(Args&&... args);
+	//析构节点并归还给分配器
+	void DestroyNode(SPLAYNode<K, V>* node);
+	//将树清空(逐个释放节点)
+	void ClearTree(SPLAYNode<K, V>* node);
+	//只析构以node为根的所有节点,不归还内存(内存随后由分配器整体释放)
+	void DestroyTree(SPLAYNode<K, V>* node);
+	//自顶向下伸展:把以node为根的子树中key所在的节点(不存在时为最后访问的节点)旋转到根,返回新的根
+	SPLAYNode<K, V>* Splay(SPLAYNode<K, V>* node, const K& key);
+	//不修改树的查找,depth返回节点的深度(根为0)
+	SPLAYNode<K, V>* FindNode(const K& key, int& depth)const;
+	//读操作的查找:按splayPeriod和splayDepth决定是否伸展
+	SPLAYNode<K, V>* Access(const K& key);
+	//这一次读操作是否伸展
+	bool ShouldSplay();
+	//插入的公共入口:key不存在时调用make()得到新节点作为根(返回key对应的节点和是否插入成功)
+	template<class Make>
+	std::pair<SPLAYNode<K, V>*, bool> InsertWith(const K& key, Make make);
+	//按中序访问所有节点(用显式的栈,不递归)
+	template<class Visitor>
+	void range_all(Visitor&& visitor)const;
 public:
 	//构造函数
-	SPLAY() {}
-	//BST会自行析构,~SPLAY()中不需要添加代码
-	~SPLAY() {}
+	SPLAY() : root(nullptr), NodeSize(0), splayPeriod(1), splayDepth(0), seed(2463534242u) {}
+	explicit SPLAY(const Compare& compare, const Alloc& allocator = Alloc())
+		: root(nullptr), NodeSize(0), alloc(allocator), comp(compare), splayPeriod(1), splayDepth(0), seed(2463534242u) {}
+	//析构函数
+	~SPLAY() { Clear(); }
+	//防止拷贝构造
+	SPLAY(const SPLAY& anotherTree) = delete;
+	SPLAY& operator=(const SPLAY& anotherTree) = delete;
 
-	// 旋转key对应的节点为根节点，并返回值为根节点。
-	void splay(T& key);
+	//插入节点的函数(key已存在时覆盖val)
+	void Insert(const K& key, const V& val) { insert_or_assign(key, val); }
+	void Insert(K&& key, V&& val) { insert_or_assign(std::move(key), std::move(val)); }
+	//key不存在时才用args原地构造val(key已存在时args不会被移动)
+	template<class... Args>
+	std::pair<SPLAYNode<K, V>*, bool> try_emplace(const K& key, Args&&... args);
+	template<class... Args>
+	std::pair<SPLAYNode<K, V>*, bool> try_emplace(K&& key, Args&&... args);
+	//key不存在时插入,存在时把val赋给已有节点
+	template<class M>
+	std::pair<SPLAYNode<K, V>*, bool> insert_or_assign(const K& key, M&& val);
+	template<class M>
+	std::pair<SPLAYNode<K, V>*, bool> insert_or_assign(K&& key, M&& val);
+	//删除节点的函数
+	void Delete(const K& key);
+	//判断是否存在键值为key的节点(可能伸展)
+	bool Search(const K& key) { return Access(key) != nullptr; }
+	//得到指定key值的节点(可能伸展)
+	SPLAYNode<K, V>* GetNode(const K& key) { return Access(key); }
+	//不伸展的查找(不修改树,多个线程可以同时调用)
+	const SPLAYNode<K, V>* peek(const K& key)const { int depth; return FindNode(key, depth); }
+	//把key所在的节点(不存在时为最后访问的节点)旋转到根
+	void splay(const K& key) { if (root != nullptr) { root = Splay(root, key); } }
+	//树清空(独占内存池时整块释放slab,不需要逐个释放节点)
+	void Clear();
+
+	//读操作的伸展策略(写操作总是伸展)
+	//period>1时每次读操作以1/period的概率伸展,否则只做普通的二叉查找,不写任何节点(随机伸展,热点key仍然会很快被转到根附近)
+	//period为1时每次都伸展(默认),为0时读操作从不伸展
+	void set_splay_period(unsigned period) { splayPeriod = period; }
+	//只有深度超过depth的节点被读到时才伸展(默认为0);已经在根附近的热点key被反复读取时不再改动树
+	void set_splay_depth(int depth) { splayDepth = depth; }
+
+	//返回最小、最大的节点(不伸展)
+	SPLAYNode<K, V>* GetMinNode()const;
+	SPLAYNode<K, V>* GetMaxNode()const;
+	//有序查询(不伸展,没有时返回nullptr)
+	//最后一个key<=key的节点
+	SPLAYNode<K, V>* floor(const K& key)const;
+	//第一个key>=key的节点
+	SPLAYNode<K, V>* ceiling(const K& key)const;
+	//按key从小到大对[lo, hi)中的每个节点调用visitor(SPLAYNode*)
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor)const;
+	//得到树的高度(不使用递归)
+	int GetHeight()const;
+	//得到节点数
+	int getNodeSize()const { return NodeSize; }
+	//中序遍历
+	template<class Function>
+	void inOrder(Function&& function) { range_all(function); }
+
+	//重载[]操作符(只伸展一次,key不存在时插入值初始化的val)
+	V& operator[](const K& key) { return try_emplace(key).first->val; }
+	V& operator[](K&& key) { return try_emplace(std::move(key)).first->val; }
 };
 
-template<class T>
-TreeNode<T>* SPLAY<T>::splayHelp(TreeNode<T>* node, T& key)
+
+//从分配器中申请并构造一个节点
+template<class K, class V, class Compare, class Alloc>
+template<class... Args>
+inline SPLAYNode<K, V>* SPLAY<K, V, Compare, Alloc>::CreateNode(Args&&... args)
+{
+	SPLAYNode<K, V>* node = NodeTraits::allocate(alloc, 1);
+	try
+	{
+		NodeTraits::construct(alloc, node, std::forward<Args>(args)...);
+	}
+	catch (...)
+	{
+		NodeTraits::deallocate(alloc, node, 1);
+		throw;
+	}
+	return node;
+}
+
+//析构节点并归还给分配器
+template<class K, class V, class Compare, class Alloc>
+inline void SPLAY<K, V, Compare, Alloc>::DestroyNode(SPLAYNode<K, V>* node)
+{
+	NodeTraits::destroy(alloc, node);
+	NodeTraits::deallocate(alloc, node, 1);
+}
+
+//将树清空:有左子节点时右旋把它转上来,否则释放当前节点并走到右子节点,不需要栈
+template<class K, class V, class Compare, class Alloc>
+void SPLAY<K, V, Compare, Alloc>::ClearTree(SPLAYNode<K, V>* node)
+{
+	while (node != nullptr)
+	{
+		if (node->left != nullptr)
+		{
+			SPLAYNode<K, V>* leftNode = node->left;
+			node->left = leftNode->right;
+			leftNode->right = node;
+			node = leftNode;
+		}
+		else
+		{
+			SPLAYNode<K, V>* rightNode = node->right;
+			DestroyNode(node);
+			node = rightNode;
+		}
+	}
+}
+
+//只析构以node为根的所有节点,不归还内存
+template<class K, class V, class Compare, class Alloc>
+void SPLAY<K, V, Compare, Alloc>::DestroyTree(SPLAYNode<K, V>* node)
 {
+	while (node != nullptr)
+	{
+		if (node->left != nullptr)
+		{
+			SPLAYNode<K, V>* leftNode = node->left;
+			node->left = leftNode->right;
+			leftNode->right = node;
+			node = leftNode;
+		}
+		else
+		{
+			SPLAYNode<K, V>* rightNode = node->right;
+			NodeTraits::destroy(alloc, node);
+			node = rightNode;
+		}
+	}
+}
+
+//树清空
+template<class K, class V, class Compare, class Alloc>
+void SPLAY<K, V, Compare, Alloc>::Clear()
+{
+	if (CanReleaseAll(alloc))
+	{
+		//内存池只属于这棵树:平凡析构的节点连遍历都不需要,直接整块归还slab
+		if (!std::is_trivially_destructible<SPLAYNode<K, V>>::value) { DestroyTree(root); }
+		ReleaseAll(alloc);
+	}
+	else
+	{
+		ClearTree(root);
+	}
+	root = nullptr;
+	NodeSize = 0;
+}
+
+//自顶向下伸展
+//下降时比当前节点小的路径挂到右树(作为右树最小节点的左子节点),大的挂到左树(作为左树最大节点的右子节点)
+//连续两步同向时先旋转一次(zig-zig),路径长度大约减半;最后把左右树接到找到的节点两侧
+template<class K, class V, class Compare, class Alloc>
+SPLAYNode<K, V>* SPLAY<K, V, Compare, Alloc>::Splay(SPLAYNode<K, V>* node, const K& key)
+{
+	SPLAYNode<K, V>* leftTree = nullptr;		//key都小于key的节点组成的树
+	SPLAYNode<K, V>* rightTree = nullptr;		//key都大于key的节点组成的树
+	SPLAYNode<K, V>** leftHook = &leftTree;		//左树中下一个节点挂的位置(最大节点的右子节点)
+	SPLAYNode<K, V>** rightHook = &rightTree;	//右树中下一个节点挂的位置(最小节点的左子节点)
+	while (true)
+	{
+		int cmp = KeyCompare3(comp, key, node->key);
+		if (cmp < 0)
+		{
+			if (node->left == nullptr) { break; }
+			if (comp(key, node->left->key))
+			{
+				//zig-zig:右旋
+				SPLAYNode<K, V>* leftNode = node->left;
+				node->left = leftNode->right;
+				leftNode->right = node;
+				node = leftNode;
+				if (node->left == nullptr) { break; }
+			}
+			*rightHook = node;
+			rightHook = &node->left;
+			node = node->left;
+		}
+		else if (cmp > 0)
+		{
+			if (node->right == nullptr) { break; }
+			if (comp(node->right->key, key))
+			{
+				//zig-zig:左旋
+				SPLAYNode<K, V>* rightNode = node->right;
+				node->right = rightNode->left;
+				rightNode->left = node;
+				node = rightNode;
+				if (node->right == nullptr) { break; }
+			}
+			*leftHook = node;
+			leftHook = &node->right;
+			node = node->right;
+		}
+		else
+		{
+			break;
+		}
+	}
+	//组装:node原来的左右子树分别接到左树的最右边和右树的最左边
+	*leftHook = node->left;
+	*rightHook = node->right;
+	node->left = leftTree;
+	node->right = rightTree;
+	return node;
+}
+
+//不修改树的查找
+template<class K, class V, class Compare, class Alloc>
+SPLAYNode<K, V>* SPLAY<K, V, Compare, Alloc>::FindNode(const K& key, int& depth)const
+{
+	depth = 0;
+	SPLAYNode<K, V>* node = root;
+	while (node != nullptr)
+	{
+		int cmp = KeyCompare3(comp, key, node->key);
+		if (cmp == 0) { return node; }
+		node = cmp < 0 ? node->left : node->right;
+		depth++;
+	}
+	return nullptr;
+}
 
+//这一次读操作是否伸展
+template<class K, class V, class Compare, class Alloc>
+inline bool SPLAY<K, V, Compare, Alloc>::ShouldSplay()
+{
+	if (splayPeriod <= 1) { return splayPeriod == 1; }
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed % splayPeriod == 0;
+}
+
+//读操作的查找
+template<class K, class V, class Compare, class Alloc>
+SPLAYNode<K, V>* SPLAY<K, V, Compare, Alloc>::Access(const K& key)
+{
+	if (root == nullptr) { return nullptr; }
+	if (splayPeriod == 1 && splayDepth == 0)
+	{
+		//默认策略:一次下降同时完成查找和伸展
+		root = Splay(root, key);
+		return comp(key, root->key) || comp(root->key, key) ? nullptr : root;
+	}
+	//先做只读的查找,只有找到了足够深的节点并且这一次被选中时才伸展(需要第二次下降)
+	int depth;
+	SPLAYNode<K, V>* node = FindNode(key, depth);
+	if (node == nullptr || depth <= splayDepth || !ShouldSplay()) { return node; }
+	root = Splay(root, key);
+	return root;
+}
+
+//插入的公共入口
+template<class K, class V, class Compare, class Alloc>
+template<class Make>
+std::pair<SPLAYNode<K, V>*, bool> SPLAY<K, V, Compare, Alloc>::InsertWith(const K& key, Make make)
+{
+	if (root == nullptr)
+	{
+		root = make();
+		NodeSize++;
+		return std::make_pair(root, true);
+	}
+	root = Splay(root, key);
+	int cmp = KeyCompare3(comp, key, root->key);
+	if (cmp == 0) { return std::make_pair(root, false); }
+	//伸展之后根是key的前驱或后继,新节点成为根,把原来的根和它的一侧子树分到两边
+	SPLAYNode<K, V>* node = make();
+	if (cmp < 0)
+	{
+		node->left = root->left;
+		node->right = root;
+		root->left = nullptr;
+	}
+	else
+	{
+		node->right = root->right;
+		node->left = root;
+		root->right = nullptr;
+	}
+	root = node;
+	NodeSize++;
+	return std::make_pair(node, true);
+}
+
+//key不存在时才用args原地构造val
+template<class K, class V, class Compare, class Alloc>
+template<class... Args>
+std::pair<SPLAYNode<K, V>*, bool> SPLAY<K, V, Compare, Alloc>::try_emplace(const K& key, Args&&... args)
+{
+	return InsertWith(key, [&]() { return CreateNode(key, std::forward<Args>(args)...); });
+}
+
+template<class K, class V, class Compare, class Alloc>
+template<class... Args>
+std::pair<SPLAYNode<K, V>*, bool> SPLAY<K, V, Compare, Alloc>::try_emplace(K&& key, Args&&... args)
+{
+	return InsertWith(key, [&]() { return CreateNode(std::move(key), std::forward<Args>(args)...); });
+}
+
+//key不存在时插入,存在时把val赋给已有节点
+template<class K, class V, class Compare, class Alloc>
+template<class M>
+std::pair<SPLAYNode<K, V>*, bool> SPLAY<K, V, Compare, Alloc>::insert_or_assign(const K& key, M&& val)
+{
+	std::pair<SPLAYNode<K, V>*, bool> result = InsertWith(key, [&]() { return CreateNode(key, std::forward<M>(val)); });
+	if (!result.second) { result.first->val = std::forward<M>(val); }
+	return result;
+}
+
+template<class K, class V, class Compare, class Alloc>
+template<class M>
+std::pair<SPLAYNode<K, V>*, bool> SPLAY<K, V, Compare, Alloc>::insert_or_assign(K&& key, M&& val)
+{
+	std::pair<SPLAYNode<K, V>*, bool> result = InsertWith(key, [&]() { return CreateNode(std::move(key), std::forward<M>(val)); });
+	if (!result.second) { result.first->val = std::forward<M>(val); }
+	return result;
+}
+
+//删除节点的函数:把key转到根,再把左子树的最大节点转上来代替它
+template<class K, class V, class Compare, class Alloc>
+void SPLAY<K, V, Compare, Alloc>::Delete(const K& key)
+{
+	if (root == nullptr) { return; }
+	root = Splay(root, key);
+	if (comp(key, root->key) || comp(root->key, key)) { return; }
+	SPLAYNode<K, V>* node = root;
+	if (node->left == nullptr)
+	{
+		root = node->right;
+	}
+	else
+	{
+		//左子树中的key都小于key,伸展后左子树的根是其中最大的节点,没有右子节点
+		root = Splay(node->left, key);
+		root->right = node->right;
+	}
+	DestroyNode(node);
+	NodeSize--;
+}
+
+//返回最小的节点
+template<class K, class V, class Compare, class Alloc>
+SPLAYNode<K, V>* SPLAY<K, V, Compare, Alloc>::GetMinNode()const
+{
+	SPLAYNode<K, V>* node = root;
+	if (node != nullptr)
+	{
+		while (node->left != nullptr) { node = node->left; }
+	}
+	return node;
+}
+
+//返回最大的节点
+template<class K, class V, class Compare, class Alloc>
+SPLAYNode<K, V>* SPLAY<K, V, Compare, Alloc>::GetMaxNode()const
+{
+	SPLAYNode<K, V>* node = root;
+	if (node != nullptr)
+	{
+		while (node->right != nullptr) { node = node->right; }
+	}
+	return node;
+}
+
+//最后一个key<=key的节点
+template<class K, class V, class Compare, class Alloc>
+SPLAYNode<K, V>* SPLAY<K, V, Compare, Alloc>::floor(const K& key)const
+{
+	SPLAYNode<K, V>* result = nullptr;
+	SPLAYNode<K, V>* node = root;
+	while (node != nullptr)
+	{
+		if (comp(key, node->key)) { node = node->left; }
+		else
+		{
+			result = node;
+			node = node->right;
+		}
+	}
+	return result;
+}
+
+//第一个key>=key的节点
+template<class K, class V, class Compare, class Alloc>
+SPLAYNode<K, V>* SPLAY<K, V, Compare, Alloc>::ceiling(const K& key)const
+{
+	SPLAYNode<K, V>* result = nullptr;
+	SPLAYNode<K, V>* node = root;
+	while (node != nullptr)
+	{
+		if (comp(node->key, key)) { node = node->right; }
+		else
+		{
+			result = node;
+			node = node->left;
+		}
+	}
+	return result;
+}
+
+//按key从小到大访问[lo, hi)中的节点:用显式的栈做中序遍历,只进入可能有范围内节点的子树
+template<class K, class V, class Compare, class Alloc>
+template<class Visitor>
+void SPLAY<K, V, Compare, Alloc>::range(const K& lo, const K& hi, Visitor&& visitor)const
+{
+	std::vector<SPLAYNode<K, V>*> stack;
+	SPLAYNode<K, V>* node = root;
+	while (node != nullptr || !stack.empty())
+	{
+		while (node != nullptr)
+		{
+			//node<lo时它和它的左子树都不在范围内
+			if (comp(node->key, lo)) { node = node->right; }
+			else
+			{
+				stack.push_back(node);
+				node = node->left;
+			}
+		}
+		if (stack.empty()) { return; }
+		node = stack.back();
+		stack.pop_back();
+		if (!comp(node->key, hi)) { return; }
+		visitor(node);
+		node = node->right;
+	}
+}
+
+//按中序访问所有节点
+template<class K, class V, class Compare, class Alloc>
+template<class Visitor>
+void SPLAY<K, V, Compare, Alloc>::range_all(Visitor&& visitor)const
+{
+	std::vector<SPLAYNode<K, V>*> stack;
+	SPLAYNode<K, V>* node = root;
+	while (node != nullptr || !stack.empty())
+	{
+		while (node != nullptr)
+		{
+			stack.push_back(node);
+			node = node->left;
+		}
+		node = stack.back();
+		stack.pop_back();
+		visitor(node);
+		node = node->right;
+	}
+}
+
+//得到树的高度
+template<class K, class V, class Compare, class Alloc>
+int SPLAY<K, V, Compare, Alloc>::GetHeight()const
+{
+	int height = 0;
+	std::vector<std::pair<SPLAYNode<K, V>*, int>> stack;
+	if (root != nullptr) { stack.emplace_back(root, 1); }
+	while (!stack.empty())
+	{
+		std::pair<SPLAYNode<K, V>*, int> top = stack.back();
+		stack.pop_back();
+		if (top.second > height) { height = top.second; }
+		if (top.first->left != nullptr) { stack.emplace_back(top.first->left, top.second + 1); }
+		if (top.first->right != nullptr) { stack.emplace_back(top.first->right, top.second + 1); }
+	}
+	return height;
 }
 
 #endif // SPLAYTREE_H
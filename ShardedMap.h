@@ -0,0 +1,497 @@
+﻿#pragma once
+#ifndef SHARDEDMAP_H
+#define SHARDEDMAP_H
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+#include "RBTree.h"
+#include "NodeEntry.h"
+#include "ReadWriteLock.h"
+
+//测试程序通过它检查树的内部结构(定义在tests/TreeCheck.h中)
+struct TreeTestAccess;
+
+//按key的范围分片的有序表:分割点splits把key划分成splits.size() + 1段,每段是一棵独立的RBT,有自己的读写锁和内存池
+//第i个分片保存[splits[i - 1], splits[i])中的key,落在不同分片上的写操作可以同时进行,写吞吐随分片数增长
+//有序查询和范围扫描按顺序逐个分片进行,每次只持有一个分片的锁(扫描看到的不是整个表的同一时刻的快照)
+//分割点可以在构造时给出,也可以用set_splits/rebalance重新划分(根据样本选择分割点,重新划分期间阻塞所有操作)
+//visitor和update的回调在分片的锁内执行,不能再调用同一个ShardedMap
+template<class K, class V, class Compare = std::less<K>, class Alloc = NodePool<std::pair<const K, V>>, class Augment = NoAugment>
+class ShardedMap
+{
+	friend struct TreeTestAccess;
+private:
+	using Tree = RBT<K, V, Compare, Alloc, Augment>;
+	using Node = RBTNode<K, V, Augment>;
+	using ReadLock = std::shared_lock<ReadWriteLock>;
+	using WriteLock = std::unique_lock<ReadWriteLock>;
+	static const size_t CacheLine = 64;
+	//一个分片(独占缓存行,避免相邻分片的锁互相干扰)
+	struct alignas(CacheLine) Shard
+	{
+		mutable ReadWriteLock lock;		//分片的读写锁
+		Tree tree;						//分片的树(使用自己的内存池,不同分片上的写操作同时分配节点时互不干扰)
+		Shard(const Compare& compare, const Alloc& allocator) : tree(compare, IndependentAllocator(allocator)) {}
+	};
+
+	std::vector<K> splits;							//严格递增的分割点
+	std::vector<std::unique_ptr<Shard>> shards;		//splits.size() + 1个分片
+	mutable ReadWriteLock layoutLock;				//普通操作持有共享锁,重新划分时持有独占锁
+	Compare comp;									//键的比较器
+	Alloc allocator;								//新分片使用的分配器
+
+	//key所在的分片
+	size_t ShardOf(const K& key) const { return size_t(std::upper_bound(splits.begin(), splits.end(), key, comp) - splits.begin()); }
+	//排序并去掉重复的分割点
+	void Normalize(std::vector<K>& points) const;
+	//按points重新划分(调用者持有layoutLock的独占锁)
+	void Redistribute(std::vector<K> points);
+	//从样本中选出把它分成shardCount段的分割点
+	std::vector<K> SplitsFromSample(std::vector<K> sample, size_t shardCount) const;
+public:
+	//构造函数:只有一个分片,之后可以用set_splits/rebalance划分
+	explicit ShardedMap(const Compare& compare = Compare(), const Alloc& alloc = Alloc());
+	//按分割点splitPoints划分成splitPoints.size() + 1个分片(会排序并去重)
+	explicit ShardedMap(std::vector<K> splitPoints, const Compare& compare = Compare(), const Alloc& alloc = Alloc());
+	//防止拷贝构造
+	ShardedMap(const ShardedMap&) = delete;
+	ShardedMap& operator=(const ShardedMap&) = delete;
+
+	//修改(只持有key所在分片的独占锁)
+	//插入键值(key已存在时覆盖val)
+	void Insert(const K& key, const V& val);
+	//key不存在时才用args构造val,返回是否插入
+	template<class... Args>
+	bool try_emplace(const K& key, Args&&... args);
+	//key不存在时插入,存在时覆盖val,返回是否插入了新节点
+	template<class M>
+	bool insert_or_assign(const K& key, M&& val);
+	//删除key
+	void Delete(const K& key);
+	//key存在时在锁内调用f(V&)原地修改val(并重新计算聚合值),返回key是否存在
+	template<class F>
+	bool update(const K& key, F&& f);
+	//删除key在[lo, hi)中的所有节点
+	void erase_range(const K& lo, const K& hi);
+	//清空(分割点不变)
+	void Clear();
+
+	//划分
+	//分片数
+	size_t shard_count() const { ReadLock guard(layoutLock); return shards.size(); }
+	//当前的分割点
+	std::vector<K> get_splits() const { ReadLock guard(layoutLock); return splits; }
+	//按新的分割点重新划分(已有的键值拷贝到新的分片中,完成前出现异常时保持原样)
+	void set_splits(std::vector<K> splitPoints);
+	//根据key的样本(例如即将写入的key)选择分割点,使样本平均落在shardCount个分片中,然后重新划分
+	void rebalance(std::vector<K> sample, size_t shardCount);
+	//从当前所有key中等间隔地取出sampleSize个作为样本,重新划分成shardCount个分片
+	void rebalance(size_t shardCount, size_t sampleSize = 1024);
+
+	//查询(持有分片的共享锁,结果按值返回)
+	//判断key是否存在
+	bool Search(const K& key) const;
+	//key对应的val的拷贝(不存在时返回空)
+	std::optional<V> Get(const K& key) const;
+	//节点数(逐个分片累加)
+	int getNodeSize() const;
+	//最小、最大的键值
+	std::optional<std::pair<K, V>> GetMin() const;
+	std::optional<std::pair<K, V>> GetMax() const;
+	//最后一个key<=key的键值
+	std::optional<std::pair<K, V>> floor(const K& key) const;
+	//第一个key>=key的键值
+	std::optional<std::pair<K, V>> ceiling(const K& key) const;
+	//按key从小到大对[lo, hi)中的每个键值调用visitor(const K&, const V&),跨越的分片依次加锁
+	template<class Visitor>
+	void range(const K& lo, const K& hi, Visitor&& visitor) const;
+	//拷贝出[lo, hi)中的所有键值
+	std::vector<std::pair<K, V>> range_copy(const K& lo, const K& hi) const;
+	//按key从小到大对所有键值调用visitor(const K&, const V&)
+	template<class Visitor>
+	void for_each(Visitor&& visitor) const;
+	//整个表的聚合值(按分片顺序合并)
+	typename Augment::value_type reduce() const;
+	//key在[lo, hi)中的节点的聚合值
+	typename Augment::value_type reduce(const K& lo, const K& hi) const;
+};
+
+//构造函数
+template<class K, class V, class Compare, class Alloc, class Augment>
+ShardedMap<K, V, Compare, Alloc, Augment>::ShardedMap(const Compare& compare, const Alloc& alloc)
+	: comp(compare), allocator(alloc)
+{
+	shards.push_back(std::unique_ptr<Shard>(new Shard(comp, allocator)));
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+ShardedMap<K, V, Compare, Alloc, Augment>::ShardedMap(std::vector<K> splitPoints, const Compare& compare, const Alloc& alloc)
+	: comp(compare), allocator(alloc)
+{
+	Normalize(splitPoints);
+	splits = std::move(splitPoints);
+	shards.reserve(splits.size() + 1);
+	for (size_t i = 0; i <= splits.size(); i++)
+	{
+		shards.push_back(std::unique_ptr<Shard>(new Shard(comp, allocator)));
+	}
+}
+
+//排序并去掉重复的分割点
+template<class K, class V, class Compare, class Alloc, class Augment>
+void ShardedMap<K, V, Compare, Alloc, Augment>::Normalize(std::vector<K>& points) const
+{
+	std::sort(points.begin(), points.end(), comp);
+	auto equal = [this](const K& a, const K& b) { return !comp(a, b) && !comp(b, a); };
+	points.erase(std::unique(points.begin(), points.end(), equal), points.end());
+}
+
+//按points重新划分
+template<class K, class V, class Compare, class Alloc, class Augment>
+void ShardedMap<K, V, Compare, Alloc, Augment>::Redistribute(std::vector<K> points)
+{
+	Normalize(points);
+	//先把所有键值按顺序拷贝出来(分片之间本身有序)
+	std::vector<std::pair<K, V>> items;
+	for (const std::unique_ptr<Shard>& shard : shards)
+	{
+		const Tree& tree = shard->tree;
+		for (const Node& node : tree) { items.emplace_back(node.key, node.val); }
+	}
+	//再在新的分片中批量构造,全部完成后才替换旧的分片
+	std::vector<std::unique_ptr<Shard>> newShards;
+	newShards.reserve(points.size() + 1);
+	auto first = items.begin();
+	for (size_t i = 0; i <= points.size(); i++)
+	{
+		auto last = items.end();
+		if (i < points.size())
+		{
+			last = std::partition_point(first, items.end(), [&](const std::pair<K, V>& item) { return comp(item.first, points[i]); });
+		}
+		newShards.push_back(std::unique_ptr<Shard>(new Shard(comp, allocator)));
+		newShards.back()->tree.build_from_sorted(std::make_move_iterator(first), std::make_move_iterator(last));
+		first = last;
+	}
+	splits.swap(points);
+	shards.swap(newShards);
+}
+
+//从样本中选出分割点
+template<class K, class V, class Compare, class Alloc, class Augment>
+std::vector<K> ShardedMap<K, V, Compare, Alloc, Augment>::SplitsFromSample(std::vector<K> sample, size_t shardCount) const
+{
+	//第i个分割点取排序后样本的i/shardCount分位数,重复的样本多时分片数会变少
+	std::sort(sample.begin(), sample.end(), comp);
+	std::vector<K> points;
+	if (shardCount <= 1 || sample.empty()) { return points; }
+	points.reserve(shardCount - 1);
+	for (size_t i = 1; i < shardCount; i++)
+	{
+		size_t index = i * sample.size() / shardCount;
+		if (index == 0) { continue; }
+		if (points.empty() || comp(points.back(), sample[index])) { points.push_back(sample[index]); }
+	}
+	return points;
+}
+
+//插入键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+void ShardedMap<K, V, Compare, Alloc, Augment>::Insert(const K& key, const V& val)
+{
+	ReadLock layout(layoutLock);
+	Shard& shard = *shards[ShardOf(key)];
+	WriteLock guard(shard.lock);
+	shard.tree.Insert(key, val);
+}
+
+//key不存在时才用args构造val
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class... Args>
+bool ShardedMap<K, V, Compare, Alloc, Augment>::try_emplace(const K& key, Args&&... args)
+{
+	ReadLock layout(layoutLock);
+	Shard& shard = *shards[ShardOf(key)];
+	WriteLock guard(shard.lock);
+	return shard.tree.try_emplace(key, std::forward<Args>(args)...).second;
+}
+
+//key不存在时插入,存在时覆盖val
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class M>
+bool ShardedMap<K, V, Compare, Alloc, Augment>::insert_or_assign(const K& key, M&& val)
+{
+	ReadLock layout(layoutLock);
+	Shard& shard = *shards[ShardOf(key)];
+	WriteLock guard(shard.lock);
+	return shard.tree.insert_or_assign(key, std::forward<M>(val)).second;
+}
+
+//删除key
+template<class K, class V, class Compare, class Alloc, class Augment>
+void ShardedMap<K, V, Compare, Alloc, Augment>::Delete(const K& key)
+{
+	ReadLock layout(layoutLock);
+	Shard& shard = *shards[ShardOf(key)];
+	WriteLock guard(shard.lock);
+	shard.tree.Delete(key);
+}
+
+//key存在时在锁内修改val
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class F>
+bool ShardedMap<K, V, Compare, Alloc, Augment>::update(const K& key, F&& f)
+{
+	ReadLock layout(layoutLock);
+	Shard& shard = *shards[ShardOf(key)];
+	WriteLock guard(shard.lock);
+	Node* node = shard.tree.GetNode(key);
+	if (node == nullptr) { return false; }
+	f(node->val);
+	shard.tree.refresh(key);
+	return true;
+}
+
+//删除key在[lo, hi)中的所有节点
+template<class K, class V, class Compare, class Alloc, class Augment>
+void ShardedMap<K, V, Compare, Alloc, Augment>::erase_range(const K& lo, const K& hi)
+{
+	if (!comp(lo, hi)) { return; }
+	ReadLock layout(layoutLock);
+	for (size_t i = ShardOf(lo), last = ShardOf(hi); i <= last; i++)
+	{
+		WriteLock guard(shards[i]->lock);
+		shards[i]->tree.erase_range(lo, hi);
+	}
+}
+
+//清空
+template<class K, class V, class Compare, class Alloc, class Augment>
+void ShardedMap<K, V, Compare, Alloc, Augment>::Clear()
+{
+	ReadLock layout(layoutLock);
+	for (const std::unique_ptr<Shard>& shard : shards)
+	{
+		WriteLock guard(shard->lock);
+		shard->tree.Clear();
+	}
+}
+
+//按新的分割点重新划分
+template<class K, class V, class Compare, class Alloc, class Augment>
+void ShardedMap<K, V, Compare, Alloc, Augment>::set_splits(std::vector<K> splitPoints)
+{
+	WriteLock layout(layoutLock);
+	Redistribute(std::move(splitPoints));
+}
+
+//根据样本重新划分
+template<class K, class V, class Compare, class Alloc, class Augment>
+void ShardedMap<K, V, Compare, Alloc, Augment>::rebalance(std::vector<K> sample, size_t shardCount)
+{
+	std::vector<K> points = SplitsFromSample(std::move(sample), shardCount);
+	WriteLock layout(layoutLock);
+	Redistribute(std::move(points));
+}
+
+//从当前的key中取样并重新划分
+template<class K, class V, class Compare, class Alloc, class Augment>
+void ShardedMap<K, V, Compare, Alloc, Augment>::rebalance(size_t shardCount, size_t sampleSize)
+{
+	WriteLock layout(layoutLock);
+	size_t total = 0;
+	for (const std::unique_ptr<Shard>& shard : shards) { total += size_t(shard->tree.getNodeSize()); }
+	//每隔stride个key取一个
+	size_t stride = sampleSize == 0 ? total + 1 : std::max(total / sampleSize, size_t(1));
+	std::vector<K> sample;
+	sample.reserve(total / stride + 1);
+	size_t index = 0;
+	for (const std::unique_ptr<Shard>& shard : shards)
+	{
+		const Tree& tree = shard->tree;
+		for (const Node& node : tree)
+		{
+			if (index++ % stride == 0) { sample.push_back(node.key); }
+		}
+	}
+	Redistribute(SplitsFromSample(std::move(sample), shardCount));
+}
+
+//判断key是否存在
+template<class K, class V, class Compare, class Alloc, class Augment>
+bool ShardedMap<K, V, Compare, Alloc, Augment>::Search(const K& key) const
+{
+	ReadLock layout(layoutLock);
+	const Shard& shard = *shards[ShardOf(key)];
+	ReadLock guard(shard.lock);
+	return shard.tree.Search(key);
+}
+
+//key对应的val的拷贝
+template<class K, class V, class Compare, class Alloc, class Augment>
+std::optional<V> ShardedMap<K, V, Compare, Alloc, Augment>::Get(const K& key) const
+{
+	ReadLock layout(layoutLock);
+	const Shard& shard = *shards[ShardOf(key)];
+	ReadLock guard(shard.lock);
+	const Node* node = shard.tree.GetNode(key);
+	if (node == nullptr) { return std::nullopt; }
+	return node->val;
+}
+
+//节点数
+template<class K, class V, class Compare, class Alloc, class Augment>
+int ShardedMap<K, V, Compare, Alloc, Augment>::getNodeSize() const
+{
+	ReadLock layout(layoutLock);
+	int size = 0;
+	for (const std::unique_ptr<Shard>& shard : shards)
+	{
+		ReadLock guard(shard->lock);
+		size += shard->tree.getNodeSize();
+	}
+	return size;
+}
+
+//最小的键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+std::optional<std::pair<K, V>> ShardedMap<K, V, Compare, Alloc, Augment>::GetMin() const
+{
+	ReadLock layout(layoutLock);
+	for (const std::unique_ptr<Shard>& shard : shards)
+	{
+		ReadLock guard(shard->lock);
+		const Node* node = shard->tree.GetMinNode();
+		if (node != nullptr) { return CopyEntry<K, V>(node); }
+	}
+	return std::nullopt;
+}
+
+//最大的键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+std::optional<std::pair<K, V>> ShardedMap<K, V, Compare, Alloc, Augment>::GetMax() const
+{
+	ReadLock layout(layoutLock);
+	for (size_t i = shards.size(); i-- > 0;)
+	{
+		ReadLock guard(shards[i]->lock);
+		const Node* node = shards[i]->tree.GetMaxNode();
+		if (node != nullptr) { return CopyEntry<K, V>(node); }
+	}
+	return std::nullopt;
+}
+
+//最后一个key<=key的键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+std::optional<std::pair<K, V>> ShardedMap<K, V, Compare, Alloc, Augment>::floor(const K& key) const
+{
+	ReadLock layout(layoutLock);
+	//key所在分片中没有时,前面分片的key都更小,取最大的一个
+	size_t i = ShardOf(key);
+	{
+		ReadLock guard(shards[i]->lock);
+		const Node* node = shards[i]->tree.floor(key);
+		if (node != nullptr) { return CopyEntry<K, V>(node); }
+	}
+	while (i-- > 0)
+	{
+		ReadLock guard(shards[i]->lock);
+		const Node* node = shards[i]->tree.GetMaxNode();
+		if (node != nullptr) { return CopyEntry<K, V>(node); }
+	}
+	return std::nullopt;
+}
+
+//第一个key>=key的键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+std::optional<std::pair<K, V>> ShardedMap<K, V, Compare, Alloc, Augment>::ceiling(const K& key) const
+{
+	ReadLock layout(layoutLock);
+	//key所在分片中没有时,后面分片的key都更大,取最小的一个
+	size_t i = ShardOf(key);
+	{
+		ReadLock guard(shards[i]->lock);
+		const Node* node = shards[i]->tree.ceiling(key);
+		if (node != nullptr) { return CopyEntry<K, V>(node); }
+	}
+	while (++i < shards.size())
+	{
+		ReadLock guard(shards[i]->lock);
+		const Node* node = shards[i]->tree.GetMinNode();
+		if (node != nullptr) { return CopyEntry<K, V>(node); }
+	}
+	return std::nullopt;
+}
+
+//按key从小到大访问[lo, hi)中的键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Visitor>
+void ShardedMap<K, V, Compare, Alloc, Augment>::range(const K& lo, const K& hi, Visitor&& visitor) const
+{
+	if (!comp(lo, hi)) { return; }
+	ReadLock layout(layoutLock);
+	for (size_t i = ShardOf(lo), last = ShardOf(hi); i <= last; i++)
+	{
+		ReadLock guard(shards[i]->lock);
+		shards[i]->tree.range(lo, hi, [&visitor](const Node* node) { visitor(node->key, node->val); });
+	}
+}
+
+//拷贝出[lo, hi)中的所有键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+std::vector<std::pair<K, V>> ShardedMap<K, V, Compare, Alloc, Augment>::range_copy(const K& lo, const K& hi) const
+{
+	std::vector<std::pair<K, V>> result;
+	range(lo, hi, [&result](const K& key, const V& val) { result.emplace_back(key, val); });
+	return result;
+}
+
+//按key从小到大访问所有键值
+template<class K, class V, class Compare, class Alloc, class Augment>
+template<class Visitor>
+void ShardedMap<K, V, Compare, Alloc, Augment>::for_each(Visitor&& visitor) const
+{
+	ReadLock layout(layoutLock);
+	for (const std::unique_ptr<Shard>& shard : shards)
+	{
+		ReadLock guard(shard->lock);
+		const Tree& tree = shard->tree;
+		for (const Node& node : tree) { visitor(node.key, node.val); }
+	}
+}
+
+//整个表的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename Augment::value_type ShardedMap<K, V, Compare, Alloc, Augment>::reduce() const
+{
+	ReadLock layout(layoutLock);
+	typename Augment::value_type result = Augment::identity();
+	for (const std::unique_ptr<Shard>& shard : shards)
+	{
+		ReadLock guard(shard->lock);
+		result = Augment::combine(result, shard->tree.reduce());
+	}
+	return result;
+}
+
+//key在[lo, hi)中的节点的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+typename Augment::value_type ShardedMap<K, V, Compare, Alloc, Augment>::reduce(const K& lo, const K& hi) const
+{
+	typename Augment::value_type result = Augment::identity();
+	if (!comp(lo, hi)) { return result; }
+	ReadLock layout(layoutLock);
+	for (size_t i = ShardOf(lo), last = ShardOf(hi); i <= last; i++)
+	{
+		ReadLock guard(shards[i]->lock);
+		result = Augment::combine(result, shards[i]->tree.reduce(lo, hi));
+	}
+	return result;
+}
+
+#endif // !SHARDEDMAP_H
@@ -0,0 +1,222 @@
+﻿#pragma once
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//work-stealing任务池,RBT/AVL的并行集合运算和并行批量构造使用它在子树上分治
+//每个线程有自己的任务队列:自己从尾部压入和取出(后进先出,数据还在缓存中),空闲的线程从其他队列的头部偷取(偷到的是较早分出的大任务)
+//只提供fork_join一种原语:分出的任务一定在fork_join返回前完成,所以任务对象直接放在调用者的栈上,不需要动态分配
+//等待被偷走的任务时,等待的线程也会去执行其他任务,不会空占一个线程
+class TaskPool
+{
+public:
+	//子问题小于这么多元素时,调用者应当退回串行代码(分出任务的开销大于收益)
+	static const size_t DefaultGrain = 4096;
+private:
+	//fork_join分出的任务(在fork_join的栈上)
+	struct Task
+	{
+		void (*invoke)(void* func);		//调用func的函数
+		void* func;						//任务的可调用对象
+		std::atomic<bool> done;			//任务是否已经执行完
+		std::exception_ptr error;		//任务抛出的异常
+	};
+	//一个线程的任务队列
+	struct WorkQueue
+	{
+		std::mutex lock;
+		std::deque<Task*> tasks;
+	};
+
+	std::vector<std::thread> workers;			//后台工作线程
+	std::unique_ptr<WorkQueue[]> queues;		//前workers.size()个队列属于工作线程,最后一个由外部线程共用
+	size_t queueCount;							//队列数
+	std::atomic<size_t> pending;				//所有队列中等待执行的任务数
+	std::mutex sleepLock;						//空闲的工作线程在wakeUp上等待
+	std::condition_variable wakeUp;
+	bool stopping;								//析构时通知工作线程退出
+
+	template<class F>
+	static void Invoke(void* func) { (*static_cast<F*>(func))(); }
+	//当前线程所属的任务池和队列编号(不是任何任务池的工作线程时为nullptr)
+	static std::pair<const TaskPool*, size_t>& Current()
+	{
+		static thread_local std::pair<const TaskPool*, size_t> current(nullptr, 0);
+		return current;
+	}
+	//当前线程使用的队列
+	size_t MyQueue() const
+	{
+		const std::pair<const TaskPool*, size_t>& current = Current();
+		return current.first == this ? current.second : queueCount - 1;
+	}
+	//压入队列q的尾部并唤醒一个空闲的工作线程
+	void Push(size_t q, Task* task)
+	{
+		{
+			std::lock_guard<std::mutex> guard(queues[q].lock);
+			queues[q].tasks.push_back(task);
+		}
+		pending.fetch_add(1);
+		//先拿一次sleepLock:工作线程要么还没检查pending(之后能看到新任务),要么已经在wait中(能收到通知)
+		{ std::lock_guard<std::mutex> guard(sleepLock); }
+		wakeUp.notify_one();
+	}
+	//task还在队列q的尾部(没有被偷走)时把它取回
+	bool TakeBack(size_t q, Task* task)
+	{
+		std::lock_guard<std::mutex> guard(queues[q].lock);
+		if (queues[q].tasks.empty() || queues[q].tasks.back() != task) { return false; }
+		queues[q].tasks.pop_back();
+		pending.fetch_sub(1);
+		return true;
+	}
+	//从队列q中取一个任务(自己的队列取尾部,别人的队列取头部)
+	Task* Pop(size_t q, bool own)
+	{
+		std::lock_guard<std::mutex> guard(queues[q].lock);
+		if (queues[q].tasks.empty()) { return nullptr; }
+		Task* task;
+		if (own)
+		{
+			task = queues[q].tasks.back();
+			queues[q].tasks.pop_back();
+		}
+		else
+		{
+			task = queues[q].tasks.front();
+			queues[q].tasks.pop_front();
+		}
+		pending.fetch_sub(1);
+		return task;
+	}
+	//执行任务,异常留给fork_join重新抛出
+	static void Execute(Task* task)
+	{
+		try
+		{
+			task->invoke(task->func);
+		}
+		catch (...)
+		{
+			task->error = std::current_exception();
+		}
+		//done置位之后task随时可能被fork_join销毁,不能再访问
+		task->done.store(true, std::memory_order_release);
+	}
+	//先执行自己队列中的任务,没有时依次从其他队列偷取,返回是否执行了任务
+	bool RunOne(size_t self)
+	{
+		Task* task = Pop(self, true);
+		for (size_t i = 1; task == nullptr && i < queueCount; i++)
+		{
+			task = Pop((self + i) % queueCount, false);
+		}
+		if (task == nullptr) { return false; }
+		Execute(task);
+		return true;
+	}
+	//等待fork_join分出的task完成:没被偷走就自己执行,否则一边等一边执行其他任务
+	void Wait(size_t self, Task* task)
+	{
+		if (TakeBack(self, task))
+		{
+			Execute(task);
+			return;
+		}
+		while (!task->done.load(std::memory_order_acquire))
+		{
+			if (!RunOne(self)) { std::this_thread::yield(); }
+		}
+	}
+	//工作线程的主循环
+	void WorkerLoop(size_t index)
+	{
+		Current() = std::pair<const TaskPool*, size_t>(this, index);
+		for (;;)
+		{
+			if (RunOne(index)) { continue; }
+			std::unique_lock<std::mutex> guard(sleepLock);
+			wakeUp.wait(guard, [this]() { return stopping || pending.load() != 0; });
+			if (stopping && pending.load() == 0) { return; }
+		}
+	}
+public:
+	//workerCount个后台工作线程,调用fork_join的线程自己也参与执行
+	//默认比硬件线程数少一个;为0时fork_join直接串行执行
+	explicit TaskPool(size_t workerCount = DefaultWorkerCount())
+		: queues(new WorkQueue[workerCount + 1]), queueCount(workerCount + 1), pending(0), stopping(false)
+	{
+		workers.reserve(workerCount);
+		for (size_t i = 0; i < workerCount; i++)
+		{
+			workers.emplace_back([this, i]() { WorkerLoop(i); });
+		}
+	}
+	//析构函数(等待所有工作线程退出)
+	~TaskPool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(sleepLock);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		for (std::thread& worker : workers) { worker.join(); }
+	}
+	TaskPool(const TaskPool&) = delete;
+	TaskPool& operator=(const TaskPool&) = delete;
+
+	//默认的工作线程数
+	static size_t DefaultWorkerCount()
+	{
+		unsigned hardware = std::thread::hardware_concurrency();
+		return hardware > 1 ? hardware - 1 : 0;
+	}
+	//后台工作线程数
+	size_t worker_count() const { return workers.size(); }
+
+	//并行执行first()和second(),两者都完成后才返回
+	//second可能被其他线程偷走执行,first总是在当前线程执行
+	//两者都抛出异常时重新抛出first的异常
+	template<class F1, class F2>
+	void fork_join(F1&& first, F2&& second)
+	{
+		if (workers.empty())
+		{
+			first();
+			second();
+			return;
+		}
+		using F = typename std::remove_reference<F2>::type;
+		Task task;
+		task.invoke = &Invoke<F>;
+		task.func = const_cast<void*>(static_cast<const void*>(std::addressof(second)));
+		task.done.store(false, std::memory_order_relaxed);
+		size_t self = MyQueue();
+		Push(self, &task);
+		try
+		{
+			first();
+		}
+		catch (...)
+		{
+			//task在当前栈上,离开前必须等它结束
+			Wait(self, &task);
+			throw;
+		}
+		Wait(self, &task);
+		if (task.error) { std::rethrow_exception(task.error); }
+	}
+};
+
+#endif // !TASKPOOL_H
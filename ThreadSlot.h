@@ -0,0 +1,58 @@
+﻿#pragma once
+#ifndef THREADSLOT_H
+#define THREADSLOT_H
+#include <cstddef>
+#include <mutex>
+
+//给线程分配全局唯一的编号(线程退出时回收),用来找到线程在各个数据结构中独占的槽(见RCUMap.h、FlatCombiningRBT.h)
+class ThreadSlot
+{
+public:
+	static const size_t MaxThreads = 256;	//同时存在的线程数上限
+	static const size_t None = MaxThreads;	//编号用完时返回None
+	//当前线程的编号
+	static size_t Get()
+	{
+		static thread_local Registration registration;
+		return registration.index;
+	}
+private:
+	struct Registry
+	{
+		std::mutex lock;
+		bool used[MaxThreads] = {};
+	};
+	static Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+	//线程第一次使用时领取编号,线程退出时归还
+	struct Registration
+	{
+		size_t index;
+		Registration() : index(None)
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> guard(registry.lock);
+			for (size_t i = 0; i < MaxThreads; i++)
+			{
+				if (!registry.used[i])
+				{
+					registry.used[i] = true;
+					index = i;
+					break;
+				}
+			}
+		}
+		~Registration()
+		{
+			if (index == None) { return; }
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> guard(registry.lock);
+			registry.used[index] = false;
+		}
+	};
+};
+
+#endif // !THREADSLOT_H
@@ -1,21 +1,27 @@
 ﻿#pragma once
 #ifndef _TREE_H
 #define _TREE_H
+#include <algorithm>
+#include <cstdint>
 
+//BST使用的节点(AVL、红黑树和伸展树有各自的节点类型AVLNode、RBTNode和SPLAYNode)
 template<class T>
 struct TreeNode
 {
 	T val;					//通用val
-	int height;				//AVL树使用
-	int color;				//红黑树使用
-	TreeNode<T>* parent;	//红黑树使用
+	uint32_t count;			//val重复的次数(BST中相等的值只保存一个节点)
 	TreeNode<T>* left;
 	TreeNode<T>* right;
 	TreeNode() = default;
-	TreeNode(T x) : val(x), height(0), color(0), left(nullptr), right(nullptr), parent(nullptr) {}
-	TreeNode(T x, TreeNode<T>* left, TreeNode<T>* right) : val(x), height(0), color(0), left(left), right(right), parent(nullptr) {}
+	TreeNode(T x) : val(x), count(1), left(nullptr), right(nullptr) {}
+	TreeNode(T x, TreeNode<T>* left, TreeNode<T>* right) : val(x), count(1), left(left), right(right) {}
 };
 
+//节点大小检查:count紧跟在val后面,只有4字节的val时count正好放进指针对齐留下的空隙,节点只比val多出两个指针;
+//8字节对齐的val时count单独占一个8字节的位置(其中4字节是填充),64位下TreeNode<long long>为32字节,没有count时只要24字节
+static_assert(sizeof(TreeNode<int>) == 2 * sizeof(int) + 2 * sizeof(void*), "TreeNode<int>: val + count + 2 links");
+static_assert(sizeof(void*) != 8 || sizeof(TreeNode<long long>) == 32, "TreeNode<long long>: val + count (padded to 8) + 2 links");
+
 template<class T>
 class Tree
 {
@@ -91,7 +97,7 @@ template<class T>
 int Tree<T>::get_Height_Help(TreeNode<T>* root)const
 {
 	if (root == nullptr) { return 0; }
-	return max(get_Height_Help(root->left), get_Height_Help(root->right)) + 1;
+	return std::max(get_Height_Help(root->left), get_Height_Help(root->right)) + 1;
 }
 
 
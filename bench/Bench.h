@@ -0,0 +1,45 @@
+﻿#pragma once
+#ifndef BENCH_H
+#define BENCH_H
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+//基准程序共用的小工具:计时、启动多个线程、每个线程独立的随机数
+
+//xorshift64*随机数(每个线程一个,避免共享rand()的状态)
+struct BenchRandom
+{
+	uint64_t state;
+	explicit BenchRandom(uint64_t seed) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+	uint64_t Next()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1Dull;
+	}
+	//[0, n)中的随机数
+	uint64_t Below(uint64_t n) { return Next() % n; }
+};
+
+//当前时间(秒)
+inline double BenchSeconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//启动threads个线程同时执行body(线程编号),返回从全部启动到全部结束的秒数
+template<class Body>
+double BenchRunThreads(int threads, Body body)
+{
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	double start = BenchSeconds();
+	for (int i = 0; i < threads; i++) { workers.emplace_back(body, i); }
+	for (std::thread& worker : workers) { worker.join(); }
+	return BenchSeconds() - start;
+}
+
+#endif // !BENCH_H
@@ -0,0 +1,182 @@
+﻿//AVL插入和删除的两种实现的对比:
+//递归版本(改成迭代之前的实现):回溯时每一层都重新写回子节点指针,有两个子节点的删除先找前驱/后继,交换键值后再递归删除
+//当前的迭代版本(AVL::Insert/Delete):子树高度不再变化时停止回溯,替换节点直接换到被删除节点的位置
+//统计每次操作的旋转次数、节点写入次数(setLeft/setRight/setBalance,递归版本交换键值算两次写入)和耗时
+//编译: g++ -std=c++17 -O2 -I.. avl_rotations_writes.cpp -o avl_rotations_writes
+//运行: ./avl_rotations_writes [key的个数]
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Bench.h"
+
+//AVLTree.h中的计数钩子
+struct AVLCounters
+{
+	static inline long writes = 0;
+	static inline long rotations = 0;
+};
+#define AVL_COUNT(counter) (++AVLCounters::counter)
+#include "AVLTree.h"
+
+using Tree = AVL<int, int>;
+using Node = AVLNode<int, int>;
+
+//AVL把TreeTestAccess声明为友元,测试程序在tests/TreeCheck.h中定义它;
+//本程序不包含测试的头文件,自己定义它,递归版本作为它的成员调用AVL私有的旋转和调整函数
+struct TreeTestAccess
+{
+	static Node*& root(Tree& tree) { return tree.root; }
+	static int nodeSize(const Tree& tree) { return tree.NodeSize; }
+	static Node* OldInsertNode(Tree& tree, Node* node, int key, bool& grown);
+	static Node* OldDeleteNode(Tree& tree, Node* node, int key, bool& shrunk);
+};
+
+//递归版本的插入
+Node* TreeTestAccess::OldInsertNode(Tree& tree, Node* node, int key, bool& grown)
+{
+	if (node == nullptr)
+	{
+		tree.NodeSize++;
+		grown = true;
+		return tree.CreateNode(key, key);
+	}
+	if (key < node->key)
+	{
+		node->setLeft(OldInsertNode(tree, node->left(), key, grown));
+		if (grown) { node = tree.LeftGrown(node, grown); }
+	}
+	else if (node->key < key)
+	{
+		node->setRight(OldInsertNode(tree, node->right(), key, grown));
+		if (grown) { node = tree.RightGrown(node, grown); }
+	}
+	else
+	{
+		grown = false;
+	}
+	Tree::Update(node);
+	return node;
+}
+
+//递归版本的删除
+Node* TreeTestAccess::OldDeleteNode(Tree& tree, Node* node, int key, bool& shrunk)
+{
+	if (node == nullptr)
+	{
+		shrunk = false;
+		return node;
+	}
+	if (key < node->key)
+	{
+		node->setLeft(OldDeleteNode(tree, node->left(), key, shrunk));
+		if (shrunk) { node = tree.LeftShrunk(node, shrunk); }
+	}
+	else if (node->key < key)
+	{
+		node->setRight(OldDeleteNode(tree, node->right(), key, shrunk));
+		if (shrunk) { node = tree.RightShrunk(node, shrunk); }
+	}
+	else if (node->left() == nullptr || node->right() == nullptr)
+	{
+		Node* child = node->left() != nullptr ? node->left() : node->right();
+		tree.DestroyNode(node);
+		tree.NodeSize--;
+		shrunk = true;
+		return child;
+	}
+	else if (node->balance() < 0)
+	{
+		//和前驱交换键值,再从左子树中删除
+		Node* preNode = tree.FindMaxNode(node->left());
+		std::swap(node->key, preNode->key);
+		std::swap(node->val, preNode->val);
+		AVLCounters::writes += 2;
+		node->setLeft(OldDeleteNode(tree, node->left(), preNode->key, shrunk));
+		if (shrunk) { node = tree.LeftShrunk(node, shrunk); }
+	}
+	else
+	{
+		//和后继交换键值,再从右子树中删除
+		Node* nextNode = tree.FindMinNode(node->right());
+		std::swap(node->key, nextNode->key);
+		std::swap(node->val, nextNode->val);
+		AVLCounters::writes += 2;
+		node->setRight(OldDeleteNode(tree, node->right(), nextNode->key, shrunk));
+		if (shrunk) { node = tree.RightShrunk(node, shrunk); }
+	}
+	Tree::Update(node);
+	return node;
+}
+
+//一组操作的统计结果(每次操作的平均值)
+struct Result
+{
+	double rotations;
+	double writes;
+	double ns;
+};
+
+//对keys中的每个key调用op(key)
+template<class Op>
+Result Measure(const std::vector<int>& keys, Op op)
+{
+	AVLCounters::writes = 0;
+	AVLCounters::rotations = 0;
+	double start = BenchSeconds();
+	for (int key : keys) { op(key); }
+	double seconds = BenchSeconds() - start;
+	double count = double(keys.size());
+	return { AVLCounters::rotations / count, AVLCounters::writes / count, seconds * 1e9 / count };
+}
+
+void Print(const char* name, const Result& before, const Result& after)
+{
+	std::printf("%-15s %6.3f -> %6.3f  %6.1f -> %6.1f  %7.0f -> %7.0f\n",
+		name, before.rotations, after.rotations, before.writes, after.writes, before.ns, after.ns);
+}
+
+//按insertOrder插入全部key,再按deleteOrder全部删除
+void Run(const char* insertName, const char* deleteName, const std::vector<int>& insertOrder, const std::vector<int>& deleteOrder)
+{
+	Tree oldTree;
+	Tree newTree;
+	Result oldInsert = Measure(insertOrder, [&oldTree](int key)
+	{
+		bool grown = false;
+		TreeTestAccess::root(oldTree) = TreeTestAccess::OldInsertNode(oldTree, TreeTestAccess::root(oldTree), key, grown);
+	});
+	Result newInsert = Measure(insertOrder, [&newTree](int key) { newTree.Insert(key, key); });
+	if (TreeTestAccess::nodeSize(oldTree) != TreeTestAccess::nodeSize(newTree) || oldTree.GetHeight() != newTree.GetHeight()) { std::printf("trees differ after insert\n"); }
+	Result oldDelete = Measure(deleteOrder, [&oldTree](int key)
+	{
+		bool shrunk = false;
+		TreeTestAccess::root(oldTree) = TreeTestAccess::OldDeleteNode(oldTree, TreeTestAccess::root(oldTree), key, shrunk);
+	});
+	Result newDelete = Measure(deleteOrder, [&newTree](int key) { newTree.Delete(key); });
+	if (TreeTestAccess::nodeSize(oldTree) != 0 || TreeTestAccess::nodeSize(newTree) != 0) { std::printf("trees not empty after delete\n"); }
+	Print(insertName, oldInsert, newInsert);
+	Print(deleteName, oldDelete, newDelete);
+}
+
+int main(int argc, char* argv[])
+{
+	int count = argc > 1 ? std::atoi(argv[1]) : 1 << 20;
+	std::vector<int> sorted(count);
+	for (int i = 0; i < count; i++) { sorted[i] = i; }
+	std::vector<int> shuffled = sorted;
+	BenchRandom random(1);
+	for (int i = count - 1; i > 0; i--) { std::swap(shuffled[i], shuffled[random.Below(i + 1)]); }
+	std::vector<int> deleteOrder = sorted;
+	for (int i = count - 1; i > 0; i--) { std::swap(deleteOrder[i], deleteOrder[random.Below(i + 1)]); }
+
+	std::printf("%d int keys, per operation, recursive -> iterative\n", count);
+	std::printf("                rotations         node writes       ns\n");
+	Run("random insert", "random delete", shuffled, deleteOrder);
+	Run("sorted insert", "sorted delete", sorted, sorted);
+	return 0;
+}
@@ -0,0 +1,104 @@
+﻿//只读负载下三种加锁方式的扩展性:std::mutex、std::shared_mutex和ConcurrentRBT(写优先的ReadWriteLock)
+//每个线程在KeyRange个key上做随机Search,总查找次数固定;最后测量4个读线程持续运行时1000次Insert的耗时(检查写者是否被饿死)
+//编译: g++ -std=c++17 -O2 -pthread -I.. concurrent_read_scaling.cpp -o concurrent_read_scaling
+//运行: ./concurrent_read_scaling [最大线程数]
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <shared_mutex>
+#include "Bench.h"
+#include "ConcurrentRBT.h"
+
+static const int KeyRange = 1 << 19;
+static const long TotalOps = 2000000;
+
+//用Lock保护的RBT,读取时用ReadGuard加锁
+template<class Lock, template<class> class ReadGuard>
+struct LockedRBT
+{
+	mutable Lock lock;
+	RBT<int, int> tree;
+	void Insert(int key, int val)
+	{
+		std::unique_lock<Lock> guard(lock);
+		tree.Insert(key, val);
+	}
+	bool Search(int key) const
+	{
+		ReadGuard<Lock> guard(lock);
+		return tree.Search(key);
+	}
+};
+using MutexRBT = LockedRBT<std::mutex, std::lock_guard>;
+using SharedMutexRBT = LockedRBT<std::shared_mutex, std::shared_lock>;
+
+//插入[0, KeyRange)中的偶数
+template<class Map>
+void Fill(Map& map)
+{
+	for (int key = 0; key < KeyRange; key += 2) { map.Insert(key, key); }
+}
+
+//threads个线程做TotalOps次随机查找,返回每秒百万次查找
+template<class Map>
+double ReadScaling(const Map& map, int threads)
+{
+	long perThread = TotalOps / threads;
+	double seconds = BenchRunThreads(threads, [&map, perThread](int id)
+	{
+		BenchRandom random(id + 1);
+		long found = 0;
+		for (long i = 0; i < perThread; i++) { found += map.Search(int(random.Below(KeyRange))); }
+		//防止查找被优化掉
+		if (found < 0) { std::printf("%ld\n", found); }
+	});
+	return perThread * threads / seconds / 1e6;
+}
+
+//readers个读线程持续查找时,一个写者完成1000次Insert的毫秒数
+template<class Map>
+double WriterLatency(Map& map, int readers)
+{
+	std::atomic<bool> stop{ false };
+	double milliseconds = 0;
+	BenchRunThreads(readers + 1, [&](int id)
+	{
+		if (id == readers)
+		{
+			double start = BenchSeconds();
+			for (int i = 0; i < 1000; i++) { map.Insert(2 * i + 1, i); }
+			milliseconds = (BenchSeconds() - start) * 1e3;
+			stop.store(true);
+			return;
+		}
+		BenchRandom random(id + 1);
+		long found = 0;
+		while (!stop.load(std::memory_order_relaxed)) { found += map.Search(int(random.Below(KeyRange))); }
+		if (found < 0) { std::printf("%ld\n", found); }
+	});
+	return milliseconds;
+}
+
+int main(int argc, char* argv[])
+{
+	int maxThreads = argc > 1 ? std::atoi(argv[1]) : 8;
+	MutexRBT mutexMap;
+	SharedMutexRBT sharedMap;
+	ConcurrentRBT<int, int> concurrentMap;
+	Fill(mutexMap);
+	Fill(sharedMap);
+	Fill(concurrentMap);
+	std::printf("random Search on %d keys, %ld lookups, hardware threads: %u\n", KeyRange / 2, TotalOps, std::thread::hardware_concurrency());
+	std::printf("threads  mutex  shared_mutex  ConcurrentRBT   (M lookups/s)\n");
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		double a = ReadScaling(mutexMap, threads);
+		double b = ReadScaling(sharedMap, threads);
+		double c = ReadScaling(concurrentMap, threads);
+		std::printf("%7d  %5.2f  %12.2f  %13.2f\n", threads, a, b, c);
+	}
+	//std::shared_mutex在glibc上读优先,写者可能长时间拿不到锁,所以只测ConcurrentRBT
+	std::printf("1000 Insert with 4 readers running: ConcurrentRBT %.1f ms\n", WriterLatency(concurrentMap, 4));
+	return 0;
+}
@@ -0,0 +1,69 @@
+﻿//FlatCombiningRBT和用一把std::mutex保护的RBT的吞吐量对比
+//每个线程做一半Insert、一半Search(比例可以用第一个参数修改),key在[0, KeyRange)中均匀随机,总操作数固定
+//编译: g++ -std=c++17 -O2 -pthread -I.. flat_combining_vs_mutex.cpp -o flat_combining_vs_mutex
+//运行: ./flat_combining_vs_mutex [写操作的百分比] [最大线程数]
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include "Bench.h"
+#include "FlatCombiningRBT.h"
+
+static const int KeyRange = 100000;
+static const long TotalOps = 400000;
+
+//每次操作加一次锁的RBT
+struct MutexRBT
+{
+	std::mutex lock;
+	RBT<int, int> tree;
+	void Insert(int key, int val)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		tree.Insert(key, val);
+	}
+	bool Search(int key)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		return tree.Search(key);
+	}
+};
+
+//threads个线程在map上执行TotalOps次操作,返回每秒百万次操作
+template<class Map>
+double Run(Map& map, int threads, int writePercent)
+{
+	for (int key = 0; key < KeyRange; key += 2) { map.Insert(key, key); }
+	long perThread = TotalOps / threads;
+	double seconds = BenchRunThreads(threads, [&map, perThread, writePercent](int id)
+	{
+		BenchRandom random(id + 1);
+		long found = 0;
+		for (long i = 0; i < perThread; i++)
+		{
+			int key = int(random.Below(KeyRange));
+			if (int(random.Below(100)) < writePercent) { map.Insert(key, key); }
+			else { found += map.Search(key); }
+		}
+		//防止查找被优化掉
+		if (found < 0) { std::printf("%ld\n", found); }
+	});
+	return perThread * threads / seconds / 1e6;
+}
+
+int main(int argc, char* argv[])
+{
+	int writePercent = argc > 1 ? std::atoi(argv[1]) : 50;
+	int maxThreads = argc > 2 ? std::atoi(argv[2]) : 8;
+	std::printf("%d%% Insert, %d%% Search, %d keys, %ld ops, hardware threads: %u\n",
+		writePercent, 100 - writePercent, KeyRange, TotalOps, std::thread::hardware_concurrency());
+	std::printf("threads  flat-combining  mutex      (Mops/s)\n");
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		FlatCombiningRBT<int, int> combining;
+		MutexRBT locked;
+		double a = Run(combining, threads, writePercent);
+		double b = Run(locked, threads, writePercent);
+		std::printf("%7d  %14.2f  %9.2f\n", threads, a, b);
+	}
+	return 0;
+}
@@ -0,0 +1,139 @@
+﻿#pragma once
+#ifndef TREECHECK_H
+#define TREECHECK_H
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//测试共用的结构检查,参数为树的根节点(由TreeTestAccess取得)
+//违反时直接assert失败,测试程序需要在没有定义NDEBUG的情况下编译
+
+//测试程序访问树的内部状态的唯一入口,各个树的头文件把它声明为友元
+//成员按名字取出,不存在这个成员的树只要不调用对应的函数就不会实例化
+struct TreeTestAccess
+{
+	//根节点、节点数、节点分配器、比较器
+	template<class Tree> static auto& root(Tree& tree) { return tree.root; }
+	template<class Tree> static auto& nodeSize(Tree& tree) { return tree.NodeSize; }
+	template<class Tree> static auto& alloc(Tree& tree) { return tree.alloc; }
+	template<class Tree> static auto& comp(Tree& tree) { return tree.comp; }
+	//BPlusTree:层数、叶子链表的两端、节点类型、非根节点最少的键数
+	template<class Tree> static auto& height(Tree& tree) { return tree.height; }
+	template<class Tree> static auto& head(Tree& tree) { return tree.head; }
+	template<class Tree> static auto& tail(Tree& tree) { return tree.tail; }
+	//(别名模板直接写Tree::Leaf时GCC在使用处检查访问权限,所以经过一层类模板)
+	template<class Tree> struct LeafType { using type = typename Tree::Leaf; };
+	template<class Tree> struct InnerType { using type = typename Tree::Inner; };
+	template<class Tree> using Leaf = typename LeafType<Tree>::type;
+	template<class Tree> using Inner = typename InnerType<Tree>::type;
+	template<class Tree> static constexpr int minLeaf() { return Tree::MinLeaf; }
+	template<class Tree> static constexpr int minInner() { return Tree::MinInner; }
+	//ARTree:带标记的子节点引用和节点类型
+	template<class Tree> struct NodeTypeOf { using type = typename Tree::NodeType; };
+	template<class Tree> using NodeType = typename NodeTypeOf<Tree>::type;
+	template<class Tree> static bool IsLeaf(uintptr_t ref) { return Tree::IsLeaf(ref); }
+	template<class Tree> static auto LeafOf(uintptr_t ref) { return Tree::LeafOf(ref); }
+	template<class Tree> static auto NodeOf(uintptr_t ref) { return Tree::NodeOf(ref); }
+	template<class Tree, class Node, class Visitor> static bool ForEachChild(Node* node, Visitor visitor) { return Tree::ForEachChild(node, visitor); }
+	//FrozenTree:按Eytzinger顺序存放的key和val
+	template<class Tree> static auto& keys(Tree& tree) { return tree.keys; }
+	template<class Tree> static auto& vals(Tree& tree) { return tree.vals; }
+	//IndexRBT/IndexAVL:存放所有节点的vector
+	template<class Tree> static auto& nodes(Tree& tree) { return tree.nodes; }
+	//RCUMap:等待释放的节点、触发回收的数量
+	template<class Tree> static auto& retired(Tree& tree) { return tree.retired; }
+	template<class Tree> static constexpr size_t collectThreshold() { return Tree::CollectThreshold; }
+	//ShardedMap:分片和分割点
+	template<class Tree> static auto& shards(Tree& tree) { return tree.shards; }
+	template<class Tree> static auto& splits(Tree& tree) { return tree.splits; }
+};
+
+//红黑树:父节点指针正确,红节点的子节点都是黑色,每条路径上的黑节点数相同;返回黑高
+template<class Node>
+int CheckRBNode(const Node* node, const Node* parent)
+{
+	if (node == nullptr) { return 1; }
+	assert(node->parent() == parent);
+	if (node->color() == 0)
+	{
+		assert(node->left == nullptr || node->left->color() == 1);
+		assert(node->right == nullptr || node->right->color() == 1);
+	}
+	int leftHeight = CheckRBNode(node->left, node);
+	int rightHeight = CheckRBNode(node->right, node);
+	assert(leftHeight == rightHeight);
+	return leftHeight + node->color();
+}
+
+//整棵红黑树:根为黑色,再检查所有节点
+template<class Node>
+void CheckRB(const Node* root)
+{
+	assert(root == nullptr || root->color() == 1);
+	CheckRBNode(root, static_cast<const Node*>(nullptr));
+}
+
+//AVL:平衡因子等于右子树高度-左子树高度,并且在[-1, 1]中;返回高度
+template<class Node>
+int CheckAVL(const Node* node)
+{
+	if (node == nullptr) { return 0; }
+	int leftHeight = CheckAVL(node->left());
+	int rightHeight = CheckAVL(node->right());
+	assert(node->balance() == rightHeight - leftHeight);
+	assert(node->balance() >= -1 && node->balance() <= 1);
+	return (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+}
+
+//路径复制的AVL(RCUNode、PersistentNode):height等于子树高度,左右子树的高度差不超过1;返回高度
+template<class Node>
+int CheckHeights(const Node* node)
+{
+	if (node == nullptr) { return 0; }
+	int leftHeight = CheckHeights(node->left);
+	int rightHeight = CheckHeights(node->right);
+	assert(leftHeight - rightHeight >= -1 && leftHeight - rightHeight <= 1);
+	assert(node->height == (leftHeight > rightHeight ? leftHeight : rightHeight) + 1);
+	return node->height;
+}
+
+//OrderStatistic的聚合值等于子树大小;返回子树大小(Left、Right取出左右子节点,兼容RBTNode和AVLNode)
+template<class Node, class Left, class Right>
+size_t CheckSizes(const Node* node, Left left, Right right)
+{
+	if (node == nullptr) { return 0; }
+	size_t size = CheckSizes(left(node), left, right) + 1 + CheckSizes(right(node), left, right);
+	assert(node->agg == size);
+	return size;
+}
+
+//聚合值等于子树中所有Augment::lift(key, val)的合并;返回子树的聚合值
+template<class Augment, class Node, class Left, class Right>
+typename Augment::value_type CheckAggregate(const Node* node, Left left, Right right)
+{
+	if (node == nullptr) { return Augment::identity(); }
+	typename Augment::value_type value = CheckAggregate<Augment>(left(node), left, right);
+	value = Augment::combine(value, Augment::lift(node->key, node->val));
+	value = Augment::combine(value, CheckAggregate<Augment>(right(node), left, right));
+	assert(node->agg == value);
+	return value;
+}
+
+//按中序遍历收集(key, val),和期望的有序表逐个比较
+template<class Tree, class Map>
+void CheckSameAsMap(Tree& tree, const Map& expected)
+{
+	std::vector<std::pair<typename Map::key_type, typename Map::mapped_type>> items;
+	tree.inOrder([&items](const auto* node) { items.emplace_back(node->key, node->val); });
+	assert(items.size() == expected.size());
+	size_t i = 0;
+	for (const auto& item : expected)
+	{
+		assert(items[i].first == item.first && items[i].second == item.second);
+		i++;
+	}
+}
+
+#endif // !TREECHECK_H
@@ -0,0 +1,141 @@
+﻿//SumAggregate/MinAggregate/MaxAggregate的reduce测试:RBT和AVL随机插入、更新、删除(以及顺序插入/删除引起的连续旋转)之后,
+//对随机的[lo, hi)(包括空区间、lo不在hi之前、超出所有key的端点)比较reduce(lo, hi)和std::map上的逐个合并,
+//reduce()等于所有节点的合并,每个节点的聚合值等于它的子树的合并;通过节点指针修改val并refresh(key)之后结果同样正确
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. aggregate_test.cpp -o aggregate_test
+#include <cassert>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <random>
+#include "RBTree.h"
+#include "AVLTree.h"
+#include "TreeCheck.h"
+
+//平衡性质和每个节点的聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+void CheckShape(const RBT<K, V, Compare, Alloc, Augment>& tree)
+{
+	using Node = RBTNode<K, V, Augment>;
+	CheckRB(TreeTestAccess::root(tree));
+	CheckAggregate<Augment>(TreeTestAccess::root(tree), [](const Node* node) { return node->left; }, [](const Node* node) { return node->right; });
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+void CheckShape(const AVL<K, V, Compare, Alloc, Augment>& tree)
+{
+	using Node = AVLNode<K, V, Augment>;
+	CheckAVL(TreeTestAccess::root(tree));
+	CheckAggregate<Augment>(TreeTestAccess::root(tree), [](const Node* node) { return node->left(); }, [](const Node* node) { return node->right(); });
+}
+
+//std::map中key在[lo, hi)的val逐个合并(lo不在hi之前时为单位元)
+template<class Augment, class Map>
+typename Augment::value_type Fold(const Map& expected, int lo, int hi)
+{
+	typename Augment::value_type value = Augment::identity();
+	if (expected.key_comp()(hi, lo)) { return value; }
+	for (auto it = expected.lower_bound(lo); it != expected.lower_bound(hi); ++it) { value = Augment::combine(value, Augment::lift(it->first, it->second)); }
+	return value;
+}
+
+template<class Augment, class Tree, class Map>
+void CheckReduce(const Tree& tree, const Map& expected, std::mt19937& random, int keyRange)
+{
+	assert(tree.reduce() == Fold<Augment>(expected, -1, keyRange));
+	for (int probe = 0; probe < 2; probe++)
+	{
+		int lo = int(random() % (keyRange + 20)) - 10;
+		int hi = int(random() % (keyRange + 20)) - 10;
+		assert(tree.reduce(lo, hi) == Fold<Augment>(expected, lo, hi));
+		assert(tree.reduce(lo, lo) == Augment::identity());
+		assert(tree.reduce(lo, lo + 1) == Fold<Augment>(expected, lo, lo + 1));
+	}
+}
+
+template<class Tree, class Augment>
+void RandomReduce(unsigned seed, int operations, int keyRange)
+{
+	std::mt19937 random(seed);
+	Tree tree;
+	std::map<int, int> expected;
+	for (int i = 0; i < operations; i++)
+	{
+		int key = int(random() % keyRange);
+		int val = int(random() % 2001) - 1000;
+		int op = int(random() % 4);
+		auto node = tree.GetNode(key);
+		if (op == 0)
+		{
+			tree.Delete(key);
+			expected.erase(key);
+		}
+		else if (op == 1 && node != nullptr)
+		{
+			//直接修改已有节点的val,再refresh
+			node->val = val;
+			tree.refresh(key);
+			expected[key] = val;
+		}
+		else
+		{
+			tree.Insert(key, val);
+			expected[key] = val;
+		}
+		CheckReduce<Augment>(tree, expected, random, keyRange);
+		if (i % 100 == 0) { CheckShape(tree); }
+	}
+	CheckShape(tree);
+}
+
+//顺序插入和删除:每一步都在同一侧旋转
+template<class Tree, class Augment>
+void SequentialReduce(int n)
+{
+	std::mt19937 random(n);
+	Tree tree;
+	std::map<int, int> expected;
+	for (int i = 0; i < n; i++)
+	{
+		tree.Insert(i, n - i);
+		expected[i] = n - i;
+		CheckReduce<Augment>(tree, expected, random, n);
+	}
+	CheckShape(tree);
+	//从两端交替删除
+	for (int i = 0; i < n / 2; i++)
+	{
+		tree.Delete(i);
+		expected.erase(i);
+		tree.Delete(n - 1 - i);
+		expected.erase(n - 1 - i);
+		CheckReduce<Augment>(tree, expected, random, n);
+	}
+	CheckShape(tree);
+	assert(tree.reduce() == Augment::identity());
+}
+
+template<class Augment>
+void AllTrees(unsigned seed)
+{
+	using R = RBT<int, int, std::less<int>, NodePool<std::pair<const int, int>>, Augment>;
+	using A = AVL<int, int, std::less<int>, NodePool<std::pair<const int, int>>, Augment>;
+	for (int keyRange : { 40, 2000 })
+	{
+		RandomReduce<R, Augment>(seed, 1500, keyRange);
+		RandomReduce<A, Augment>(seed, 1500, keyRange);
+	}
+	SequentialReduce<R, Augment>(500);
+	SequentialReduce<A, Augment>(500);
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 2; seed++)
+	{
+		AllTrees<SumAggregate<long long>>(seed);
+		AllTrees<MinAggregate<int>>(seed);
+		AllTrees<MaxAggregate<int>>(seed);
+	}
+	std::printf("aggregate_test passed\n");
+	return 0;
+}
@@ -0,0 +1,212 @@
+﻿//ARTree的测试:整数、负数和带0字节/长度超过ARTKeyBytes::InlineSize的字符串上随机的插入/删除,和std::map比较,
+//检查节点结构(子节点数和节点类型相符、只有一个子节点的节点被合并、前缀和分支字节与叶子的编码一致)
+//以及键编码的顺序和前缀性质;密集的key让节点一直长到Node256,再全部删除缩回去
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. art_tree_test.cpp -o art_tree_test
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ARTree.h"
+#include "TreeCheck.h"
+
+//编码后的字节串
+template<class K>
+std::string Encoded(const K& key)
+{
+	ARTKeyBytes bytes;
+	ARTKeyTraits<K>::Encode(key, bytes);
+	return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+//a<b时编码的字典序也更小,并且不是前缀
+template<class K>
+void CheckEncoding(const K& a, const K& b)
+{
+	std::string x = Encoded(a);
+	std::string y = Encoded(b);
+	if (a < b) { assert(x < y); }
+	else if (b < a) { assert(y < x); }
+	else { assert(x == y); }
+	if (!(a == b))
+	{
+		assert(x.compare(0, std::string::npos, y, 0, x.size()) != 0 || x.size() > y.size());
+		assert(y.compare(0, std::string::npos, x, 0, y.size()) != 0 || y.size() > x.size());
+	}
+}
+
+//检查以ref为根、位于编码第depth个字节的子树,叶子按顺序放进leaves
+template<class Tree>
+void CheckNode(uintptr_t ref, size_t depth, std::vector<std::string>& leaves)
+{
+	if (TreeTestAccess::IsLeaf<Tree>(ref))
+	{
+		leaves.push_back(Encoded(TreeTestAccess::LeafOf<Tree>(ref)->key));
+		assert(leaves.back().size() >= depth);
+		return;
+	}
+	using NodeType = TreeTestAccess::NodeType<Tree>;
+	ARTNode* node = TreeTestAccess::NodeOf<Tree>(ref);
+	size_t first = leaves.size();
+	size_t branch = depth + node->prefixLen;
+	int count = 0;
+	int last = -1;
+	TreeTestAccess::ForEachChild<Tree>(node, [&](unsigned char byte, uintptr_t child)
+	{
+		//子节点按字节递增访问,子树中所有叶子在分支位置上的字节都是byte
+		assert(int(byte) > last && child != 0);
+		last = byte;
+		count++;
+		size_t begin = leaves.size();
+		CheckNode<Tree>(child, branch + 1, leaves);
+		for (size_t i = begin; i < leaves.size(); i++) { assert(leaves[i].size() > branch && (unsigned char)leaves[i][branch] == byte); }
+		return true;
+	});
+	assert(count == node->count && count >= 2);
+	switch (node->type)
+	{
+	case NodeType::Type4: assert(count <= 4); break;
+	case NodeType::Type16: assert(count >= 4 && count <= 16); break;
+	case NodeType::Type48:
+	{
+		assert(count >= 13 && count <= 48);
+		//index指向的下标互不相同
+		bool used[48] = {};
+		ARTNode48* n = static_cast<ARTNode48*>(node);
+		for (int b = 0; b < 256; b++)
+		{
+			if (n->index[b] == 0) { continue; }
+			assert(n->index[b] <= 48 && !used[n->index[b] - 1]);
+			used[n->index[b] - 1] = true;
+		}
+		break;
+	}
+	default: assert(node->type == NodeType::Type256 && count >= 38); break;
+	}
+	//压缩的路径:子树中所有叶子在[depth, branch)上相同,保存的前MaxPrefix个字节和它们一致
+	const std::string& sample = leaves[first];
+	size_t stored = node->prefixLen < ARTNode::MaxPrefix ? node->prefixLen : ARTNode::MaxPrefix;
+	assert(std::memcmp(sample.data() + depth, node->prefix, stored) == 0);
+	for (size_t i = first + 1; i < leaves.size(); i++) { assert(leaves[i].compare(depth, node->prefixLen, sample, depth, node->prefixLen) == 0); }
+}
+
+template<class Tree, class Map>
+void CheckTree(const Tree& tree, const Map& expected)
+{
+	std::vector<std::string> leaves;
+	if (TreeTestAccess::root(tree) != 0) { CheckNode<Tree>(TreeTestAccess::root(tree), 0, leaves); }
+	assert(leaves.size() == expected.size() && tree.getNodeSize() == int(expected.size()));
+	for (size_t i = 1; i < leaves.size(); i++) { assert(leaves[i - 1] < leaves[i]); }
+	std::vector<std::pair<typename Map::key_type, int>> items;
+	tree.inOrder([&items](const auto* leaf) { items.emplace_back(leaf->key, leaf->val); });
+	assert(items == (std::vector<std::pair<typename Map::key_type, int>>(expected.begin(), expected.end())));
+	if (expected.empty()) { assert(tree.GetMinNode() == nullptr && tree.GetMaxNode() == nullptr); }
+	else
+	{
+		assert(tree.GetMinNode()->key == expected.begin()->first);
+		assert(tree.GetMaxNode()->key == expected.rbegin()->first);
+	}
+}
+
+template<class K, class Gen>
+void RandomOperations(unsigned seed, int operations, Gen gen)
+{
+	std::mt19937 random(seed);
+	ARTree<K, int> tree;
+	std::map<K, int> expected;
+	for (int i = 0; i < operations; i++)
+	{
+		K key = gen(random);
+		switch (random() % 5)
+		{
+		case 0:
+		case 1:
+			tree.Insert(key, i);
+			expected[key] = i;
+			break;
+		case 2:
+		{
+			auto result = tree.try_emplace(key, i);
+			assert(result.second == expected.emplace(key, i).second);
+			assert(result.first->key == key && result.first->val == expected[key]);
+			break;
+		}
+		default:
+			tree.Delete(key);
+			expected.erase(key);
+			break;
+		}
+		const auto* leaf = tree.GetNode(key);
+		assert(expected.count(key) ? leaf != nullptr && leaf->val == expected.at(key) : leaf == nullptr);
+		K other = gen(random);
+		assert(tree.Search(other) == (expected.count(other) != 0));
+		CheckEncoding(key, other);
+		if (i % 200 == 0)
+		{
+			CheckTree(tree, expected);
+			//range访问[lo, hi)
+			K lo = gen(random);
+			K hi = gen(random);
+			if (hi < lo) { std::swap(lo, hi); }
+			std::vector<std::pair<K, int>> items;
+			tree.range(lo, hi, [&items](const auto* item) { items.emplace_back(item->key, item->val); });
+			assert(items == (std::vector<std::pair<K, int>>(expected.lower_bound(lo), expected.lower_bound(hi))));
+		}
+	}
+	CheckTree(tree, expected);
+	//全部删除
+	for (const auto& item : expected) { tree.Delete(item.first); }
+	assert(tree.getNodeSize() == 0 && TreeTestAccess::root(tree) == 0);
+}
+
+//密集的key:低位字节取遍0..255,节点长到Node256;再按随机顺序删除,经过每一种缩小
+void DenseKeys()
+{
+	ARTree<unsigned, int> tree;
+	std::map<unsigned, int> expected;
+	std::vector<unsigned> keys;
+	for (unsigned i = 0; i < 40000; i++)
+	{
+		tree[i] = int(i);
+		expected[i] = int(i);
+		keys.push_back(i);
+	}
+	CheckTree(tree, expected);
+	assert(TreeTestAccess::NodeOf<decltype(tree)>(TreeTestAccess::root(tree))->type == TreeTestAccess::NodeType<decltype(tree)>::Type256);
+	std::mt19937 random(3);
+	std::shuffle(keys.begin(), keys.end(), random);
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		tree.Delete(keys[i]);
+		expected.erase(keys[i]);
+		if (i % 4000 == 0 || expected.size() < 100) { CheckTree(tree, expected); }
+	}
+	assert(TreeTestAccess::root(tree) == 0);
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 2; seed++)
+	{
+		RandomOperations<int>(seed, 10000, [](std::mt19937& random) { return int(random() % 5000) - 2500; });
+		RandomOperations<long long>(seed, 10000, [](std::mt19937& random) { return ((long long)(random() % 4000) - 2000) * (1LL << (random() % 40)); });
+		RandomOperations<unsigned long long>(seed, 10000, [](std::mt19937& random) { return (unsigned long long)random() << 20 ^ random() % 100; });
+		//短字符串互为前缀;长字符串超过ARTKeyBytes的内部存储,并且共享很长的前缀(超过MaxPrefix)
+		RandomOperations<std::string>(seed, 10000, [](std::mt19937& random)
+		{
+			std::string key;
+			bool isLong = random() % 4 == 0;
+			int length = isLong ? 60 + int(random() % 80) : int(random() % 8);
+			for (int i = 0; i < length; i++) { key += "ab\0c"[random() % 4]; }
+			if (isLong) { key.replace(0, 40, std::string(40, 'x')); }
+			return key;
+		});
+	}
+	DenseKeys();
+	std::printf("art_tree_test passed\n");
+	return 0;
+}
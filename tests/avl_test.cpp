@@ -0,0 +1,89 @@
+﻿//AVL插入和删除的回归测试:随机的Insert/Delete和std::map比较,每次修改后检查平衡因子、OrderStatistic的子树大小,
+//并检查删除有两个子节点的节点后,其他节点的地址不变(替换节点被移动到原位置,而不是交换键值)
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. avl_test.cpp -o avl_test
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+#include "AVLTree.h"
+#include "TreeCheck.h"
+
+using Tree = AVL<int, int, std::less<int>, NodePool<std::pair<const int, int>>, OrderStatistic>;
+using Node = AVLNode<int, int, OrderStatistic>;
+
+void CheckTree(Tree& tree, const std::map<int, int>& expected)
+{
+	CheckAVL(TreeTestAccess::root(tree));
+	CheckSizes(TreeTestAccess::root(tree), [](const Node* node) { return node->left(); }, [](const Node* node) { return node->right(); });
+	assert(TreeTestAccess::nodeSize(tree) == int(expected.size()));
+	CheckSameAsMap(tree, expected);
+}
+
+//每checkEvery次修改做一次完整检查
+void RandomOperations(unsigned seed, int keyRange, int operations, int checkEvery)
+{
+	std::mt19937 random(seed);
+	Tree tree;
+	std::map<int, int> expected;
+	std::map<int, const Node*> address;
+	for (int i = 0; i < operations; i++)
+	{
+		int key = int(random() % keyRange);
+		if (random() % 3 != 0)
+		{
+			tree.Insert(key, i);
+			expected[key] = i;
+			address[key] = tree.GetNode(key);
+		}
+		else
+		{
+			tree.Delete(key);
+			expected.erase(key);
+			address.erase(key);
+		}
+		if (i % checkEvery == 0) { CheckTree(tree, expected); }
+		//节点一旦插入,地址在删除之前保持不变
+		if (i % 64 == 0)
+		{
+			for (const auto& item : address) { assert(tree.GetNode(item.first) == item.second); }
+		}
+	}
+	CheckTree(tree, expected);
+}
+
+//顺序插入和删除(每次都在同一侧,旋转最多)
+void SortedOperations(int count)
+{
+	Tree tree;
+	std::map<int, int> expected;
+	for (int key = 0; key < count; key++)
+	{
+		tree.Insert(key, key);
+		expected[key] = key;
+	}
+	CheckTree(tree, expected);
+	for (int key = 0; key < count; key += 2)
+	{
+		tree.Delete(key);
+		expected.erase(key);
+	}
+	CheckTree(tree, expected);
+	for (int key = count - 1; key >= 0; key--)
+	{
+		tree.Delete(key);
+		expected.erase(key);
+	}
+	assert(TreeTestAccess::root(tree) == nullptr && TreeTestAccess::nodeSize(tree) == 0);
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 3; seed++) { RandomOperations(seed, 300, 10000, 1); }
+	RandomOperations(9, 5000, 30000, 97);
+	SortedOperations(10000);
+	std::printf("avl_test passed\n");
+	return 0;
+}
@@ -0,0 +1,148 @@
+﻿//RBT和AVL的有序查询的测试:随机的插入/删除之后,对随机的key(包括比所有key都小/大的)检查
+//lower_bound/upper_bound/floor/ceiling/predecessor/successor和std::map的结果一致,range(lo, hi)访问的节点和std::map的[lo, hi)相同
+//RBT还检查从lower_bound开始的正向/反向迭代;std::greater的树按比较器的顺序(key递减)回答同样的查询
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. bound_query_test.cpp -o bound_query_test
+#include <cassert>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "RBTree.h"
+#include "AVLTree.h"
+
+//RBT的lower_bound/upper_bound返回迭代器,AVL的直接返回节点;都转成节点(没有时为nullptr)
+template<class K, class V, class Compare, class Alloc, class Augment>
+const RBTNode<K, V, Augment>* LowerBound(const RBT<K, V, Compare, Alloc, Augment>& tree, const K& key)
+{
+	auto it = tree.lower_bound(key);
+	return it == tree.end() ? nullptr : &*it;
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+const RBTNode<K, V, Augment>* UpperBound(const RBT<K, V, Compare, Alloc, Augment>& tree, const K& key)
+{
+	auto it = tree.upper_bound(key);
+	return it == tree.end() ? nullptr : &*it;
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+const AVLNode<K, V, Augment>* LowerBound(const AVL<K, V, Compare, Alloc, Augment>& tree, const K& key) { return tree.lower_bound(key); }
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+const AVLNode<K, V, Augment>* UpperBound(const AVL<K, V, Compare, Alloc, Augment>& tree, const K& key) { return tree.upper_bound(key); }
+
+//node和it指向同一个键值(it为end()时node为nullptr)
+template<class Node, class Map>
+void CheckSame(const Node* node, typename Map::const_iterator it, const Map& expected)
+{
+	if (it == expected.end()) { assert(node == nullptr); }
+	else { assert(node != nullptr && node->key == it->first && node->val == it->second); }
+}
+
+//it的前一个位置,it为begin()时为end()
+template<class Map>
+typename Map::const_iterator Before(const Map& expected, typename Map::const_iterator it)
+{
+	return it == expected.begin() ? expected.end() : std::prev(it);
+}
+
+template<class Tree, class Map>
+void CheckBounds(const Tree& tree, const Map& expected, int key)
+{
+	auto lower = expected.lower_bound(key);
+	auto upper = expected.upper_bound(key);
+	CheckSame(LowerBound(tree, key), lower, expected);
+	CheckSame(UpperBound(tree, key), upper, expected);
+	CheckSame(tree.ceiling(key), lower, expected);
+	CheckSame(tree.successor(key), upper, expected);
+	CheckSame(tree.floor(key), Before(expected, upper), expected);
+	CheckSame(tree.predecessor(key), Before(expected, lower), expected);
+}
+
+//range(lo, hi)按比较器的顺序访问[lo, hi)中的节点(lo不在hi之前时为空)
+template<class Tree, class Map>
+void CheckRange(Tree& tree, const Map& expected, int lo, int hi)
+{
+	std::vector<std::pair<int, int>> items;
+	tree.range(lo, hi, [&items](const auto* node) { items.emplace_back(node->key, node->val); });
+	std::vector<std::pair<int, int>> want;
+	if (!expected.key_comp()(hi, lo)) { want.assign(expected.lower_bound(lo), expected.lower_bound(hi)); }
+	assert(items == want);
+}
+
+//RBT:从lower_bound(lo)正向走到lower_bound(hi),再反向走回来(AVL没有迭代器)
+template<class K, class V, class Compare, class Alloc, class Augment, class Map>
+void CheckIterators(const RBT<K, V, Compare, Alloc, Augment>& tree, const Map& expected, int lo, int hi)
+{
+	if (expected.key_comp()(hi, lo)) { return; }
+	std::vector<std::pair<int, int>> items;
+	for (auto it = tree.lower_bound(lo); it != tree.lower_bound(hi); ++it) { items.emplace_back(it->key, it->val); }
+	std::vector<std::pair<int, int>> want(expected.lower_bound(lo), expected.lower_bound(hi));
+	assert(items == want);
+	items.clear();
+	for (auto it = tree.lower_bound(hi); it != tree.lower_bound(lo);)
+	{
+		--it;
+		items.emplace_back(it->key, it->val);
+	}
+	assert((std::vector<std::pair<int, int>>(want.rbegin(), want.rend()) == items));
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment, class Map>
+void CheckIterators(const AVL<K, V, Compare, Alloc, Augment>&, const Map&, int, int) {}
+
+template<class Tree, class Map>
+void RandomQueries(unsigned seed, int operations, int keyRange)
+{
+	std::mt19937 random(seed);
+	Tree tree;
+	Map expected;
+	for (int i = 0; i < operations; i++)
+	{
+		int key = int(random() % keyRange);
+		if (random() % 3 == 0)
+		{
+			tree.Delete(key);
+			expected.erase(key);
+		}
+		else
+		{
+			tree.Insert(key, i);
+			expected[key] = i;
+		}
+		//探测的key可以比所有key都小或都大
+		for (int probe = 0; probe < 4; probe++) { CheckBounds(tree, expected, int(random() % (keyRange + 20)) - 10); }
+		if (i % 20 == 0)
+		{
+			int lo = int(random() % (keyRange + 20)) - 10;
+			int hi = int(random() % (keyRange + 20)) - 10;
+			CheckRange(tree, expected, lo, hi);
+			CheckRange(tree, expected, lo, lo);
+			CheckIterators(tree, expected, lo, hi);
+		}
+	}
+	//清空之后所有查询都没有结果
+	for (const auto& item : Map(expected)) { tree.Delete(item.first); }
+	expected.clear();
+	for (int key = -1; key <= keyRange; key += 7) { CheckBounds(tree, expected, key); }
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 3; seed++)
+	{
+		//key的范围有大有小:小的范围里探测的key经常命中,大的范围里经常落在两个key之间
+		for (int keyRange : { 50, 3000 })
+		{
+			RandomQueries<RBT<int, int>, std::map<int, int>>(seed, 3000, keyRange);
+			RandomQueries<AVL<int, int>, std::map<int, int>>(seed, 3000, keyRange);
+			RandomQueries<RBT<int, int, std::greater<int>>, std::map<int, int, std::greater<int>>>(seed, 2000, keyRange);
+			RandomQueries<AVL<int, int, std::greater<int>>, std::map<int, int, std::greater<int>>>(seed, 2000, keyRange);
+		}
+	}
+	std::printf("bound_query_test passed\n");
+	return 0;
+}
@@ -0,0 +1,262 @@
+﻿//BPlusTree的测试:随机的插入/删除和std::map比较,检查B+树的结构(所有叶子在同一层、非根节点的键数不少于一半(最右边的叶子除外)、
+//分隔键划分子树、叶子链表和head/tail一致),以及floor/ceiling/predecessor/successor/range/迭代器
+//用很小的NodeBytes让每个节点只有几个键,分裂、借键和合并都会频繁发生
+//插入时构造val抛出异常,空树不会留下空的根叶子
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. bplus_tree_test.cpp -o bplus_tree_test
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "BPlusTree.h"
+#include "TreeCheck.h"
+
+//检查以node为根、位于第depth层的子树,key都在[lo, hi)中(为nullptr时不限),叶子按顺序放进leaves;返回键值数
+template<class Key, class Tree>
+int CheckNode(const Tree& tree, const BPlusNodeBase* node, int depth, const Key* lo, const Key* hi, std::vector<const TreeTestAccess::Leaf<Tree>*>& leaves)
+{
+	bool isRoot = node == TreeTestAccess::root(tree);
+	if (node->leaf)
+	{
+		assert(depth == TreeTestAccess::height(tree));
+		const auto* leaf = static_cast<const TreeTestAccess::Leaf<Tree>*>(node);
+		//按key递增追加时最右边的叶子分裂后可以只有一个键(见InsertAt),其余非根叶子至少半满
+		assert(leaf->count <= Tree::LeafSlots && (isRoot || leaf == TreeTestAccess::tail(tree) ? leaf->count >= 1 : leaf->count >= TreeTestAccess::minLeaf<Tree>()));
+		for (int i = 0; i < leaf->count; i++)
+		{
+			if (i > 0) { assert(leaf->keys[i - 1] < leaf->keys[i]); }
+			if (lo != nullptr) { assert(!(leaf->keys[i] < *lo)); }
+			if (hi != nullptr) { assert(leaf->keys[i] < *hi); }
+		}
+		leaves.push_back(leaf);
+		return leaf->count;
+	}
+	const auto* inner = static_cast<const TreeTestAccess::Inner<Tree>*>(node);
+	assert(inner->count <= Tree::InnerSlots && (isRoot ? inner->count >= 1 : inner->count >= TreeTestAccess::minInner<Tree>()));
+	int total = 0;
+	for (int i = 0; i <= inner->count; i++)
+	{
+		if (i > 0 && i < inner->count) { assert(inner->keys[i - 1] < inner->keys[i]); }
+		const auto* childLo = i == 0 ? lo : &inner->keys[i - 1];
+		const auto* childHi = i == inner->count ? hi : &inner->keys[i];
+		total += CheckNode(tree, inner->children[i], depth + 1, childLo, childHi, leaves);
+	}
+	return total;
+}
+
+template<class Key, class Tree>
+void CheckTree(const Tree& tree)
+{
+	if (TreeTestAccess::root(tree) == nullptr)
+	{
+		assert(TreeTestAccess::height(tree) == 0 && TreeTestAccess::nodeSize(tree) == 0 && TreeTestAccess::head(tree) == nullptr && TreeTestAccess::tail(tree) == nullptr);
+		return;
+	}
+	std::vector<const TreeTestAccess::Leaf<Tree>*> leaves;
+	assert(CheckNode<Key>(tree, TreeTestAccess::root(tree), 1, nullptr, nullptr, leaves) == TreeTestAccess::nodeSize(tree));
+	//叶子链表和树中的叶子顺序相同
+	assert(leaves.front() == TreeTestAccess::head(tree) && leaves.back() == TreeTestAccess::tail(tree));
+	assert(TreeTestAccess::head(tree)->prev == nullptr && TreeTestAccess::tail(tree)->next == nullptr);
+	for (size_t i = 0; i + 1 < leaves.size(); i++) { assert(leaves[i]->next == leaves[i + 1] && leaves[i + 1]->prev == leaves[i]); }
+}
+
+template<class Tree, class Map>
+void CheckQueries(const Tree& tree, const Map& expected, const typename Map::key_type& key)
+{
+	auto floor = tree.floor(key);
+	auto it = expected.upper_bound(key);
+	if (it == expected.begin()) { assert(floor == nullptr); }
+	else { assert(floor != nullptr && floor->key == std::prev(it)->first); }
+	auto ceiling = tree.ceiling(key);
+	it = expected.lower_bound(key);
+	if (it == expected.end()) { assert(ceiling == nullptr); }
+	else { assert(ceiling != nullptr && ceiling->key == it->first && ceiling->val == it->second); }
+	auto predecessor = tree.predecessor(key);
+	if (it == expected.begin()) { assert(predecessor == nullptr); }
+	else { assert(predecessor != nullptr && predecessor->key == std::prev(it)->first); }
+	auto successor = tree.successor(key);
+	it = expected.upper_bound(key);
+	if (it == expected.end()) { assert(successor == nullptr); }
+	else { assert(successor != nullptr && successor->key == it->first); }
+}
+
+template<class Tree, class Map>
+void CheckContents(const Tree& tree, const Map& expected)
+{
+	using Item = std::pair<typename Map::key_type, typename Map::mapped_type>;
+	std::vector<Item> items;
+	tree.inOrder([&items](auto ref) { items.emplace_back(ref->key, ref->val); });
+	std::vector<Item> want(expected.begin(), expected.end());
+	assert(items == want);
+	//迭代器正向和反向
+	items.clear();
+	for (auto it = tree.begin(); it != tree.end(); ++it) { items.emplace_back(it->key, it->val); }
+	assert(items == want);
+	items.clear();
+	for (auto it = tree.end(); it != tree.begin();)
+	{
+		--it;
+		items.emplace_back(it->key, it->val);
+	}
+	assert(std::vector<Item>(want.rbegin(), want.rend()) == items);
+}
+
+template<class Key, size_t NodeBytes, class Gen>
+void RandomOperations(unsigned seed, int operations, Gen gen)
+{
+	using Tree = BPlusTree<Key, int, std::less<Key>, NodePool<std::pair<const Key, int>>, NodeBytes>;
+	std::mt19937 random(seed);
+	Tree tree;
+	std::map<Key, int> expected;
+	for (int i = 0; i < operations; i++)
+	{
+		Key key = gen(random);
+		switch (random() % 5)
+		{
+		case 0:
+		case 1:
+			tree.Insert(key, i);
+			expected[key] = i;
+			break;
+		case 2:
+			tree[key] += 1;
+			expected[key] += 1;
+			break;
+		default:
+			assert(tree.Delete(key) == (expected.erase(key) != 0));
+			break;
+		}
+		assert(tree.Search(key) == (expected.count(key) != 0));
+		CheckQueries(tree, expected, gen(random));
+		CheckTree<Key>(tree);
+		if (i % 50 == 0)
+		{
+			CheckContents(tree, expected);
+			//range访问[lo, hi)
+			Key lo = gen(random);
+			Key hi = gen(random);
+			if (hi < lo) { std::swap(lo, hi); }
+			std::vector<std::pair<Key, int>> items;
+			tree.range(lo, hi, [&items](auto ref) { items.emplace_back(ref->key, ref->val); });
+			assert(items == (std::vector<std::pair<Key, int>>(expected.lower_bound(lo), expected.lower_bound(hi))));
+		}
+	}
+	CheckContents(tree, expected);
+	//全部删除
+	for (const auto& item : expected)
+	{
+		assert(tree.Delete(item.first));
+		CheckTree<Key>(tree);
+	}
+	assert(tree.getNodeSize() == 0 && tree.GetHeight() == 0);
+}
+
+//按key递增插入:除了最右边的叶子都是满的;再按key递增和递减删除
+template<size_t NodeBytes>
+void SortedOperations(int count)
+{
+	using Tree = BPlusTree<int, int, std::less<int>, NodePool<std::pair<const int, int>>, NodeBytes>;
+	for (int reverse = 0; reverse < 2; reverse++)
+	{
+		Tree tree;
+		std::map<int, int> expected;
+		for (int i = 0; i < count; i++)
+		{
+			tree.Insert(i, -i);
+			expected[i] = -i;
+			CheckTree<int>(tree);
+		}
+		CheckContents(tree, expected);
+		for (const TreeTestAccess::Leaf<Tree>* leaf = TreeTestAccess::head(tree); leaf != TreeTestAccess::tail(tree); leaf = leaf->next) { assert(leaf->count == Tree::LeafSlots); }
+		for (int i = 0; i < count; i++)
+		{
+			int key = reverse ? count - 1 - i : i;
+			assert(tree.Delete(key));
+			expected.erase(key);
+			CheckTree<int>(tree);
+			if (i % 64 == 0) { CheckContents(tree, expected); }
+		}
+		assert(tree.getNodeSize() == 0 && tree.GetHeight() == 0);
+	}
+}
+
+//从负数构造或拷贝时抛出异常的val
+struct Fragile
+{
+	int value;
+	Fragile() : value(0) {}
+	Fragile(int value) : value(value)
+	{
+		if (value < 0) { throw std::runtime_error("construct"); }
+	}
+	Fragile(const Fragile& other) : value(other.value)
+	{
+		if (value < 0) { throw std::runtime_error("copy"); }
+	}
+	Fragile& operator=(const Fragile& other) = default;
+};
+
+//插入时构造val抛出异常:空树保持为空(没有留下空的根叶子),非空的树内容不变
+void ThrowingInsert()
+{
+	using Tree = BPlusTree<int, Fragile, std::less<int>, NodePool<std::pair<const int, Fragile>>, 64>;
+	Tree tree;
+	Fragile bad;
+	bad.value = -1;
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		bool thrown = false;
+		try
+		{
+			if (attempt == 0) { tree.try_emplace(1, -1); }
+			else { tree.insert_or_assign(1, bad); }
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		assert(thrown && tree.getNodeSize() == 0 && tree.GetHeight() == 0);
+		assert(TreeTestAccess::root(tree) == nullptr && TreeTestAccess::head(tree) == nullptr && TreeTestAccess::tail(tree) == nullptr);
+		assert(tree.GetMinNode() == nullptr && tree.GetMaxNode() == nullptr && tree.begin() == tree.end());
+		CheckTree<int>(tree);
+	}
+	for (int i = 0; i < 100; i++) { assert(tree.try_emplace(i, i).second); }
+	bool thrown = false;
+	try
+	{
+		tree.try_emplace(1000, -1);
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	assert(thrown && tree.getNodeSize() == 100 && tree.GetMaxNode()->key == 99);
+	CheckTree<int>(tree);
+	//空树插入成功后和正常的树一样
+	Tree single;
+	assert(single.insert_or_assign(5, Fragile(5)).second && single.getNodeSize() == 1);
+	assert(single.GetMinNode()->key == 5 && single.GetMaxNode()->key == 5);
+	CheckTree<int>(single);
+}
+
+int main()
+{
+	auto smallInt = [](std::mt19937& random) { return int(random() % 600); };
+	auto wideInt = [](std::mt19937& random) { return (long long)(random() % 3000) * 1000003LL - 800000000LL; };
+	auto text = [](std::mt19937& random) { return std::to_string(random() % 600); };
+	for (unsigned seed = 1; seed <= 2; seed++)
+	{
+		RandomOperations<int, 64>(seed, 8000, smallInt);
+		RandomOperations<int, 256>(seed, 8000, smallInt);
+		RandomOperations<long long, 96>(seed, 8000, wideInt);
+		RandomOperations<std::string, 128>(seed, 5000, text);
+	}
+	SortedOperations<64>(2000);
+	SortedOperations<256>(2000);
+	ThrowingInsert();
+	std::printf("bplus_tree_test passed\n");
+	return 0;
+}
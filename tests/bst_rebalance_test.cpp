@@ -0,0 +1,139 @@
+﻿//BST重建的测试:有序插入时替罪羊规则保证高度不超过RebalanceFactor * log2(n)附近,rebalance()得到完全平衡的树,
+//重建不改变树中的值和次数;RebalanceFactor为0时不自动重建
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. bst_rebalance_test.cpp -o bst_rebalance_test
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "BSTree.h"
+
+//BST的inOrder只接受函数指针,遍历结果放在这里
+static std::vector<std::pair<int, uint32_t>> visited;
+
+void CheckContents(BST<int>& tree, const std::map<int, uint32_t>& expected)
+{
+	visited.clear();
+	tree.inOrder([](TreeNode<int>* node) { visited.emplace_back(node->val, node->count); });
+	std::vector<std::pair<int, uint32_t>> want(expected.begin(), expected.end());
+	assert(visited == want);
+}
+
+//高度(节点数)不超过factor * log2(n) + 1
+void CheckHeightBound(BST<int>& tree, double factor)
+{
+	int n = tree.getNodeSize();
+	if (n > 1) { assert(tree.getHeight() <= int(factor * std::log2(double(n))) + 1); }
+}
+
+//完全平衡:高度为ceil(log2(n + 1))
+void CheckPerfect(BST<int>& tree)
+{
+	int n = tree.getNodeSize();
+	assert(tree.getHeight() == int(std::ceil(std::log2(double(n) + 1))));
+}
+
+void TestSortedInsert(double factor)
+{
+	BST<int> tree;
+	tree.set_rebalance_factor(factor);
+	std::map<int, uint32_t> expected;
+	for (int i = 0; i < 5000; i++)
+	{
+		tree.Insert(i);
+		expected[i]++;
+		if (i % 97 == 0) { CheckHeightBound(tree, factor); }
+	}
+	CheckHeightBound(tree, factor);
+	CheckContents(tree, expected);
+	//降序插入
+	for (int i = -1; i >= -5000; i--)
+	{
+		tree.Insert(i);
+		expected[i]++;
+	}
+	CheckHeightBound(tree, factor);
+	CheckContents(tree, expected);
+}
+
+void TestRandom(unsigned seed)
+{
+	std::mt19937 random(seed);
+	BST<int> tree;
+	std::map<int, uint32_t> expected;
+	for (int i = 0; i < 30000; i++)
+	{
+		int val = int(random() % 3000);
+		if (random() % 3 != 0)
+		{
+			tree.Insert(val);
+			expected[val]++;
+		}
+		else
+		{
+			tree.Delete(val);
+			auto it = expected.find(val);
+			if (it != expected.end() && --it->second == 0) { expected.erase(it); }
+		}
+		if (i % 500 == 0)
+		{
+			CheckHeightBound(tree, 2.0);
+			CheckContents(tree, expected);
+		}
+	}
+	//rebalance()重建整棵树,值和次数不变
+	tree.rebalance();
+	CheckPerfect(tree);
+	CheckContents(tree, expected);
+	//删除大部分节点之后树会整体重建,高度仍然受限
+	for (int val = 0; val < 2900; val++)
+	{
+		tree.DeleteAll(val);
+		expected.erase(val);
+	}
+	CheckHeightBound(tree, 2.0);
+	CheckContents(tree, expected);
+}
+
+void TestNoRebalance()
+{
+	BST<int> tree;
+	tree.set_rebalance_factor(0);
+	for (int i = 0; i < 1000; i++) { tree.Insert(i); }
+	assert(tree.getHeight() == 1000);
+	tree.rebalance();
+	CheckPerfect(tree);
+	//倍数必须大于1
+	bool thrown = false;
+	try
+	{
+		tree.set_rebalance_factor(1.0);
+	}
+	catch (const std::invalid_argument&)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+int main()
+{
+	TestSortedInsert(2.0);
+	TestSortedInsert(1.5);
+	for (unsigned seed = 1; seed <= 3; seed++) { TestRandom(seed); }
+	TestNoRebalance();
+	//各种大小的树的rebalance()
+	for (int n = 0; n < 300; n++)
+	{
+		BST<int> tree;
+		tree.set_rebalance_factor(0);
+		for (int i = 0; i < n; i++) { tree.Insert(i); }
+		tree.rebalance();
+		CheckPerfect(tree);
+	}
+	std::printf("bst_rebalance_test passed\n");
+	return 0;
+}
@@ -0,0 +1,255 @@
+﻿//ConcurrentRBT和ReadWriteLock的测试
+//单线程:随机操作和std::map比较(包括update/write/erase_range/有序查询),每次修改后检查红黑树的性质
+//多线程:写线程在write()中把val从一个key转移到另一个key,或者插入/删除val为0的key,所有val的和不变;
+//读线程用reduce()、range_copy和read()检查每次看到的都是完整的状态(和不变、有序、红黑树的性质成立)
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -pthread -I.. concurrent_rbt_test.cpp -o concurrent_rbt_test
+//(也可以用-fsanitize=thread代替address检查数据竞争)
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "ConcurrentRBT.h"
+#include "TreeCheck.h"
+
+using SumTree = ConcurrentRBT<int, long long, std::less<int>, NodePool<std::pair<const int, long long>>, SumAggregate<long long>>;
+
+//和std::map比较有序查询的结果
+void CheckEntry(const std::optional<std::pair<int, long long>>& entry, std::map<int, long long>::const_iterator it, const std::map<int, long long>& expected)
+{
+	if (it == expected.end()) { assert(!entry); }
+	else { assert(entry && entry->first == it->first && entry->second == it->second); }
+}
+
+void SingleThread(unsigned seed)
+{
+	std::mt19937 random(seed);
+	SumTree tree;
+	std::map<int, long long> expected;
+	for (int i = 0; i < 6000; i++)
+	{
+		int key = int(random() % 800);
+		switch (random() % 8)
+		{
+		case 0:
+			tree.Insert(key, i);
+			expected[key] = i;
+			break;
+		case 1:
+			assert(tree.emplace(key, i) == expected.emplace(key, i).second);
+			break;
+		case 2:
+			assert(tree.try_emplace(key, i) == expected.try_emplace(key, i).second);
+			break;
+		case 3:
+			assert(tree.insert_or_assign(key, i) == expected.insert_or_assign(key, i).second);
+			break;
+		case 4:
+			tree.Delete(key);
+			expected.erase(key);
+			break;
+		case 5:
+		{
+			//update在锁内原地修改val,聚合值随之更新
+			bool found = tree.update(key, [](long long& val) { val += 7; });
+			assert(found == (expected.count(key) != 0));
+			if (found) { expected[key] += 7; }
+			break;
+		}
+		case 6:
+			if (random() % 8 == 0)
+			{
+				tree.erase_range(key, key + 20);
+				expected.erase(expected.lower_bound(key), expected.lower_bound(key + 20));
+			}
+			break;
+		default:
+		{
+			//write()中的一组修改只加一次锁
+			int count = tree.write([&](auto& inner)
+			{
+				for (int k = key; k < key + 5; k++) { inner.Insert(k, k); }
+				return inner.getNodeSize();
+			});
+			for (int k = key; k < key + 5; k++) { expected[k] = k; }
+			assert(count == int(expected.size()));
+			break;
+		}
+		}
+		tree.read([&](const auto& inner) { CheckRB(TreeTestAccess::root(inner)); });
+		assert(tree.getNodeSize() == int(expected.size()));
+		int probe = int(random() % 850) - 20;
+		auto found = tree.Get(probe);
+		assert(expected.count(probe) ? found && *found == expected[probe] : !found);
+		assert(tree.Search(probe) == (expected.count(probe) != 0));
+		auto lower = expected.lower_bound(probe);
+		auto upper = expected.upper_bound(probe);
+		CheckEntry(tree.ceiling(probe), lower, expected);
+		CheckEntry(tree.successor(probe), upper, expected);
+		CheckEntry(tree.floor(probe), upper == expected.begin() ? expected.end() : std::prev(upper), expected);
+		CheckEntry(tree.predecessor(probe), lower == expected.begin() ? expected.end() : std::prev(lower), expected);
+		CheckEntry(tree.GetMin(), expected.begin(), expected);
+		CheckEntry(tree.GetMax(), expected.empty() ? expected.end() : std::prev(expected.end()), expected);
+		if (i % 50 == 0)
+		{
+			auto items = tree.range_copy(probe, probe + 100);
+			assert(items == (std::vector<std::pair<int, long long>>(expected.lower_bound(probe), expected.lower_bound(probe + 100))));
+			long long sum = 0;
+			for (const auto& item : expected) { sum += item.second; }
+			assert(tree.reduce() == sum);
+			sum = 0;
+			for (const auto& item : items) { sum += item.second; }
+			assert(tree.reduce(probe, probe + 100) == sum);
+		}
+	}
+	tree.read([&](const auto& inner) { CheckSameAsMap(const_cast<std::decay_t<decltype(inner)>&>(inner), expected); });
+	//read()中的查询只给出const节点,读者不能在共享锁内修改val
+	tree.read([](const auto& inner)
+	{
+		using ConstNode = const RBTNode<int, long long, SumAggregate<long long>>*;
+		static_assert(std::is_same<decltype(inner.GetNode(0)), ConstNode>::value, "read: GetNode gives a const node");
+		static_assert(std::is_same<decltype(inner.GetMinNode()), ConstNode>::value && std::is_same<decltype(inner.GetMaxNode()), ConstNode>::value, "read: GetMinNode/GetMaxNode give const nodes");
+		static_assert(std::is_same<decltype(inner.floor(0)), ConstNode>::value && std::is_same<decltype(inner.ceiling(0)), ConstNode>::value, "read: floor/ceiling give const nodes");
+		static_assert(std::is_same<decltype(inner.predecessor(0)), ConstNode>::value && std::is_same<decltype(inner.successor(0)), ConstNode>::value, "read: predecessor/successor give const nodes");
+	});
+	tree.Clear();
+	assert(tree.getNodeSize() == 0 && !tree.GetMin());
+}
+
+//所有val的和保持为Total
+void ConcurrentReadersAndWriters(int readers, int writers, int operations)
+{
+	const int Accounts = 200;
+	const long long Total = Accounts * 100LL;
+	SumTree tree;
+	for (int key = 0; key < Accounts; key++) { tree.Insert(key, 100); }
+	std::atomic<int> writersLeft(writers);
+	std::vector<std::thread> threads;
+	for (int w = 0; w < writers; w++)
+	{
+		threads.emplace_back([&tree, &writersLeft, w, operations]()
+		{
+			std::mt19937 random(100 + w);
+			for (int i = 0; i < operations; i++)
+			{
+				int from = int(random() % Accounts);
+				int to = int(random() % Accounts);
+				long long amount = (long long)(random() % 10);
+				if (random() % 4 == 0)
+				{
+					//val为0的key:插入和删除不改变和
+					int key = Accounts + int(random() % 300);
+					if (random() % 2) { tree.try_emplace(key, 0); }
+					else { tree.Delete(key); }
+					continue;
+				}
+				tree.write([&](auto& inner)
+				{
+					inner.GetNode(from)->val -= amount;
+					inner.refresh(from);
+					inner.GetNode(to)->val += amount;
+					inner.refresh(to);
+					return 0;
+				});
+			}
+			writersLeft--;
+		});
+	}
+	std::atomic<long long> reads(0);
+	for (int r = 0; r < readers; r++)
+	{
+		threads.emplace_back([&tree, &writersLeft, &reads, Total]()
+		{
+			do
+			{
+				assert(tree.reduce() == Total);
+				auto items = tree.range_copy(0, 1 << 30);
+				long long sum = 0;
+				for (size_t i = 0; i < items.size(); i++)
+				{
+					assert(i == 0 || items[i - 1].first < items[i].first);
+					sum += items[i].second;
+				}
+				assert(sum == Total);
+				tree.read([](const auto& inner) { CheckRB(TreeTestAccess::root(inner)); });
+				reads++;
+			} while (writersLeft.load() > 0);
+		});
+	}
+	for (std::thread& thread : threads) { thread.join(); }
+	assert(reads.load() >= readers);
+	assert(tree.reduce() == Total);
+	tree.read([](const auto& inner)
+	{
+		CheckRB(TreeTestAccess::root(inner));
+		for (int key = 0; key < Accounts; key++) { assert(inner.Search(key)); }
+	});
+}
+
+//ReadWriteLock:写者在独占锁内把计数加两次,读者在共享锁内只能看到偶数
+void LockExclusion(int readers, int writers, int operations)
+{
+	ReadWriteLock lock;
+	long long counter = 0;
+	std::atomic<int> writersLeft(writers);
+	std::atomic<int> sharedHolders(0);
+	std::vector<std::thread> threads;
+	for (int w = 0; w < writers; w++)
+	{
+		threads.emplace_back([&]()
+		{
+			for (int i = 0; i < operations; i++)
+			{
+				std::unique_lock<ReadWriteLock> guard(lock);
+				assert(sharedHolders.load() == 0);
+				counter++;
+				counter++;
+			}
+			writersLeft--;
+		});
+	}
+	for (int r = 0; r < readers; r++)
+	{
+		threads.emplace_back([&]()
+		{
+			do
+			{
+				std::shared_lock<ReadWriteLock> guard(lock);
+				sharedHolders++;
+				assert(counter % 2 == 0);
+				std::this_thread::yield();
+				assert(counter % 2 == 0);
+				sharedHolders--;
+			} while (writersLeft.load() > 0);
+		});
+	}
+	for (std::thread& thread : threads) { thread.join(); }
+	assert(counter == 2LL * writers * operations);
+	//try_lock在有读者时失败,try_lock_shared在有写者时失败
+	{
+		std::shared_lock<ReadWriteLock> reader(lock);
+		assert(!lock.try_lock());
+	}
+	{
+		std::unique_lock<ReadWriteLock> writer(lock);
+		std::thread other([&lock]() { assert(!lock.try_lock_shared()); });
+		other.join();
+	}
+	assert(lock.try_lock());
+	lock.unlock();
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 2; seed++) { SingleThread(seed); }
+	ConcurrentReadersAndWriters(3, 2, 3000);
+	LockExclusion(3, 2, 20000);
+	std::printf("concurrent_rbt_test passed\n");
+	return 0;
+}
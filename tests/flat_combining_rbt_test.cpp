@@ -0,0 +1,163 @@
+﻿//FlatCombiningRBT的测试
+//单线程:随机操作和std::map比较,用write()检查红黑树的性质和内容;执行请求时抛出的异常在请求者的线程中重新抛出,树保持有效
+//多线程:每个线程只修改key % threads == t的key,它对这些key的每次Search/Get都必须和自己的std::map一致;
+//另一个线程反复用write()扫描整棵树,结束后树的内容是所有线程的std::map的并集
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -pthread -I.. flat_combining_rbt_test.cpp -o flat_combining_rbt_test
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "FlatCombiningRBT.h"
+#include "TreeCheck.h"
+
+//value为负数时拷贝抛出异常
+struct Fragile
+{
+	int value;
+	Fragile(int value = 0) : value(value) {}
+	Fragile(const Fragile& other) : value(other.value)
+	{
+		if (value < 0) { throw std::runtime_error("copy"); }
+	}
+	Fragile& operator=(const Fragile& other)
+	{
+		if (other.value < 0) { throw std::runtime_error("assign"); }
+		value = other.value;
+		return *this;
+	}
+	bool operator==(const Fragile& other) const { return value == other.value; }
+};
+
+template<class Tree, class Map>
+void CheckTree(Tree& tree, const Map& expected)
+{
+	tree.write([&expected](auto& inner)
+	{
+		CheckRB(TreeTestAccess::root(inner));
+		CheckSameAsMap(inner, expected);
+	});
+	assert(tree.getNodeSize() == int(expected.size()));
+}
+
+void SingleThread(unsigned seed)
+{
+	std::mt19937 random(seed);
+	FlatCombiningRBT<int, Fragile> tree;
+	std::map<int, Fragile> expected;
+	for (int i = 0; i < 6000; i++)
+	{
+		int key = int(random() % 1000);
+		switch (random() % 6)
+		{
+		case 0:
+		case 1:
+			tree.Insert(key, Fragile(i));
+			expected[key] = Fragile(i);
+			break;
+		case 2:
+			tree.Delete(key);
+			expected.erase(key);
+			break;
+		case 3:
+		{
+			//插入时拷贝val抛出异常:新key不会被插入,已有的key保持原来的val
+			bool thrown = false;
+			try
+			{
+				tree.Insert(key, Fragile(-1));
+			}
+			catch (const std::runtime_error&)
+			{
+				thrown = true;
+			}
+			assert(thrown);
+			break;
+		}
+		default:
+		{
+			auto found = tree.Get(key);
+			assert(expected.count(key) ? found && found->value == expected[key].value : !found);
+			break;
+		}
+		}
+		assert(tree.Search(key) == (expected.count(key) != 0));
+		if (i % 200 == 0) { CheckTree(tree, expected); }
+	}
+	CheckTree(tree, expected);
+}
+
+//线程t只修改key % threads == t的key
+void ConcurrentOperations(int threads, int operations)
+{
+	FlatCombiningRBT<int, int> tree;
+	std::vector<std::map<int, int>> expected(threads);
+	std::atomic<int> running(threads);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&, t]()
+		{
+			std::mt19937 random(400 + t);
+			std::map<int, int>& mine = expected[t];
+			for (int i = 0; i < operations; i++)
+			{
+				int key = int(random() % 500) * threads + t;
+				switch (random() % 4)
+				{
+				case 0:
+				case 1:
+					tree.Insert(key, i);
+					mine[key] = i;
+					break;
+				case 2:
+					tree.Delete(key);
+					mine.erase(key);
+					break;
+				default:
+				{
+					auto found = tree.Get(key);
+					assert(mine.count(key) ? found && *found == mine[key] : !found);
+					break;
+				}
+				}
+				assert(tree.Search(key) == (mine.count(key) != 0));
+			}
+			running--;
+		});
+	}
+	//write()独占地扫描整棵树
+	workers.emplace_back([&]()
+	{
+		do
+		{
+			tree.write([](auto& inner)
+			{
+				CheckRB(TreeTestAccess::root(inner));
+				int last = -1;
+				inner.inOrder([&last](const auto* node)
+				{
+					assert(node->key > last);
+					last = node->key;
+				});
+			});
+			std::this_thread::yield();
+		} while (running.load() > 0);
+	});
+	for (std::thread& worker : workers) { worker.join(); }
+	std::map<int, int> all;
+	for (const auto& part : expected) { all.insert(part.begin(), part.end()); }
+	CheckTree(tree, all);
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 2; seed++) { SingleThread(seed); }
+	ConcurrentOperations(4, 5000);
+	std::printf("flat_combining_rbt_test passed\n");
+	return 0;
+}
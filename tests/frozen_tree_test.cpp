@@ -0,0 +1,151 @@
+﻿//FrozenTree的测试:0到300个键值的每一种大小(覆盖所有不满的最后一层),检查Eytzinger布局、
+//lower_bound/upper_bound/find/range和双向迭代,以及RBT/AVL的freeze()、字符串key和自定义比较器
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. frozen_tree_test.cpp -o frozen_tree_test
+#include <cassert>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "FrozenTree.h"
+#include "RBTree.h"
+#include "AVLTree.h"
+#include "TreeCheck.h"
+
+//下标从1开始,i的左右子节点2i、2i+1分别比它小、比它大
+template<class Frozen>
+void CheckLayout(const Frozen& tree)
+{
+	size_t n = TreeTestAccess::keys(tree).size();
+	assert(TreeTestAccess::vals(tree).size() == n);
+	for (size_t i = 1; i <= n; i++)
+	{
+		if (2 * i <= n) { assert(TreeTestAccess::comp(tree)(TreeTestAccess::keys(tree)[2 * i - 1], TreeTestAccess::keys(tree)[i - 1])); }
+		if (2 * i + 1 <= n) { assert(TreeTestAccess::comp(tree)(TreeTestAccess::keys(tree)[i - 1], TreeTestAccess::keys(tree)[2 * i])); }
+	}
+}
+
+//和有序表比较:内容、双向迭代,以及对probes中每个key的查询
+template<class Frozen, class Map, class Key>
+void CheckSameAsMap(const Frozen& tree, const Map& expected, const std::vector<Key>& probes)
+{
+	CheckLayout(tree);
+	assert(tree.size() == expected.size() && tree.getNodeSize() == int(expected.size()) && tree.empty() == expected.empty());
+	auto it = tree.begin();
+	for (const auto& item : expected)
+	{
+		assert(it != tree.end() && it->key == item.first && (*it).val == item.second);
+		++it;
+	}
+	assert(it == tree.end());
+	for (auto rit = expected.rbegin(); rit != expected.rend(); ++rit)
+	{
+		--it;
+		assert(it->key == rit->first && it->val == rit->second);
+	}
+	assert(it == tree.begin());
+	for (const Key& key : probes)
+	{
+		auto lower = expected.lower_bound(key);
+		auto found = tree.lower_bound(key);
+		assert(lower == expected.end() ? found == tree.end() : found != tree.end() && found->key == lower->first);
+		auto upper = expected.upper_bound(key);
+		found = tree.upper_bound(key);
+		assert(upper == expected.end() ? found == tree.end() : found != tree.end() && found->key == upper->first);
+		found = tree.find(key);
+		assert(expected.count(key) ? found != tree.end() && found->val == expected.at(key) : found == tree.end());
+		assert(tree.Search(key) == (expected.count(key) != 0));
+		//lower_bound的前一个位置是最后一个key<key的位置
+		if (lower != expected.begin())
+		{
+			auto previous = tree.lower_bound(key);
+			--previous;
+			assert(previous->key == std::prev(lower)->first);
+		}
+	}
+	//[probes[i], probes[i + 1])的范围访问
+	for (size_t i = 0; i + 1 < probes.size(); i += 7)
+	{
+		const Key& lo = probes[i];
+		const Key& hi = probes[i + 1];
+		std::vector<std::pair<Key, typename Map::mapped_type>> items;
+		tree.range(lo, hi, [&items](const auto* entry) { items.emplace_back(entry->key, entry->val); });
+		std::vector<std::pair<Key, typename Map::mapped_type>> wanted;
+		if (!expected.key_comp()(hi, lo)) { wanted.assign(expected.lower_bound(lo), expected.lower_bound(hi)); }
+		assert(items == wanted);
+	}
+}
+
+//n个偶数key:0, 2, ..., 2n - 2,查询[-2, 2n]中的所有整数
+void EverySize(int maxSize)
+{
+	for (int n = 0; n <= maxSize; n++)
+	{
+		std::vector<std::pair<int, int>> items;
+		std::map<int, int> expected;
+		for (int i = 0; i < n; i++)
+		{
+			items.emplace_back(2 * i, -i);
+			expected[2 * i] = -i;
+		}
+		FrozenTree<int, int> tree(sorted_input, items.begin(), items.end());
+		std::vector<int> probes;
+		for (int key = -2; key <= 2 * n; key++) { probes.push_back(key); }
+		CheckSameAsMap(tree, expected, probes);
+	}
+}
+
+//RBT/AVL随机插入、删除后freeze(),冻结的表和原来的树互不影响
+template<class Tree>
+void FreezeTree(unsigned seed)
+{
+	std::mt19937 random(seed);
+	Tree tree;
+	std::map<int, int> expected;
+	for (int i = 0; i < 3000; i++)
+	{
+		int key = int(random() % 2000);
+		if (random() % 3 == 0)
+		{
+			tree.Delete(key);
+			expected.erase(key);
+		}
+		else
+		{
+			tree.Insert(key, i);
+			expected[key] = i;
+		}
+	}
+	auto frozen = tree.freeze();
+	std::vector<int> probes;
+	for (int i = 0; i < 500; i++) { probes.push_back(int(random() % 2100) - 50); }
+	CheckSameAsMap(frozen, expected, probes);
+	tree.Clear();
+	CheckSameAsMap(frozen, expected, probes);
+}
+
+int main()
+{
+	EverySize(300);
+	for (unsigned seed = 1; seed <= 3; seed++)
+	{
+		FreezeTree<RBT<int, int>>(seed);
+		FreezeTree<AVL<int, int>>(seed);
+	}
+	//字符串key,从大到小排序
+	{
+		std::map<std::string, int, std::greater<std::string>> expected;
+		std::mt19937 random(7);
+		for (int i = 0; i < 1000; i++) { expected["key" + std::to_string(random() % 5000)] = i; }
+		FrozenTree<std::string, int, std::greater<std::string>> tree(sorted_input, expected.begin(), expected.end());
+		std::vector<std::string> probes;
+		for (int i = 0; i < 300; i++) { probes.push_back("key" + std::to_string(random() % 5000)); }
+		probes.push_back("");
+		probes.push_back("z");
+		CheckSameAsMap(tree, expected, probes);
+	}
+	std::printf("frozen_tree_test passed\n");
+	return 0;
+}
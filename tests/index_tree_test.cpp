@@ -0,0 +1,118 @@
+﻿//IndexRBT和IndexAVL的测试:随机的Insert/Delete/operator[]和std::map比较,检查红黑树/AVL的性质(下标链接)、
+//删除的节点被空闲链表复用(vector不再增长),以及整棵树可以直接拷贝
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. index_tree_test.cpp -o index_tree_test
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "IndexTree.h"
+#include "TreeCheck.h"
+
+//红黑树:父节点下标正确,红节点的子节点都是黑色,每条路径上的黑节点数相同;返回黑高
+template<class Tree>
+int CheckIndexRB(const Tree& tree, uint32_t x, uint32_t parent)
+{
+	if (x == 0) { return 1; }
+	const auto& node = TreeTestAccess::nodes(tree)[x];
+	assert(node.parent == parent);
+	if (node.color == 0) { assert(TreeTestAccess::nodes(tree)[node.left].color == 1 && TreeTestAccess::nodes(tree)[node.right].color == 1); }
+	int leftHeight = CheckIndexRB(tree, node.left, x);
+	int rightHeight = CheckIndexRB(tree, node.right, x);
+	assert(leftHeight == rightHeight);
+	return leftHeight + node.color;
+}
+
+//AVL:平衡因子等于右子树高度-左子树高度;返回高度
+template<class Tree>
+int CheckIndexAVL(const Tree& tree, uint32_t x)
+{
+	if (x == 0) { return 0; }
+	const auto& node = TreeTestAccess::nodes(tree)[x];
+	int leftHeight = CheckIndexAVL(tree, node.left);
+	int rightHeight = CheckIndexAVL(tree, node.right);
+	assert(node.balance == rightHeight - leftHeight && node.balance >= -1 && node.balance <= 1);
+	return (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+}
+
+void CheckStructure(const IndexRBT<int, int>& tree)
+{
+	assert(TreeTestAccess::nodes(tree)[0].color == 1);
+	assert(TreeTestAccess::root(tree) == 0 || TreeTestAccess::nodes(tree)[TreeTestAccess::root(tree)].color == 1);
+	CheckIndexRB(tree, TreeTestAccess::root(tree), 0);
+}
+
+void CheckStructure(const IndexAVL<int, int>& tree)
+{
+	CheckIndexAVL(tree, TreeTestAccess::root(tree));
+}
+
+template<class Tree>
+void CheckContents(Tree& tree, const std::map<int, int>& expected)
+{
+	std::vector<std::pair<int, int>> items;
+	tree.inOrder([&items](const auto* node) { items.emplace_back(node->key, node->val); });
+	std::vector<std::pair<int, int>> want(expected.begin(), expected.end());
+	assert(items == want);
+	assert(tree.size() == expected.size());
+}
+
+template<class Tree>
+void RandomOperations(unsigned seed)
+{
+	std::mt19937 random(seed);
+	Tree tree;
+	std::map<int, int> expected;
+	for (int i = 0; i < 20000; i++)
+	{
+		int key = int(random() % 400);
+		switch (random() % 4)
+		{
+		case 0:
+			tree.Insert(key, i);
+			expected[key] = i;
+			break;
+		case 1:
+			//operator[]:key不存在时插入值初始化的val
+			tree[key] += 1;
+			expected[key] += 1;
+			break;
+		default:
+			tree.Delete(key);
+			expected.erase(key);
+			break;
+		}
+		assert(tree.Search(key) == (expected.count(key) != 0));
+		CheckStructure(tree);
+		if (i % 20 == 0) { CheckContents(tree, expected); }
+	}
+	CheckContents(tree, expected);
+	//删除的节点进入空闲链表,再插入同样多的节点时节点数组不增长
+	size_t capacity = TreeTestAccess::nodes(tree).size();
+	std::vector<int> keys;
+	for (const auto& item : expected) { keys.push_back(item.first); }
+	for (int key : keys) { tree.Delete(key); }
+	assert(tree.size() == 0 && TreeTestAccess::root(tree) == 0);
+	for (int key : keys) { tree.Insert(key, key); }
+	assert(TreeTestAccess::nodes(tree).size() == capacity);
+	CheckStructure(tree);
+	//节点只用下标相连,拷贝得到一棵独立的树
+	Tree copy = tree;
+	copy.Delete(keys.empty() ? 0 : keys[0]);
+	CheckStructure(copy);
+	assert(tree.size() == keys.size());
+	if (!keys.empty()) { assert(copy.size() == keys.size() - 1 && tree.Search(keys[0]) && !copy.Search(keys[0])); }
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 3; seed++)
+	{
+		RandomOperations<IndexRBT<int, int>>(seed);
+		RandomOperations<IndexAVL<int, int>>(seed);
+	}
+	std::printf("index_tree_test passed\n");
+	return 0;
+}
@@ -0,0 +1,175 @@
+﻿//KeyCompare3和透明比较器的测试
+//KeyCompare3:std::less、std::greater、std::less<>(std::string和const char*/std::string_view混合)和自定义比较器的三路结果
+//std::less<>的std::string键的RBT/AVL用const char*和std::string_view查找(Search/GetNode,RBT还有find)
+//带is_transparent的自定义比较器(不区分大小写)走KeyCompare3的通用分支:用std::string_view查找不构造键,
+//每层最多调用两次比较器,结果和std::map一致;IndexRBT/IndexAVL使用std::greater时按key递减排列
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. key_compare_test.cpp -o key_compare_test
+//(用-std=c++20编译时std::less的比较走<=>的分支)
+#include <cassert>
+#include <cctype>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "RBTree.h"
+#include "AVLTree.h"
+#include "IndexTree.h"
+
+//记录构造次数的键(用来确认查找时没有构造临时的键)
+struct Name
+{
+	static int constructed;
+	std::string text;
+	Name(std::string_view text) : text(text) { constructed++; }
+	Name(const Name& other) : text(other.text) { constructed++; }
+	Name& operator=(const Name& other) = default;
+};
+int Name::constructed = 0;
+
+//不区分大小写的透明比较器,记录调用次数
+struct CaseLess
+{
+	using is_transparent = void;
+	static long calls;
+	static bool Less(std::string_view a, std::string_view b)
+	{
+		calls++;
+		for (size_t i = 0; i < a.size() && i < b.size(); i++)
+		{
+			int x = std::tolower((unsigned char)a[i]);
+			int y = std::tolower((unsigned char)b[i]);
+			if (x != y) { return x < y; }
+		}
+		return a.size() < b.size();
+	}
+	bool operator()(const Name& a, const Name& b) const { return Less(a.text, b.text); }
+	bool operator()(const Name& a, std::string_view b) const { return Less(a.text, b); }
+	bool operator()(std::string_view a, const Name& b) const { return Less(a, b.text); }
+	bool operator()(const std::string& a, const std::string& b) const { return Less(a, b); }
+};
+long CaseLess::calls = 0;
+
+void ThreeWay()
+{
+	assert(KeyCompare3(std::less<int>(), 1, 2) < 0 && KeyCompare3(std::less<int>(), 2, 1) > 0 && KeyCompare3(std::less<int>(), 3, 3) == 0);
+	assert(KeyCompare3(std::greater<int>(), 1, 2) > 0 && KeyCompare3(std::greater<int>(), 2, 1) < 0 && KeyCompare3(std::greater<int>(), 3, 3) == 0);
+	std::string apple = "apple";
+	assert(KeyCompare3(std::less<>(), apple, "banana") < 0 && KeyCompare3(std::less<>(), "banana", apple) > 0);
+	assert(KeyCompare3(std::less<>(), apple, std::string_view("apple")) == 0);
+	assert(KeyCompare3(std::less<std::string>(), apple, std::string("apple\0", 6)) < 0);
+	CaseLess::calls = 0;
+	assert(KeyCompare3(CaseLess(), Name("Apple"), std::string_view("aPPLE")) == 0 && CaseLess::calls == 2);
+	assert(KeyCompare3(CaseLess(), std::string_view("b"), Name("A")) > 0);
+	assert(KeyCompare3(CaseLess(), std::string_view("a"), Name("B")) < 0);
+}
+
+//std::less<>:用const char*、std::string_view和std::string查找std::string键
+template<class Tree>
+void StringKeys()
+{
+	Tree tree;
+	std::vector<std::string> words = { "pear", "apple", "fig", "banana", "cherry", "date", "grape", "kiwi" };
+	for (size_t i = 0; i < words.size(); i++) { tree.Insert(words[i], int(i)); }
+	for (size_t i = 0; i < words.size(); i++)
+	{
+		const char* word = words[i].c_str();
+		std::string_view view(words[i]);
+		assert(tree.Search(word) && tree.Search(view) && tree.Search(words[i]));
+		assert(tree.GetNode(word)->val == int(i) && tree.GetNode(view) == tree.GetNode(words[i]));
+	}
+	assert(!tree.Search("grapefruit") && tree.GetNode(std::string_view("gra")) == nullptr);
+	//string_view指向更长的字符串的一部分
+	std::string text = "kiwifruit";
+	assert(tree.GetNode(std::string_view(text).substr(0, 4))->val == 7);
+}
+
+//RBT的迭代器查找
+void StringFind()
+{
+	RBT<std::string, int, std::less<>> tree;
+	tree.Insert("date", 5);
+	tree.Insert("fig", 2);
+	assert(tree.find(std::string_view("date"))->val == 5 && tree.find("fig")->val == 2);
+	assert(tree.find("plum") == tree.end());
+	const auto& constTree = tree;
+	assert(constTree.find(std::string_view("fig")) != constTree.end());
+}
+
+//自定义的透明比较器:键按不区分大小写的顺序排列,查找不构造键,每层最多两次比较
+template<class Tree>
+void CustomComparator(unsigned seed)
+{
+	std::mt19937 random(seed);
+	Tree tree;
+	std::map<std::string, int, CaseLess> expected;
+	auto randomWord = [&random]()
+	{
+		std::string word(1 + random() % 4, 'a');
+		for (char& c : word) { c = char((random() % 2 ? 'a' : 'A') + random() % 6); }
+		return word;
+	};
+	for (int i = 0; i < 3000; i++)
+	{
+		std::string word = randomWord();
+		if (random() % 4 == 0)
+		{
+			tree.Delete(Name(word));
+			expected.erase(word);
+		}
+		else
+		{
+			tree.Insert(Name(word), i);
+			expected[word] = i;
+		}
+		//用另一种大小写查找
+		std::string probe = randomWord();
+		int before = Name::constructed;
+		CaseLess::calls = 0;
+		auto node = tree.GetNode(std::string_view(probe));
+		assert(Name::constructed == before && CaseLess::calls <= 2 * tree.GetHeight());
+		auto it = expected.find(probe);
+		if (it == expected.end()) { assert(node == nullptr && !tree.Search(std::string_view(probe))); }
+		else { assert(node != nullptr && node->val == it->second && !CaseLess::Less(node->key.text, probe) && !CaseLess::Less(probe, node->key.text)); }
+	}
+	std::vector<std::string> keys;
+	tree.inOrder([&keys](const auto* node) { keys.push_back(node->key.text); });
+	assert(keys.size() == expected.size());
+	size_t i = 0;
+	for (const auto& item : expected) { assert(!CaseLess::Less(keys[i], item.first) && !CaseLess::Less(item.first, keys[i])); i++; }
+}
+
+//下标存储的树使用std::greater
+template<class Tree>
+void Descending()
+{
+	Tree tree;
+	for (int i = 0; i < 1000; i++) { tree.Insert((i * 7919) % 1000, i); }
+	assert(tree.GetMinNode()->key == 999 && tree.GetMaxNode()->key == 0);
+	int last = 1000;
+	tree.inOrder([&last](const auto* node)
+	{
+		assert(node->key == last - 1);
+		last = node->key;
+	});
+	assert(last == 0 && tree.Search(500) && !tree.Search(1000));
+}
+
+int main()
+{
+	ThreeWay();
+	StringKeys<RBT<std::string, int, std::less<>>>();
+	StringKeys<AVL<std::string, int, std::less<>>>();
+	StringFind();
+	for (unsigned seed = 1; seed <= 2; seed++)
+	{
+		CustomComparator<RBT<Name, int, CaseLess>>(seed);
+		CustomComparator<AVL<Name, int, CaseLess>>(seed);
+	}
+	Descending<IndexRBT<int, int, std::greater<int>>>();
+	Descending<IndexAVL<int, int, std::greater<int>>>();
+	std::printf("key_compare_test passed\n");
+	return 0;
+}
@@ -0,0 +1,174 @@
+﻿//多重集合的测试:BST的计数节点(相等的值只保存一个节点)、RBTMultiSet和RBTMultiMap,和std::multiset/std::multimap比较
+//count和equal_range在每次操作之后和期望的结果一致
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. multiset_test.cpp -o multiset_test
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "BSTree.h"
+#include "MultiTree.h"
+
+//BST的inOrder只接受函数指针,遍历结果放在这里
+static std::vector<std::pair<int, uint32_t>> visited;
+
+void CheckBST(BST<int>& tree, const std::multiset<int>& expected)
+{
+	visited.clear();
+	tree.inOrder([](TreeNode<int>* node) { visited.emplace_back(node->val, node->count); });
+	size_t distinct = 0;
+	for (auto it = expected.begin(); it != expected.end(); it = expected.upper_bound(*it))
+	{
+		assert(distinct < visited.size());
+		assert(visited[distinct].first == *it && visited[distinct].second == expected.count(*it));
+		distinct++;
+	}
+	assert(visited.size() == distinct);
+	assert(tree.getNodeSize() == int(distinct));
+	assert(tree.size() == expected.size());
+}
+
+//equal_range得到(保存的值, 出现次数),不存在时为(nullptr, 0)
+void CheckEqualRange(const std::pair<const int*, size_t>& range, const std::multiset<int>& expected, int key)
+{
+	assert(range.second == expected.count(key));
+	if (range.second == 0) { assert(range.first == nullptr); }
+	else { assert(range.first != nullptr && *range.first == key); }
+}
+
+void TestBST(unsigned seed)
+{
+	std::mt19937 random(seed);
+	BST<int> tree;
+	std::multiset<int> expected;
+	for (int i = 0; i < 20000; i++)
+	{
+		int val = int(random() % 200);
+		switch (random() % 4)
+		{
+		case 0:
+		case 1:
+			tree.Insert(val);
+			expected.insert(val);
+			break;
+		case 2:
+		{
+			tree.Delete(val);
+			auto it = expected.find(val);
+			if (it != expected.end()) { expected.erase(it); }
+			break;
+		}
+		default:
+			assert(tree.DeleteAll(val) == expected.erase(val));
+			break;
+		}
+		assert(tree.count(val) == expected.count(val));
+		CheckEqualRange(tree.equal_range(val), expected, val);
+		assert(tree.Search(val) == (expected.count(val) != 0));
+		if (i % 50 == 0) { CheckBST(tree, expected); }
+	}
+	CheckBST(tree, expected);
+	//同一个值重复再多次也只占一个节点,不会让树变高
+	BST<int> same;
+	for (int i = 0; i < 100000; i++) { same.Insert(7); }
+	assert(same.getNodeSize() == 1 && same.size() == 100000 && same.getHeight() == 1);
+}
+
+void TestMultiSet(unsigned seed)
+{
+	std::mt19937 random(seed);
+	RBTMultiSet<int> set;
+	std::multiset<int> expected;
+	for (int i = 0; i < 20000; i++)
+	{
+		int key = int(random() % 200);
+		switch (random() % 4)
+		{
+		case 0:
+		case 1:
+			set.Insert(key);
+			expected.insert(key);
+			break;
+		case 2:
+		{
+			auto it = expected.find(key);
+			assert(set.Delete(key) == (it != expected.end()));
+			if (it != expected.end()) { expected.erase(it); }
+			break;
+		}
+		default:
+			assert(set.DeleteAll(key) == expected.erase(key));
+			break;
+		}
+		assert(set.count(key) == expected.count(key));
+		CheckEqualRange(set.equal_range(key), expected, key);
+		assert(set.size() == expected.size());
+	}
+	//range按key访问不同的key和它们的次数
+	std::vector<std::pair<int, size_t>> items;
+	set.range(50, 150, [&items](const int& key, size_t count) { items.emplace_back(key, count); });
+	size_t i = 0;
+	for (auto it = expected.lower_bound(50); it != expected.lower_bound(150); it = expected.upper_bound(*it))
+	{
+		assert(i < items.size() && items[i].first == *it && items[i].second == expected.count(*it));
+		i++;
+	}
+	assert(i == items.size());
+}
+
+void TestMultiMap(unsigned seed)
+{
+	std::mt19937 random(seed);
+	RBTMultiMap<int, int> map;
+	std::multimap<int, int> expected;
+	for (int i = 0; i < 20000; i++)
+	{
+		int key = int(random() % 100);
+		int val = int(random() % 8);
+		switch (random() % 4)
+		{
+		case 0:
+		case 1:
+			map.Insert(key, val);
+			expected.emplace(key, val);
+			break;
+		case 2:
+		{
+			//删除key的一个等于val的值(第一个)
+			auto range = expected.equal_range(key);
+			auto it = range.first;
+			while (it != range.second && it->second != val) { ++it; }
+			assert(map.DeleteValue(key, val) == (it != range.second));
+			if (it != range.second) { expected.erase(it); }
+			break;
+		}
+		default:
+			assert(map.Delete(key) == expected.erase(key));
+			break;
+		}
+		//同一个key的值按插入顺序排列,和std::multimap相同
+		auto values = map.equal_range(key);
+		auto range = expected.equal_range(key);
+		assert(size_t(values.second - values.first) == map.count(key) && map.count(key) == expected.count(key));
+		for (const int* v = values.first; v != values.second; ++v, ++range.first) { assert(*v == range.first->second); }
+		assert(map.size() == expected.size());
+	}
+	std::vector<std::pair<int, int>> items;
+	map.range(20, 80, [&items](const int& key, int& val) { items.emplace_back(key, val); });
+	std::vector<std::pair<int, int>> want(expected.lower_bound(20), expected.lower_bound(80));
+	assert(items == want);
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 3; seed++)
+	{
+		TestBST(seed);
+		TestMultiSet(seed);
+		TestMultiMap(seed);
+	}
+	std::printf("multiset_test passed\n");
+	return 0;
+}
@@ -0,0 +1,117 @@
+﻿//NodePool和PoolArena的测试
+//PoolArena:释放的节点按后进先出复用,slab按64个节点起倍增,Release()归还所有slab
+//NodePool:拷贝和rebind得到的分配器相等(A(B(a)) == a),同一类型共享PoolArena,默认构造和IndependentAllocator得到新的内存池
+//树:用同一个NodePool构造的两棵树共享内存池,可以互相复用对方释放的节点;独占内存池的树Clear()时整体归还slab,共享时逐个释放
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. node_pool_test.cpp -o node_pool_test
+#include <cassert>
+#include <cstdio>
+#include <functional>
+#include <set>
+#include <utility>
+#include "RBTree.h"
+#include "AVLTree.h"
+#include "TreeCheck.h"
+
+void Arena()
+{
+	PoolArena arena(sizeof(long long));
+	assert(arena.SlabCount() == 0);
+	//空闲链表后进先出
+	void* a = arena.Allocate();
+	void* b = arena.Allocate();
+	assert(a != b && arena.SlabCount() == 1);
+	arena.Deallocate(a);
+	arena.Deallocate(b);
+	assert(arena.Allocate() == b && arena.Allocate() == a);
+	//第一个slab有64个节点,之后倍增
+	std::set<void*> seen{ a, b };
+	for (int i = 2; i < 64; i++) { assert(seen.insert(arena.Allocate()).second); }
+	assert(arena.SlabCount() == 1);
+	assert(seen.insert(arena.Allocate()).second && arena.SlabCount() == 2);
+	for (int i = 65; i < 64 + 128; i++) { arena.Allocate(); }
+	assert(arena.SlabCount() == 2);
+	arena.Allocate();
+	assert(arena.SlabCount() == 3);
+	arena.Release();
+	assert(arena.SlabCount() == 0);
+	arena.Allocate();
+	assert(arena.SlabCount() == 1);
+}
+
+void Rebind()
+{
+	NodePool<int> a;
+	NodePool<double> b(a);
+	NodePool<int> c(b);
+	assert(b == a && c == a && a == b && !(c != a));
+	//同一类型使用同一个PoolArena:一个分配的节点可以由另一个释放,之后被复用
+	int* p = a.allocate(1);
+	c.deallocate(p, 1);
+	assert(a.allocate(1) == p);
+	assert(!a.unique() && b.unique());
+	//不同的PoolGroup互不相等
+	NodePool<int> other;
+	assert(other != a && !(other == b));
+	NodePool<int> independent = IndependentAllocator(a);
+	assert(independent != a && independent.unique());
+	//多个节点的分配不走内存池
+	int* array = a.allocate(10);
+	size_t slabs = a.slab_count();
+	a.deallocate(array, 10);
+	assert(a.slab_count() == slabs);
+	a.deallocate(p, 1);
+}
+
+//T类型的NodePool都销毁之后,同一组中再rebind得到的是新的PoolArena
+void ArenaLifetime()
+{
+	NodePool<int> a;
+	{
+		NodePool<long long> b(a);
+		b.allocate(1);
+		assert(b.slab_count() == 1 && b.unique());
+	}
+	NodePool<long long> b(a);
+	assert(b == a && b.slab_count() == 0);
+}
+
+template<class Tree>
+void SharedTrees()
+{
+	using Pool = NodePool<std::pair<const int, int>>;
+	Pool pool;
+	Tree x(std::less<int>(), pool);
+	Tree y(std::less<int>(), pool);
+	assert(TreeTestAccess::alloc(x) == TreeTestAccess::alloc(y) && TreeTestAccess::alloc(x) == pool);
+	for (int i = 0; i < 5000; i++) { x.Insert(i, i); }
+	size_t slabs = TreeTestAccess::alloc(x).slab_count();
+	assert(slabs > 0 && TreeTestAccess::alloc(y).slab_count() == slabs);
+	//x释放的节点被y复用,不需要新的slab
+	for (int i = 0; i < 5000; i++) { x.Delete(i); }
+	for (int i = 0; i < 5000; i++) { y.Insert(i, -i); }
+	assert(TreeTestAccess::alloc(y).slab_count() == slabs);
+	//共享内存池时Clear()逐个释放节点,不归还slab
+	for (int i = 0; i < 3000; i++) { x.Insert(i, i); }
+	x.Clear();
+	assert(TreeTestAccess::nodeSize(x) == 0 && TreeTestAccess::alloc(y).slab_count() == slabs);
+	for (int i = 0; i < 5000; i++) { assert(y.GetNode(i)->val == -i); }
+	//独占内存池的树Clear()时整体归还所有slab
+	Tree z;
+	for (int i = 0; i < 5000; i++) { z.Insert(i, i); }
+	assert(TreeTestAccess::alloc(z).unique() && TreeTestAccess::alloc(z).slab_count() > 0);
+	z.Clear();
+	assert(TreeTestAccess::nodeSize(z) == 0 && TreeTestAccess::alloc(z).slab_count() == 0);
+	z.Insert(1, 1);
+	assert(z.GetNode(1)->val == 1);
+}
+
+int main()
+{
+	Arena();
+	Rebind();
+	ArenaLifetime();
+	SharedTrees<RBT<int, int>>();
+	SharedTrees<AVL<int, int>>();
+	std::printf("node_pool_test passed\n");
+	return 0;
+}
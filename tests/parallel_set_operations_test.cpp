@@ -0,0 +1,225 @@
+﻿//TaskPool和RBT/AVL并行集合运算、并行批量构造的测试
+//TaskPool:嵌套的fork_join(递归求和)结果正确,两边抛出的异常按约定重新抛出
+//0、1、3个工作线程和很小的grain下,并行的union_with/intersect_with/difference_with/build和std::map比较,
+//检查平衡性质和聚合值;并行批量构造中途构造失败时抛出异常,树保持为空,没有泄漏
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -pthread -I.. parallel_set_operations_test.cpp -o parallel_set_operations_test
+//(也可以用-fsanitize=thread代替address检查数据竞争)
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "RBTree.h"
+#include "AVLTree.h"
+#include "TaskPool.h"
+#include "TreeCheck.h"
+
+using Sum = SumAggregate<long long>;
+using Pool = NodePool<std::pair<const int, long long>>;
+using SumRBT = RBT<int, long long, std::less<int>, Pool, Sum>;
+using SumAVL = AVL<int, long long, std::less<int>, Pool, Sum>;
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+void CheckShape(const RBT<K, V, Compare, Alloc, Augment>& tree)
+{
+	using Node = RBTNode<K, V, Augment>;
+	CheckRB(TreeTestAccess::root(tree));
+	if constexpr (!std::is_same<Augment, NoAugment>::value)
+	{
+		CheckAggregate<Augment>(TreeTestAccess::root(tree), [](const Node* node) { return node->left; }, [](const Node* node) { return node->right; });
+	}
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+void CheckShape(const AVL<K, V, Compare, Alloc, Augment>& tree)
+{
+	using Node = AVLNode<K, V, Augment>;
+	CheckAVL(TreeTestAccess::root(tree));
+	if constexpr (!std::is_same<Augment, NoAugment>::value)
+	{
+		CheckAggregate<Augment>(TreeTestAccess::root(tree), [](const Node* node) { return node->left(); }, [](const Node* node) { return node->right(); });
+	}
+}
+
+template<class Tree>
+void CheckTree(Tree& tree, const std::map<int, long long>& expected)
+{
+	CheckShape(tree);
+	assert(TreeTestAccess::nodeSize(tree) == int(expected.size()));
+	CheckSameAsMap(tree, expected);
+}
+
+//[lo, hi)的和:区间足够大时两半用fork_join并行计算
+long long ParallelSum(TaskPool& pool, long long lo, long long hi)
+{
+	if (hi - lo <= 64)
+	{
+		long long sum = 0;
+		for (long long i = lo; i < hi; i++) { sum += i; }
+		return sum;
+	}
+	long long mid = lo + (hi - lo) / 2;
+	long long left = 0;
+	long long right = 0;
+	pool.fork_join([&]() { left = ParallelSum(pool, lo, mid); }, [&]() { right = ParallelSum(pool, mid, hi); });
+	return left + right;
+}
+
+void ForkJoin(TaskPool& pool)
+{
+	assert(ParallelSum(pool, 0, 100000) == 100000LL * 99999 / 2);
+	//只有second抛出异常:first照常执行完
+	int x = 0;
+	bool thrown = false;
+	try
+	{
+		pool.fork_join([&]() { x = 1; }, []() { throw std::logic_error("second"); });
+	}
+	catch (const std::logic_error&)
+	{
+		thrown = true;
+	}
+	assert(thrown && x == 1);
+	//两边都抛出异常时重新抛出first的
+	thrown = false;
+	try
+	{
+		pool.fork_join([]() { throw std::runtime_error("first"); }, []() { throw std::logic_error("second"); });
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+template<class Tree>
+void RandomOperations(TaskPool& pool, unsigned seed, int rounds)
+{
+	std::mt19937 random(seed);
+	for (int round = 0; round < rounds; round++)
+	{
+		Tree a;
+		Tree b;
+		std::map<int, long long> ma;
+		std::map<int, long long> mb;
+		int keyRange = 1 + int(random() % 50000);
+		size_t grain = 1 + random() % 64;
+		std::vector<std::pair<int, long long>> items;
+		for (int i = int(random() % 6000); i > 0; i--)
+		{
+			int key = int(random() % keyRange);
+			long long val = random() % 100;
+			items.emplace_back(key, val);
+			ma[key] = val;
+		}
+		//build:无序、有重复的输入,key相同时保留最后一个
+		a.build(items.begin(), items.end(), pool, grain);
+		CheckTree(a, ma);
+		//一半的轮次共享分配器
+		if (round % 2) { a.split(1 << 30, b); }
+		for (int i = int(random() % (round % 3 ? 6000 : 50)); i > 0; i--)
+		{
+			int key = int(random() % keyRange);
+			long long val = 1000 + random() % 100;
+			b.Insert(key, val);
+			mb[key] = val;
+		}
+		switch (round % 3)
+		{
+		case 0:
+			a.union_with(b, pool, grain);
+			for (const auto& item : mb) { ma[item.first] = item.second; }
+			CheckTree(a, ma);
+			assert(TreeTestAccess::root(b) == nullptr && TreeTestAccess::nodeSize(b) == 0);
+			break;
+		case 1:
+		{
+			a.intersect_with(b, pool, grain);
+			std::map<int, long long> result;
+			for (const auto& item : ma) { if (mb.count(item.first)) { result.insert(item); } }
+			CheckTree(a, result);
+			CheckTree(b, mb);
+			break;
+		}
+		default:
+		{
+			a.difference_with(b, pool, grain);
+			std::map<int, long long> result;
+			for (const auto& item : ma) { if (!mb.count(item.first)) { result.insert(item); } }
+			CheckTree(a, result);
+			CheckTree(b, mb);
+			break;
+		}
+		}
+	}
+}
+
+//记录存活的对象数,拷贝构造可以在指定的次数时抛出异常
+struct Counted
+{
+	static std::atomic<int> live;			//存活的对象数
+	static std::atomic<int> throwAfter;		//大于0时每次拷贝减1,减到0的那次拷贝抛出异常
+	long long value;
+	Counted(long long value = 0) : value(value) { live++; }
+	Counted(const Counted& other) : value(other.value)
+	{
+		if (throwAfter.load() > 0 && --throwAfter == 0) { throw std::runtime_error("copy"); }
+		live++;
+	}
+	Counted& operator=(const Counted& other) { value = other.value; return *this; }
+	~Counted() { live--; }
+};
+std::atomic<int> Counted::live(0);
+std::atomic<int> Counted::throwAfter(0);
+
+//并行批量构造时第failAt个节点构造失败:已经构造的子树被析构,所有节点归还,树保持为空
+template<class Tree>
+void BuildFailure(TaskPool& pool)
+{
+	std::vector<std::pair<int, Counted>> items;
+	for (int i = 0; i < 5000; i++) { items.emplace_back(i, Counted(i)); }
+	int live = Counted::live.load();
+	for (int failAt : { 1, 7, 2500, 4999, 5000 })
+	{
+		Counted::throwAfter = failAt;
+		Tree tree;
+		bool thrown = false;
+		try
+		{
+			tree.build_from_sorted(items.begin(), items.end(), pool, 16);
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		assert(thrown && TreeTestAccess::root(tree) == nullptr && TreeTestAccess::nodeSize(tree) == 0);
+		assert(Counted::live.load() == live);
+	}
+	Counted::throwAfter = 0;
+	Tree tree;
+	tree.build_from_sorted(items.begin(), items.end(), pool, 16);
+	assert(TreeTestAccess::nodeSize(tree) == 5000 && Counted::live.load() == live + 5000);
+	CheckShape(tree);
+}
+
+int main()
+{
+	for (size_t workers : { 0, 1, 3 })
+	{
+		TaskPool pool(workers);
+		assert(pool.worker_count() == workers);
+		ForkJoin(pool);
+		RandomOperations<SumRBT>(pool, unsigned(1 + workers), 24);
+		RandomOperations<SumAVL>(pool, unsigned(2 + workers), 24);
+		BuildFailure<RBT<int, Counted>>(pool);
+		BuildFailure<AVL<int, Counted>>(pool);
+	}
+	assert(Counted::live.load() == 0);
+	std::printf("parallel_set_operations_test passed\n");
+	return 0;
+}
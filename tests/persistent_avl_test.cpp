@@ -0,0 +1,206 @@
+﻿//PersistentAVL的测试:随机修改和std::map比较,检查每个版本的AVL结构;
+//之前取得的快照和Insert/Delete的原版本保持不变,新版本只新建O(logn)个节点,其余和旧版本共享;
+//val的拷贝抛出异常时版本不变、没有泄漏;没有其他版本时每个节点的引用计数为1,所有版本析构后val全部释放;
+//不同线程同时遍历和析构共享节点的版本
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -pthread -I.. persistent_avl_test.cpp -o persistent_avl_test
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "PersistentAVL.h"
+#include "TreeCheck.h"
+
+//记录存活的对象数,拷贝构造可以在指定的次数时抛出异常
+struct Counted
+{
+	static std::atomic<int> live;			//存活的对象数
+	static std::atomic<int> throwAfter;		//大于0时每次拷贝减1,减到0的那次拷贝抛出异常
+	int value;
+	Counted(int value = 0) : value(value) { live++; }
+	Counted(const Counted& other) : value(other.value)
+	{
+		if (throwAfter.load() > 0 && --throwAfter == 0) { throw std::runtime_error("copy"); }
+		live++;
+	}
+	Counted(Counted&& other) noexcept : value(other.value) { live++; }
+	Counted& operator=(const Counted& other) { value = other.value; return *this; }
+	~Counted() { live--; }
+};
+std::atomic<int> Counted::live(0);
+std::atomic<int> Counted::throwAfter(0);
+
+using Version = PersistentAVL<int, Counted>;
+using Node = PersistentNode<int, Counted>;
+
+void Collect(const Node* node, std::set<const Node*>& nodes)
+{
+	if (node == nullptr) { return; }
+	nodes.insert(node);
+	Collect(node->left, nodes);
+	Collect(node->right, nodes);
+}
+
+//没有其他版本引用时,每个节点只被它的父节点(或者版本的根)引用
+void CheckUnshared(const Node* node)
+{
+	if (node == nullptr) { return; }
+	assert(node->refs.load() == 1);
+	CheckUnshared(node->left);
+	CheckUnshared(node->right);
+}
+
+void CheckContents(const Version& version, const std::map<int, int>& expected)
+{
+	CheckHeights(TreeTestAccess::root(version));
+	assert(version.getNodeSize() == int(expected.size()));
+	std::vector<std::pair<int, int>> items;
+	version.inOrder([&items](const Node* node) { items.emplace_back(node->key, node->val.value); });
+	assert(items == (std::vector<std::pair<int, int>>(expected.begin(), expected.end())));
+	if (expected.empty()) { assert(version.GetMinNode() == nullptr && version.GetMaxNode() == nullptr); }
+	else
+	{
+		assert(version.GetMinNode()->key == expected.begin()->first);
+		assert(version.GetMaxNode()->key == expected.rbegin()->first);
+	}
+}
+
+void RandomOperations(unsigned seed)
+{
+	std::mt19937 random(seed);
+	{
+		Version current;
+		std::map<int, int> expected;
+		std::vector<std::pair<Version, std::map<int, int>>> snapshots;
+		for (int i = 0; i < 4000; i++)
+		{
+			int key = int(random() % 1500);
+			switch (random() % 8)
+			{
+			case 0:
+			case 1:
+			case 2:
+				assert(current.insert_or_assign(key, Counted(i)) == expected.insert_or_assign(key, i).second);
+				break;
+			case 3:
+				assert(current.try_insert(key, Counted(i)) == expected.emplace(key, i).second);
+				break;
+			case 4:
+			case 5:
+				assert(current.erase(key) == (expected.erase(key) != 0));
+				break;
+			case 6:
+			{
+				//Insert/Delete返回新版本,原版本不变;新版本只新建从根到key的路径(加上旋转)上的节点
+				std::set<const Node*> before;
+				Collect(TreeTestAccess::root(current), before);
+				int height = current.GetHeight();
+				Version next = random() % 2 ? current.Insert(key, Counted(-i)) : current.Delete(key);
+				CheckContents(current, expected);
+				CheckHeights(TreeTestAccess::root(next));
+				std::set<const Node*> after;
+				Collect(TreeTestAccess::root(next), after);
+				int created = 0;
+				for (const Node* node : after) { created += before.count(node) == 0 ? 1 : 0; }
+				assert(created <= height + 2);
+				break;
+			}
+			default:
+			{
+				//val的拷贝在复制路径的中途抛出异常:版本不变,新建的节点全部释放
+				Counted::throwAfter = 1 + int(random() % 6);
+				const Node* root = TreeTestAccess::root(current);
+				int live = Counted::live.load();
+				try
+				{
+					Version next = random() % 2 ? current.Insert(key, Counted(i)) : current.Delete(key);
+					Counted::throwAfter = 0;
+				}
+				catch (const std::runtime_error&)
+				{
+					assert(TreeTestAccess::root(current) == root && Counted::live.load() == live);
+				}
+				break;
+			}
+			}
+			const Node* node = current.GetNode(key);
+			assert(expected.count(key) ? node != nullptr && node->val.value == expected[key] : node == nullptr);
+			int probe = int(random() % 1600) - 50;
+			assert(current.Search(probe) == (expected.count(probe) != 0));
+			const Node* floor = current.floor(probe);
+			auto upper = expected.upper_bound(probe);
+			assert(upper == expected.begin() ? floor == nullptr : floor != nullptr && floor->key == std::prev(upper)->first);
+			const Node* ceil = current.ceiling(probe);
+			auto lower = expected.lower_bound(probe);
+			assert(lower == expected.end() ? ceil == nullptr : ceil != nullptr && ceil->key == lower->first);
+			if (i % 100 == 0)
+			{
+				CheckContents(current, expected);
+				std::vector<int> keys;
+				current.range(probe, probe + 200, [&keys](const Node* item) { keys.push_back(item->key); });
+				std::vector<int> wanted;
+				for (auto it = lower; it != expected.lower_bound(probe + 200); ++it) { wanted.push_back(it->first); }
+				assert(keys == wanted);
+			}
+			if (i % 400 == 0) { snapshots.emplace_back(current.snapshot(), expected); }
+		}
+		//快照看到的是取得时的内容
+		for (const auto& item : snapshots) { CheckContents(item.first, item.second); }
+		//快照都析构之后,当前版本的节点不再和其他版本共享
+		snapshots.clear();
+		CheckUnshared(TreeTestAccess::root(current));
+		//拷贝和移动
+		Version copy = current;
+		assert(TreeTestAccess::root(copy) == TreeTestAccess::root(current) && TreeTestAccess::root(current)->refs.load() == 2);
+		Version moved = std::move(copy);
+		assert(TreeTestAccess::root(copy) == nullptr && copy.getNodeSize() == 0 && TreeTestAccess::root(moved) == TreeTestAccess::root(current));
+		moved.Clear();
+		current.Clear();
+		assert(current.getNodeSize() == 0 && current.GetHeight() == 0);
+	}
+	assert(Counted::live.load() == 0);
+}
+
+//多个线程各自持有共享节点的版本,同时遍历并析构,主线程继续修改
+void SharedAcrossThreads(int threads)
+{
+	{
+		Version current;
+		for (int key = 0; key < 3000; key++) { current.insert_or_assign(key, Counted(key)); }
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; t++)
+		{
+			workers.emplace_back([version = current.snapshot(), t]() mutable
+			{
+				for (int round = 0; round < 3; round++)
+				{
+					long long sum = 0;
+					version.inOrder([&sum](const Node* node) { sum += node->val.value; });
+					assert(sum == 3000LL * 2999 / 2);
+					//局部的修改只影响这个线程的版本
+					Version local = version.Delete(t).Insert(t, Counted(t));
+					assert(local.getNodeSize() == 3000);
+				}
+				version = Version();
+			});
+		}
+		for (int key = 0; key < 3000; key += 2) { current.erase(key); }
+		for (std::thread& worker : workers) { worker.join(); }
+		assert(current.getNodeSize() == 1500);
+		CheckUnshared(TreeTestAccess::root(current));
+	}
+	assert(Counted::live.load() == 0);
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 2; seed++) { RandomOperations(seed); }
+	SharedAcrossThreads(3);
+	std::printf("persistent_avl_test passed\n");
+	return 0;
+}
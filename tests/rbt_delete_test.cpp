@@ -0,0 +1,107 @@
+﻿//RBT删除的回归测试:随机的Delete、erase(it)、erase(first, last)、erase_range和插入交替进行,
+//每次修改后检查红黑树的性质(颜色、黑高、父节点指针)、OrderStatistic的子树大小,并和std::map比较内容
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. rbt_delete_test.cpp -o rbt_delete_test
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+#include "RBTree.h"
+#include "TreeCheck.h"
+
+template<class Tree>
+void CheckTree(Tree& tree, const std::map<int, int>& expected)
+{
+	CheckRB(TreeTestAccess::root(tree));
+	assert(tree.getNodeSize() == int(expected.size()));
+	CheckSameAsMap(tree, expected);
+}
+
+template<class Tree>
+void CheckTreeSizes(Tree& tree)
+{
+	using Node = typename std::remove_pointer<std::decay_t<decltype(TreeTestAccess::root(tree))>>::type;
+	CheckSizes(TreeTestAccess::root(tree), [](const Node* node) { return node->left; }, [](const Node* node) { return node->right; });
+}
+
+//keyRange个不同的key上的随机操作
+template<class Tree, bool CheckOrderStatistic = false>
+void RandomOperations(unsigned seed, int keyRange, int operations)
+{
+	std::mt19937 random(seed);
+	Tree tree;
+	std::map<int, int> expected;
+	for (int i = 0; i < operations; i++)
+	{
+		int key = int(random() % keyRange);
+		switch (random() % 6)
+		{
+		case 0:
+		case 1:
+			tree.Insert(key, i);
+			expected[key] = i;
+			break;
+		case 2:
+			tree.Delete(key);
+			expected.erase(key);
+			break;
+		case 3:
+		{
+			//erase(it)返回下一个位置,指向其他节点的迭代器不受影响
+			auto it = tree.lower_bound(key);
+			if (it == tree.end()) { break; }
+			auto other = tree.begin();
+			if (other == it) { ++other; }
+			const auto* otherNode = other == tree.end() ? nullptr : &*other;
+			auto expectedIt = expected.erase(expected.find(it->key));
+			auto next = tree.erase(it);
+			assert(expectedIt == expected.end() ? next == tree.end() : next->key == expectedIt->first);
+			if (otherNode != nullptr) { assert(tree.GetNode(otherNode->key) == otherNode); }
+			break;
+		}
+		case 4:
+		{
+			//erase(first, last),last有时为end()
+			int hi = key + int(random() % 20);
+			auto first = tree.lower_bound(key);
+			auto last = random() % 4 == 0 ? tree.end() : tree.lower_bound(hi);
+			auto expectedLast = last == tree.end() ? expected.end() : expected.lower_bound(hi);
+			expected.erase(expected.lower_bound(key), expectedLast);
+			auto result = tree.erase(first, last);
+			assert(result == last);
+			break;
+		}
+		default:
+		{
+			int hi = key + int(random() % 20);
+			tree.erase_range(key, hi);
+			expected.erase(expected.lower_bound(key), expected.lower_bound(hi));
+			break;
+		}
+		}
+		CheckTree(tree, expected);
+		if constexpr (CheckOrderStatistic) { CheckTreeSizes(tree); }
+	}
+	//删空
+	while (tree.getNodeSize() != 0)
+	{
+		tree.Delete(tree.GetMinNode()->key);
+		CheckRB(TreeTestAccess::root(tree));
+	}
+	assert(TreeTestAccess::root(tree) == nullptr);
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 4; seed++)
+	{
+		RandomOperations<RBT<int, int>>(seed, 300, 20000);
+		RandomOperations<RBT<int, int, std::less<int>, NodePool<std::pair<const int, int>>, OrderStatistic>, true>(seed, 300, 20000);
+	}
+	//较大的树:删除会经过更多层的调整
+	RandomOperations<RBT<int, int>>(7, 20000, 60000);
+	std::printf("rbt_delete_test passed\n");
+	return 0;
+}
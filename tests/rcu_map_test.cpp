@@ -0,0 +1,222 @@
+﻿//RCUMap的测试
+//单线程:随机操作和std::map比较,检查每个版本的AVL结构;val的拷贝抛出异常时旧版本不变、没有泄漏;
+//没有读者时被替换的节点会及时回收,析构后所有val都被释放
+//多线程:读者在range中停住时写者替换掉所有节点,读者看到的旧版本不能被释放(用std::allocator,释放过早时ASan会报告);
+//读写线程同时运行时读者每次看到的都是有序的、val和key一致的版本,结束后每个写者负责的key和它自己的std::map一致
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -pthread -I.. rcu_map_test.cpp -o rcu_map_test
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "RCUMap.h"
+#include "TreeCheck.h"
+
+//记录存活的对象数,拷贝构造可以在指定的次数时抛出异常
+struct Counted
+{
+	static std::atomic<int> live;			//存活的对象数
+	static std::atomic<int> throwAfter;		//大于0时每次拷贝减1,减到0的那次拷贝抛出异常
+	int value;
+	Counted(int value = 0) : value(value) { live++; }
+	Counted(const Counted& other) : value(other.value)
+	{
+		if (throwAfter.load() > 0 && --throwAfter == 0) { throw std::runtime_error("copy"); }
+		live++;
+	}
+	Counted(Counted&& other) noexcept : value(other.value) { live++; }
+	Counted& operator=(const Counted& other) { value = other.value; return *this; }
+	~Counted() { live--; }
+	bool operator==(const Counted& other) const { return value == other.value; }
+};
+std::atomic<int> Counted::live(0);
+std::atomic<int> Counted::throwAfter(0);
+
+template<class Map>
+void CheckContents(const Map& map, const std::map<int, int>& expected)
+{
+	CheckHeights(TreeTestAccess::root(map).load());
+	assert(map.getNodeSize() == int(expected.size()));
+	std::vector<std::pair<int, int>> items;
+	map.range(-1000000, 1000000, [&items](int key, const Counted& val) { items.emplace_back(key, val.value); });
+	assert(items == (std::vector<std::pair<int, int>>(expected.begin(), expected.end())));
+}
+
+void SingleThread(unsigned seed)
+{
+	std::mt19937 random(seed);
+	{
+		RCUMap<int, Counted> map;
+		std::map<int, int> expected;
+		for (int i = 0; i < 8000; i++)
+		{
+			int key = int(random() % 1500);
+			if (random() % 10 == 0)
+			{
+				//第几次拷贝时抛出异常:可能在复制路径的中途,也可能不抛出
+				Counted::throwAfter = 1 + int(random() % 12);
+				int live = Counted::live.load();
+				const auto* root = TreeTestAccess::root(map).load();
+				try
+				{
+					if (random() % 2) { map.insert_or_assign(key, Counted(i)); }
+					else { map.Delete(key); }
+					Counted::throwAfter = 0;
+				}
+				catch (const std::runtime_error&)
+				{
+					//失败的修改不发布新版本,新建的节点全部释放
+					assert(TreeTestAccess::root(map).load() == root && Counted::live.load() == live);
+					continue;
+				}
+				//没有抛出异常:和普通的修改一样更新期望的结果
+				if (map.Search(key)) { expected[key] = map.Get(key)->value; }
+				else { expected.erase(key); }
+			}
+			else
+			{
+				switch (random() % 4)
+				{
+				case 0:
+				case 1:
+					assert(map.insert_or_assign(key, Counted(i)) == expected.insert_or_assign(key, i).second);
+					break;
+				case 2:
+					assert(map.try_insert(key, Counted(i)) == expected.emplace(key, i).second);
+					break;
+				default:
+					assert(map.Delete(key) == (expected.erase(key) != 0));
+					break;
+				}
+			}
+			int probe = int(random() % 1600) - 50;
+			auto found = map.Get(probe);
+			assert(expected.count(probe) ? found && found->value == expected[probe] : !found);
+			auto ceil = map.ceiling(probe);
+			auto lower = expected.lower_bound(probe);
+			assert(lower == expected.end() ? !ceil : ceil && ceil->first == lower->first && ceil->second.value == lower->second);
+			auto floor = map.floor(probe);
+			auto upper = expected.upper_bound(probe);
+			assert(upper == expected.begin() ? !floor : floor && floor->first == std::prev(upper)->first);
+			//没有读者:等待回收的节点不会超过回收的阈值加上一次修改替换的节点
+			assert(Counted::live.load() <= map.getNodeSize() + int(TreeTestAccess::collectThreshold<decltype(map)>()) + 64);
+			if (i % 100 == 0)
+			{
+				CheckContents(map, expected);
+				auto items = map.range_copy(probe, probe + 200);
+				assert(items.size() == size_t(std::distance(expected.lower_bound(probe), expected.lower_bound(probe + 200))));
+			}
+		}
+		CheckContents(map, expected);
+		map.Clear();
+		assert(map.getNodeSize() == 0 && TreeTestAccess::root(map).load() == nullptr);
+		for (int key = 0; key < 100; key++) { map.Insert(key, Counted(key)); }
+	}
+	assert(Counted::live.load() == 0);
+}
+
+using StringMap = RCUMap<int, std::string, std::less<int>, std::allocator<std::pair<const int, std::string>>>;
+
+//读者停在range中间时,写者替换掉所有节点并触发回收,读者继续扫描旧版本
+void ReaderBlocksReclamation()
+{
+	StringMap map;
+	const int Count = 1000;
+	for (int key = 0; key < Count; key++) { map.Insert(key, "old" + std::to_string(key)); }
+	std::atomic<int> stage(0);
+	std::thread reader([&map, &stage, Count]()
+	{
+		int seen = 0;
+		map.range(0, Count, [&](int key, const std::string& val)
+		{
+			if (seen == 0)
+			{
+				stage = 1;
+				while (stage.load() != 2) { std::this_thread::yield(); }
+				//嵌套的读操作看到的是新版本
+				assert(*map.Get(key) == "new" + std::to_string(key));
+			}
+			assert(key == seen && val == "old" + std::to_string(key));
+			seen++;
+		});
+		assert(seen == Count);
+	});
+	while (stage.load() != 1) { std::this_thread::yield(); }
+	for (int key = 0; key < Count; key++) { map.Insert(key, "new" + std::to_string(key)); }
+	//被替换的节点远超回收阈值,但是读者还在,一个都不能释放
+	assert(TreeTestAccess::retired(map).size() >= size_t(Count));
+	stage = 2;
+	reader.join();
+	//读者离开后下一次回收就能释放它们
+	for (int i = 0; i < int(TreeTestAccess::collectThreshold<StringMap>()); i++) { map.Insert(i, "new" + std::to_string(i)); }
+	assert(TreeTestAccess::retired(map).size() < TreeTestAccess::collectThreshold<StringMap>() + 64);
+}
+
+//读写线程同时运行,写者w负责key % writers == w的key
+void ConcurrentReadersAndWriters(int readers, int writers, int operations)
+{
+	StringMap map;
+	std::vector<std::map<int, std::string>> expected(writers);
+	std::atomic<int> writersLeft(writers);
+	std::vector<std::thread> threads;
+	for (int w = 0; w < writers; w++)
+	{
+		threads.emplace_back([&, w]()
+		{
+			std::mt19937 random(200 + w);
+			for (int i = 0; i < operations; i++)
+			{
+				int key = int(random() % 500) * writers + w;
+				if (random() % 3 == 0)
+				{
+					assert(map.Delete(key) == (expected[w].erase(key) != 0));
+				}
+				else
+				{
+					std::string val = std::to_string(key) + "/" + std::to_string(i);
+					map.Insert(key, val);
+					expected[w][key] = val;
+				}
+			}
+			writersLeft--;
+		});
+	}
+	for (int r = 0; r < readers; r++)
+	{
+		threads.emplace_back([&]()
+		{
+			do
+			{
+				int last = -1;
+				map.range(0, 1 << 30, [&last](int key, const std::string& val)
+				{
+					assert(key > last && val.compare(0, val.find('/'), std::to_string(key)) == 0);
+					last = key;
+				});
+				auto items = map.range_copy(100, 300);
+				for (const auto& item : items) { assert(item.first >= 100 && item.first < 300); }
+			} while (writersLeft.load() > 0);
+		});
+	}
+	for (std::thread& thread : threads) { thread.join(); }
+	std::map<int, std::string> all;
+	for (const auto& part : expected) { all.insert(part.begin(), part.end()); }
+	CheckHeights(TreeTestAccess::root(map).load());
+	assert(map.getNodeSize() == int(all.size()));
+	assert(map.range_copy(0, 1 << 30) == (std::vector<std::pair<int, std::string>>(all.begin(), all.end())));
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 2; seed++) { SingleThread(seed); }
+	ReaderBlocksReclamation();
+	ConcurrentReadersAndWriters(2, 2, 3000);
+	std::printf("rcu_map_test passed\n");
+	return 0;
+}
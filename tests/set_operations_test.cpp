@@ -0,0 +1,233 @@
+﻿//RBT和AVL的join/split集合运算的测试:随机的两棵树做union_with/intersect_with/difference_with/erase_range/split/join,
+//和std::map比较,检查结果的平衡性质和SumAggregate的聚合值;两棵树的大小相差很大、共享或不共享分配器的情况都会出现
+//OrderStatistic的树在split/join/union_with之后节点数和rank/select仍然正确
+//分配器相等时join/union_with直接接过对方的节点(节点地址不变)
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. set_operations_test.cpp -o set_operations_test
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "RBTree.h"
+#include "AVLTree.h"
+#include "TreeCheck.h"
+
+using Sum = SumAggregate<long long>;
+using Pool = NodePool<std::pair<const int, long long>>;
+using SumRBT = RBT<int, long long, std::less<int>, Pool, Sum>;
+using SumAVL = AVL<int, long long, std::less<int>, Pool, Sum>;
+
+//平衡性质和聚合值
+template<class K, class V, class Compare, class Alloc, class Augment>
+void CheckShape(const RBT<K, V, Compare, Alloc, Augment>& tree)
+{
+	using Node = RBTNode<K, V, Augment>;
+	CheckRB(TreeTestAccess::root(tree));
+	CheckAggregate<Augment>(TreeTestAccess::root(tree), [](const Node* node) { return node->left; }, [](const Node* node) { return node->right; });
+}
+
+template<class K, class V, class Compare, class Alloc, class Augment>
+void CheckShape(const AVL<K, V, Compare, Alloc, Augment>& tree)
+{
+	using Node = AVLNode<K, V, Augment>;
+	CheckAVL(TreeTestAccess::root(tree));
+	CheckAggregate<Augment>(TreeTestAccess::root(tree), [](const Node* node) { return node->left(); }, [](const Node* node) { return node->right(); });
+}
+
+template<class Tree>
+void CheckTree(Tree& tree, const std::map<int, long long>& expected)
+{
+	CheckShape(tree);
+	assert(TreeTestAccess::nodeSize(tree) == int(expected.size()));
+	CheckSameAsMap(tree, expected);
+}
+
+template<class Tree>
+void RandomOperations(unsigned seed, int rounds)
+{
+	std::mt19937 random(seed);
+	for (int round = 0; round < rounds; round++)
+	{
+		//大小相差很大的两棵树,key的范围有时很小(大量重复的key)
+		Tree a;
+		Tree b;
+		std::map<int, long long> ma;
+		std::map<int, long long> mb;
+		int keyRange = 1 + int(random() % 5000);
+		int sizeA = int(random() % (round % 7 == 0 ? 3000 : 200));
+		int sizeB = int(random() % (round % 5 == 0 ? 3000 : 200));
+		for (int i = 0; i < sizeA; i++)
+		{
+			int key = int(random() % keyRange);
+			long long val = random() % 100;
+			a.Insert(key, val);
+			ma[key] = val;
+		}
+		//一半的轮次中b由a的split得到,和a共享分配器,节点可以直接接过来
+		if (round % 2)
+		{
+			a.split(1 << 30, b);
+			assert(TreeTestAccess::alloc(b) == TreeTestAccess::alloc(a) && TreeTestAccess::nodeSize(b) == 0);
+		}
+		for (int i = 0; i < sizeB; i++)
+		{
+			int key = int(random() % keyRange);
+			long long val = 1000 + random() % 100;
+			b.Insert(key, val);
+			mb[key] = val;
+		}
+		switch (round % 5)
+		{
+		case 0:
+			//key相同时保留b的val,b被清空
+			a.union_with(b);
+			for (const auto& item : mb) { ma[item.first] = item.second; }
+			CheckTree(a, ma);
+			assert(TreeTestAccess::root(b) == nullptr && TreeTestAccess::nodeSize(b) == 0);
+			//清空的b仍然可以使用
+			b.Insert(1, 1);
+			assert(TreeTestAccess::nodeSize(b) == 1);
+			break;
+		case 1:
+		{
+			a.intersect_with(b);
+			std::map<int, long long> result;
+			for (const auto& item : ma) { if (mb.count(item.first)) { result.insert(item); } }
+			CheckTree(a, result);
+			CheckTree(b, mb);
+			break;
+		}
+		case 2:
+		{
+			a.difference_with(b);
+			std::map<int, long long> result;
+			for (const auto& item : ma) { if (!mb.count(item.first)) { result.insert(item); } }
+			CheckTree(a, result);
+			CheckTree(b, mb);
+			break;
+		}
+		case 3:
+		{
+			int lo = int(random() % keyRange);
+			int hi = lo + int(random() % (keyRange / 2 + 1));
+			a.erase_range(lo, hi);
+			ma.erase(ma.lower_bound(lo), ma.lower_bound(hi));
+			CheckTree(a, ma);
+			a.Insert(lo, 5);
+			ma[lo] = 5;
+			CheckTree(a, ma);
+			break;
+		}
+		default:
+		{
+			//split之后两边各自修改,再join回来
+			int key = int(random() % keyRange);
+			Tree right;
+			a.split(key, right);
+			std::map<int, long long> mr(ma.lower_bound(key), ma.end());
+			ma.erase(ma.lower_bound(key), ma.end());
+			CheckTree(a, ma);
+			CheckTree(right, mr);
+			right.Insert(keyRange + 5, 1);
+			mr[keyRange + 5] = 1;
+			if (!ma.empty())
+			{
+				a.Delete(ma.begin()->first);
+				ma.erase(ma.begin());
+			}
+			a.join(right);
+			ma.insert(mr.begin(), mr.end());
+			CheckTree(a, ma);
+			assert(TreeTestAccess::root(right) == nullptr && TreeTestAccess::nodeSize(right) == 0);
+			break;
+		}
+		}
+	}
+}
+
+//OrderStatistic:split不需要遍历就能得到两边的节点数,rank/select在运算之后仍然正确
+template<class Tree>
+void OrderStatisticSizes()
+{
+	Tree x;
+	for (int i = 0; i < 1000; i++) { x.Insert(i, i); }
+	Tree y;
+	x.split(400, y);
+	assert(TreeTestAccess::nodeSize(x) == 400 && TreeTestAccess::nodeSize(y) == 600);
+	assert(y.rank(1000) == 600 && x.select(399)->key == 399 && y.select(0)->key == 400);
+	x.join(y);
+	assert(TreeTestAccess::nodeSize(x) == 1000);
+	for (int i = 0; i < 1000; i++) { assert(x.select(i)->key == i); }
+	Tree z;
+	for (int i = 500; i < 1500; i += 2) { z.Insert(i, -i); }
+	x.union_with(z);
+	assert(TreeTestAccess::nodeSize(x) == 1250 && x.GetNode(600)->val == -600 && x.rank(100000) == 1250);
+	Tree w;
+	for (int i = 0; i < 1500; i += 3) { w.Insert(i, 0); }
+	x.difference_with(w);
+	assert(TreeTestAccess::nodeSize(x) == int(x.rank(100000)));
+	x.intersect_with(z);
+	assert(TreeTestAccess::nodeSize(x) == int(x.rank(100000)));
+}
+
+//两棵树用同一个NodePool构造时分配器相等:join和union_with直接接过对方的节点,节点的地址不变;
+//分配器不相等时键值被移动到新节点中,结果同样正确
+template<class Tree>
+void AdoptNodes()
+{
+	using Node = std::remove_pointer_t<std::decay_t<decltype(TreeTestAccess::root(std::declval<Tree&>()))>>;
+	Pool pool;
+	Tree a(std::less<int>(), pool);
+	Tree b(std::less<int>(), pool);
+	assert(TreeTestAccess::alloc(a) == TreeTestAccess::alloc(b));
+	std::map<int, const Node*> nodes;
+	for (int i = 0; i < 2000; i++)
+	{
+		Tree& tree = i < 1000 ? a : b;
+		tree.Insert(i, i);
+		nodes[i] = tree.GetNode(i);
+	}
+	a.join(b);
+	assert(TreeTestAccess::root(b) == nullptr && TreeTestAccess::nodeSize(a) == 2000);
+	for (const auto& item : nodes) { assert(a.GetNode(item.first) == item.second); }
+	CheckShape(a);
+	//key交错、互不相同的两棵树合并
+	Tree c(std::less<int>(), pool);
+	for (int i = 2000; i < 6000; i += 2)
+	{
+		c.Insert(i + 1, i);
+		nodes[i + 1] = c.GetNode(i + 1);
+		a.Insert(i, i);
+		nodes[i] = a.GetNode(i);
+	}
+	a.union_with(c);
+	assert(TreeTestAccess::root(c) == nullptr && TreeTestAccess::nodeSize(a) == 6000);
+	for (const auto& item : nodes) { assert(a.GetNode(item.first) == item.second); }
+	CheckShape(a);
+	//各自默认构造的分配器不相等
+	Tree d;
+	for (int i = 6000; i < 7000; i++) { d.Insert(i, i); }
+	assert(!(TreeTestAccess::alloc(a) == TreeTestAccess::alloc(d)));
+	a.join(d);
+	assert(TreeTestAccess::root(d) == nullptr && TreeTestAccess::nodeSize(a) == 7000);
+	for (int i = 0; i < 7000; i++) { assert(a.GetNode(i)->key == i); }
+	CheckShape(a);
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 2; seed++)
+	{
+		RandomOperations<SumRBT>(seed, 200);
+		RandomOperations<SumAVL>(seed, 200);
+	}
+	AdoptNodes<SumRBT>();
+	AdoptNodes<SumAVL>();
+	OrderStatisticSizes<RBT<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, OrderStatistic>>();
+	OrderStatisticSizes<AVL<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, OrderStatistic>>();
+	std::printf("set_operations_test passed\n");
+	return 0;
+}
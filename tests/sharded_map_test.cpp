@@ -0,0 +1,219 @@
+﻿//ShardedMap的测试
+//单线程:随机操作和std::map比较,中途用set_splits/rebalance重新划分(包括空分片和重复的分割点),
+//检查每个分片的key都在自己的范围内、每个分片都是合法的红黑树,跨分片的有序查询、范围访问和聚合值
+//多线程:写线程各自负责一部分key,读线程扫描整个表,另一个线程反复rebalance,结束后和每个写者自己的std::map一致
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -pthread -I.. sharded_map_test.cpp -o sharded_map_test
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ShardedMap.h"
+#include "TreeCheck.h"
+
+using SumMap = ShardedMap<int, long long, std::less<int>, NodePool<std::pair<const int, long long>>, SumAggregate<long long>>;
+
+//分片i中的key都在[splits[i - 1], splits[i])中
+template<class Map>
+void CheckShards(const Map& map, const std::map<int, long long>& expected)
+{
+	assert(TreeTestAccess::shards(map).size() == TreeTestAccess::splits(map).size() + 1);
+	for (size_t i = 1; i < TreeTestAccess::splits(map).size(); i++) { assert(TreeTestAccess::splits(map)[i - 1] < TreeTestAccess::splits(map)[i]); }
+	int total = 0;
+	for (size_t i = 0; i < TreeTestAccess::shards(map).size(); i++)
+	{
+		const auto& tree = TreeTestAccess::shards(map)[i]->tree;
+		CheckRB(TreeTestAccess::root(tree));
+		total += tree.getNodeSize();
+		const auto* minNode = tree.GetMinNode();
+		const auto* maxNode = tree.GetMaxNode();
+		if (minNode == nullptr) { continue; }
+		if (i > 0) { assert(!(minNode->key < TreeTestAccess::splits(map)[i - 1])); }
+		if (i < TreeTestAccess::splits(map).size()) { assert(maxNode->key < TreeTestAccess::splits(map)[i]); }
+	}
+	assert(total == int(expected.size()) && map.getNodeSize() == total);
+	std::vector<std::pair<int, long long>> items;
+	map.for_each([&items](int key, long long val) { items.emplace_back(key, val); });
+	assert(items == (std::vector<std::pair<int, long long>>(expected.begin(), expected.end())));
+}
+
+void CheckEntry(const std::optional<std::pair<int, long long>>& entry, std::map<int, long long>::const_iterator it, const std::map<int, long long>& expected)
+{
+	if (it == expected.end()) { assert(!entry); }
+	else { assert(entry && entry->first == it->first && entry->second == it->second); }
+}
+
+void SingleThread(unsigned seed)
+{
+	std::mt19937 random(seed);
+	SumMap map(std::vector<int>{ 900, 100, 500, 500 });
+	assert((map.get_splits() == std::vector<int>{ 100, 500, 900 }) && map.shard_count() == 4);
+	std::map<int, long long> expected;
+	for (int i = 0; i < 6000; i++)
+	{
+		int key = int(random() % 1000);
+		switch (random() % 8)
+		{
+		case 0:
+		case 1:
+			map.Insert(key, i);
+			expected[key] = i;
+			break;
+		case 2:
+			assert(map.try_emplace(key, i) == expected.try_emplace(key, i).second);
+			break;
+		case 3:
+			assert(map.insert_or_assign(key, i) == expected.insert_or_assign(key, i).second);
+			break;
+		case 4:
+			map.Delete(key);
+			expected.erase(key);
+			break;
+		case 5:
+		{
+			bool found = map.update(key, [](long long& val) { val *= 2; });
+			assert(found == (expected.count(key) != 0));
+			if (found) { expected[key] *= 2; }
+			break;
+		}
+		case 6:
+			if (random() % 4 == 0)
+			{
+				//可能跨越多个分片
+				int hi = key + int(random() % 300);
+				map.erase_range(key, hi);
+				expected.erase(expected.lower_bound(key), expected.lower_bound(hi));
+			}
+			break;
+		default:
+			if (random() % 30 == 0)
+			{
+				switch (random() % 3)
+				{
+				case 0:
+				{
+					//随机的分割点,可能有重复和空分片
+					std::vector<int> points;
+					for (int p = int(random() % 6); p > 0; p--) { points.push_back(int(random() % 1100) - 50); }
+					map.set_splits(points);
+					break;
+				}
+				case 1:
+					map.rebalance(1 + random() % 8, 64);
+					break;
+				default:
+				{
+					//按即将写入的key的样本划分
+					std::vector<int> sample;
+					for (int s = 0; s < 100; s++) { sample.push_back(int(random() % 200) + 400); }
+					map.rebalance(sample, 4);
+					break;
+				}
+				}
+				CheckShards(map, expected);
+			}
+			break;
+		}
+		int probe = int(random() % 1100) - 50;
+		auto found = map.Get(probe);
+		assert(expected.count(probe) ? found && *found == expected[probe] : !found);
+		assert(map.Search(probe) == (expected.count(probe) != 0));
+		auto lower = expected.lower_bound(probe);
+		auto upper = expected.upper_bound(probe);
+		CheckEntry(map.ceiling(probe), lower, expected);
+		CheckEntry(map.floor(probe), upper == expected.begin() ? expected.end() : std::prev(upper), expected);
+		CheckEntry(map.GetMin(), expected.begin(), expected);
+		CheckEntry(map.GetMax(), expected.empty() ? expected.end() : std::prev(expected.end()), expected);
+		if (i % 50 == 0)
+		{
+			int hi = probe + int(random() % 400);
+			auto items = map.range_copy(probe, hi);
+			assert(items == (std::vector<std::pair<int, long long>>(expected.lower_bound(probe), expected.lower_bound(hi))));
+			long long sum = 0;
+			for (const auto& item : items) { sum += item.second; }
+			assert(map.reduce(probe, hi) == sum);
+			sum = 0;
+			for (const auto& item : expected) { sum += item.second; }
+			assert(map.reduce() == sum);
+			CheckShards(map, expected);
+		}
+	}
+	CheckShards(map, expected);
+	size_t shards = map.shard_count();
+	map.Clear();
+	assert(map.getNodeSize() == 0 && map.shard_count() == shards && !map.GetMin());
+}
+
+//写者w负责key % writers == w的key
+void ConcurrentOperations(int readers, int writers, int operations)
+{
+	ShardedMap<int, int> map(std::vector<int>{ 1000, 2000, 3000 });
+	std::vector<std::map<int, int>> expected(writers);
+	std::atomic<int> writersLeft(writers);
+	std::vector<std::thread> threads;
+	for (int w = 0; w < writers; w++)
+	{
+		threads.emplace_back([&, w]()
+		{
+			std::mt19937 random(300 + w);
+			for (int i = 0; i < operations; i++)
+			{
+				int key = int(random() % 1000) * writers + w;
+				if (random() % 3 == 0)
+				{
+					map.Delete(key);
+					expected[w].erase(key);
+				}
+				else
+				{
+					map.Insert(key, key + i);
+					expected[w][key] = key + i;
+				}
+			}
+			writersLeft--;
+		});
+	}
+	for (int r = 0; r < readers; r++)
+	{
+		threads.emplace_back([&]()
+		{
+			do
+			{
+				int last = -1;
+				map.for_each([&last](int key, int val)
+				{
+					assert(key > last && val >= key);
+					last = key;
+				});
+				auto entry = map.ceiling(1500);
+				assert(!entry || entry->first >= 1500);
+			} while (writersLeft.load() > 0);
+		});
+	}
+	threads.emplace_back([&]()
+	{
+		for (size_t shardCount = 2; writersLeft.load() > 0; shardCount = shardCount % 6 + 1)
+		{
+			map.rebalance(shardCount, 128);
+			std::this_thread::yield();
+		}
+	});
+	for (std::thread& thread : threads) { thread.join(); }
+	std::map<int, long long> all;
+	for (const auto& part : expected) { all.insert(part.begin(), part.end()); }
+	std::map<int, long long> contents;
+	map.for_each([&contents](int key, int val) { contents[key] = val; });
+	assert(contents == all);
+	for (const auto& shard : TreeTestAccess::shards(map)) { CheckRB(TreeTestAccess::root(shard->tree)); }
+}
+
+int main()
+{
+	for (unsigned seed = 1; seed <= 2; seed++) { SingleThread(seed); }
+	ConcurrentOperations(2, 3, 4000);
+	std::printf("sharded_map_test passed\n");
+	return 0;
+}
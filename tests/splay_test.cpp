@@ -0,0 +1,161 @@
+﻿//SPLAY的测试:各种读伸展策略下随机的插入/删除/查找和std::map比较,检查伸展后被访问的节点在根,
+//不伸展的读操作不修改树,有序查询和范围访问,以及退化成长链之后的遍历、求高度和清空(不能递归)
+//编译: g++ -std=c++17 -g -fsanitize=address,undefined -I.. splay_test.cpp -o splay_test
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SPLAYTree.h"
+#include "TreeCheck.h"
+
+//有序查询和范围访问(都不伸展,不改变根)
+template<class Tree>
+void CheckQueries(const Tree& tree, const std::map<int, int>& expected, int key)
+{
+	const auto* root = TreeTestAccess::root(tree);
+	auto ceil = expected.lower_bound(key);
+	const auto* node = tree.ceiling(key);
+	assert(ceil == expected.end() ? node == nullptr : node != nullptr && node->key == ceil->first);
+	auto floor = expected.upper_bound(key);
+	node = tree.floor(key);
+	assert(floor == expected.begin() ? node == nullptr : node != nullptr && node->key == std::prev(floor)->first);
+	node = tree.peek(key);
+	assert(expected.count(key) ? node != nullptr && node->val == expected.at(key) : node == nullptr);
+	std::vector<std::pair<int, int>> items;
+	tree.range(key, key + 50, [&items](const auto* item) { items.emplace_back(item->key, item->val); });
+	assert(items == (std::vector<std::pair<int, int>>(expected.lower_bound(key), expected.lower_bound(key + 50))));
+	if (expected.empty()) { assert(tree.GetMinNode() == nullptr && tree.GetMaxNode() == nullptr); }
+	else
+	{
+		assert(tree.GetMinNode()->key == expected.begin()->first);
+		assert(tree.GetMaxNode()->key == expected.rbegin()->first);
+	}
+	assert(TreeTestAccess::root(tree) == root);
+}
+
+//period、depth为读操作的伸展策略(见SPLAY::set_splay_period/set_splay_depth)
+template<class Alloc>
+void RandomOperations(unsigned seed, unsigned period, int depth, int operations)
+{
+	using Tree = SPLAY<int, int, std::less<int>, Alloc>;
+	std::mt19937 random(seed);
+	Tree tree;
+	tree.set_splay_period(period);
+	tree.set_splay_depth(depth);
+	std::map<int, int> expected;
+	for (int i = 0; i < operations; i++)
+	{
+		//一半的操作集中在16个热点key上
+		int key = random() % 2 ? int(random() % 16) * 37 : int(random() % 1000);
+		switch (random() % 6)
+		{
+		case 0:
+			tree.Insert(key, i);
+			expected[key] = i;
+			//写操作总是伸展
+			assert(TreeTestAccess::root(tree)->key == key);
+			break;
+		case 1:
+		{
+			auto result = tree.try_emplace(key, i);
+			assert(result.second == (expected.count(key) == 0));
+			expected.emplace(key, i);
+			assert(result.first == TreeTestAccess::root(tree) && result.first->val == expected[key]);
+			break;
+		}
+		case 2:
+			tree[key] += 1;
+			expected[key] += 1;
+			break;
+		case 3:
+			tree.Delete(key);
+			expected.erase(key);
+			break;
+		default:
+		{
+			const auto* root = TreeTestAccess::root(tree);
+			int height = tree.GetHeight();
+			auto* node = tree.GetNode(key);
+			assert(expected.count(key) ? node != nullptr && node->val == expected[key] : node == nullptr);
+			if (period == 1 && depth == 0)
+			{
+				//默认策略:找到的节点(不存在时为最后访问的节点)被转到根
+				assert(TreeTestAccess::root(tree) != nullptr || expected.empty());
+				if (node != nullptr) { assert(TreeTestAccess::root(tree) == node); }
+			}
+			else if (period == 0 || node == nullptr)
+			{
+				//从不伸展,或者没找到时不修改树
+				assert(TreeTestAccess::root(tree) == root && tree.GetHeight() == height);
+			}
+			break;
+		}
+		}
+		assert(tree.getNodeSize() == int(expected.size()));
+		CheckQueries(tree, expected, int(random() % 1100) - 50);
+		if (i % 64 == 0) { CheckSameAsMap(tree, expected); }
+	}
+	CheckSameAsMap(tree, expected);
+	//全部删除
+	for (const auto& item : expected)
+	{
+		assert(tree.Search(item.first));
+		tree.Delete(item.first);
+		assert(!tree.Search(item.first));
+	}
+	assert(tree.getNodeSize() == 0 && TreeTestAccess::root(tree) == nullptr);
+}
+
+//按key递增插入后树是一条链;遍历、求高度和清空都不能递归
+template<class Alloc>
+void LongChain(int count)
+{
+	SPLAY<int, int, std::less<int>, Alloc> tree;
+	std::map<int, int> expected;
+	for (int i = 0; i < count; i++)
+	{
+		tree.Insert(i, -i);
+		expected[i] = -i;
+	}
+	assert(tree.GetHeight() == count);
+	CheckSameAsMap(tree, expected);
+	//访问最小的key把链折起来,高度大约减半
+	assert(tree.Search(0));
+	assert(TreeTestAccess::root(tree)->key == 0 && tree.GetHeight() <= count / 2 + 2);
+	CheckSameAsMap(tree, expected);
+	tree.Clear();
+	assert(tree.getNodeSize() == 0 && tree.GetHeight() == 0);
+	for (int i = count - 1; i >= 0; i--) { tree.Insert(i, i); }
+	assert(tree.GetHeight() == count);
+}
+
+int main()
+{
+	using Pool = NodePool<std::pair<const int, int>>;
+	using Std = std::allocator<std::pair<const int, int>>;
+	for (unsigned seed = 1; seed <= 2; seed++)
+	{
+		RandomOperations<Pool>(seed, 1, 0, 4000);
+		RandomOperations<Pool>(seed, 4, 0, 4000);
+		RandomOperations<Pool>(seed, 1, 3, 4000);
+		RandomOperations<Pool>(seed, 0, 0, 4000);
+		RandomOperations<Std>(seed, 1, 0, 4000);
+	}
+	LongChain<Pool>(100000);
+	LongChain<Std>(100000);
+	//val不能平凡析构时Clear仍然要逐个析构
+	{
+		SPLAY<int, std::string> tree;
+		for (int i = 0; i < 1000; i++) { tree.Insert(i, std::string(40, char('a' + i % 26))); }
+		tree.Delete(500);
+		assert(tree.getNodeSize() == 999 && tree.GetNode(501)->val == std::string(40, char('a' + 501 % 26)));
+		tree.Clear();
+		assert(tree.getNodeSize() == 0);
+	}
+	std::printf("splay_test passed\n");
+	return 0;
+}